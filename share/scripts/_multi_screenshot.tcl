@@ -23,7 +23,107 @@ proc multi_screenshot_helper {acc max {base ""}} {
 	}
 }
 
+set_help_text periodic_screenshot \
+{Take a screenshot every N frames, e.g. for visual regression tests. The
+screenshots are numbered (000000.png, 000001.png, ...) and written in the
+background (see 'screenshot -async'). Tip: this combines well with
+'set renderer headless', then only the captured frames are rendered.
+
+Usage:
+ periodic_screenshot start <frames> <directory> [-raw] [-size <width>] [-with-osd]
+ periodic_screenshot stop    stops, returns the number of written screenshots
+ periodic_screenshot status
+}
+
+variable periodic_after_id ""
+variable periodic_every 0
+variable periodic_directory ""
+variable periodic_options [list]
+variable periodic_frame 0
+variable periodic_count 0
+
+proc periodic_screenshot {subcmd args} {
+	variable periodic_after_id
+	variable periodic_every
+	variable periodic_directory
+	variable periodic_options
+	variable periodic_frame
+	variable periodic_count
+
+	switch -- $subcmd {
+		"start" {
+			if {[llength $args] < 2} {
+				error "Usage: periodic_screenshot start <frames> <directory> \[<screenshot options>\]"
+			}
+			lassign $args every directory
+			if {![string is integer -strict $every] || $every < 1} {
+				error "Expected a positive number of frames, got: $every"
+			}
+			if {$periodic_after_id ne ""} {
+				periodic_screenshot stop
+			}
+			file mkdir $directory
+			set periodic_every $every
+			set periodic_directory $directory
+			set periodic_options [lrange $args 2 end]
+			set periodic_frame 0
+			set periodic_count 0
+			set periodic_after_id [after frame [namespace code periodic_screenshot_helper]]
+			return ""
+		}
+		"stop" {
+			if {$periodic_after_id eq ""} {
+				error "No periodic screenshots in progress"
+			}
+			after cancel $periodic_after_id
+			set periodic_after_id ""
+			return $periodic_count
+		}
+		"status" {
+			if {$periodic_after_id eq ""} {
+				return "idle"
+			}
+			return "writing a screenshot every $periodic_every frames to $periodic_directory ($periodic_count so far)"
+		}
+		default {
+			error "Unknown subcommand: $subcmd, expected one of: start, stop, status"
+		}
+	}
+}
+
+proc periodic_screenshot_helper {} {
+	variable periodic_after_id
+	variable periodic_every
+	variable periodic_directory
+	variable periodic_options
+	variable periodic_frame
+	variable periodic_count
+
+	if {[incr periodic_frame] >= $periodic_every} {
+		set periodic_frame 0
+		set filename [file join $periodic_directory [format "%06d.png" $periodic_count]]
+		if {[catch {::openmsx::internal_screenshot -async {*}$periodic_options $filename} msg]} {
+			set periodic_after_id ""
+			error "Periodic screenshot stopped: $msg"
+		}
+		incr periodic_count
+	}
+	set periodic_after_id [after frame [namespace code periodic_screenshot_helper]]
+}
+
+set_tabcompletion_proc periodic_screenshot [namespace code periodic_screenshot_tab]
+proc periodic_screenshot_tab {args} {
+	if {[llength $args] == 2} {
+		return [list "start" "stop" "status"]
+	}
+	if {[lindex $args 1] eq "start" && [llength $args] > 4} {
+		return [list "-raw" "-size" "-with-osd"]
+	}
+	return [list]
+}
+
 namespace export multi_screenshot
+namespace export periodic_screenshot
 
 } ;# namespace multi_screenshot
 
@@ -44,11 +44,12 @@ screenshot -raw              raw screenshot (of MSX screen only), default -size
 screenshot -with-osd         Include OSD elements in the screenshot
 screenshot -no-sprites       Don't include sprites in the screenshot
 screenshot -guess-name       Guess the name of the running software and use it as prefix
+screenshot -async            Write the PNG file in the background (doesn't stall the emulation)
 }
 
 set_tabcompletion_proc screenshot [namespace code screenshot_tab]
 proc screenshot_tab {args} {
-	list "-prefix" "-raw" "-size" "-with-osd" "-no-sprites" "-guess-name"
+	list "-prefix" "-raw" "-size" "-with-osd" "-no-sprites" "-guess-name" "-async"
 }
 
 namespace export screenshot
@@ -24,6 +24,7 @@
 #include "InfoTopic.hh"
 #include "InputEventGenerator.hh"
 #include "Keyboard.hh"
+#include "MSXCommandController.hh"
 #include "MSXMotherBoard.hh"
 #include "MessageCommand.hh"
 #include "Mixer.hh"
@@ -164,6 +165,17 @@ private:
 	Reactor& reactor;
 };
 
+class CloneMachineCommand final : public Command
+{
+public:
+	CloneMachineCommand(CommandController& commandController, Reactor& reactor);
+	void execute(std::span<const TclObject> tokens, TclObject& result) override;
+	[[nodiscard]] std::string help(std::span<const TclObject> tokens) const override;
+	void tabCompletion(std::vector<std::string>& tokens) const override;
+private:
+	Reactor& reactor;
+};
+
 class SetupCommand final : public Command
 {
 public:
@@ -277,6 +289,8 @@ void Reactor::init()
 		*globalCommandController, *this);
 	restoreMachineCommand = std::make_unique<RestoreMachineCommand>(
 		*globalCommandController, *this);
+	cloneMachineCommand = std::make_unique<CloneMachineCommand>(
+		*globalCommandController, *this);
 	setupCommand = std::make_unique<SetupCommand>(
 		*globalCommandController, *this);
 	getClipboardCommand = std::make_unique<GetClipboardCommand>(
@@ -1110,6 +1124,78 @@ void RestoreMachineCommand::tabCompletion(std::vector<std::string>& tokens) cons
 }
 
 
+// class CloneMachineCommand
+
+CloneMachineCommand::CloneMachineCommand(
+	CommandController& commandController_, Reactor& reactor_)
+	: Command(commandController_, "clone_machine")
+	, reactor(reactor_)
+{
+}
+
+void CloneMachineCommand::execute(std::span<const TclObject> tokens,
+                                  TclObject& result)
+{
+	checkNumArgs(tokens, Between{2, 3}, Prefix{1}, "id ?count?");
+	auto board = reactor.getMachine(tokens[1].getString());
+	int count = (tokens.size() == 3) ? tokens[2].getInt(getInterpreter()) : 1;
+	static constexpr int MAX_COUNT = 256;
+	if ((count < 1) || (count > MAX_COUNT)) {
+		throw CommandException("count must be between 1 and ", MAX_COUNT);
+	}
+
+	// Serialize only once, in memory (the same mechanism as the snapshots
+	// for reverse). Large blocks (RAM, VRAM, ...) end up in 'deltaBlocks',
+	// these are shared by all clones while deserializing. The RAM of the
+	// clones even keeps sharing these blocks (copy-on-write), see
+	// CowBuffer. ROM images are not part of the savestate, the clones
+	// share those via RomCache.
+	LastDeltaBlocks lastDeltaBlocks;
+	std::vector<std::shared_ptr<DeltaBlock>> deltaBlocks;
+	MemOutputArchive out(lastDeltaBlocks, deltaBlocks, false, true);
+	out.serialize("machine", std::as_const(*board));
+	auto savestate = std::move(out).releaseBuffer();
+
+	// Only add the new machines once all of them are created, so that on
+	// an error no (unreachable) clones are left behind.
+	std::vector<Reactor::Board> newBoards;
+	newBoards.reserve(count);
+	for (int i = 0; i < count; ++i) {
+		auto newBoard = reactor.createEmptyMotherBoard();
+		try {
+			MemInputArchive in(savestate, deltaBlocks);
+			in.serialize("machine", *newBoard);
+		} catch (MSXException& e) {
+			throw CommandException("Cannot clone machine: ", e.getMessage());
+		}
+		// Same as restore_machine: use the actual host keyboard state.
+		newBoard->getStateChangeDistributor().stopReplay(newBoard->getCurrentTime());
+		newBoard->getMSXCommandController().transferSettings(
+			board->getMSXCommandController());
+		newBoards.push_back(std::move(newBoard));
+	}
+	for (auto& newBoard : newBoards) {
+		result.addListElement(newBoard->getMachineID());
+		reactor.boards.push_back(std::move(newBoard));
+	}
+}
+
+std::string CloneMachineCommand::help(std::span<const TclObject> /*tokens*/) const
+{
+	return "clone_machine <id>          Create a copy of the given machine, returns the ID of the new machine\n"
+	       "clone_machine <id> <count>  Create <count> (at most 256) copies, returns the list of new IDs\n"
+	       "\n"
+	       "The new machines start in the exact same state as the given "
+	       "machine. This is the same as a store_machine/restore_machine "
+	       "pair, but without going through a file.";
+}
+
+void CloneMachineCommand::tabCompletion(std::vector<std::string>& tokens) const
+{
+	completeString(tokens, reactor.getMachineIDs());
+}
+
+
 // class SetupCommand
 
 SetupCommand::SetupCommand(CommandController& commandController_,
@@ -22,6 +22,7 @@ class AfterCommand;
 class AviRecorder;
 class CliComm;
 class CommandController;
+class CloneMachineCommand;
 class CommandLineParser;
 class ConfigInfo;
 class CreateMachineCommand;
@@ -198,6 +199,7 @@ private:
 	std::unique_ptr<ActivateMachineCommand> activateMachineCommand;
 	std::unique_ptr<StoreMachineCommand> storeMachineCommand;
 	std::unique_ptr<RestoreMachineCommand> restoreMachineCommand;
+	std::unique_ptr<CloneMachineCommand> cloneMachineCommand;
 	std::unique_ptr<SetupCommand> setupCommand;
 	std::unique_ptr<GetClipboardCommand> getClipboardCommand;
 	std::unique_ptr<SetClipboardCommand> setClipboardCommand;
@@ -239,6 +241,7 @@ private:
 	friend class ActivateMachineCommand;
 	friend class StoreMachineCommand;
 	friend class RestoreMachineCommand;
+	friend class CloneMachineCommand;
 	friend class SetupCommand;
 };
 
@@ -238,7 +238,7 @@ XMLElement& HardwareConfig::getDevicesElem()
 static void loadHelper(XMLDocument& doc, zstring_view filename)
 {
 	try {
-		doc.load(filename, "msxconfig2.dtd");
+		doc.loadCached(filename, "msxconfig2.dtd");
 	} catch (XMLException& e) {
 		throw MSXException(
 			"Loading of hardware configuration failed: ",
@@ -0,0 +1,63 @@
+#include "XMLDocumentCache.hh"
+
+#include "FileOperations.hh"
+#include "XMLElement.hh"
+
+#include "strCat.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace openmsx::XMLDocumentCache {
+
+// Only keep this many documents in memory (a machine config is typically
+// 10-50kB), the least recently used one is dropped first.
+static constexpr size_t MAX_ENTRIES = 64;
+
+std::shared_ptr<const XMLDocument> get(zstring_view filename, std::string_view systemID)
+{
+	struct Entry {
+		std::shared_ptr<const XMLDocument> doc;
+		std::string key;
+		uint64_t lastUse;
+	};
+	static std::mutex mutex;
+	static std::map<std::string, Entry, std::less<>> cache;
+	static uint64_t useCounter = 0;
+
+	auto st = FileOperations::getStat(filename);
+	if (!st) {
+		// not cached, load() throws the appropriate exception
+		auto doc = std::make_shared<XMLDocument>();
+		doc->load(filename, systemID);
+		return doc;
+	}
+	auto key = strCat(filename, '\0', st->st_size, '\0',
+	                  FileOperations::getModificationDate(*st), '\0', systemID);
+
+	std::scoped_lock lock(mutex);
+	auto it = cache.find(filename);
+	if ((it != cache.end()) && (it->second.key == key)) {
+		it->second.lastUse = ++useCounter;
+		return it->second.doc;
+	}
+
+	auto doc = std::make_shared<XMLDocument>();
+	doc->load(filename, systemID);
+	std::shared_ptr<const XMLDocument> result = std::move(doc);
+
+	if (it != cache.end()) {
+		it->second = Entry{result, std::move(key), ++useCounter};
+	} else {
+		if (cache.size() >= MAX_ENTRIES) {
+			cache.erase(std::ranges::min_element(cache, {}, [](const auto& p) { return p.second.lastUse; }));
+		}
+		cache.emplace(std::string(filename), Entry{result, std::move(key), ++useCounter});
+	}
+	return result;
+}
+
+} // namespace openmsx::XMLDocumentCache
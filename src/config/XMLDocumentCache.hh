@@ -0,0 +1,33 @@
+#ifndef XMLDOCUMENTCACHE_HH
+#define XMLDOCUMENTCACHE_HH
+
+#include "zstring_view.hh"
+
+#include <memory>
+#include <string_view>
+
+namespace openmsx {
+
+class XMLDocument;
+
+/** Process-wide cache of parsed XML files, e.g. the machine and extension
+  * configs. These are parsed each time a machine is created, and
+  * (repeatedly) when querying the config info of all machines.
+  *
+  * Entries are keyed by filename and only reused while the size and
+  * modification time of the file are unchanged.
+  *
+  * The returned documents must not be modified, see
+  * XMLDocument::loadCached() to get a modifiable (shallow) copy.
+  */
+namespace XMLDocumentCache {
+
+/** @throws XMLException */
+[[nodiscard]] std::shared_ptr<const XMLDocument> get(
+	zstring_view filename, std::string_view systemID);
+
+} // namespace XMLDocumentCache
+
+} // namespace openmsx
+
+#endif
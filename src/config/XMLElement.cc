@@ -5,6 +5,7 @@
 #include "FileContext.hh" // for bw compat
 #include "FileException.hh"
 #include "StringOp.hh"
+#include "XMLDocumentCache.hh"
 #include "XMLException.hh"
 #include "XMLOutputStream.hh"
 #include "rapidsax.hh"
@@ -391,6 +392,34 @@ void XMLDocument::load(zstring_view filename, std::string_view systemID)
 	}
 }
 
+void XMLDocument::loadCached(zstring_view filename, std::string_view systemID)
+{
+	assert(!root);
+	cached = XMLDocumentCache::get(filename, systemID);
+	root = shallowClone(*cached->getRoot());
+}
+
+XMLElement* XMLDocument::shallowClone(const XMLElement& inElem)
+{
+	auto* outElem = allocateElement(inElem.name, inElem.data);
+
+	auto** attrPtr = &outElem->firstAttribute;
+	for (const auto& inAttr : inElem.getAttributes()) {
+		auto* outAttr = allocateAttribute(inAttr.name, inAttr.value);
+		*attrPtr = outAttr;
+		attrPtr = &outAttr->nextAttribute;
+	}
+
+	auto** childPtr = &outElem->firstChild;
+	for (const auto& inChild : inElem.getChildren()) {
+		auto* outChild = shallowClone(inChild);
+		*childPtr = outChild;
+		childPtr = &outChild->nextSibling;
+	}
+
+	return outElem;
+}
+
 XMLElement* XMLDocument::loadElement(MemInputArchive& ar)
 {
 	auto name = ar.loadStr();
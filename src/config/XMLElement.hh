@@ -11,6 +11,7 @@
 #include <concepts>
 #include <cstddef>
 #include <iterator>
+#include <memory>
 //#include <memory_resource>
 #include <string>
 #include <string_view>
@@ -311,6 +312,12 @@ public:
 	// Load/parse an xml file. Requires that the document is still empty.
 	void load(zstring_view filename, std::string_view systemID);
 
+	// Same as load(), but the parsed file is cached (see XMLDocumentCache).
+	// So loading the same (unchanged) file again is much cheaper. This
+	// document refers to the strings of the cached document, only the
+	// XMLElement and XMLAttribute objects are (shallow) copied.
+	void loadCached(zstring_view filename, std::string_view systemID);
+
 	[[nodiscard]] const XMLElement* getRoot() const { return root; }
 	[[nodiscard]] XMLElement* getRoot() { return root; }
 	void setRoot(XMLElement* root_) { assert(!root); root = root_; }
@@ -347,10 +354,12 @@ private:
 	XMLElement* loadElement(MemInputArchive& ar);
 	XMLElement* clone(const XMLElement& inElem);
 	XMLElement* clone(const OldXMLElement& elem);
+	XMLElement* shallowClone(const XMLElement& inElem);
 
 private:
 	XMLElement* root = nullptr;
 	MappedFile<char> buf;
+	std::shared_ptr<const XMLDocument> cached; // owns the strings, see loadCached()
 	// part of c++17, but not yet implemented in libc++
 	//    std::pmr::monotonic_buffer_resource allocator;
 	monotonic_allocator allocator;
@@ -2,12 +2,14 @@
 
 #include "FileException.hh"
 #include "MappedFile.hh"
+#include "SeekableInflate.hh"
 
 #include "hash_set.hh"
 #include "ranges.hh"
 #include "xxhash.hh"
 
 #include <cstring>
+#include <mutex>
 
 namespace openmsx {
 
@@ -18,6 +20,9 @@ struct GetURLFromDecompressed {
 };
 static hash_set<std::unique_ptr<CompressedFileAdapter::Decompressed>,
                 GetURLFromDecompressed, XXHasher> decompressCache;
+// Files can be opened from multiple threads (e.g. FilePool scans directories
+// in parallel), protects 'decompressCache' and the 'useCount' members.
+static std::mutex decompressMutex;
 
 
 CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_, zstring_view filename_)
@@ -29,6 +34,7 @@ CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_, zs
 CompressedFileAdapter::~CompressedFileAdapter()
 {
 	if (decompressed) {
+		std::scoped_lock lock(decompressMutex);
 		auto it = decompressCache.find(decompressed->cachedURL);
 		assert(it != end(decompressCache));
 		assert(it->get() == decompressed);
@@ -44,13 +50,21 @@ void CompressedFileAdapter::decompress()
 {
 	if (decompressed) return;
 
+	std::unique_lock lock(decompressMutex);
 	auto it = decompressCache.find(filename);
 	if (it == end(decompressCache)) {
+		// don't hold the lock during the (slow) decompression
+		lock.unlock();
 		auto d = std::make_unique<Decompressed>();
 		decompress(*file, *d);
 		d->cachedModificationDate = getModificationDate();
 		d->cachedURL = filename;
-		it = decompressCache.insert_noDuplicateCheck(std::move(d));
+		lock.lock();
+		// meanwhile another thread may have decompressed the same file
+		it = decompressCache.find(filename);
+		if (it == end(decompressCache)) {
+			it = decompressCache.insert_noDuplicateCheck(std::move(d));
+		}
 	}
 	++(*it)->useCount;
 	decompressed = it->get();
@@ -62,10 +76,14 @@ void CompressedFileAdapter::decompress()
 void CompressedFileAdapter::read(std::span<uint8_t> buffer)
 {
 	decompress();
-	if (decompressed->buf.size() < (pos + buffer.size())) {
+	if (getSize() < (pos + buffer.size())) {
 		throw FileException("Read beyond end of file");
 	}
-	copy_to_range(decompressed->buf.subspan(pos, buffer.size()), buffer);
+	if (decompressed->stream) {
+		decompressed->stream->read(pos, buffer);
+	} else {
+		copy_to_range(decompressed->buf.subspan(pos, buffer.size()), buffer);
+	}
 	pos += buffer.size();
 }
 
@@ -77,13 +95,22 @@ void CompressedFileAdapter::write(std::span<const uint8_t> /*buffer*/)
 MappedFileImpl CompressedFileAdapter::mmap(size_t extra, bool is_const)
 {
 	decompress();
+	if (auto& d = *decompressed; d.stream) {
+		// the whole content is needed after all
+		std::call_once(d.bufFlag, [&] {
+			MemBuffer<uint8_t> buf(d.stream->getSize());
+			d.stream->read(0, buf);
+			d.buf = std::move(buf);
+		});
+	}
 	return {std::span{decompressed->buf}, extra, is_const};
 }
 
 size_t CompressedFileAdapter::getSize()
 {
 	decompress();
-	return decompressed->buf.size();
+	return decompressed->stream ? decompressed->stream->getSize()
+	                            : decompressed->buf.size();
 }
 
 void CompressedFileAdapter::seek(size_t newPos)
@@ -7,14 +7,21 @@
 #include "zstring_view.hh"
 
 #include <memory>
+#include <mutex>
 
 namespace openmsx {
 
+class SeekableInflate;
+
 class CompressedFileAdapter : public FileBase
 {
 public:
 	struct Decompressed {
 		MemBuffer<uint8_t> buf;
+		// For large files: decompress on demand. Then 'buf' is only
+		// filled when the whole content is needed (for mmap()).
+		std::unique_ptr<SeekableInflate> stream;
+		std::once_flag bufFlag;
 		std::string originalName;
 		std::string cachedURL;
 		time_t cachedModificationDate;
@@ -34,6 +41,9 @@ public:
 	[[nodiscard]] time_t getModificationDate() final;
 
 protected:
+	// Files of (at least) this size are decompressed on demand.
+	static constexpr size_t STREAM_THRESHOLD = 64 * 1024 * 1024;
+
 	explicit CompressedFileAdapter(std::unique_ptr<FileBase> file, zstring_view filename);
 	~CompressedFileAdapter() override;
 	virtual void decompress(FileBase& file, Decompressed& decompressed) = 0;
@@ -45,7 +55,7 @@ private:
 	// invariant: exactly one of 'file' and 'decompressed' is '!= nullptr'
 	std::unique_ptr<FileBase> file;
 	std::string filename;
-	const Decompressed* decompressed = nullptr;
+	Decompressed* decompressed = nullptr;
 	size_t pos = 0;
 };
 
@@ -41,16 +41,28 @@ FilePool::FilePool(CommandController& controller, Reactor& reactor_)
 		"This is an internal setting. Don't change this directly, "
 		"instead use the 'filepool' command.",
 		initialFilePoolSettingValue().getString())
+	, watchSetting(
+		controller, "filepool_watch",
+		"Watch the file pool directories for changes in the background "
+		"(only supported on Linux). This keeps the file pool index "
+		"up-to-date, so that files that were added later don't require "
+		"a (slow) scan of the file pool.",
+		false)
 	, reactor(reactor_)
 	, sha1SumCommand(controller)
 {
 	filePoolSetting.attach(*this);
+	watchSetting.attach(*this);
+	if (watchSetting.getBoolean()) {
+		core.setWatching(true);
+	}
 	reactor.getEventDistributor().registerEventListener(EventType::QUIT, *this);
 }
 
 FilePool::~FilePool()
 {
 	reactor.getEventDistributor().unregisterEventListener(EventType::QUIT, *this);
+	watchSetting.detach(*this);
 	filePoolSetting.detach(*this);
 }
 
@@ -143,8 +155,13 @@ FilePoolCore::Directories FilePool::getDirectories() const
 
 void FilePool::update(const Setting& setting) noexcept
 {
-	assert(&setting == &filePoolSetting); (void)setting;
-	(void)getDirectories(); // check for syntax errors
+	if (&setting == &filePoolSetting) {
+		(void)getDirectories(); // check for syntax errors
+	} else {
+		assert(&setting == &watchSetting);
+	}
+	// (re)start watching (the possibly changed directories), or stop
+	core.setWatching(watchSetting.getBoolean());
 }
 
 void FilePool::reportProgress(std::string_view message, float fraction)
@@ -1,6 +1,7 @@
 #ifndef FILEPOOL_HH
 #define FILEPOOL_HH
 
+#include "BooleanSetting.hh"
 #include "Command.hh"
 #include "EventListener.hh"
 #include "FilePoolCore.hh"
@@ -51,6 +52,7 @@ private:
 private:
 	FilePoolCore core;
 	StringSetting filePoolSetting;
+	BooleanSetting watchSetting;
 	Reactor& reactor;
 
 	class Sha1SumCommand final : public Command {
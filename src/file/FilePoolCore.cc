@@ -1,20 +1,78 @@
 #include "FilePoolCore.hh"
 
 #include "FileException.hh"
+#include "FilePoolWatcher.hh"
 #include "foreach_file.hh"
 
 #include "Date.hh"
 #include "Timer.hh"
+#include "WorkerPool.hh"
 #include "one_of.hh"
 #include "ranges.hh"
+#include "stl.hh"
+#include "xrange.hh"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <fstream>
 #include <optional>
 #include <tuple>
 
 namespace openmsx {
 
+// Number of files that are hashed in parallel while scanning the pool
+// directories (including the calling thread). Mostly limited by I/O, so this
+// can be larger than the number of CPU cores, though not too large, e.g. to
+// not overload a network file system.
+static constexpr unsigned SCAN_THREADS = 8;
+
+// Small files are hashed in groups of this size via SHA1::calcMany(), that
+// hashes several files at once (when the CPU supports it).
+static constexpr size_t HASH_GROUP = 8;
+
+// Number of files that are collected before hashing them in parallel.
+static constexpr size_t SCAN_BATCH = 2 * SCAN_THREADS * HASH_GROUP;
+
+// Larger files are not hashed in parallel, but on the main thread, so that
+// progress is shown (and the search can be aborted) while hashing them.
+static constexpr size_t LARGE_FILE = 16 * 1024 * 1024; // 16MB
+
+// While scanning, write the (partial) result to '.filecache' at most this
+// often. So that the work isn't lost when openMSX is killed during a long
+// scan.
+static constexpr uint64_t WRITE_INTERVAL = 10'000'000; // 10s
+
+// The binary index is a copy of the information in '.filecache' that can be
+// loaded without any parsing: a header, followed by the records (sorted on
+// sha1sum), followed by all filenames. It's stored in the native byte order,
+// a mismatch is detected via the 'endian' field. The text file remains the
+// primary format (e.g. older openMSX versions only understand that one), so
+// the index is only used when it still matches the size and modification
+// time of that text file.
+static constexpr std::array<char, 8> INDEX_MAGIC = {'o', 'M', 'S', 'X', 'f', 'p', 'i', '1'};
+static constexpr uint32_t INDEX_ENDIAN = 0x01020304;
+
+struct IndexHeader {
+	std::array<char, 8> magic;
+	uint32_t endian;
+	uint32_t count; // number of records
+	uint64_t textSize;
+	int64_t textTime;
+	uint64_t stringsSize;
+};
+static_assert(sizeof(IndexHeader) == 40);
+
+struct IndexRecord {
+	Sha1Sum sum;
+	uint32_t filenameSize;
+	int64_t time;
+	uint64_t filenameOffset; // relative to the start of the strings
+};
+static_assert(sizeof(IndexRecord) == 40);
+static_assert(std::is_trivially_copyable_v<IndexRecord>);
+
 struct GetSha1 {
 	const FilePoolCore::Pool& pool;
 
@@ -28,6 +86,7 @@ FilePoolCore::FilePoolCore(std::string fileCache_,
                            std::function<Directories()> getDirectories_,
                            std::function<void(std::string_view, float)> reportProgress_)
 	: fileCache(std::move(fileCache_))
+	, indexFile(fileCache + ".idx")
 	, getDirectories(std::move(getDirectories_))
 	, reportProgress(std::move(reportProgress_))
 {
@@ -40,6 +99,8 @@ FilePoolCore::FilePoolCore(std::string fileCache_,
 
 FilePoolCore::~FilePoolCore()
 {
+	applyWatcherUpdates();
+	watcher.reset();
 	if (needWrite) {
 		writeSha1sums();
 	}
@@ -170,6 +231,83 @@ void FilePoolCore::readSha1sums()
 	assert(sha1Index.empty());
 	assert(fileMem.empty());
 
+	if (!readIndex()) {
+		readText();
+	}
+
+	if (!std::ranges::is_sorted(sha1Index, {}, GetSha1{pool})) {
+		// This should _rarely_ happen. In fact it should only happen
+		// when .filecache was manually edited. Though because it's
+		// very important that pool is indeed sorted I've added this
+		// safety mechanism.
+		std::ranges::sort(sha1Index, {}, GetSha1{pool});
+	}
+
+	// 'pool' is populated, 'sha1Index' is sorted, now build 'filenameIndex'
+	auto n = sha1Index.size();
+	filenameIndex.reserve(n);
+	while (n != 0) { // sha1Index might change while iterating ...
+		--n;
+		Index idx = sha1Index[n]; // ... therefor use indices instead of iterators
+		bool inserted = filenameIndex.insert(idx);
+		if (!inserted) {
+			// ERROR: there may not be multiple entries for the same filename
+			// Should only happen when .filecache was manually edited.
+			remove(idx);
+		}
+	}
+}
+
+// Returns false (and leaves the pool empty) when there's no (valid) binary
+// index, or when it doesn't match the text file.
+bool FilePoolCore::readIndex()
+{
+	auto st = FileOperations::getStat(fileCache);
+	if (!st) return false;
+	size_t size = 0;
+	try {
+		File file(indexFile);
+		size = file.getSize();
+		if (size < sizeof(IndexHeader)) return false;
+		// Note: read instead of mmap, the string_views in 'pool' keep
+		// pointing to this memory, while the file itself gets rewritten.
+		fileMem.resize(size);
+		file.read(fileMem.first(size));
+	} catch (FileException&) {
+		fileMem.clear();
+		return false;
+	}
+
+	IndexHeader header;
+	memcpy(&header, fileMem.data(), sizeof(header));
+	if ((header.magic != INDEX_MAGIC) ||
+	    (header.endian != INDEX_ENDIAN) ||
+	    (header.textSize != uint64_t(st->st_size)) ||
+	    (header.textTime != int64_t(FileOperations::getModificationDate(*st))) ||
+	    (size != sizeof(IndexHeader) + header.count * sizeof(IndexRecord) + header.stringsSize)) {
+		fileMem.clear();
+		return false;
+	}
+
+	const char* records = fileMem.data() + sizeof(IndexHeader);
+	const char* strings = records + header.count * sizeof(IndexRecord);
+	sha1Index.reserve(header.count);
+	for (auto i : xrange(header.count)) {
+		IndexRecord r;
+		memcpy(&r, records + i * sizeof(IndexRecord), sizeof(r));
+		if ((r.filenameOffset > header.stringsSize) ||
+		    (r.filenameSize > header.stringsSize - r.filenameOffset) ||
+		    (time_t(r.time) == Date::INVALID_TIME_T)) {
+			continue; // corrupt record
+		}
+		std::string_view filename(strings + r.filenameOffset, r.filenameSize);
+		sha1Index.push_back(pool.emplace(r.sum, time_t(r.time), filename).idx);
+	}
+	return true;
+}
+
+void FilePoolCore::readText()
+{
 	File file(fileCache);
 	auto size = file.getSize();
 	fileMem.resize(size + 1);
@@ -196,53 +334,109 @@ void FilePoolCore::readSha1sums()
 			return c != one_of('\n', '\r');
 		});
 	}
+}
 
-	if (!std::ranges::is_sorted(sha1Index, {}, GetSha1{pool})) {
-		// This should _rarely_ happen. In fact it should only happen
-		// when .filecache was manually edited. Though because it's
-		// very important that pool is indeed sorted I've added this
-		// safety mechanism.
-		std::ranges::sort(sha1Index, {}, GetSha1{pool});
-	}
-
-	// 'pool' is populated, 'sha1Index' is sorted, now build 'filenameIndex'
-	auto n = sha1Index.size();
-	filenameIndex.reserve(n);
-	while (n != 0) { // sha1Index might change while iterating ...
-		--n;
-		Index idx = sha1Index[n]; // ... therefor use indices instead of iterators
-		bool inserted = filenameIndex.insert(idx);
-		if (!inserted) {
-			// ERROR: there may not be multiple entries for the same filename
-			// Should only happen when .filecache was manually edited.
-			remove(idx);
+void FilePoolCore::writeSha1sums()
+{
+	{
+		std::ofstream file;
+		FileOperations::openOfStream(file, fileCache);
+		if (!file.is_open()) {
+			return;
 		}
-	}
+		for (auto idx : sha1Index) {
+			const auto& entry = pool[idx];
+			file << entry.sum << "  ";
+			if (entry.timeStr) {
+				file << entry.timeStr;
+			} else {
+				assert(entry.time != Date::INVALID_TIME_T);
+				std::array<char, 24> buf;
+				file << Date::toString(entry.time, buf);
+			}
+			file << "  " << entry.filename << '\n';
+		}
+	} // close the text file, writeIndex() needs its final size and time
+	writeIndex();
 }
 
-void FilePoolCore::writeSha1sums()
+void FilePoolCore::writeIndex()
 {
+	auto st = FileOperations::getStat(fileCache);
+	if (!st) return;
+
+	std::vector<IndexRecord> records;
+	records.reserve(sha1Index.size());
+	std::string strings;
+	for (auto idx : sha1Index) {
+		auto& entry = pool[idx];
+		auto time = entry.getTime();
+		if (time == Date::INVALID_TIME_T) continue; // skip, like readText() would
+		records.push_back({.sum = entry.sum,
+		                   .filenameSize = uint32_t(entry.filename.size()),
+		                   .time = int64_t(time),
+		                   .filenameOffset = strings.size()});
+		strings += entry.filename;
+	}
+	IndexHeader header = {
+		.magic = INDEX_MAGIC,
+		.endian = INDEX_ENDIAN,
+		.count = uint32_t(records.size()),
+		.textSize = uint64_t(st->st_size),
+		.textTime = int64_t(FileOperations::getModificationDate(*st)),
+		.stringsSize = strings.size(),
+	};
+
 	std::ofstream file;
-	FileOperations::openOfStream(file, fileCache);
+	FileOperations::openOfStream(file, indexFile, std::ios::binary);
 	if (!file.is_open()) {
 		return;
 	}
-	for (auto idx : sha1Index) {
-		const auto& entry = pool[idx];
-		file << entry.sum << "  ";
-		if (entry.timeStr) {
-			file << entry.timeStr;
-		} else {
-			assert(entry.time != Date::INVALID_TIME_T);
-			std::array<char, 24> buf;
-			file << Date::toString(entry.time, buf);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(records.data()),
+	           std::streamsize(records.size() * sizeof(IndexRecord)));
+	file.write(strings.data(), std::streamsize(strings.size()));
+	// On a write error the size doesn't match, and the index is ignored.
+}
+
+void FilePoolCore::setWatching(bool enabled)
+{
+	applyWatcherUpdates();
+	watcher.reset();
+	if (!enabled || !FilePoolWatcher::isSupported()) return;
+
+	std::vector<std::string> directories;
+	for (const auto& dir : getDirectories()) {
+		auto path = FileOperations::expandTilde(std::string(dir.path));
+		if (!contains(directories, path)) {
+			directories.push_back(std::move(path));
+		}
+	}
+	watcher = std::make_unique<FilePoolWatcher>(std::move(directories));
+}
+
+// Bring the database in sync with the changes that were detected by the
+// watcher thread (if any). Only called from the main thread.
+void FilePoolCore::applyWatcherUpdates()
+{
+	if (!watcher) return;
+	for (auto& update : watcher->takeUpdates()) {
+		auto [idx, entry] = findInDatabase(update.filename);
+		if (!update.sum) {
+			// removed (or can't be read)
+			if (idx != Index(-1)) remove(idx, *entry);
+		} else if (idx == Index(-1)) {
+			insert(*update.sum, update.time, update.filename);
+		} else if ((entry->getTime() != update.time) || (entry->sum != *update.sum)) {
+			entry->setTime(update.time);
+			adjustSha1(idx, *entry, *update.sum);
 		}
-		file << "  " << entry.filename << '\n';
 	}
 }
 
 FilePoolCore::Result FilePoolCore::getFile(FileType fileType, const Sha1Sum& sha1sum)
 {
+	applyWatcherUpdates();
 	auto result = getFromPool(sha1sum);
 	if (result.file.is_open()) return result;
 
@@ -251,6 +445,11 @@ FilePoolCore::Result FilePoolCore::getFile(FileType fileType, const Sha1Sum& sha
 	ScanProgress progress {
 		.lastTime = Timer::getTime(),
 	};
+	lastWriteTime = progress.lastTime;
+	if (!workers) {
+		// only created on the first scan, then reused
+		workers = std::make_unique<WorkerPool>(SCAN_THREADS - 1);
+	}
 
 	for (const auto& [path, types] : getDirectories()) {
 		if ((types & fileType) != FileType::NONE) {
@@ -370,7 +569,12 @@ FilePoolCore::Result FilePoolCore::scanDirectory(
 	const Sha1Sum& sha1sum, const std::string& directory, std::string_view poolPath,
 	ScanProgress& progress)
 {
+	// Files that are already in the database (with the correct timestamp)
+	// are checked immediately. The others are collected and then hashed in
+	// parallel.
 	Result result;
+	std::vector<HashJob> jobs;
+	jobs.reserve(SCAN_BATCH);
 	auto fileAction = [&](const std::string& path, const FileOperations::Stat& st) {
 		if (stop) {
 			// Scanning can take a long time. Allow to exit
@@ -379,16 +583,111 @@ FilePoolCore::Result FilePoolCore::scanDirectory(
 			assert(!result.file.is_open());
 			return false; // abort foreach_file_recursive
 		}
-		result = scanFile(sha1sum, path, st, poolPath, progress);
+		result = scanFile(sha1sum, path, st, poolPath, progress, jobs);
+		if (!result.file.is_open() && (jobs.size() == SCAN_BATCH)) {
+			result = hashFiles(sha1sum, jobs);
+			jobs.clear();
+		}
 		return !result.file.is_open(); // abort traversal when found
 	};
-	foreach_file_recursive(directory, fileAction);
+	if (foreach_file_recursive(directory, fileAction) && !jobs.empty()) {
+		result = hashFiles(sha1sum, jobs);
+	}
+	return result;
+}
+
+FilePoolCore::Result FilePoolCore::hashFiles(
+	const Sha1Sum& sha1sum, std::span<HashJob> jobs)
+{
+	// Calculate the sha1sums of the small files in parallel, in groups of
+	// HASH_GROUP files. Don't start new groups once the requested file has
+	// been found.
+	std::vector<HashJob*> smallJobs;
+	for (auto& job : jobs) {
+		if (job.size < LARGE_FILE) smallJobs.push_back(&job);
+	}
+	std::atomic<bool> found = false;
+	auto numGroups = (smallJobs.size() + HASH_GROUP - 1) / HASH_GROUP;
+	workers->parallelFor(numGroups, [&](size_t g) {
+		if (found.load(std::memory_order_relaxed)) return;
+		auto group = std::span{smallJobs}.subspan(g * HASH_GROUP);
+		if (group.size() > HASH_GROUP) group = group.first(HASH_GROUP);
+
+		std::array<File, HASH_GROUP> files;
+		std::array<MappedFile<const uint8_t>, HASH_GROUP> mapped;
+		std::array<std::span<const uint8_t>, HASH_GROUP> data;
+		std::array<HashJob*, HASH_GROUP> opened;
+		size_t num = 0;
+		for (auto* job : group) {
+			try {
+				files[num] = File(job->filename);
+				mapped[num] = files[num].mmap<const uint8_t>();
+				data[num] = mapped[num];
+				opened[num++] = job;
+			} catch (FileException&) {
+				job->done = true; // without sum
+			}
+		}
+		std::array<Sha1Sum, HASH_GROUP> sums;
+		SHA1::calcMany(std::span{data}.first(num), std::span{sums}.first(num));
+		for (auto i : xrange(num)) {
+			opened[i]->sum = sums[i];
+			opened[i]->done = true;
+			if (sums[i] == sha1sum) found = true;
+		}
+	});
+	// The large files one by one on this thread, calcSha1sum() shows the
+	// progress (in 1MB steps). Check between files whether the search was
+	// aborted (via the reportProgress callback).
+	for (auto& job : jobs) {
+		if ((job.size < LARGE_FILE) || found || stop) continue;
+		try {
+			File file(job.filename);
+			job.sum = calcSha1sum(file, job.filename);
+			if (*job.sum == sha1sum) found = true;
+		} catch (FileException&) {
+			// ignore
+		}
+		job.done = true;
+	}
+
+	// Update the database (only in this thread).
+	Result result;
+	for (auto& job : jobs) {
+		if (!job.done) continue;
+		auto [idx, entry] = findInDatabase(job.filename);
+		if (!job.sum) {
+			// error reading file, remove from db
+			if (idx != Index(-1)) remove(idx, *entry);
+			continue;
+		}
+		if (idx == Index(-1)) {
+			insert(*job.sum, job.time, job.filename);
+		} else {
+			entry->setTime(job.time);
+			adjustSha1(idx, *entry, *job.sum);
+		}
+		if (!result.file.is_open() && (*job.sum == sha1sum)) {
+			try {
+				result = {.file = File(job.filename), .filename = job.filename};
+			} catch (FileException&) {
+				// ignore
+			}
+		}
+	}
+
+	if (auto now = Timer::getTime();
+	    needWrite && (now > (lastWriteTime + WRITE_INTERVAL))) {
+		lastWriteTime = now;
+		writeSha1sums();
+		needWrite = false;
+	}
 	return result;
 }
 
 FilePoolCore::Result FilePoolCore::scanFile(const Sha1Sum& sha1sum, zstring_view filename,
                             const FileOperations::Stat& st, std::string_view poolPath,
-                            ScanProgress& progress)
+                            ScanProgress& progress, std::vector<HashJob>& jobs)
 {
 	++progress.amountScanned;
 	// Periodically send a progress message with the current filename
@@ -405,43 +704,23 @@ FilePoolCore::Result FilePoolCore::scanFile(const Sha1Sum& sha1sum, zstring_view
 	}
 
 	auto time = FileOperations::getModificationDate(st);
-	if (auto [idx, entry] = findInDatabase(filename); idx == Index(-1)) {
-		// not in pool
-		try {
-			File file(filename);
-			auto sum = calcSha1sum(file, filename);
-			insert(sum, time, filename);
-			if (sum == sha1sum) {
-				return {.file = std::move(file), .filename = std::string(filename)};
-			}
-		} catch (FileException&) {
-			// ignore
-		}
-	} else {
-		// already in pool
+	auto [idx, entry] = findInDatabase(filename);
+	if ((idx != Index(-1)) && (entry->getTime() == time)) {
+		// already in pool and db is still up to date
 		assert(filename == entry->filename);
-		try {
-			if (entry->getTime() == time) {
-				// db is still up to date
-				if (entry->sum == sha1sum) {
-					return {.file = File(filename), .filename = std::string(filename)};
-				}
-			} else {
-				// db outdated
-				File file(filename);
-				auto sum = calcSha1sum(file, filename);
-				entry->setTime(time);
-				adjustSha1(idx, *entry, sum);
-				if (sum == sha1sum) {
-					return {.file = std::move(file), .filename = std::string(filename)};
-				}
+		if (entry->sum == sha1sum) {
+			try {
+				return {.file = File(filename), .filename = std::string(filename)};
+			} catch (FileException&) {
+				// error reading file, remove from db
+				remove(idx, *entry);
 			}
-		} catch (FileException&) {
-			// error reading file, remove from db
-			remove(idx, *entry);
 		}
+	} else {
+		// not in pool or db outdated, (re)calculate later
+		jobs.emplace_back(std::string(filename), time, size_t(st.st_size));
 	}
-	return {}; // not found
+	return {}; // not found (yet)
 }
 
 std::pair<FilePoolCore::Index, FilePoolCore::Entry*> FilePoolCore::findInDatabase(std::string_view filename)
@@ -462,6 +741,7 @@ std::pair<FilePoolCore::Index, FilePoolCore::Entry*> FilePoolCore::findInDatabas
 
 Sha1Sum FilePoolCore::getSha1Sum(File& file, std::string_view filename)
 {
+	applyWatcherUpdates();
 	auto time = file.getModificationDate();
 
 	auto [idx, entry] = findInDatabase(filename);
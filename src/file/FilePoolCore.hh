@@ -14,6 +14,8 @@
 #include <cstdint>
 #include <ctime>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -21,6 +23,8 @@
 namespace openmsx {
 
 class File;
+class FilePoolWatcher;
+class WorkerPool;
 
 enum class FileType : uint8_t {
 	NONE = 0,
@@ -75,6 +79,14 @@ public:
 	 */
 	void abort() { stop = true; }
 
+	/** Start (or restart) or stop watching the pool directories for
+	 * changes. When enabled, a background thread hashes new or modified
+	 * files, so that a later getFile() doesn't have to scan for them. Call
+	 * this again (with 'true') when the directories have changed.
+	 * Only supported on Linux, elsewhere this does nothing.
+	 */
+	void setWatching(bool enabled);
+
 private:
 	struct ScanProgress {
 		uint64_t lastTime;
@@ -82,6 +94,15 @@ private:
 		bool printed = false;
 	};
 
+	// A file for which the sha1sum must be (re)calculated during a scan.
+	struct HashJob {
+		std::string filename;
+		time_t time;
+		size_t size; // of the file on disk
+		std::optional<Sha1Sum> sum; // empty if not calculated or on error
+		bool done = false;
+	};
+
 	struct Entry {
 		Entry(const Sha1Sum& s, time_t t, std::string_view f)
 			: filename(f), time(t), sum(s)
@@ -144,7 +165,11 @@ private:
 	bool adjustSha1(Index idx,              Entry& entry, const Sha1Sum& newSum);
 
 	void readSha1sums();
+	[[nodiscard]] bool readIndex();
+	void readText();
 	void writeSha1sums();
+	void writeIndex();
+	void applyWatcherUpdates();
 
 	[[nodiscard]] Result getFromPool(const Sha1Sum& sha1sum);
 	[[nodiscard]] Result scanDirectory(
@@ -157,22 +182,31 @@ private:
 	        zstring_view filename,
 	        const FileOperations::Stat& st,
 	        std::string_view poolPath,
-	        ScanProgress& progress);
+	        ScanProgress& progress,
+	        std::vector<HashJob>& jobs);
+	[[nodiscard]] Result hashFiles(
+		const Sha1Sum& sha1sum,
+	        std::span<HashJob> jobs);
 	[[nodiscard]] Sha1Sum calcSha1sum(File& file, std::string_view filename) const;
 	[[nodiscard]] std::pair<Index, Entry*> findInDatabase(std::string_view filename);
 
 private:
 	std::string fileCache; // path of the '.filecache' file.
+	std::string indexFile; // path of the binary index, see readIndex()
 	std::function<Directories()> getDirectories;
 	std::function<void(std::string_view, float)> reportProgress;
 
-	MemBuffer<char> fileMem; // content of initial .filecache
+	MemBuffer<char> fileMem; // content of initial .filecache (or its binary index)
 	std::vector<std::string> stringBuffer; // owns strings that are not in 'fileMem'
 
 	Pool pool; // the actual entries
 	Sha1Index sha1Index; // entries accessible via sha1, sorted on 'CompareSha1'
 	FilenameIndex filenameIndex{FilenameIndexHash(pool), FilenameIndexEqual(pool)}; // accessible via filename
 
+	std::unique_ptr<FilePoolWatcher> watcher; // only when enabled
+	std::unique_ptr<WorkerPool> workers; // to hash files in parallel, see hashFiles()
+
+	uint64_t lastWriteTime = 0; // see hashFiles()
 	bool stop = false; // abort long search (set via reportProgress callback)
 	bool needWrite = false; // dirty '.filecache'? write on exit
 
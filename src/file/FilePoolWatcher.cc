@@ -0,0 +1,182 @@
+#include "FilePoolWatcher.hh"
+
+#include <utility>
+
+#ifdef __linux__
+#include "File.hh"
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "foreach_file.hh"
+
+#include "strCat.hh"
+
+#include <array>
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace openmsx {
+
+#ifdef __linux__
+
+// Note: IN_CREATE is only needed for directories, new files are reported
+// (with their final content) via IN_CLOSE_WRITE.
+static constexpr uint32_t WATCH_MASK =
+	IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ONLYDIR;
+
+FilePoolWatcher::FilePoolWatcher(std::vector<std::string> directories)
+	: inotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+	, wakeupFd(eventfd(0, EFD_CLOEXEC))
+{
+	if ((inotifyFd == -1) || (wakeupFd == -1)) return; // then just don't watch
+	thread = std::thread([this, dirs = std::move(directories)]() mutable {
+		run(std::move(dirs));
+	});
+}
+
+FilePoolWatcher::~FilePoolWatcher()
+{
+	if (thread.joinable()) {
+		uint64_t one = 1;
+		(void)!write(wakeupFd, &one, sizeof(one));
+		thread.join();
+	}
+	if (inotifyFd != -1) close(inotifyFd);
+	if (wakeupFd  != -1) close(wakeupFd);
+}
+
+bool FilePoolWatcher::isSupported()
+{
+	return true;
+}
+
+void FilePoolWatcher::run(std::vector<std::string> directories)
+{
+	// The files that are already present were (or will be) handled by a
+	// regular scan of the pool, so only watch for changes.
+	for (const auto& dir : directories) {
+		addWatches(dir, false);
+	}
+
+	std::array<pollfd, 2> fds = {{{.fd = inotifyFd, .events = POLLIN, .revents = 0},
+	                              {.fd = wakeupFd,  .events = POLLIN, .revents = 0}}};
+	alignas(inotify_event) std::array<char, 4096> buf;
+	while (true) {
+		if (poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) continue;
+			return;
+		}
+		if (fds[1].revents) return; // requested to stop
+
+		auto len = read(inotifyFd, buf.data(), buf.size());
+		if (len <= 0) continue;
+		const char* end = buf.data() + len;
+		for (const char* p = buf.data(); p < end; /**/) {
+			const auto* event = reinterpret_cast<const inotify_event*>(p);
+			p += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_IGNORED) {
+				// watch removed (e.g. directory deleted)
+				watches.erase(event->wd);
+				continue;
+			}
+			auto it = watches.find(event->wd);
+			if ((it == watches.end()) || (event->len == 0)) continue;
+			auto path = strCat(it->second, '/', event->name);
+
+			if (event->mask & IN_ISDIR) {
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					addWatches(path, true);
+				} else if (event->mask & IN_MOVED_FROM) {
+					removeWatches(path);
+				}
+				// Entries for the files in a removed directory
+				// remain, FilePoolCore removes them when they're
+				// looked up.
+			} else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+				fileChanged(std::move(path));
+			} else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+				fileRemoved(std::move(path));
+			}
+		}
+	}
+}
+
+void FilePoolWatcher::addWatches(const std::string& directory, bool hashFiles)
+{
+	int wd = inotify_add_watch(inotifyFd, directory.c_str(), WATCH_MASK);
+	if (wd == -1) return; // e.g. doesn't exist or out of watches, just skip
+	if (!watches.try_emplace(wd, directory).second) {
+		return; // already watched (e.g. via a symlink), avoid loops
+	}
+	auto fileAction = [&](const std::string& path) {
+		if (hashFiles) fileChanged(path);
+	};
+	auto dirAction = [&](const std::string& path) {
+		addWatches(path, hashFiles);
+	};
+	foreach_file_and_directory(directory, fileAction, dirAction);
+}
+
+void FilePoolWatcher::removeWatches(std::string_view directory)
+{
+	for (auto it = watches.begin(); it != watches.end(); /**/) {
+		std::string_view path = it->second;
+		if (path.starts_with(directory) &&
+		    ((path.size() == directory.size()) || (path[directory.size()] == '/'))) {
+			inotify_rm_watch(inotifyFd, it->first);
+			it = watches.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void FilePoolWatcher::fileChanged(std::string filename)
+{
+	auto st = FileOperations::getStat(filename);
+	if (!st || !FileOperations::isRegularFile(*st)) return;
+	Update update{.filename = std::move(filename),
+	              .time = FileOperations::getModificationDate(*st),
+	              .sum = {}};
+	try {
+		File file(update.filename);
+		update.sum = SHA1::calc(file.mmap<const uint8_t>());
+	} catch (MSXException&) {
+		// can't read, report as removed
+	}
+	std::scoped_lock lock(mutex);
+	updates.push_back(std::move(update));
+}
+
+void FilePoolWatcher::fileRemoved(std::string filename)
+{
+	std::scoped_lock lock(mutex);
+	updates.push_back(Update{.filename = std::move(filename), .time = 0, .sum = {}});
+}
+
+#else
+
+FilePoolWatcher::FilePoolWatcher(std::vector<std::string> /*directories*/)
+{
+}
+
+FilePoolWatcher::~FilePoolWatcher() = default;
+
+bool FilePoolWatcher::isSupported()
+{
+	return false;
+}
+
+#endif
+
+std::vector<FilePoolWatcher::Update> FilePoolWatcher::takeUpdates()
+{
+	std::scoped_lock lock(mutex);
+	return std::exchange(updates, {});
+}
+
+} // namespace openmsx
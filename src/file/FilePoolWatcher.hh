@@ -0,0 +1,68 @@
+#ifndef FILEPOOLWATCHER_HH
+#define FILEPOOLWATCHER_HH
+
+#include "sha1.hh"
+
+#include <ctime>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace openmsx {
+
+/** Watches the file pool directories (recursively) for changes and
+  * calculates the sha1sum of new or modified files in a background thread.
+  * The results are picked up by FilePoolCore (in the main thread), so that
+  * the '.filecache' stays up-to-date without having to rescan the pool.
+  *
+  * This is only a cache: events can get lost (e.g. when the kernel event
+  * queue overflows), FilePoolCore still verifies modification times before
+  * using an entry.
+  *
+  * Currently only implemented on Linux (via inotify).
+  */
+class FilePoolWatcher
+{
+public:
+	struct Update {
+		std::string filename;
+		time_t time;
+		std::optional<Sha1Sum> sum; // empty when removed (or can't be read)
+	};
+
+	explicit FilePoolWatcher(std::vector<std::string> directories);
+	~FilePoolWatcher();
+
+	FilePoolWatcher(const FilePoolWatcher&) = delete;
+	FilePoolWatcher& operator=(const FilePoolWatcher&) = delete;
+
+	/** Get (and remove) the changes that were detected so far. */
+	[[nodiscard]] std::vector<Update> takeUpdates();
+
+	[[nodiscard]] static bool isSupported();
+
+private:
+#ifdef __linux__
+	void run(std::vector<std::string> directories);
+	void addWatches(const std::string& directory, bool hashFiles);
+	void removeWatches(std::string_view directory);
+	void fileChanged(std::string filename);
+	void fileRemoved(std::string filename);
+
+	int inotifyFd = -1;
+	int wakeupFd = -1; // to stop the thread
+	std::unordered_map<int, std::string> watches; // only used by the thread
+	std::thread thread;
+#endif
+
+	std::mutex mutex;
+	std::vector<Update> updates; // protected by 'mutex'
+};
+
+} // namespace openmsx
+
+#endif
@@ -2,6 +2,7 @@
 
 #include "FileException.hh"
 #include "MappedFile.hh"
+#include "SeekableInflate.hh"
 #include "ZlibInflate.hh"
 
 namespace openmsx {
@@ -61,6 +62,18 @@ void GZFileAdapter::decompress(FileBase& f, Decompressed& d)
 	if (!skipHeader(zlib, d.originalName)) {
 		throw FileException("Not a gzip header");
 	}
+
+	// The last 4 bytes contain the decompressed size. Note: this is modulo
+	// 4GB, such large files are not supported (SeekableInflate detects
+	// that the data continues after this size).
+	if (auto start = zlib.getInputPos(); mmap.size() >= (start + 4)) {
+		auto tail = std::span{mmap}.last(4);
+		size_t size = tail[0] | (tail[1] << 8) | (tail[2] << 16) | (size_t(tail[3]) << 24);
+		if (size >= STREAM_THRESHOLD) {
+			d.stream = std::make_unique<SeekableInflate>(std::move(mmap), start, size);
+			return;
+		}
+	}
 	d.buf = zlib.inflate();
 }
 
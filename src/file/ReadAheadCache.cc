@@ -0,0 +1,375 @@
+#include "ReadAheadCache.hh"
+
+#include "FileException.hh"
+
+#include "ranges.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <cassert>
+
+namespace openmsx {
+
+static constexpr size_t MIN_WINDOW = 8; // in blocks
+
+ReadAheadCache::ReadAheadCache(File& file_, size_t blockSize_, size_t cacheSize)
+	: file(file_)
+	, blockSize(blockSize_)
+	, numSlots(std::max<size_t>(cacheSize / blockSize_, 4))
+{
+}
+
+ReadAheadCache::~ReadAheadCache()
+{
+	if (!thread.joinable()) return;
+	{
+		std::scoped_lock lock(mutex);
+		stop = true; // the thread still writes the remaining dirty blocks (once)
+	}
+	cv.notify_all();
+	thread.join();
+}
+
+void ReadAheadCache::read(size_t pos, std::span<uint8_t> buf)
+{
+	if (buf.empty()) return;
+	if (fileSize == size_t(-1)) {
+		std::scoped_lock lock(fileMutex);
+		fileSize = file.getSize();
+	}
+	if ((pos > fileSize) || (buf.size() > (fileSize - pos))) {
+		throw FileException("Read beyond end of file");
+	}
+	auto endPos = pos + buf.size();
+	auto copyOut = [&](size_t block, std::span<const uint8_t> blockData) {
+		auto start = block * blockSize;
+		auto from = std::max(start, pos);
+		auto to = std::min(start + blockSize, endPos);
+		copy_to_range(blockData.subspan(from - start, to - from),
+		              buf.subspan(from - pos));
+	};
+	auto isBusy = [&](size_t block) {
+		return (busy.begin <= block) && (block < busy.end);
+	};
+
+	auto block = pos / blockSize;
+	auto endBlock = (endPos + blockSize - 1) / blockSize;
+	std::unique_lock lock(mutex);
+	while (block < endBlock) {
+		if (auto it = blockToSlot.find(block); it != blockToSlot.end()) {
+			copyOut(block, slotData(it->second));
+			++stats.hits;
+			++block;
+			continue;
+		}
+		if (isBusy(block)) {
+			// it's being read ahead right now, wait for it
+			cv.wait(lock);
+			continue;
+		}
+
+		// Read all consecutive missing blocks in one go.
+		auto runEnd = block + 1;
+		while ((runEnd < endBlock) && !blockToSlot.contains(runEnd) && !isBusy(runEnd)) {
+			++runEnd;
+		}
+		// Don't also read these blocks again in the background.
+		for (auto& r : requests) {
+			if ((r.begin >= block) && (r.begin < runEnd)) r.begin = std::min(runEnd, r.end);
+		}
+		std::erase_if(requests, [](const Range& r) { return r.begin == r.end; });
+
+		Range range{block, runEnd};
+		std::vector<uint8_t> tmp((runEnd - block) * blockSize);
+		lock.unlock();
+		{
+			std::scoped_lock fileLock(fileMutex);
+			readBlocks(range, tmp);
+		}
+		lock.lock();
+		stats.misses += runEnd - block;
+		insertBlocks(range, tmp);
+		for (/**/; block < runEnd; ++block) {
+			copyOut(block, std::span{tmp}.subspan((block - range.begin) * blockSize, blockSize));
+		}
+	}
+
+	bool sequential = pos == nextPos;
+	nextPos = endPos;
+	readAhead(sequential, endBlock);
+}
+
+void ReadAheadCache::readAhead(bool sequential, size_t endBlock)
+{
+	if (!sequential) {
+		// Stop reading ahead, though let a range that's already being
+		// read finish.
+		window = 0;
+		prefetchEnd = 0;
+		requests.clear();
+		return;
+	}
+	// Start small, so that a few accidental sequential reads don't cause
+	// much extra I/O, and grow while the sequential access continues.
+	window = std::min(std::max(2 * window, MIN_WINDOW), numSlots / 4);
+	auto numBlocks = (fileSize + blockSize - 1) / blockSize;
+	auto target = std::min(endBlock + window, numBlocks);
+	auto begin = std::max(prefetchEnd, endBlock);
+	// Only request reasonably large ranges.
+	if (target < (begin + window / 2)) return;
+	while ((begin < target) && blockToSlot.contains(begin)) ++begin;
+	prefetchEnd = target;
+	if (begin == target) return;
+	requests.push_back(Range{begin, target});
+	startThread();
+	cv.notify_all();
+}
+
+void ReadAheadCache::write(size_t pos, std::span<const uint8_t> buf)
+{
+	assert((pos % blockSize) == 0);
+	assert((buf.size() % blockSize) == 0);
+
+	std::unique_lock lock(mutex);
+	startThread();
+	auto block = pos / blockSize;
+	while (!buf.empty()) {
+		if (numDirty >= (numSlots / 2)) {
+			// Don't let the dirty blocks take up the whole cache.
+			cv.notify_all();
+			cv.wait(lock, [&] { return (numDirty < (numSlots / 2)) || writeError; });
+		}
+		auto it = blockToSlot.find(block);
+		if ((it == blockToSlot.end()) && (numDirty == numSlots)) {
+			// Only possible after write errors: there's no room left,
+			// so the rest of this data is lost.
+			assert(writeError);
+			break;
+		}
+		auto slot = (it != blockToSlot.end()) ? it->second : allocateSlot(block);
+		copy_to_range(buf.first(blockSize), slotData(slot));
+		auto& s = slots[slot];
+		if (!s.dirty) {
+			s.dirty = true;
+			++numDirty;
+		}
+		s.writeCount = ++writeCounter;
+		buf = buf.subspan(blockSize);
+		++block;
+	}
+	cv.notify_all();
+	// Only now report an earlier error (that error mentions the position
+	// that failed), the new data is already stored.
+	rethrowWriteError();
+}
+
+bool ReadAheadCache::flush()
+{
+	std::unique_lock lock(mutex);
+	waitIdle(lock);
+	rethrowWriteError();
+	bool result = std::exchange(wroteSinceFlush, false);
+	lock.unlock();
+
+	if (result) {
+		std::scoped_lock fileLock(fileMutex);
+		file.flush();
+	}
+	return result;
+}
+
+void ReadAheadCache::invalidate()
+{
+	std::unique_lock lock(mutex);
+	waitIdle(lock);
+	for (auto& s : slots) {
+		s.block = NO_BLOCK;
+		s.dirty = false; // could not be written, dropped
+	}
+	blockToSlot.clear();
+	victim = 0;
+	numDirty = 0;
+	wroteSinceFlush = false;
+	writeError = nullptr;
+	stats = {};
+	fileSize = size_t(-1);
+	nextPos = 0;
+}
+
+void ReadAheadCache::waitIdle(std::unique_lock<std::mutex>& lock)
+{
+	requests.clear();
+	prefetchEnd = 0;
+	window = 0;
+	cv.notify_all();
+	cv.wait(lock, [&] {
+		return ((numDirty == 0) || writeError) && (busy.begin == busy.end);
+	});
+}
+
+void ReadAheadCache::rethrowWriteError()
+{
+	if (writeError) {
+		// The failed blocks are still dirty, the thread retries to
+		// write them.
+		cv.notify_all();
+		std::rethrow_exception(std::exchange(writeError, nullptr));
+	}
+}
+
+ReadAheadCache::Stats ReadAheadCache::getStats()
+{
+	std::scoped_lock lock(mutex);
+	return stats;
+}
+
+size_t ReadAheadCache::allocateSlot(size_t block)
+{
+	if (slots.empty()) {
+		// only allocate when the cache is actually used
+		slots.resize(numSlots);
+		data.resize(numSlots * blockSize);
+	}
+	// Dirty slots can't be reused, but at most half of them are dirty.
+	while (slots[victim].dirty) victim = (victim + 1) % numSlots;
+	auto slot = victim;
+	victim = (victim + 1) % numSlots;
+
+	auto& s = slots[slot];
+	if (s.block != NO_BLOCK) blockToSlot.erase(s.block);
+	s.block = block;
+	blockToSlot[block] = slot;
+	return slot;
+}
+
+void ReadAheadCache::readBlocks(Range range, std::span<uint8_t> buf)
+{
+	// The last block can be partial.
+	auto start = range.begin * blockSize;
+	auto len = std::min(buf.size(), fileSize - start);
+	file.seek(start);
+	file.read(buf.first(len));
+	std::ranges::fill(buf.subspan(len), 0);
+}
+
+void ReadAheadCache::insertBlocks(Range range, std::span<const uint8_t> buf)
+{
+	for (auto block = range.begin; block < range.end; ++block) {
+		// A cached block is either the same or more recent (written).
+		if (blockToSlot.contains(block)) continue;
+		auto slot = allocateSlot(block);
+		copy_to_range(buf.subspan((block - range.begin) * blockSize, blockSize),
+		              slotData(slot));
+	}
+}
+
+void ReadAheadCache::startThread()
+{
+	if (!thread.joinable()) {
+		thread = std::thread([this] { run(); });
+	}
+}
+
+void ReadAheadCache::run()
+{
+	std::unique_lock lock(mutex);
+	while (true) {
+		// After a write error, only retry once the main thread got
+		// that error.
+		cv.wait(lock, [&] { return stop || (numDirty && !writeError) || !requests.empty(); });
+		if (numDirty && !writeError) {
+			// writes have priority
+			writeBack(lock);
+			continue;
+		}
+		if (stop) break;
+
+		busy = requests.front();
+		requests.pop_front();
+		while ((busy.begin < busy.end) && blockToSlot.contains(busy.begin)) ++busy.begin;
+		if (busy.begin == busy.end) continue;
+
+		auto range = busy;
+		std::vector<uint8_t> tmp((range.end - range.begin) * blockSize);
+		lock.unlock();
+		bool ok = true;
+		try {
+			std::scoped_lock fileLock(fileMutex);
+			readBlocks(range, tmp);
+		} catch (MSXException&) {
+			// ignore, the main thread gets the error when it actually
+			// needs this data
+			ok = false;
+		}
+		lock.lock();
+		if (ok) {
+			insertBlocks(range, tmp);
+			stats.prefetched += range.end - range.begin;
+		}
+		busy = Range{0, 0};
+		cv.notify_all();
+	}
+}
+
+void ReadAheadCache::writeBack(std::unique_lock<std::mutex>& lock)
+{
+	struct Item {
+		size_t block;
+		size_t slot;
+		uint64_t writeCount;
+	};
+	std::vector<Item> items;
+	items.reserve(numDirty);
+	for (auto i : xrange(numSlots)) {
+		if (const auto& s = slots[i]; s.dirty) {
+			items.push_back(Item{s.block, i, s.writeCount});
+		}
+	}
+	std::ranges::sort(items, {}, &Item::block);
+	std::vector<uint8_t> tmp(items.size() * blockSize);
+	for (auto i : xrange(items.size())) {
+		copy_to_range(slotData(items[i].slot),
+		              std::span{tmp}.subspan(i * blockSize, blockSize));
+	}
+	lock.unlock();
+
+	std::exception_ptr error;
+	size_t i = 0;
+	try {
+		std::scoped_lock fileLock(fileMutex);
+		while (i < items.size()) {
+			// combine consecutive blocks
+			auto j = i + 1;
+			while ((j < items.size()) && (items[j].block == (items[j - 1].block + 1))) ++j;
+			file.seek(items[i].block * blockSize);
+			file.write(std::span{tmp}.subspan(i * blockSize, (j - i) * blockSize));
+			i = j;
+		}
+	} catch (MSXException& e) {
+		// reported on the next write() or flush()
+		error = std::make_exception_ptr(FileException(
+			"Error writing at offset ", items[i].block * blockSize,
+			": ", e.getMessage()));
+	}
+
+	lock.lock();
+	wroteSinceFlush = true; // possibly partially
+	if (error) {
+		// keep the blocks dirty
+		writeError = error;
+		cv.notify_all();
+		return;
+	}
+	for (const auto& item : items) {
+		// unless it was written again in the meantime
+		if (auto& s = slots[item.slot]; s.writeCount == item.writeCount) {
+			assert(s.dirty && (s.block == item.block));
+			s.dirty = false;
+			--numDirty;
+		}
+	}
+	stats.written += items.size();
+	cv.notify_all();
+}
+
+} // namespace openmsx
@@ -0,0 +1,144 @@
+#ifndef READAHEADCACHE_HH
+#define READAHEADCACHE_HH
+
+#include "File.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace openmsx {
+
+/** Caches the content of a (large) image file, used for harddisk and CD-ROM
+  * images.
+  *
+  * Sequential reads are detected, and then the data that will (likely) be
+  * read next is already fetched in a background thread. So the emulation
+  * thread doesn't need to wait for the (possibly slow) host disk. The amount
+  * that is read ahead grows the longer the sequential access continues.
+  *
+  * Writes are only stored in the cache, a background thread writes them to the
+  * file (combining adjacent blocks). Reads of written data are served from the
+  * cache. Call flush() to wait till everything is written, e.g. before a
+  * savestate, and invalidate() before the file is closed or replaced.
+  *
+  * All methods must be called from the same (=main) thread. After flush()
+  * returns, and until the next read() or write(), the background thread
+  * doesn't touch the file. So in between the file can be used directly, as
+  * long as it's not modified.
+  */
+class ReadAheadCache
+{
+public:
+	struct Stats {
+		uint64_t hits = 0;       // blocks read from the cache
+		uint64_t misses = 0;     // blocks that had to be read from the file
+		uint64_t prefetched = 0; // blocks read in advance
+		uint64_t written = 0;    // blocks written back to the file
+	};
+
+	/** @param file The file, it's not owned, but must outlive this cache.
+	  * @param blockSize The granularity of the cache (e.g. the sector size).
+	  * @param cacheSize The total size of the cache (in bytes).
+	  */
+	ReadAheadCache(File& file, size_t blockSize, size_t cacheSize = 1024 * 1024);
+	ReadAheadCache(const ReadAheadCache&) = delete;
+	ReadAheadCache& operator=(const ReadAheadCache&) = delete;
+	~ReadAheadCache();
+
+	/** Read 'buf.size()' bytes starting at position 'pos'. This doesn't need
+	  * to be aligned to blocks.
+	  * @throws FileException
+	  */
+	void read(size_t pos, std::span<uint8_t> buf);
+
+	/** Write complete blocks, 'pos' and 'buf.size()' must be multiples of
+	  * the block size. The data is written to the file later.
+	  * @throws FileException when writing (some) earlier data failed. The
+	  *         new data is still stored (unless the whole cache is filled
+	  *         with data that can't be written).
+	  */
+	void write(size_t pos, std::span<const uint8_t> buf);
+
+	/** Wait till all written data is in the file (and flush the file).
+	  * @result Was there anything written since the previous flush?
+	  * @throws FileException when writing (some) data failed. That data
+	  *         remains in the cache, writing it is retried later.
+	  */
+	bool flush();
+
+	/** Drop all cached data, must be called before the file is closed,
+	  * replaced or resized. Call flush() first, data that could not be
+	  * written is dropped (without an error). This also resets the
+	  * statistics.
+	  */
+	void invalidate();
+
+	[[nodiscard]] Stats getStats();
+
+private:
+	static constexpr auto NO_BLOCK = size_t(-1);
+
+	struct Slot {
+		size_t block = NO_BLOCK;
+		uint64_t writeCount = 0; // to detect re-writes during write-back
+		bool dirty = false;
+	};
+	struct Range {
+		size_t begin;
+		size_t end;
+	};
+
+	[[nodiscard]] std::span<uint8_t> slotData(size_t slot) {
+		return std::span{data}.subspan(slot * blockSize, blockSize);
+	}
+	[[nodiscard]] size_t allocateSlot(size_t block); // requires 'mutex'
+	void readBlocks(Range range, std::span<uint8_t> buf); // requires 'fileMutex'
+	void insertBlocks(Range range, std::span<const uint8_t> buf); // requires 'mutex'
+	void readAhead(bool sequential, size_t endBlock); // requires 'mutex'
+	void startThread(); // requires 'mutex'
+	void waitIdle(std::unique_lock<std::mutex>& lock);
+	void rethrowWriteError(); // requires 'mutex'
+	void run();
+	void writeBack(std::unique_lock<std::mutex>& lock);
+
+private:
+	File& file;
+	const size_t blockSize;
+	const size_t numSlots;
+	size_t fileSize = size_t(-1); // only read from the file when needed
+
+	// sequential access detection, only used by the main thread
+	size_t nextPos = 0; // position right after the previous read
+	size_t window = 0;  // number of blocks to read ahead, 0 when not sequential
+	size_t prefetchEnd = 0; // end of the (requested) read-ahead data
+
+	std::mutex fileMutex; // serializes all file access
+
+	std::mutex mutex; // protects everything below
+	std::condition_variable cv; // signals all changes in the state below
+	std::vector<uint8_t> data;
+	std::vector<Slot> slots;
+	std::unordered_map<size_t, size_t> blockToSlot;
+	size_t victim = 0; // next slot to reuse (FIFO)
+	size_t numDirty = 0;
+	uint64_t writeCounter = 0;
+	std::deque<Range> requests; // pending read-ahead
+	Range busy = {0, 0}; // range that is being read ahead right now
+	bool wroteSinceFlush = false;
+	std::exception_ptr writeError;
+	bool stop = false;
+	Stats stats;
+
+	std::thread thread; // only started when needed
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,186 @@
+#include "SeekableInflate.hh"
+
+#include "FileException.hh"
+
+#include "ranges.hh"
+
+#include <algorithm>
+#include <cassert>
+
+namespace openmsx {
+
+static constexpr size_t SPAN = 1024 * 1024; // distance between access points
+static constexpr size_t WINDOW_SIZE = 32 * 1024; // size of the deflate window
+static constexpr size_t CHUNK_SIZE = 64 * 1024; // granularity of the output cache
+static constexpr size_t NUM_CHUNKS = 32;
+static constexpr size_t MAX_INPUT_CHUNK = 1024 * 1024 * 1024; // 'avail_in' is only 32-bit
+
+SeekableInflate::SeekableInflate(MappedFile<const uint8_t> input_, size_t start, size_t size_)
+	: input(std::move(input_))
+	, size(size_)
+	, chunks(NUM_CHUNKS)
+{
+	if (start > input.size()) {
+		throw FileException("Error while decompressing: unexpected end of file.");
+	}
+	s.zalloc = nullptr;
+	s.zfree  = nullptr;
+	s.opaque = nullptr;
+	s.next_in  = nullptr;
+	s.avail_in = 0;
+	if (int err = inflateInit2(&s, -MAX_WBITS);
+	    err != Z_OK) {
+		throw FileException(
+			"Error initializing inflate struct: ", zError(err));
+	}
+	index.push_back(AccessPoint{.out = 0, .in = start, .bits = 0, .window = {}});
+	restart(index.front());
+}
+
+SeekableInflate::~SeekableInflate()
+{
+	inflateEnd(&s);
+}
+
+void SeekableInflate::read(size_t pos, std::span<uint8_t> output)
+{
+	if ((pos > size) || (output.size() > (size - pos))) {
+		throw FileException("Read beyond end of file");
+	}
+	std::scoped_lock lock(mutex);
+	while (!output.empty()) {
+		auto chunk = getChunk(pos / CHUNK_SIZE).subspan(pos % CHUNK_SIZE);
+		auto num = std::min(chunk.size(), output.size());
+		copy_to_range(chunk.first(num), output);
+		output = output.subspan(num);
+		pos += num;
+	}
+}
+
+std::span<const uint8_t> SeekableInflate::getChunk(size_t num)
+{
+	auto chunkStart = num * CHUNK_SIZE;
+	auto len = std::min(CHUNK_SIZE, size - chunkStart);
+	if (auto it = std::ranges::find(chunks, num, &Chunk::num);
+	    it != chunks.end()) {
+		it->lastUse = ++useCounter;
+		return {it->data.data(), len};
+	}
+
+	// Continue from the current position, unless we're already past the
+	// requested position or there's a closer access point.
+	auto it = std::ranges::upper_bound(index, chunkStart, {}, &AccessPoint::out);
+	assert(it != index.begin());
+	--it;
+	if ((outPos > chunkStart) || (it->out > outPos)) {
+		restart(*it);
+	}
+
+	auto& chunk = *std::ranges::min_element(chunks, {}, &Chunk::lastUse);
+	chunk.num = size_t(-1); // in case of an exception
+	if (chunk.data.empty()) chunk.data.resize(CHUNK_SIZE);
+	std::span<uint8_t> buf{chunk.data.data(), CHUNK_SIZE};
+	try {
+		while (outPos < chunkStart) {
+			// skip, (ab)use the chunk buffer as scratch area
+			inflate(buf.first(std::min(CHUNK_SIZE, chunkStart - outPos)));
+		}
+		inflate(buf.first(len));
+	} catch (FileException&) {
+		outPos = size_t(-1); // force restart on the next read
+		throw;
+	}
+	chunk.num = num;
+	chunk.lastUse = ++useCounter;
+	return buf.first(len);
+}
+
+void SeekableInflate::restart(const AccessPoint& point)
+{
+	inflateReset(&s);
+	s.avail_in = 0;
+	inPos = point.in;
+	outPos = point.out;
+	if (point.bits) {
+		// the access point is in the middle of a byte
+		inflatePrime(&s, point.bits, input[point.in - 1] >> (8 - point.bits));
+	}
+	if (!point.window.empty()) {
+		inflateSetDictionary(&s, point.window.data(), uInt(point.window.size()));
+	}
+}
+
+void SeekableInflate::inflate(std::span<uint8_t> output)
+{
+	s.next_out = output.data();
+	s.avail_out = uInt(output.size());
+	while (s.avail_out) {
+		if (inflateStep()) {
+			if (s.avail_out) {
+				throw FileException(
+					"Error while decompressing: unexpected end of compressed data.");
+			}
+			return;
+		}
+	}
+	if (outPos == size) {
+		// The stated size can be wrong, e.g. gzip only stores it modulo
+		// 4GB. So check that the data really ends here, otherwise we'd
+		// silently serve truncated data.
+		uint8_t dummy;
+		s.next_out = &dummy;
+		s.avail_out = 1;
+		while (!inflateStep()) {
+			if (s.avail_out == 0) {
+				throw FileException(
+					"Error while decompressing: the decompressed data is "
+					"larger than the stated size (files of 4GB or more "
+					"are not supported).");
+			}
+		}
+	}
+}
+
+bool SeekableInflate::inflateStep()
+{
+	if (s.avail_in == 0) {
+		// (at the end of the input) zlib can possibly still make
+		// progress with the bits it already consumed
+		auto num = std::min(input.size() - inPos, MAX_INPUT_CHUNK);
+		s.next_in = input.data() + inPos;
+		s.avail_in = uInt(num);
+		inPos += num;
+	}
+	auto before = s.avail_out;
+	// Z_BLOCK: also stop at the end of each deflate block
+	int err = ::inflate(&s, Z_BLOCK);
+	outPos += before - s.avail_out;
+	if (err == Z_STREAM_END) return true;
+	if ((err == Z_BUF_ERROR) && (s.avail_in == 0)) {
+		throw FileException(
+			"Error while decompressing: unexpected end of file.");
+	}
+	if (err != Z_OK) {
+		throw FileException("Error decompressing gzip: ", zError(err));
+	}
+	// bit 7: at the end of a block, bit 6: that was the last block
+	if ((s.data_type & 128) && !(s.data_type & 64) &&
+	    (outPos >= (index.back().out + SPAN))) {
+		addAccessPoint();
+	}
+	return false;
+}
+
+void SeekableInflate::addAccessPoint()
+{
+	AccessPoint point{.out = outPos,
+	                  .in = inPos - s.avail_in,
+	                  .bits = s.data_type & 7,
+	                  .window = MemBuffer<uint8_t>(WINDOW_SIZE)};
+	auto len = uInt(WINDOW_SIZE);
+	inflateGetDictionary(&s, point.window.data(), &len);
+	point.window.resize(len);
+	index.push_back(std::move(point));
+}
+
+} // namespace openmsx
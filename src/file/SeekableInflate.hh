@@ -0,0 +1,89 @@
+#ifndef SEEKABLEINFLATE_HH
+#define SEEKABLEINFLATE_HH
+
+#include "MappedFile.hh"
+
+#include "MemBuffer.hh"
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#define ZLIB_CONST
+#include <zlib.h>
+
+namespace openmsx {
+
+/** Random access reads in a (raw) deflate stream, without decompressing the
+  * whole stream up-front. Used by CompressedFileAdapter for large files (e.g.
+  * gzip'ed harddisk images).
+  *
+  * This is based on the zran.c example from zlib: while decompressing, the
+  * decompressor state at a block boundary is remembered (about) every 1MB of
+  * output. A read then only needs to decompress from the closest such point
+  * before the requested position. These points are added on the fly, the
+  * first read at a far position still needs to decompress everything before
+  * it (but without keeping that output). The most recently used output is
+  * also cached, so that (nearby) small reads don't need to decompress the
+  * same data again and again.
+  *
+  * Reading is thread-safe.
+  */
+class SeekableInflate
+{
+public:
+	/** @param input The compressed file.
+	  * @param start Position of the deflate stream in the input.
+	  * @param size Size of the decompressed data. When the data turns out
+	  *             to be larger, reading the end of the data throws.
+	  * @throws FileException
+	  */
+	SeekableInflate(MappedFile<const uint8_t> input, size_t start, size_t size);
+	SeekableInflate(const SeekableInflate&) = delete;
+	SeekableInflate& operator=(const SeekableInflate&) = delete;
+	~SeekableInflate();
+
+	[[nodiscard]] size_t getSize() const { return size; }
+
+	/** Read 'output.size()' bytes starting at position 'pos', this range
+	  * must be within the decompressed size.
+	  * @throws FileException
+	  */
+	void read(size_t pos, std::span<uint8_t> output);
+
+private:
+	struct AccessPoint {
+		size_t out; // position in the decompressed data
+		size_t in;  // position in the input of the first complete byte
+		int bits;   // number of bits of the byte before 'in' that still need to be processed
+		MemBuffer<uint8_t> window; // the output (max 32kB) right before 'out'
+	};
+	struct Chunk {
+		size_t num = size_t(-1);
+		MemBuffer<uint8_t> data;
+		uint64_t lastUse = 0;
+	};
+
+	[[nodiscard]] std::span<const uint8_t> getChunk(size_t num);
+	void restart(const AccessPoint& point);
+	void inflate(std::span<uint8_t> output);
+	[[nodiscard]] bool inflateStep();
+	void addAccessPoint();
+
+private:
+	MappedFile<const uint8_t> input;
+	const size_t size;
+
+	std::mutex mutex; // protects everything below
+	z_stream s;
+	size_t inPos;  // end of the input that was given to 's' so far
+	size_t outPos; // current position of 's' in the decompressed data
+	std::vector<AccessPoint> index; // sorted on 'out'
+	std::vector<Chunk> chunks;
+	uint64_t useCounter = 0;
+};
+
+} // namespace openmsx
+
+#endif
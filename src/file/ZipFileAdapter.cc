@@ -2,6 +2,7 @@
 
 #include "FileException.hh"
 #include "MappedFile.hh"
+#include "SeekableInflate.hh"
 #include "ZlibInflate.hh"
 
 namespace openmsx {
@@ -38,6 +39,13 @@ void ZipFileAdapter::decompress(FileBase& f, Decompressed& d)
 	d.originalName = zlib.getString(filenameLen); // original filename
 	zlib.skip(extraFieldLen); // skip "extra field"
 
+	// origSize is 0 when it's stored after the compressed data, and
+	// 0xFFFFFFFF for a zip64 file
+	if ((origSize >= STREAM_THRESHOLD) && (origSize != 0xFFFFFFFF)) {
+		d.stream = std::make_unique<SeekableInflate>(
+			std::move(mmap), zlib.getInputPos(), origSize);
+		return;
+	}
 	d.buf = zlib.inflate(origSize);
 }
 
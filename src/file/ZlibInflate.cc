@@ -22,6 +22,7 @@ ZlibInflate::ZlibInflate(std::span<const uint8_t> input)
 	s.opaque = nullptr;
 	s.next_in  = input.data();
 	s.avail_in = inputLen;
+	inputSize = inputLen;
 	wasInit = false;
 }
 
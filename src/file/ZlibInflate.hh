@@ -29,10 +29,14 @@ public:
 	[[nodiscard]] std::string getString(size_t len);
 	[[nodiscard]] std::string getCString();
 
+	/** Number of input bytes that were consumed so far. */
+	[[nodiscard]] size_t getInputPos() const { return inputSize - s.avail_in; }
+
 	[[nodiscard]] MemBuffer<uint8_t> inflate(size_t sizeHint = 65536);
 
 private:
 	z_stream s;
+	size_t inputSize;
 	bool wasInit;
 };
 
@@ -3,6 +3,7 @@
 #include "DeviceConfig.hh"
 #include "Display.hh"
 #include "FileContext.hh"
+#include "FileOperations.hh"
 #include "FilePool.hh"
 #include "GlobalSettings.hh"
 #include "HDImageCLI.hh"
@@ -14,14 +15,47 @@
 
 #include "narrow.hh"
 #include "serialize.hh"
+#include "sha1.hh"
+#include "strCat.hh"
 #include "tiger.hh"
 
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
+#include <cstring>
+#include <fstream>
+#include <map>
 #include <memory>
+#include <vector>
 
 namespace openmsx {
 
+// The upper part of the tiger-tree of an image is saved between sessions, so
+// that the hash of a large (unchanged) image doesn't need to be recalculated
+// on each startup, and a change only requires to rehash a small part of the
+// image. The cache is only used when the size and modification time of the
+// image still match.
+static constexpr size_t TTH_CACHE_MIN_BLOCKS = 256; // 256kB
+static constexpr std::array<char, 8> TTH_CACHE_MAGIC = {'o', 'M', 'S', 'X', 't', 't', 'h', '1'};
+static constexpr uint32_t TTH_CACHE_ENDIAN = 0x01020304;
+
+struct TTHCacheHeader {
+	std::array<char, 8> magic;
+	uint32_t endian;
+	uint32_t count; // number of nodes
+	uint64_t dataSize;
+	int64_t time;
+};
+static_assert(sizeof(TTHCacheHeader) == 32);
+static_assert(std::is_trivially_copyable_v<TigerTree::SavedNode>);
+
+// All HDs (of all machines) that currently use a certain (resolved) image.
+// E.g. reverse and 'clone_machine' create a new machine while the old one
+// still has the image open. Each HD has its own write-back cache, so the
+// caches are only used while a single HD uses the image.
+static std::map<std::string, std::vector<HD*>, std::less<>> imageUsers;
+
 std::shared_ptr<HD::HDInUse> HD::getDrivesInUse(MSXMotherBoard& motherBoard)
 {
 	return motherBoard.getSharedStuff<HDInUse>("hdInUse");
@@ -56,6 +90,7 @@ HD::HD(const DeviceConfig& config)
 		filename = Filename(std::move(cliImage), userFileContext());
 	}
 
+	flushImageUsers(filename.getResolved()); // before we read the image
 	file = File(filename.getResolved(), mode);
 	filesize = file.getSize();
 	if (mode == File::OpenMode::CREATE && filesize == 0) {
@@ -65,6 +100,7 @@ HD::HD(const DeviceConfig& config)
 		filesize = file.getSize();
 	}
 	tigerTree.emplace(*this, filesize, filename.getResolved());
+	loadTigerTreeCache();
 
 	(*hdInUse)[id] = true;
 	hdCommand.emplace(
@@ -76,10 +112,14 @@ HD::HD(const DeviceConfig& config)
 
 	motherBoard.registerMediaProvider(name, *this);
 	motherBoard.getMSXCliComm().update(CliComm::UpdateType::HARDWARE, name, "add");
+	registerImage(); // for exception safety, only at the end
 }
 
 HD::~HD()
 {
+	flushWrites();
+	saveTigerTreeCache();
+	unregisterImage();
 	motherBoard.unregisterMediaProvider(*this);
 	motherBoard.getMSXCliComm().update(CliComm::UpdateType::HARDWARE, name, "remove");
 
@@ -90,8 +130,13 @@ HD::~HD()
 
 void HD::getMediaInfo(TclObject& result)
 {
+	auto stats = sectorCache.getStats();
 	result.addDictKeyValues("target", getImageName().getResolved(),
-	                        "readonly", isWriteProtected());
+	                        "readonly", isWriteProtected(),
+	                        "cache", makeTclDict("hits", stats.hits,
+	                                             "misses", stats.misses,
+	                                             "prefetched", stats.prefetched,
+	                                             "written", stats.written));
 }
 
 void HD::setMedia(const TclObject& info, EmuTime /*time*/)
@@ -104,10 +149,18 @@ void HD::setMedia(const TclObject& info, EmuTime /*time*/)
 
 void HD::switchImage(const Filename& newFilename)
 {
-	file = File(newFilename.getResolved());
+	File newFile(newFilename.getResolved());
+	flushWrites();
+	saveTigerTreeCache();
+	unregisterImage();
+	sectorCache.invalidate();
+	flushImageUsers(newFilename.getResolved());
+	file = std::move(newFile);
 	filename = newFilename;
 	filesize = file.getSize();
 	tigerTree.emplace(*this, filesize, filename.getResolved());
+	loadTigerTreeCache();
+	registerImage();
 	motherBoard.getMSXCliComm().update(CliComm::UpdateType::MEDIA, getName(),
 	                                   filename.getResolved());
 }
@@ -120,16 +173,30 @@ size_t HD::getNbSectorsImpl()
 void HD::readSectorsImpl(
 	std::span<SectorBuffer> buffers, size_t startSector)
 {
-	file.seek(startSector * sizeof(SectorBuffer));
-	file.read(buffers);
+	auto pos = startSector * sizeof(SectorBuffer);
+	auto dst = std::span{std::bit_cast<uint8_t*>(buffers.data()), buffers.size_bytes()};
+	if (cacheEnabled) {
+		sectorCache.read(pos, dst);
+	} else {
+		file.seek(pos);
+		file.read(dst);
+	}
 }
 
 void HD::writeSectorImpl(size_t sector, const SectorBuffer& buf)
 {
-	file.seek(sector * sizeof(buf));
-	file.write(buf.raw);
-	tigerTree->notifyChange(sector * sizeof(buf), sizeof(buf),
-	                        file.getModificationDate());
+	if (!cacheEnabled) {
+		file.seek(sector * sizeof(buf));
+		file.write(buf.raw);
+		tigerTree->notifyChange(sector * sizeof(buf), sizeof(buf),
+		                        file.getModificationDate());
+		return;
+	}
+	// The modification time is updated in flushWrites(), once the data is
+	// in the file. (Also, right now the cache's thread may use the file.)
+	// Notify first: the data is stored, even if write() throws.
+	tigerTree->notifyChange(sector * sizeof(buf), sizeof(buf));
+	sectorCache.write(sector * sizeof(buf), buf.raw); // written to the file later
 }
 
 bool HD::isWriteProtectedImpl() const
@@ -142,6 +209,7 @@ Sha1Sum HD::getSha1SumImpl(FilePool& filePool)
 	if (hasPatches()) {
 		return SectorAccessibleDisk::getSha1SumImpl(filePool);
 	}
+	flushWrites();
 	return filePool.getSha1Sum(file, filename.getResolved());
 }
 
@@ -166,29 +234,83 @@ void HD::showProgress(size_t position, size_t maxPosition)
 
 std::string HD::getTigerTreeHash()
 {
+	flushWrites(); // also when creating a savestate
 	lastProgressTime = Timer::getTime();
 	everDidProgress = false;
 	auto callback = [this](size_t p, size_t t) { showProgress(p, t); };
 	return tigerTree->calcHash(callback).toString(); // calls HD::getData()
 }
 
-uint8_t* HD::getData(size_t offset, size_t size)
+const uint8_t* HD::getData(size_t offset, size_t size)
 {
 	assert(size <= TigerTree::BLOCK_SIZE);
 	assert((offset % sizeof(SectorBuffer)) == 0);
 	assert((size   % sizeof(SectorBuffer)) == 0);
 
-	struct Work {
-		char extra; // at least one byte before 'bufs'
-		// likely there are padding bytes in between
-		std::array<SectorBuffer, TigerTree::BLOCK_SIZE / sizeof(SectorBuffer)> bufs;
-	};
-	static Work work; // not reentrant
+	static std::array<SectorBuffer, TigerTree::BLOCK_SIZE / sizeof(SectorBuffer)> bufs; // not reentrant
 
 	size_t sector = offset / sizeof(SectorBuffer);
 	size_t num    = size   / sizeof(SectorBuffer);
-	readSectors(std::span{work.bufs.data(), num}, sector); // This possibly applies IPS patches.
-	return work.bufs[0].raw.data();
+	readSectors(std::span{bufs.data(), num}, sector); // This possibly applies IPS patches.
+	return bufs[0].raw.data();
+}
+
+void HD::flushWrites()
+{
+	// Writing changes the modification time of the file, update it in the
+	// tiger-tree, otherwise the whole tree is considered invalid.
+	try {
+		if (sectorCache.flush() && tigerTree) {
+			tigerTree->notifyChange(0, 0, file.getModificationDate());
+		}
+	} catch (MSXException& e) {
+		motherBoard.getMSXCliComm().printWarning(
+			"Error writing hard disk image ", filename.getResolved(),
+			": ", e.getMessage());
+	}
+}
+
+void HD::flushImageUsers(std::string_view resolved)
+{
+	if (auto it = imageUsers.find(resolved); it != imageUsers.end()) {
+		for (auto* hd : it->second) hd->flushWrites();
+	}
+}
+
+void HD::registerImage()
+{
+	auto& users = imageUsers[filename.getResolved()];
+	users.push_back(this);
+	if (users.size() > 1) {
+		for (auto* hd : users) hd->setCaching(false);
+	}
+}
+
+void HD::unregisterImage()
+{
+	auto it = imageUsers.find(filename.getResolved());
+	if (it == imageUsers.end()) return;
+	auto& users = it->second;
+	if (auto u = std::ranges::find(users, this); u != users.end()) {
+		users.erase(u);
+	}
+	if (users.empty()) {
+		imageUsers.erase(it);
+	} else if (users.size() == 1) {
+		users.front()->setCaching(true);
+	}
+	cacheEnabled = true;
+}
+
+void HD::setCaching(bool enabled)
+{
+	if (cacheEnabled == enabled) return;
+	if (!enabled) {
+		// Afterwards the cache's thread no longer uses the file.
+		flushWrites();
+		sectorCache.invalidate();
+	}
+	cacheEnabled = enabled;
 }
 
 bool HD::isCacheStillValid(time_t& cacheTime)
@@ -199,6 +321,80 @@ bool HD::isCacheStillValid(time_t& cacheTime)
 	return result;
 }
 
+std::string HD::getTigerTreeCacheName() const
+{
+	// Not stored next to the image: that directory might not be writable.
+	const auto& resolved = filename.getResolved();
+	auto sum = SHA1::calc(std::span{std::bit_cast<const uint8_t*>(resolved.data()), resolved.size()});
+	return strCat(FileOperations::getUserDataDir(), "/tthcache/", sum);
+}
+
+void HD::loadTigerTreeCache()
+{
+	// With IPS patches the hashed data is not the content of the file.
+	if (!file.is_open() || hasPatches() || tigerTree->hasValidNodes()) return;
+	try {
+		File cache(getTigerTreeCacheName());
+		auto size = cache.getSize();
+		if (size < sizeof(TTHCacheHeader)) return;
+		TTHCacheHeader header;
+		cache.read(std::span{std::bit_cast<uint8_t*>(&header), sizeof(header)});
+		if ((header.magic != TTH_CACHE_MAGIC) ||
+		    (header.endian != TTH_CACHE_ENDIAN) ||
+		    (header.dataSize != filesize) ||
+		    (header.time != int64_t(file.getModificationDate())) ||
+		    (size != sizeof(header) + header.count * sizeof(TigerTree::SavedNode))) {
+			return;
+		}
+		std::vector<TigerTree::SavedNode> nodes(header.count);
+		cache.read(std::span{std::bit_cast<uint8_t*>(nodes.data()),
+		                     nodes.size() * sizeof(TigerTree::SavedNode)});
+		tigerTree->restoreNodes(nodes);
+	} catch (MSXException&) {
+		// no (readable) cache, ignore
+	}
+}
+
+void HD::saveTigerTreeCache()
+{
+	if (!file.is_open() || hasPatches() || !tigerTree) return;
+	auto nodes = tigerTree->getUpperNodes(TTH_CACHE_MIN_BLOCKS);
+	if (nodes.empty()) return; // small image or hash never calculated
+
+	try {
+		file.flush(); // so that the modification time is final
+		TTHCacheHeader header = {
+			.magic = TTH_CACHE_MAGIC,
+			.endian = TTH_CACHE_ENDIAN,
+			.count = uint32_t(nodes.size()),
+			.dataSize = filesize,
+			.time = int64_t(file.getModificationDate()),
+		};
+		auto cacheName = getTigerTreeCacheName();
+		if (FileOperations::isRegularFile(cacheName)) {
+			// Skip writing when the file is already up-to-date (e.g.
+			// when this HD is only re-created for reverse/loadstate).
+			File cache(cacheName);
+			TTHCacheHeader old;
+			if (cache.getSize() >= sizeof(old)) {
+				cache.read(std::span{std::bit_cast<uint8_t*>(&old), sizeof(old)});
+				if (memcmp(&old, &header, sizeof(header)) == 0) return;
+			}
+		} else {
+			FileOperations::mkdirp(FileOperations::getUserDataDir() + "/tthcache");
+		}
+		std::ofstream out;
+		FileOperations::openOfStream(out, cacheName, std::ios::binary);
+		if (!out.is_open()) return;
+		out.write(std::bit_cast<const char*>(&header), sizeof(header));
+		out.write(std::bit_cast<const char*>(nodes.data()),
+		          std::streamsize(nodes.size() * sizeof(TigerTree::SavedNode)));
+		// On a write error the size doesn't match, and the cache is ignored.
+	} catch (MSXException&) {
+		// it's only a cache, ignore
+	}
+}
+
 SectorAccessibleDisk* HD::getSectorAccessibleDisk()
 {
 	return this;
@@ -249,6 +445,9 @@ void HD::serialize(Archive& ar, unsigned version)
 			//  - So to get in the same state as the initial
 			//    savestate we again close the file. Otherwise the
 			//    checksum-check code below goes wrong.
+			flushWrites();
+			unregisterImage();
+			sectorCache.invalidate();
 			file.close();
 		} else {
 			tmp.updateAfterLoadState();
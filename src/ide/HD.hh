@@ -7,6 +7,7 @@
 #include "File.hh"
 #include "Filename.hh"
 #include "MSXMotherBoard.hh"
+#include "ReadAheadCache.hh"
 #include "SectorAccessibleDisk.hh"
 #include "serialize_meta.hh"
 
@@ -15,6 +16,7 @@
 #include <bitset>
 #include <optional>
 #include <string>
+#include <string_view>
 
 namespace openmsx {
 
@@ -63,10 +65,20 @@ private:
 	int insertDisk(const std::string& newFilename) override;
 
 	// TTData
-	[[nodiscard]] uint8_t* getData(size_t offset, size_t size) override;
+	[[nodiscard]] const uint8_t* getData(size_t offset, size_t size) override;
 	[[nodiscard]] bool isCacheStillValid(time_t& time) override;
 
+	[[nodiscard]] std::string getTigerTreeCacheName() const;
+	void loadTigerTreeCache();
+	void saveTigerTreeCache();
+
 	void showProgress(size_t position, size_t maxPosition);
+	void flushWrites();
+
+	static void flushImageUsers(std::string_view resolved);
+	void registerImage();
+	void unregisterImage();
+	void setCaching(bool enabled);
 
 private:
 	MSXMotherBoard& motherBoard;
@@ -77,6 +89,8 @@ private:
 	File file;
 	Filename filename;
 	size_t filesize;
+	ReadAheadCache sectorCache{file, sizeof(SectorBuffer)}; // must be destroyed before 'file'
+	bool cacheEnabled = true; // false while other HDs use the same image
 
 	std::shared_ptr<HDInUse> hdInUse;
 
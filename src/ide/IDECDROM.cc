@@ -72,7 +72,11 @@ IDECDROM::~IDECDROM()
 
 void IDECDROM::getMediaInfo(TclObject& result)
 {
-	result.addDictKeyValue("target", filename);
+	auto stats = sectorCache.getStats();
+	result.addDictKeyValues("target", filename,
+	                        "cache", makeTclDict("hits", stats.hits,
+	                                             "misses", stats.misses,
+	                                             "prefetched", stats.prefetched));
 }
 
 void IDECDROM::setMedia(const TclObject& info, EmuTime /*time*/)
@@ -122,8 +126,7 @@ unsigned IDECDROM::readBlockStart(AlignedBuffer& buf, unsigned count)
 	assert(readSectorData);
 	if (file.is_open()) {
 		//fprintf(stderr, "read sector data at %08X\n", transferOffset);
-		file.seek(transferOffset);
-		file.read(std::span{buf.data(), count});
+		sectorCache.read(transferOffset, std::span{buf.data(), count});
 		transferOffset += count;
 		return count;
 	} else {
@@ -320,6 +323,7 @@ void IDECDROM::executePacketCommand(AlignedBuffer& packet)
 
 void IDECDROM::eject()
 {
+	sectorCache.invalidate();
 	file.close();
 	filename.clear();
 	mediaChanged = true;
@@ -329,6 +333,7 @@ void IDECDROM::eject()
 
 void IDECDROM::insert(zstring_view fname)
 {
+	sectorCache.invalidate();
 	file = File(fname);
 	filename = fname;
 	mediaChanged = true;
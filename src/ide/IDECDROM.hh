@@ -5,6 +5,7 @@
 
 #include "File.hh"
 #include "MSXMotherBoard.hh"
+#include "ReadAheadCache.hh"
 #include "RecordedCommand.hh"
 
 #include <bitset>
@@ -84,6 +85,7 @@ private:
 	std::string name;
 	std::optional<CDXCommand> cdxCommand; // delayed init
 	File file;
+	ReadAheadCache sectorCache{file, 2048}; // must be destroyed before 'file'
 	std::string filename;
 	unsigned byteCountLimit;
 	unsigned transferOffset;
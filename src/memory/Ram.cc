@@ -112,7 +112,11 @@ void RamDebuggable::write(unsigned address, uint8_t value)
 template<typename Archive>
 void Ram::serialize(Archive& ar, unsigned /*version*/)
 {
-	ar.serialize_blob("ram", std::span{*this});
+	if constexpr (std::is_same_v<Archive, MemInputArchive>) {
+		ar.serialize_blob("ram", ram);
+	} else {
+		ar.serialize_blob("ram", std::span{*this});
+	}
 }
 INSTANTIATE_SERIALIZE_METHODS(Ram);
 
@@ -3,7 +3,7 @@
 
 #include "SimpleDebuggable.hh"
 
-#include "MemBuffer.hh"
+#include "CowBuffer.hh"
 #include "static_string_view.hh"
 
 #include <cstdint>
@@ -61,7 +61,7 @@ public:
 
 private:
 	const XMLElement& xml;
-	MemBuffer<uint8_t> ram;
+	CowBuffer ram; // shared between clones, see clone_machine
 	const std::optional<RamDebuggable> debuggable; // can be nullopt
 	bool dummyDebugWrite = false;
 };
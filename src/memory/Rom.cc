@@ -16,6 +16,7 @@
 #include "MemBuffer.hh"
 #include "PanasonicMemory.hh"
 #include "Reactor.hh"
+#include "RomCache.hh"
 #include "RomDatabase.hh"
 #include "RomInfo.hh"
 #include "XMLElement.hh"
@@ -191,18 +192,25 @@ void Rom::init(MSXMotherBoard& motherBoard, XMLElement& config,
 				"supported.");
 		}
 		try {
-			mmap = file.mmap<uint8_t>();
-			rom = *mmap;
+			// For file-based roms, calc sha1 via File::getSha1Sum(). It can
+			// possibly use the FilePool cache to avoid the calculation.
+			if (originalSha1.empty()) {
+				originalSha1 = filePool.getSha1Sum(file, filename);
+			}
+
+			if (config.findChild("patches")) {
+				// needs a private (writable) copy
+				mmap = file.mmap<uint8_t>();
+				rom = *mmap;
+			} else {
+				// share with all other Roms with the same content
+				sharedImage = RomCache::get(originalSha1, filename);
+				rom = sharedImage->getData();
+			}
 		} catch (FileException&) {
 			throw MSXException("Error reading ROM image: ", filename);
 		}
 
-		// For file-based roms, calc sha1 via File::getSha1Sum(). It can
-		// possibly use the FilePool cache to avoid the calculation.
-		if (originalSha1.empty()) {
-			originalSha1 = filePool.getSha1Sum(file, filename);
-		}
-
 		// verify SHA1
 		if (!checkSHA1(config)) {
 			motherBoard.getMSXCliComm().printWarning(
@@ -338,6 +346,7 @@ Rom::Rom(Rom&& r) noexcept
 	, file         (std::move(r.file))
 	, filename     (std::move(r.filename))
 	, mmap         (std::move(r.mmap))
+	, sharedImage  (std::move(r.sharedImage))
 	, originalSha1 (r.originalSha1)
 	, actualSha1   (r.actualSha1)
 	, name         (std::move(r.name))
@@ -23,6 +23,7 @@ class DeviceConfig;
 class FileContext;
 class RomDebuggable;
 class TclObject;
+namespace RomCache { class Image; }
 
 class Rom final
 {
@@ -66,6 +67,8 @@ private:
 	File file; // can be a closed file
 	std::string filename;
 	std::optional<MappedFile<uint8_t>> mmap; // non-const to allow patching
+	// read-only, shared with other Rom objects (also in other machines)
+	std::shared_ptr<const RomCache::Image> sharedImage;
 
 	mutable Sha1Sum originalSha1;
 	mutable Sha1Sum actualSha1;
@@ -0,0 +1,34 @@
+#include "RomCache.hh"
+
+#include "File.hh"
+
+#include <map>
+#include <mutex>
+
+namespace openmsx::RomCache {
+
+Image::Image(const std::string& filename)
+{
+	File file(filename);
+	data.resize(file.getSize());
+	file.read(data);
+}
+
+std::shared_ptr<const Image> get(const Sha1Sum& sha1, const std::string& filename)
+{
+	static std::mutex mutex;
+	static std::map<Sha1Sum, std::weak_ptr<const Image>> cache;
+
+	std::scoped_lock lock(mutex);
+	auto& weak = cache[sha1];
+	auto result = weak.lock();
+	if (!result) {
+		// also remove other stale entries
+		std::erase_if(cache, [&](const auto& p) { return p.second.expired() && (&p.second != &weak); });
+		result = std::make_shared<const Image>(filename);
+		weak = result;
+	}
+	return result;
+}
+
+} // namespace openmsx::RomCache
@@ -0,0 +1,52 @@
+#ifndef ROMCACHE_HH
+#define ROMCACHE_HH
+
+#include "MemBuffer.hh"
+#include "sha1.hh"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace openmsx {
+
+/** Process-wide cache of (unpatched) ROM images, indexed by their SHA1 sum.
+  *
+  * Rom objects with the same content share one immutable image, also when
+  * they belong to different machines (e.g. many identical machines on a test
+  * server, or the machines that get created for reverse-replay). So N
+  * identical machines don't cost N times the ROM memory and loading time.
+  *
+  * Images are reference counted, an image is dropped from the cache once no
+  * Rom object uses it anymore.
+  */
+namespace RomCache {
+
+class Image
+{
+public:
+	/** @throws FileException */
+	explicit Image(const std::string& filename);
+
+	[[nodiscard]] std::span<const uint8_t> getData() const { return data; }
+
+private:
+	// A private copy (not a mmap of the file). The image is identified by
+	// the SHA1 sum of its content, so it may not change when the file is
+	// later modified (or truncated) on disk.
+	MemBuffer<uint8_t> data;
+};
+
+/** Returns the image with the given SHA1 sum. If it's not yet in the cache,
+  * it's loaded from the given file. The caller must make sure that file has
+  * the given SHA1 sum (e.g. obtained via FilePool).
+  * @throws FileException
+  */
+[[nodiscard]] std::shared_ptr<const Image> get(const Sha1Sum& sha1, const std::string& filename);
+
+} // namespace RomCache
+
+} // namespace openmsx
+
+#endif
@@ -3,6 +3,7 @@
 #include "CliComm.hh"
 #include "File.hh"
 #include "FileContext.hh"
+#include "FileOperations.hh"
 #include "MSXException.hh"
 
 #include "String32.hh"
@@ -12,27 +13,36 @@
 #include "ranges.hh"
 #include "rapidsax.hh"
 #include "stl.hh"
+#include "strCat.hh"
 #include "unreachable.hh"
+#include "xrange.hh"
 #include "xxhash.hh"
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
+#include <cstring>
+#include <fstream>
+#include <limits>
 #include <ranges>
 #include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace openmsx {
 
 using UnknownTypes = hash_map<std::string, unsigned, XXHasher>;
+using Warnings = std::vector<std::string>;
 
 class DBParser : public rapidsax::NullHandler
 {
 public:
 	DBParser(RomDatabase::RomDB& db_, UnknownTypes& unknownTypes_,
-	         CliComm& cliComm_, char* bufStart_)
+	         Warnings& warnings_, char* bufStart_)
 		: db(db_)
 		, unknownTypes(unknownTypes_)
-		, cliComm(cliComm_)
+		, warnings(warnings_)
 		, bufStart(bufStart_)
 		, initialSize(db.size())
 	{
@@ -49,6 +59,9 @@ public:
 
 private:
 	[[nodiscard]] String32 cIndex(zstring_view str) const;
+	template<typename... Args> void warning(Args&& ...args) {
+		warnings.push_back(strCat(std::forward<Args>(args)...));
+	}
 	void addEntries();
 	void addAllEntries();
 
@@ -83,7 +96,7 @@ private:
 
 	RomDatabase::RomDB& db;
 	UnknownTypes& unknownTypes;
-	CliComm& cliComm;
+	Warnings& warnings;
 	char* bufStart;
 
 	std::string_view systemID;
@@ -304,7 +317,7 @@ void DBParser::attribute(zstring_view name, zstring_view value)
 				if (auto g = StringOp::stringToBase<10, unsigned>(value)) {
 					genMSXid = *g;
 				} else {
-					cliComm.printWarning(
+					warning(
 						"Ignoring bad Generation MSX id (genmsxid) "
 						"in entry with title '", fromString32(bufStart, title),
 						": ", value);
@@ -346,7 +359,7 @@ void DBParser::attribute(zstring_view name, zstring_view value)
 				try {
 					dumps.back().hash = Sha1Sum(value);
 				} catch (MSXException& e) {
-					cliComm.printWarning(
+					warning(
 						"Ignoring bad dump for '", fromString32(bufStart, title),
 						"': ", e.getMessage());
 				}
@@ -406,7 +419,7 @@ void DBParser::text(zstring_view txt)
 		if (auto g = StringOp::stringToBase<10, unsigned>(txt)) {
 			genMSXid = *g;
 		} else {
-			cliComm.printWarning(
+			warning(
 				"Ignoring bad Generation MSX id (genmsxid) "
 				"in entry with title '", fromString32(bufStart, title),
 				": ", txt);
@@ -426,7 +439,7 @@ void DBParser::text(zstring_view txt)
 		try {
 			dumps.back().hash = Sha1Sum(txt);
 		} catch (MSXException& e) {
-			cliComm.printWarning(
+			warning(
 				"Ignoring bad dump for '", fromString32(bufStart, title),
 				"': ", e.getMessage());
 		}
@@ -492,7 +505,7 @@ void DBParser::addAllEntries()
 	// move non-duplicates up
 	while (it2 != last) {
 		if (it1->sha1 == it2->sha1) {
-			cliComm.printWarning(
+			warning(
 				"duplicate softwaredb entry SHA1: ",
 				it2->sha1);
 		} else {
@@ -629,10 +642,10 @@ void DBParser::doctype(zstring_view txt)
 	systemID = t.substr(0, pos2);
 }
 
-static void parseDB(CliComm& cliComm, char* buf, char* bufStart,
+static void parseDB(Warnings& warnings, char* buf, char* bufStart,
                     RomDatabase::RomDB& db, UnknownTypes& unknownTypes)
 {
-	DBParser handler(db, unknownTypes, cliComm, bufStart);
+	DBParser handler(db, unknownTypes, warnings, bufStart);
 	rapidsax::parse<rapidsax::trimWhitespace | rapidsax::zeroTerminateStrings>(handler, buf);
 
 	if (handler.getSystemID() != "softwaredb1.dtd") {
@@ -643,17 +656,184 @@ static void parseDB(CliComm& cliComm, char* buf, char* bufStart,
 	}
 }
 
+// The parsed database is cached in a binary file, so that the (large) XML
+// files don't need to be parsed on each startup. The cache is only used when
+// it was created from the same files (same names, sizes and modification
+// times) and with the same list of rom types. Its content is:
+//   header, key, warnings, records, strings
+// The String32 values in the records are offsets relative to the start of
+// the file (so they can be used directly on 64-bit systems). Offset 0 (the
+// first byte of the header) is replaced by a zero byte when loading, it
+// represents an empty string, like in the XML buffer.
+static constexpr std::array<char, 8> CACHE_MAGIC = {'o', 'M', 'S', 'X', 's', 'd', 'b', '1'};
+static constexpr uint32_t CACHE_ENDIAN = 0x01020304;
+
+struct CacheHeader {
+	std::array<char, 8> magic;
+	uint32_t endian;
+	uint32_t numEntries;
+	uint32_t keySize;
+	uint32_t warningsSize; // zero-terminated strings
+	uint64_t totalSize;
+};
+static_assert(sizeof(CacheHeader) == 32);
+
+struct CacheRecord {
+	Sha1Sum sha1;
+	std::array<uint32_t, 6> strings; // title, year, company, country, origType, remark
+	uint32_t genMSXid;
+	RomType romType;
+	uint8_t original;
+	std::array<uint8_t, 2> padding;
+};
+static_assert(sizeof(CacheRecord) == 52);
+static_assert(std::is_trivially_copyable_v<CacheRecord>);
+
+[[nodiscard]] static std::string getCacheFilename()
+{
+	return FileOperations::getUserDataDir() + "/.softwaredb.cache";
+}
+
+[[nodiscard]] static bool readCache(std::string_view key, MemBuffer<char>& buffer,
+                                    RomDatabase::RomDB& db, Warnings& warnings)
+{
+	try {
+		File file(getCacheFilename());
+		auto size = file.getSize();
+		if (size < sizeof(CacheHeader)) return false;
+		CacheHeader header;
+		file.read(std::span{std::bit_cast<char*>(&header), sizeof(header)});
+		if ((header.magic != CACHE_MAGIC) ||
+		    (header.endian != CACHE_ENDIAN) ||
+		    (header.totalSize != size) ||
+		    (header.keySize != key.size())) {
+			return false;
+		}
+		auto stringsStart = sizeof(header) + header.keySize + header.warningsSize +
+		                    size_t(header.numEntries) * sizeof(CacheRecord);
+		if ((stringsStart > size) || (size > std::numeric_limits<uint32_t>::max())) {
+			return false;
+		}
+		buffer.resize(size);
+		file.seek(0);
+		file.read(std::span{buffer.data(), size});
+	} catch (MSXException&) {
+		return false;
+	}
+
+	// All checks below only guard against a corrupt file. Note: the
+	// last byte is always zero (it terminates the last string).
+	CacheHeader header;
+	memcpy(&header, buffer.data(), sizeof(header));
+	const char* p = buffer.data() + sizeof(header);
+	if ((std::string_view(p, header.keySize) != key) ||
+	    (buffer[buffer.size() - 1] != 0)) {
+		return false;
+	}
+	p += header.keySize;
+	std::string_view warningsStr(p, header.warningsSize);
+	p += header.warningsSize;
+	buffer[0] = 0;
+
+	auto toStr32 = [&](uint32_t offset) {
+		String32 result;
+		toString32(buffer.data(), buffer.data() + offset, result);
+		return result;
+	};
+	db.reserve(header.numEntries);
+	for (auto i : xrange(header.numEntries)) {
+		CacheRecord r;
+		memcpy(&r, p + i * sizeof(CacheRecord), sizeof(r));
+		if (std::ranges::any_of(r.strings, [&](auto s) { return s >= buffer.size(); }) ||
+		    (size_t(r.romType) > size_t(RomType::UNKNOWN))) {
+			db.clear();
+			return false;
+		}
+		db.push_back(RomDatabase::Entry{
+			r.sha1,
+			RomInfo(toStr32(r.strings[0]), toStr32(r.strings[1]),
+			        toStr32(r.strings[2]), toStr32(r.strings[3]),
+			        r.original != 0, toStr32(r.strings[4]),
+			        toStr32(r.strings[5]), r.romType, r.genMSXid)});
+	}
+	if (!std::ranges::is_sorted(db, {}, &RomDatabase::Entry::sha1)) {
+		db.clear();
+		return false;
+	}
+	for (auto w : StringOp::split_view<StringOp::EmptyParts::KEEP>(warningsStr, '\0')) {
+		if (!w.empty()) warnings.emplace_back(w);
+	}
+	return true;
+}
+
+static void writeCache(std::string_view key, const MemBuffer<char>& buffer,
+                       const RomDatabase::RomDB& db, const Warnings& warnings)
+{
+	std::string warningsStr;
+	for (const auto& w : warnings) strAppend(warningsStr, w, '\0');
+
+	// Only store the strings that are actually used (and only once).
+	auto stringsStart = sizeof(CacheHeader) + key.size() + warningsStr.size() +
+	                    db.size() * sizeof(CacheRecord);
+	std::string strings;
+	hash_map<std::string_view, uint32_t, XXHasher> offsets;
+	auto addString = [&](std::string_view s) -> uint32_t {
+		if (s.empty()) return 0;
+		auto [it, inserted] = offsets.try_emplace(s, narrow<uint32_t>(stringsStart + strings.size()));
+		if (inserted) strAppend(strings, s, '\0');
+		return it->second;
+	};
+	const char* buf = buffer.data();
+	std::vector<CacheRecord> records;
+	records.reserve(db.size());
+	for (const auto& [sha1, info] : db) {
+		records.push_back(CacheRecord{
+			.sha1 = sha1,
+			.strings = {addString(info.getTitle(buf)),    addString(info.getYear(buf)),
+			            addString(info.getCompany(buf)),  addString(info.getCountry(buf)),
+			            addString(info.getOrigType(buf)), addString(info.getRemark(buf))},
+			.genMSXid = info.getGenMSXid(),
+			.romType = info.getRomType(),
+			.original = uint8_t(info.getOriginal()),
+			.padding = {}});
+	}
+	strings += '\0'; // so that the file always ends with a zero byte
+
+	CacheHeader header = {
+		.magic = CACHE_MAGIC,
+		.endian = CACHE_ENDIAN,
+		.numEntries = narrow<uint32_t>(records.size()),
+		.keySize = narrow<uint32_t>(key.size()),
+		.warningsSize = narrow<uint32_t>(warningsStr.size()),
+		.totalSize = stringsStart + strings.size(),
+	};
+
+	std::ofstream file;
+	FileOperations::openOfStream(file, getCacheFilename(), std::ios::binary);
+	if (!file.is_open()) return;
+	file.write(std::bit_cast<const char*>(&header), sizeof(header));
+	file.write(key.data(), std::streamsize(key.size()));
+	file.write(warningsStr.data(), std::streamsize(warningsStr.size()));
+	file.write(std::bit_cast<const char*>(records.data()),
+	           std::streamsize(records.size() * sizeof(CacheRecord)));
+	file.write(strings.data(), std::streamsize(strings.size()));
+	// On a write error the size doesn't match, and the cache is ignored.
+}
+
 RomDatabase::RomDatabase(CliComm& cliComm)
 {
-	db.reserve(3500);
-	UnknownTypes unknownTypes;
+	Warnings warnings;
 	// first user- then system-directory
 	std::vector<File> files;
+	std::string cacheKey;
 	size_t bufferSize = 0;
 	for (const auto& p : systemFileContext().getPaths()) {
 		try {
-			auto& f = files.emplace_back(p + "/softwaredb.xml");
-			bufferSize += f.getSize() + rapidsax::EXTRA_BUFFER_SPACE;
+			auto filename = p + "/softwaredb.xml";
+			auto& f = files.emplace_back(filename);
+			auto size = f.getSize();
+			bufferSize += size + rapidsax::EXTRA_BUFFER_SPACE;
+			strAppend(cacheKey, filename, '\0', size, '\0', f.getModificationDate(), '\n');
 		} catch (MSXException& /*e*/) {
 			// Ignore. It's not unusual the DB in the user
 			// directory is not found. In case there's an error
@@ -661,37 +841,51 @@ RomDatabase::RomDatabase(CliComm& cliComm)
 			// warning, but that's done below.
 		}
 	}
-	buffer.resize(bufferSize);
-	size_t bufferOffset = 0;
-	for (auto& file : files) {
-		try {
-			auto size = file.getSize();
-			auto* buf = &buffer[bufferOffset];
-			bufferOffset += size + rapidsax::EXTRA_BUFFER_SPACE;
-			file.read(std::span{buf, size});
-			buf[size] = 0;
-
-			parseDB(cliComm, buf, buffer.data(), db, unknownTypes);
-		} catch (rapidsax::ParseError& e) {
-			cliComm.printWarning(
-				"Rom database parsing failed: ", e.what());
-		} catch (MSXException& /*e*/) {
-			// Ignore, see above
+	// The numerical values of the rom types are stored in the cache.
+	for (auto name : RomInfo::getAllRomTypes()) strAppend(cacheKey, name, ',');
+
+	if (files.empty() || !readCache(cacheKey, buffer, db, warnings)) {
+		db.reserve(3500);
+		UnknownTypes unknownTypes;
+		buffer.resize(bufferSize);
+		size_t bufferOffset = 0;
+		for (auto& file : files) {
+			try {
+				auto size = file.getSize();
+				auto* buf = &buffer[bufferOffset];
+				bufferOffset += size + rapidsax::EXTRA_BUFFER_SPACE;
+				file.read(std::span{buf, size});
+				buf[size] = 0;
+
+				parseDB(warnings, buf, buffer.data(), db, unknownTypes);
+			} catch (rapidsax::ParseError& e) {
+				warnings.push_back(strCat(
+					"Rom database parsing failed: ", e.what()));
+			} catch (MSXException& /*e*/) {
+				// Ignore, see above
+			}
+		}
+		if (bufferSize) buffer[0] = 0;
+		if (!unknownTypes.empty()) {
+			std::string output = "Unknown mapper types in software database: ";
+			for (const auto& [type, count] : unknownTypes) {
+				strAppend(output, type, " (", count, "x); ");
+			}
+			warnings.push_back(std::move(output));
+		}
+		if (!db.empty()) {
+			writeCache(cacheKey, buffer, db, warnings);
 		}
 	}
-	if (bufferSize) buffer[0] = 0;
+
+	for (const auto& w : warnings) {
+		cliComm.printWarning(w);
+	}
 	if (db.empty()) {
 		cliComm.printWarning(
 			"Couldn't load software database.\n"
 			"This may cause incorrect ROM mapper types to be used.");
 	}
-	if (!unknownTypes.empty()) {
-		std::string output = "Unknown mapper types in software database: ";
-		for (const auto& [type, count] : unknownTypes) {
-			strAppend(output, type, " (", count, "x); ");
-		}
-		cliComm.printWarning(output);
-	}
 }
 
 const RomInfo* RomDatabase::fetchRomInfo(const Sha1Sum& sha1sum) const
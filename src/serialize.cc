@@ -6,6 +6,7 @@
 #include "XMLException.hh"
 
 #include "Base64.hh"
+#include "CowBuffer.hh"
 #include "Date.hh"
 #include "DeltaBlock.hh"
 #include "HexDump.hh"
@@ -153,9 +154,13 @@ void MemOutputArchive::serialize_blob(const char* /*tag*/, std::span<const uint8
 	if (data.size() > SMALL_SIZE) {
 		auto deltaBlockIdx = unsigned(deltaBlocks.size());
 		save(deltaBlockIdx); // see comment below in MemInputArchive
-		deltaBlocks.push_back(diff
-			? lastDeltaBlocks.createNew(data.data(), data)
-			: lastDeltaBlocks.createNullDiff(data.data(), data));
+		if (auto image = shareBlobs ? CowImage::create(data) : nullptr) {
+			deltaBlocks.push_back(std::make_shared<DeltaBlockShared>(std::move(image)));
+		} else {
+			deltaBlocks.push_back(diff
+				? lastDeltaBlocks.createNew(data.data(), data)
+				: lastDeltaBlocks.createNullDiff(data.data(), data));
+		}
 	} else {
 		auto buf = buffer.allocate(data.size());
 		copy_to_range(data, buf);
@@ -182,6 +187,21 @@ void MemInputArchive::serialize_blob(const char* /*tag*/, std::span<uint8_t> dat
 	}
 }
 
+void MemInputArchive::serialize_blob(const char* tag, CowBuffer& data)
+{
+	if (data.size() > SMALL_SIZE) {
+		unsigned deltaBlockIdx; load(deltaBlockIdx);
+		const auto& block = *deltaBlocks[deltaBlockIdx];
+		if (const auto* image = block.getCowImage();
+		    image && data.share(*image)) {
+			return;
+		}
+		block.apply(std::span{data});
+	} else {
+		serialize_blob(tag, std::span{data});
+	}
+}
+
 ////
 
 XmlOutputArchive::XmlOutputArchive(zstring_view filename_)
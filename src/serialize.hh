@@ -29,6 +29,7 @@
 
 namespace openmsx {
 
+class CowBuffer;
 class LastDeltaBlocks;
 class DeltaBlock;
 
@@ -650,12 +651,17 @@ template<typename T, size_t N> struct SerializeAsMemcpy<std::array<T, N>> : Seri
 class MemOutputArchive final : public OutputArchiveBase<MemOutputArchive>
 {
 public:
+	/** When 'shareBlobs_' is true, large blobs are stored so that they
+	  * can be shared (copy-on-write) with the memory they're restored in,
+	  * see DeltaBlockShared. Only useful when the same state is restored
+	  * many times. */
 	MemOutputArchive(LastDeltaBlocks& lastDeltaBlocks_,
 	                 std::vector<std::shared_ptr<DeltaBlock>>& deltaBlocks_,
-			 bool reverseSnapshot_)
+			 bool reverseSnapshot_, bool shareBlobs_ = false)
 		: lastDeltaBlocks(lastDeltaBlocks_)
 		, deltaBlocks(deltaBlocks_)
 		, reverseSnapshot(reverseSnapshot_)
+		, shareBlobs(shareBlobs_)
 	{
 	}
 
@@ -754,6 +760,7 @@ private:
 	LastDeltaBlocks& lastDeltaBlocks;
 	std::vector<std::shared_ptr<DeltaBlock>>& deltaBlocks;
 	const bool reverseSnapshot;
+	const bool shareBlobs;
 };
 
 class MemInputArchive final : public InputArchiveBase<MemInputArchive>
@@ -788,6 +795,9 @@ public:
 	[[nodiscard]] std::string_view loadStr();
 	void serialize_blob(const char* tag, std::span<uint8_t> data,
 	                    bool diff = true);
+	// Same, but if possible share the memory (copy-on-write) with the
+	// stored blob instead of copying it, see CowBuffer.
+	void serialize_blob(const char* tag, CowBuffer& data);
 
 	using InputArchiveBase<MemInputArchive>::serialize;
 	template<typename T, typename ...Args>
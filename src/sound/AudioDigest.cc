@@ -0,0 +1,135 @@
+#include "AudioDigest.hh"
+
+#include "TclObject.hh"
+
+#include "Math.hh"
+#include "endian.hh"
+#include "enumerate.hh"
+#include "ranges.hh"
+#include "small_buffer.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace openmsx {
+
+// Same conversion as in Wav16Writer.
+static int16_t float2int16(float f)
+{
+	return Math::clipToInt16(lrintf(32768.0f * f));
+}
+
+AudioDigest::AudioDigest(unsigned channels_, unsigned sampleRate_, bool perSecond_)
+	: channels(channels_), sampleRate(sampleRate_), perSecond(perSecond_)
+{
+}
+
+void AudioDigest::write(std::span<const float> buffer, float amp)
+{
+	small_buffer<int16_t, 4096> buf(uninitialized_tag{}, buffer.size());
+	std::ranges::transform(buffer, buf.data(), [=](float f) { return float2int16(f * amp); });
+	add(buf);
+}
+
+void AudioDigest::write(std::span<const StereoFloat> buffer, float ampLeft, float ampRight)
+{
+	small_buffer<int16_t, 2 * 4096> buf(uninitialized_tag{}, 2 * buffer.size());
+	for (auto [i, s] : enumerate(buffer)) {
+		buf[2 * i + 0] = float2int16(s.left  * ampLeft);
+		buf[2 * i + 1] = float2int16(s.right * ampRight);
+	}
+	add(buf);
+}
+
+void AudioDigest::writeSilence(uint32_t samples)
+{
+	small_buffer<int16_t, 4096> buf(samples, 0);
+	add(buf);
+}
+
+void AudioDigest::add(std::span<const int16_t> samples)
+{
+	if (!perSecond) {
+		total.add(samples);
+		return;
+	}
+	uint64_t secondSize = uint64_t(channels) * sampleRate;
+	while (!samples.empty()) {
+		auto n = std::min<uint64_t>(samples.size(), secondSize - current.count);
+		auto part = samples.first(n);
+		total.add(part);
+		current.add(part);
+		samples = samples.subspan(n);
+		if (current.count == secondSize) {
+			seconds.push_back(current.getResult(channels));
+			current = Stats{};
+		}
+	}
+}
+
+void AudioDigest::Stats::add(std::span<const int16_t> samples)
+{
+	small_buffer<Endian::L16, 4096> buf(uninitialized_tag{}, samples.size());
+	for (auto [i, s] : enumerate(samples)) {
+		buf[i] = uint16_t(s);
+		sumSquares += uint64_t(int(s) * int(s));
+		peak = std::max(peak, unsigned(std::abs(int(s))));
+	}
+	sha1.update(as_byte_span(std::span{buf}));
+	count += samples.size();
+}
+
+AudioDigest::Result AudioDigest::Stats::getResult(unsigned channels) const
+{
+	auto copy = sha1; // digest() finalizes
+	return {
+		.sha1 = copy.digest(),
+		.samples = count / channels,
+		.rms = count ? std::sqrt(double(sumSquares) / double(count)) / 32768.0 : 0.0,
+		.peak = peak / 32768.0,
+	};
+}
+
+AudioDigest::Result AudioDigest::getResult() const
+{
+	return total.getResult(channels);
+}
+
+std::vector<AudioDigest::Result> AudioDigest::getResultPerSecond() const
+{
+	auto result = seconds;
+	if (current.count) {
+		result.push_back(current.getResult(channels));
+	}
+	return result;
+}
+
+static void addResult(TclObject& dict, const AudioDigest::Result& r)
+{
+	std::array<char, 40> buf;
+	dict.addDictKeyValues("sha1", r.sha1.toString(buf),
+	                      "samples", r.samples,
+	                      "rms", r.rms,
+	                      "peak", r.peak);
+}
+
+TclObject AudioDigest::toTclObject() const
+{
+	TclObject result;
+	addResult(result, getResult());
+	result.addDictKeyValues("channels", channels,
+	                        "rate", sampleRate);
+	if (perSecond) {
+		TclObject list;
+		for (const auto& r : getResultPerSecond()) {
+			TclObject dict;
+			addResult(dict, r);
+			list.addListElement(dict);
+		}
+		result.addDictKeyValue("seconds", list);
+	}
+	return result;
+}
+
+} // namespace openmsx
@@ -0,0 +1,83 @@
+#ifndef AUDIODIGEST_HH
+#define AUDIODIGEST_HH
+
+#include "Mixer.hh"
+
+#include "sha1.hh"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace openmsx {
+
+class TclObject;
+
+/** Calculates a digest of a stream of audio samples. This allows to compare
+  * the sound output in automated tests, without writing WAV files.
+  *
+  * The samples are converted to 16-bit exactly like Wav16Writer does. The
+  * sha1 is calculated over the little-endian sample data. So it's the same as
+  * the sha1sum of the data chunk of the equivalent WAV file. Also the RMS and
+  * peak level are calculated. Optionally all this is also done for each
+  * second of audio separately.
+  */
+class AudioDigest
+{
+public:
+	AudioDigest(unsigned channels, unsigned sampleRate, bool perSecond);
+
+	// Same interface as Wav16Writer.
+	void write(std::span<const float> buffer, float amp = 1.0f);
+	void write(std::span<const StereoFloat> buffer, float ampLeft = 1.0f, float ampRight = 1.0f);
+	/** @param samples Number of 16-bit values (so for stereo, twice the
+	  *                number of sample frames).
+	  */
+	void writeSilence(uint32_t samples);
+
+	struct Result {
+		Sha1Sum sha1;
+		uint64_t samples; // number of sample frames
+		double rms;       // range [0, 1]
+		double peak;      // range [0, 1]
+	};
+	/** The result for all samples so far. Can be called at any time, also
+	  * while more samples are added later.
+	  */
+	[[nodiscard]] Result getResult() const;
+
+	/** The results per second. The last one is for a (possibly) partial
+	  * second. Empty when not enabled in the constructor.
+	  */
+	[[nodiscard]] std::vector<Result> getResultPerSecond() const;
+
+	/** The results as a Tcl dict, with keys 'sha1', 'samples', 'rms',
+	  * 'peak', 'channels', 'rate' and (when enabled) 'seconds'. The latter
+	  * is a list of dicts with keys 'sha1', 'samples', 'rms' and 'peak'.
+	  */
+	[[nodiscard]] TclObject toTclObject() const;
+
+private:
+	void add(std::span<const int16_t> samples);
+
+	struct Stats {
+		void add(std::span<const int16_t> samples);
+		[[nodiscard]] Result getResult(unsigned channels) const;
+
+		SHA1 sha1;
+		uint64_t count = 0; // number of 16-bit values
+		uint64_t sumSquares = 0;
+		unsigned peak = 0;
+	};
+
+	const unsigned channels;
+	const unsigned sampleRate;
+	const bool perSecond;
+	Stats total;
+	Stats current; // the current second, only used when 'perSecond'
+	std::vector<Result> seconds; // completed seconds
+};
+
+} // namespace openmsx
+
+#endif
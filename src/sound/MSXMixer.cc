@@ -1,5 +1,6 @@
 #include "MSXMixer.hh"
 
+#include "AudioDigest.hh"
 #include "Mixer.hh"
 #include "SoundDevice.hh"
 
@@ -14,6 +15,7 @@
 #include "MSXCommandController.hh"
 #include "MSXMotherBoard.hh"
 #include "StringSetting.hh"
+#include "TclArgParser.hh"
 #include "TclObject.hh"
 #include "ThrottleManager.hh"
 
@@ -27,6 +29,7 @@
 #include "ranges.hh"
 #include "stl.hh"
 #include "unreachable.hh"
+#include "xrange.hh"
 
 #include <algorithm>
 #include <cassert>
@@ -44,16 +47,20 @@ MSXMixer::MSXMixer(Mixer& mixer_, MSXMotherBoard& motherBoard_,
 	, motherBoard(motherBoard_)
 	, commandController(motherBoard.getMSXCommandController())
 	, masterVolume(mixer.getMasterVolume())
+	, decimationSetting(mixer.getDecimationSetting())
 	, speedManager(globalSettings.getSpeedManager())
 	, throttleManager(globalSettings.getThrottleManager())
 	, prevTime(getCurrentTime(), 44100)
 	, soundDeviceInfo(commandController.getMachineInfoCommand())
+	, audioDigestCmd(commandController)
 {
 	reschedule2();
 
 	masterVolume.attach(*this);
+	decimationSetting.attach(*this);
 	speedManager.attach(*this);
 	throttleManager.attach(*this);
+	updateDecimation();
 }
 
 MSXMixer::~MSXMixer()
@@ -65,6 +72,7 @@ MSXMixer::~MSXMixer()
 
 	throttleManager.detach(*this);
 	speedManager.detach(*this);
+	decimationSetting.detach(*this);
 	masterVolume.detach(*this);
 
 	mute(); // calls Mixer::unregisterMixer()
@@ -119,6 +127,9 @@ void MSXMixer::registerSound(SoundDevice& device, float volume,
 void MSXMixer::unregisterSound(SoundDevice& device)
 {
 	auto it = rfind_unguarded(infos, &device, &SoundDeviceInfo::device);
+	for (auto ch : xrange(device.getNumChannels())) {
+		device.digestChannel(ch, nullptr); // (possibly) keep the result
+	}
 	it->volumeSetting->detach(*this);
 	it->balanceSetting->detach(*this);
 	for (auto& s : it->channelSettings) {
@@ -144,6 +155,7 @@ void MSXMixer::setSynchronousMode(bool synchronous)
 			setMixerParams(fragmentSize, hostSampleRate);
 		}
 	}
+	updateDecimation();
 }
 
 double MSXMixer::getEffectiveSpeed() const
@@ -157,8 +169,15 @@ void MSXMixer::updateStream(EmuTime time)
 	assert(count <= 8192);
 	inplace_buffer<StereoFloat, 8192> mixBuffer(uninitialized_tag{}, count);
 
-	// call generate() even if count==0 and even if muted
-	generate(mixBuffer, time);
+	if (count && isDecimating()) {
+		// only advance the state of the sound devices
+		skip(count, time);
+		std::ranges::fill(mixBuffer, StereoFloat{});
+		tl0 = tr0 = 0.0f;
+	} else {
+		// call generate() even if count==0 and even if muted
+		generate(mixBuffer, time);
+	}
 
 	if (!muteCount && fragmentSize) {
 		mixer.uploadBuffer(*this, mixBuffer);
@@ -167,6 +186,9 @@ void MSXMixer::updateStream(EmuTime time)
 	if (recorder) {
 		recorder->addWave(mixBuffer);
 	}
+	if (digesting) {
+		digests.front().digest->write(mixBuffer);
+	}
 
 	prevTime += count;
 }
@@ -465,14 +487,45 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 	auto tmpBufStereo = subspan(tmpBufExtra,    0, samples); // StereoFloat
 	auto tmpBufMono   = std::span{tmpBufPtr, samples};      // float
 
+	// Optionally generate the output of all devices concurrently (each in
+	// its own buffer). Mixing is still done below, in the same order as in
+	// the sequential case, so the result is exactly the same.
+	auto& workers = mixer.getSoundWorkers();
+	bool parallel = (workers.getNumThreads() != 0) && (infos.size() > 1);
+	if (parallel) {
+		auto size = 2 * (samples + 3); // stereo, +3 see above
+		if (parallelBuffers.size() < infos.size()) {
+			parallelBuffers.resize(infos.size());
+		}
+		for (auto& buf : parallelBuffers) {
+			if (buf.size() < size) buf.resize(size);
+		}
+		parallelResults.resize(infos.size());
+		workers.parallelFor(infos.size(), [&](size_t i) {
+			Math::DenormalGuard noDenormals2; // MXCSR is per thread
+			parallelResults[i] = infos[i].device->updateBuffer(
+				samples, parallelBuffers[i].data(), time);
+		});
+	}
+	auto updateBuffer = [&](size_t i, float* buffer) {
+		SoundDevice& device = *infos[i].device;
+		if (!parallel) {
+			return device.updateBuffer(samples, buffer, time);
+		}
+		if (!parallelResults[i]) return false;
+		std::copy_n(parallelBuffers[i].data(),
+		            samples * (device.isStereo() ? 2 : 1), buffer);
+		return true;
+	};
+
 	constexpr unsigned HAS_MONO_FLAG = 1;
 	constexpr unsigned HAS_STEREO_FLAG = 2;
 	unsigned usedBuffers = 0;
 
 	// TODO: The Infos should be ordered such that all the mono
 	// devices are handled first
-	for (auto& info : infos) {
-		SoundDevice& device = *info.device;
+	for (auto&& [i, info] : enumerate(infos)) {
+		const SoundDevice& device = *info.device;
 		auto l1 = info.left1;
 		auto r1 = info.right1;
 		if (!device.isStereo()) {
@@ -482,14 +535,14 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 				if (!(usedBuffers & HAS_MONO_FLAG)) {
 					// generate in 'monoBuf' (because it was still empty)
 					// then multiply in-place
-					if (device.updateBuffer(samples, monoBufPtr, time)) {
+					if (updateBuffer(i, monoBufPtr)) {
 						usedBuffers |= HAS_MONO_FLAG;
 						mul(monoBuf, l1);
 					}
 				} else {
 					// generate in 'tmpBuf' (as mono data)
 					// then multiply-accumulate into 'monoBuf'
-					if (device.updateBuffer(samples, tmpBufPtr, time)) {
+					if (updateBuffer(i, tmpBufPtr)) {
 						mulAcc(monoBuf, tmpBufMono, l1);
 					}
 				}
@@ -498,14 +551,14 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
 					// 'stereoBuf' (which is still empty) is first filled with mono-data,
 					// then in-place expanded to stereo-data
-					if (device.updateBuffer(samples, stereoBufPtr, time)) {
+					if (updateBuffer(i, stereoBufPtr)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mulExpand(stereoBuf, l1, r1);
 					}
 				} else {
 					// 'tmpBuf' is first filled with mono-data,
 					// then expanded to stereo and mul-acc into 'stereoBuf'
-					if (device.updateBuffer(samples, tmpBufPtr, time)) {
+					if (updateBuffer(i, tmpBufPtr)) {
 						mulExpandAcc(stereoBuf, tmpBufMono, l1, r1);
 					}
 				}
@@ -521,14 +574,14 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
 					// generate in 'stereoBuf' (because it was still empty)
 					// then multiply in-place
-					if (device.updateBuffer(samples, stereoBufPtr, time)) {
+					if (updateBuffer(i, stereoBufPtr)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mul(stereoBuf, l1);
 					}
 				} else {
 					// generate in 'tmpBuf' (as stereo data)
 					// then multiply-accumulate into 'stereoBuf'
-					if (device.updateBuffer(samples, tmpBufPtr, time)) {
+					if (updateBuffer(i, tmpBufPtr)) {
 						mulAcc(stereoBuf, tmpBufStereo, l1);
 					}
 				}
@@ -538,14 +591,14 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
 					// generate in 'stereoBuf' (because it was still empty)
 					// then mix in-place
-					if (device.updateBuffer(samples, stereoBufPtr, time)) {
+					if (updateBuffer(i, stereoBufPtr)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mulMix2(stereoBuf, l1, l2, r1, r2);
 					}
 				} else {
 					// 'tmpBuf' is first filled with stereo-data,
 					// then mixed into stereoBuf
-					if (device.updateBuffer(samples, tmpBufPtr, time)) {
+					if (updateBuffer(i, tmpBufPtr)) {
 						mulMix2Acc(stereoBuf, tmpBufStereo, l1, l2, r1, r2);
 					}
 				}
@@ -592,6 +645,30 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 	}
 }
 
+void MSXMixer::skip(size_t samples, EmuTime time)
+{
+	auto& workers = mixer.getSoundWorkers();
+	workers.parallelFor(infos.size(), [&](size_t i) {
+		Math::DenormalGuard noDenormals; // MXCSR is per thread
+		infos[i].device->skipBuffer(samples, time);
+	});
+}
+
+// Never decimate while recording (synchronous mode).
+void MSXMixer::updateDecimation()
+{
+	decimate = decimationSetting.getBoolean() && (synchronousCounter == 0);
+}
+
+// Only when the sound can't be played at its normal speed anyway.
+bool MSXMixer::isDecimating() const
+{
+	return decimate &&
+	       ((speedManager.getSpeed() > 1.0) ||
+	        !throttleManager.isThrottled() ||
+	        motherBoard.isFastForwarding());
+}
+
 bool MSXMixer::needStereoRecording() const
 {
 	return std::ranges::any_of(infos, [](auto& info) {
@@ -660,6 +737,8 @@ void MSXMixer::update(const Setting& setting) noexcept
 {
 	if (&setting == &masterVolume) {
 		updateMasterVolume();
+	} else if (&setting == &decimationSetting) {
+		updateDecimation();
 	} else if (dynamic_cast<const IntegerSetting*>(&setting)) {
 		auto it = find_if_unguarded(infos,
 			[&](const SoundDeviceInfo& i) {
@@ -856,4 +935,117 @@ void MSXMixer::SoundDeviceInfoTopic::tabCompletion(std::vector<std::string>& tok
 	}
 }
 
+
+// Audio digest
+
+void MSXMixer::startDigest(std::span<const TclObject> tokens)
+{
+	bool perSecond = false;
+	std::array info = {flagArg("-persecond", perSecond)};
+	auto arguments = parseTclArgs(commandController.getInterpreter(), tokens.subspan(2), info);
+	std::vector<SoundDevice*> devices;
+	for (const auto& arg : arguments) {
+		auto* device = findDevice(arg.getString());
+		if (!device) {
+			throw CommandException("Unknown sound device: ", arg.getString());
+		}
+		devices.push_back(device);
+	}
+
+	stopDigest();
+	digests.clear();
+	digests.emplace_back("mix", std::make_unique<AudioDigest>(2, hostSampleRate, perSecond));
+	for (auto* device : devices) {
+		for (auto ch : xrange(device->getNumChannels())) {
+			auto& d = digests.emplace_back(
+				strCat(device->getName(), "_ch", ch + 1),
+				std::make_unique<AudioDigest>(
+					device->hasStereoChannels() ? 2 : 1,
+					unsigned(device->getNativeSampleRate()), perSecond));
+			device->digestChannel(ch, d.digest.get());
+		}
+	}
+	// like for recording, generate the sound independent of the speed
+	setSynchronousMode(true);
+	digesting = true;
+}
+
+void MSXMixer::stopDigest()
+{
+	if (!digesting) return;
+	for (auto& info : infos) {
+		for (auto ch : xrange(info.device->getNumChannels())) {
+			info.device->digestChannel(ch, nullptr);
+		}
+	}
+	digesting = false;
+	setSynchronousMode(false);
+}
+
+TclObject MSXMixer::getDigestResult() const
+{
+	TclObject result;
+	for (const auto& [name, digest] : digests) {
+		result.addDictKeyValue(name, digest->toTclObject());
+	}
+	return result;
+}
+
+MSXMixer::AudioDigestCmd::AudioDigestCmd(CommandController& commandController_)
+	: Command(commandController_, "audio_digest")
+{
+}
+
+void MSXMixer::AudioDigestCmd::execute(std::span<const TclObject> tokens, TclObject& result)
+{
+	checkNumArgs(tokens, AtLeast{2}, "subcommand ?arg ...?");
+	auto& msxMixer = OUTER(MSXMixer, audioDigestCmd);
+	executeSubCommand(tokens[1].getString(),
+		"start",  [&]{ msxMixer.startDigest(tokens); },
+		"stop",   [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			msxMixer.stopDigest(); },
+		"result", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			result = msxMixer.getDigestResult(); },
+		"status", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			result = msxMixer.digesting ? "active" : "idle"; });
+}
+
+std::string MSXMixer::AudioDigestCmd::help(std::span<const TclObject> /*tokens*/) const
+{
+	return "Calculates a digest (sha1, RMS and peak level) of the sound output, "
+	       "e.g. to compare the sound in automated tests without writing "
+	       "WAV files.\n"
+	       "audio_digest start [-persecond] [<sounddevice> ...]\n"
+	       "                       (Re)start for the mixed output and for the\n"
+	       "                       individual channels of the given sound devices\n"
+	       "audio_digest stop      Stop, the result remains available\n"
+	       "audio_digest result    Get the result so far, a dict per output\n"
+	       "audio_digest status    Query whether a digest is being calculated\n"
+	       "\n"
+	       "The sha1 is the same as the sha1sum of the data in a 16-bit WAV "
+	       "file of that output (e.g. from 'record start -audioonly -stereo' "
+	       "or from the <sounddevice>_ch<n>_record settings). With -persecond "
+	       "the result also contains this info for each second.";
+}
+
+void MSXMixer::AudioDigestCmd::tabCompletion(std::vector<std::string>& tokens) const
+{
+	using namespace std::literals;
+	if (tokens.size() == 2) {
+		static constexpr std::array cmds = {
+			"start"sv, "stop"sv, "result"sv, "status"sv,
+		};
+		completeString(tokens, cmds);
+	} else if ((tokens.size() >= 3) && (tokens[1] == "start")) {
+		auto& msxMixer = OUTER(MSXMixer, audioDigestCmd);
+		std::vector<std::string_view> options = {"-persecond"};
+		append(options, std::views::transform(msxMixer.infos,
+			[](auto& info) -> std::string_view { return info.device->getName(); }));
+		completeString(tokens, options);
+	}
+}
+
 } // namespace openmsx
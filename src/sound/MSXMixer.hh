@@ -1,21 +1,26 @@
 #ifndef MSXMIXER_HH
 #define MSXMIXER_HH
 
+#include "Command.hh"
 #include "DynamicClock.hh"
 #include "EmuTime.hh"
 #include "InfoTopic.hh"
 #include "Mixer.hh"
 #include "Schedulable.hh"
 
+#include "MemBuffer.hh"
 #include "Observer.hh"
 #include "dynarray.hh"
 
+#include <cstdint>
 #include <memory>
 #include <span>
+#include <string>
 #include <vector>
 
 namespace openmsx {
 
+class AudioDigest;
 class SoundDevice;
 class Mixer;
 class MSXMotherBoard;
@@ -148,6 +153,9 @@ private:
 	void reschedule();
 	void reschedule2();
 	void generate(std::span<StereoFloat> output, EmuTime time);
+	void skip(size_t samples, EmuTime time);
+	void updateDecimation();
+	[[nodiscard]] bool isDecimating() const;
 
 	// Schedulable
 	void executeUntil(EmuTime time) override;
@@ -162,6 +170,10 @@ private:
 	void changeRecordSetting(const Setting& setting);
 	void changeMuteSetting(const Setting& setting);
 
+	void startDigest(std::span<const TclObject> tokens);
+	void stopDigest();
+	[[nodiscard]] TclObject getDigestResult() const;
+
 private:
 	unsigned fragmentSize = 0;
 	unsigned hostSampleRate = 44100; // requested freq by sound driver,
@@ -174,6 +186,7 @@ private:
 	MSXCommandController& commandController;
 
 	IntegerSetting& masterVolume;
+	BooleanSetting& decimationSetting;
 	SpeedManager& speedManager;
 	ThrottleManager& throttleManager;
 
@@ -187,10 +200,31 @@ private:
 		void tabCompletion(std::vector<std::string>& tokens) const override;
 	} soundDeviceInfo;
 
+	struct AudioDigestCmd final : Command {
+		explicit AudioDigestCmd(CommandController& commandController);
+		void execute(std::span<const TclObject> tokens, TclObject& result) override;
+		[[nodiscard]] std::string help(std::span<const TclObject> tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} audioDigestCmd;
+
+	// See 'audio_digest' command. The first element is for the mixed
+	// output, the others for individual sound device channels.
+	struct Digest {
+		std::string name;
+		std::unique_ptr<AudioDigest> digest;
+	};
+	std::vector<Digest> digests;
+	bool digesting = false;
+
+	// Only used when the sound devices are generated in parallel.
+	std::vector<MemBuffer<float>> parallelBuffers;
+	std::vector<uint8_t> parallelResults; // not vector<bool>, written concurrently
+
 	AviRecorder* recorder = nullptr;
 	unsigned synchronousCounter = 0;
 
 	unsigned muteCount = 1; // start muted
+	bool decimate = false; // see updateDecimation()
 	float tl0, tr0; // internal DC-filter state
 };
 
@@ -7,8 +7,11 @@
 #include "CliComm.hh"
 #include "CommandController.hh"
 #include "MSXException.hh"
+#include "Reactor.hh"
+#include "TclObject.hh"
 
 #include "one_of.hh"
+#include "outer.hh"
 #include "stl.hh"
 #include "unreachable.hh"
 
@@ -50,11 +53,24 @@ Mixer::Mixer(Reactor& reactor_, CommandController& commandController_)
 	, samplesSetting(
 		commandController, "samples",
 		"mixer samples", defaultSamples, 64, 8192)
+	, threadsSetting(
+		commandController, "sound_threads",
+		"number of threads used to generate the sound of the different "
+		"sound devices, 1 means all sound is generated in the emulation "
+		"thread (the sound output is the same in all cases)", 1, 1, 16)
+	, decimationSetting(
+		commandController, "sound_decimation",
+		"when the emulation runs faster than realtime (speed above 100% "
+		"or throttle off), don't produce sound, only keep the state of "
+		"the sound devices up-to-date", false)
+	, soundDriverInfo(reactor_.getOpenMSXInfoCommand())
 {
 	muteSetting       .attach(*this);
 	frequencySetting  .attach(*this);
 	samplesSetting    .attach(*this);
 	soundDriverSetting.attach(*this);
+	threadsSetting    .attach(*this);
+	update(threadsSetting);
 
 	// Set correct initial mute state.
 	if (muteSetting.getBoolean()) ++muteCount;
@@ -67,6 +83,7 @@ Mixer::~Mixer()
 	assert(msxMixers.empty());
 	driver.reset();
 
+	threadsSetting    .detach(*this);
 	soundDriverSetting.detach(*this);
 	samplesSetting    .detach(*this);
 	frequencySetting  .detach(*this);
@@ -169,9 +186,41 @@ void Mixer::update(const Setting& setting) noexcept
 	} else if (&setting == one_of(&samplesSetting, &soundDriverSetting, &frequencySetting)) {
 		reloadDriver();
 		muteHelper();
+	} else if (&setting == &threadsSetting) {
+		try {
+			soundWorkers.setNumThreads(threadsSetting.getInt() - 1);
+		} catch (std::exception& e) {
+			commandController.getCliComm().printWarning(
+				"Couldn't start sound threads: ", e.what());
+		}
 	} else {
 		UNREACHABLE;
 	}
 }
 
+
+// class SoundDriverInfoTopic
+
+Mixer::SoundDriverInfoTopic::SoundDriverInfoTopic(InfoCommand& openMSXInfoCommand)
+	: InfoTopic(openMSXInfoCommand, "sound_driver")
+{
+}
+
+void Mixer::SoundDriverInfoTopic::execute(
+	std::span<const TclObject> /*tokens*/, TclObject& result) const
+{
+	const auto& mixer = OUTER(Mixer, soundDriverInfo);
+	if (!mixer.driver) return;
+	result.addDictKeyValues("frequency", mixer.driver->getFrequency(),
+	                        "samples", mixer.driver->getSamples());
+	mixer.driver->getInfo(result);
+}
+
+std::string Mixer::SoundDriverInfoTopic::help(std::span<const TclObject> /*tokens*/) const
+{
+	return "Returns info about the sound output: the frequency, the fragment "
+	       "size and, for the SDL driver, the (measured) latency in "
+	       "milliseconds and the number of buffer underruns.";
+}
+
 } // namespace openmsx
@@ -3,7 +3,9 @@
 
 #include "BooleanSetting.hh"
 #include "EnumSetting.hh"
+#include "InfoTopic.hh"
 #include "IntegerSetting.hh"
+#include "WorkerPool.hh"
 
 #include "Observer.hh"
 
@@ -57,6 +59,12 @@ public:
 
 	[[nodiscard]] IntegerSetting& getMasterVolume() { return masterVolume; }
 	[[nodiscard]] BooleanSetting& getMuteSetting() { return muteSetting; }
+	[[nodiscard]] BooleanSetting& getDecimationSetting() { return decimationSetting; }
+
+	/** Threads to generate the output of the sound devices in parallel,
+	  * see 'sound_threads' setting.
+	  */
+	[[nodiscard]] WorkerPool& getSoundWorkers() { return soundWorkers; }
 
 private:
 	void reloadDriver();
@@ -77,6 +85,17 @@ private:
 	IntegerSetting masterVolume;
 	IntegerSetting frequencySetting;
 	IntegerSetting samplesSetting;
+	IntegerSetting threadsSetting;
+	BooleanSetting decimationSetting;
+
+	WorkerPool soundWorkers;
+
+	struct SoundDriverInfoTopic final : InfoTopic {
+		explicit SoundDriverInfoTopic(InfoCommand& openMSXInfoCommand);
+		void execute(std::span<const TclObject> tokens,
+		             TclObject& result) const override;
+		[[nodiscard]] std::string help(std::span<const TclObject> tokens) const override;
+	} soundDriverInfo;
 
 	int muteCount = 0;
 };
@@ -24,4 +24,8 @@ void NullSoundDriver::uploadBuffer(std::span<const StereoFloat> /*buffer*/)
 {
 }
 
+void NullSoundDriver::getInfo(TclObject& /*result*/) const
+{
+}
+
 } // namespace openmsx
@@ -15,6 +15,7 @@ public:
 	[[nodiscard]] unsigned getSamples() const override;
 
 	void uploadBuffer(std::span<const StereoFloat> buffer) override;
+	void getInfo(TclObject& result) const override;
 };
 
 } // namespace openmsx
@@ -0,0 +1,433 @@
+#ifndef RESAMPLEHQKERNELS_HH
+#define RESAMPLEHQKERNELS_HH
+
+#include "HostCPU.hh"
+
+#include "narrow.hh"
+#include "xrange.hh"
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+/** The inner loop of ResampleHQ: the dot product of one row of filter
+  * coefficients with the input samples (mono or interleaved stereo).
+  *
+  * All variants have the same parameters:
+  *  - 'buf': the first input sample (or stereo frame) of the filter window.
+  *  - 'tab': for the forward variants this is the start of a coefficient
+  *           row. For the REVERSE variants it's the end of the row, the
+  *           coefficients are then used from back to front.
+  *  - 'len': the filter length, a multiple of 4 and at least 8.
+  *  - 'out': receives 1 (mono) or 2 (stereo) output samples.
+  * The coefficient rows must be 16-byte aligned (ResampleCoeffs allocates
+  * the table that way and the rows have a length that's a multiple of 4), so
+  * the SSE versions can use aligned loads for them. The input samples have
+  * no alignment requirements.
+  *
+  * calc() selects the fastest variant that's available. On x86 the AVX
+  * variants are always compiled, they're only used when the CPU supports AVX
+  * (checked at run-time). calcScalar() is the portable version.
+  * The variants only differ in the order in which they add the products, so
+  * their results can differ in the least significant bits.
+  */
+namespace openmsx::ResampleHQKernels {
+
+using Kernel = void (*)(const float* buf, const float* tab, size_t len, float* out);
+
+template<unsigned CHANNELS, bool REVERSE>
+inline void calcScalar(const float* buf, const float* tab, size_t len, float* out)
+{
+	assert((len % 4) == 0);
+	auto coef = [&](size_t i) {
+		if constexpr (REVERSE) {
+			return tab[-narrow<ptrdiff_t>(i) - 1];
+		} else {
+			return tab[i];
+		}
+	};
+	for (auto ch : xrange(CHANNELS)) {
+		float r0 = 0.0f;
+		float r1 = 0.0f;
+		float r2 = 0.0f;
+		float r3 = 0.0f;
+		for (size_t i = 0; i < len; i += 4) {
+			r0 += coef(i + 0) * buf[CHANNELS * (i + 0)];
+			r1 += coef(i + 1) * buf[CHANNELS * (i + 1)];
+			r2 += coef(i + 2) * buf[CHANNELS * (i + 2)];
+			r3 += coef(i + 3) * buf[CHANNELS * (i + 3)];
+		}
+		out[ch] = r0 + r1 + r2 + r3;
+		++buf;
+	}
+}
+
+#ifdef __SSE2__
+
+inline __m128 reverse(__m128 x)
+{
+	return _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+template<bool REVERSE>
+inline void calcSseMono(const float* buf_, const float* tab_, size_t len, float* out)
+{
+	assert((len % 4) == 0);
+	assert((uintptr_t(tab_) % 16) == 0);
+
+	auto x = narrow<ptrdiff_t>((len & ~7) * sizeof(float));
+	assert((x % 32) == 0);
+	const char* buf = std::bit_cast<const char*>(buf_) + x;
+	const char* tab = std::bit_cast<const char*>(tab_) + (REVERSE ? -x : x);
+	x = -x;
+
+	__m128 a0 = _mm_setzero_ps();
+	__m128 a1 = _mm_setzero_ps();
+	do {
+		__m128 b0 = _mm_loadu_ps(std::bit_cast<const float*>(buf + x +  0));
+		__m128 b1 = _mm_loadu_ps(std::bit_cast<const float*>(buf + x + 16));
+		__m128 t0, t1;
+		if constexpr (REVERSE) {
+			t0 = reverse(_mm_load_ps(std::bit_cast<const float*>(tab - x - 16)));
+			t1 = reverse(_mm_load_ps(std::bit_cast<const float*>(tab - x - 32)));
+		} else {
+			t0 = _mm_load_ps (std::bit_cast<const float*>(tab + x +  0));
+			t1 = _mm_load_ps (std::bit_cast<const float*>(tab + x + 16));
+		}
+		__m128 m0 = _mm_mul_ps(b0, t0);
+		__m128 m1 = _mm_mul_ps(b1, t1);
+		a0 = _mm_add_ps(a0, m0);
+		a1 = _mm_add_ps(a1, m1);
+		x += 2 * sizeof(__m128);
+	} while (x < 0);
+	if (len & 4) {
+		__m128 b0 = _mm_loadu_ps(std::bit_cast<const float*>(buf));
+		__m128 t0;
+		if constexpr (REVERSE) {
+			t0 = reverse(_mm_load_ps(std::bit_cast<const float*>(tab - 16)));
+		} else {
+			t0 = _mm_load_ps (std::bit_cast<const float*>(tab));
+		}
+		__m128 m0 = _mm_mul_ps(b0, t0);
+		a0 = _mm_add_ps(a0, m0);
+	}
+
+	__m128 a = _mm_add_ps(a0, a1);
+	// The following can be _slightly_ faster by using the SSE3 _mm_hadd_ps()
+	// intrinsic, but not worth the trouble.
+	__m128 t = _mm_add_ps(a, _mm_movehl_ps(a, a));
+	__m128 s = _mm_add_ss(t, _mm_shuffle_ps(t, t, 1));
+
+	_mm_store_ss(out, s);
+}
+
+template<int N> inline __m128 shuffle(__m128 x)
+{
+	return _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(x), N));
+}
+template<bool REVERSE>
+inline void calcSseStereo(const float* buf_, const float* tab_, size_t len, float* out)
+{
+	assert((len % 4) == 0);
+	assert((uintptr_t(tab_) % 16) == 0);
+
+	auto x = narrow<ptrdiff_t>(2 * (len & ~7) * sizeof(float));
+	const auto* buf = std::bit_cast<const char*>(buf_) + x;
+	const auto* tab = std::bit_cast<const char*>(tab_);
+	x = -x;
+
+	__m128 a0 = _mm_setzero_ps();
+	__m128 a1 = _mm_setzero_ps();
+	__m128 a2 = _mm_setzero_ps();
+	__m128 a3 = _mm_setzero_ps();
+	do {
+		__m128 b0 = _mm_loadu_ps(std::bit_cast<const float*>(buf + x +  0));
+		__m128 b1 = _mm_loadu_ps(std::bit_cast<const float*>(buf + x + 16));
+		__m128 b2 = _mm_loadu_ps(std::bit_cast<const float*>(buf + x + 32));
+		__m128 b3 = _mm_loadu_ps(std::bit_cast<const float*>(buf + x + 48));
+		__m128 ta, tb;
+		if constexpr (REVERSE) {
+			ta = reverse(_mm_load_ps(std::bit_cast<const float*>(tab - 16)));
+			tb = reverse(_mm_load_ps(std::bit_cast<const float*>(tab - 32)));
+			tab -= 2 * sizeof(__m128);
+		} else {
+			ta = _mm_load_ps (std::bit_cast<const float*>(tab +  0));
+			tb = _mm_load_ps (std::bit_cast<const float*>(tab + 16));
+			tab += 2 * sizeof(__m128);
+		}
+		__m128 t0 = shuffle<0x50>(ta);
+		__m128 t1 = shuffle<0xFA>(ta);
+		__m128 t2 = shuffle<0x50>(tb);
+		__m128 t3 = shuffle<0xFA>(tb);
+		__m128 m0 = _mm_mul_ps(b0, t0);
+		__m128 m1 = _mm_mul_ps(b1, t1);
+		__m128 m2 = _mm_mul_ps(b2, t2);
+		__m128 m3 = _mm_mul_ps(b3, t3);
+		a0 = _mm_add_ps(a0, m0);
+		a1 = _mm_add_ps(a1, m1);
+		a2 = _mm_add_ps(a2, m2);
+		a3 = _mm_add_ps(a3, m3);
+		x += 4 * sizeof(__m128);
+	} while (x < 0);
+	if (len & 4) {
+		__m128 b0 = _mm_loadu_ps(std::bit_cast<const float*>(buf +  0));
+		__m128 b1 = _mm_loadu_ps(std::bit_cast<const float*>(buf + 16));
+		__m128 ta;
+		if constexpr (REVERSE) {
+			ta = reverse(_mm_load_ps(std::bit_cast<const float*>(tab - 16)));
+		} else {
+			ta = _mm_load_ps (std::bit_cast<const float*>(tab +  0));
+		}
+		__m128 t0 = shuffle<0x50>(ta);
+		__m128 t1 = shuffle<0xFA>(ta);
+		__m128 m0 = _mm_mul_ps(b0, t0);
+		__m128 m1 = _mm_mul_ps(b1, t1);
+		a0 = _mm_add_ps(a0, m0);
+		a1 = _mm_add_ps(a1, m1);
+	}
+
+	__m128 a01 = _mm_add_ps(a0, a1);
+	__m128 a23 = _mm_add_ps(a2, a3);
+	__m128 a   = _mm_add_ps(a01, a23);
+	// Can faster with SSE3, but (like above) not worth the trouble.
+	__m128 s = _mm_add_ps(a, _mm_movehl_ps(a, a));
+	_mm_store_ss(&out[0], s);
+	_mm_store_ss(&out[1], shuffle<0x55>(s));
+}
+
+// The AVX variants, these may only be called when the CPU supports AVX.
+#if defined(__AVX__) || defined(_MSC_VER)
+#define AVX_TARGET
+#else
+#define AVX_TARGET __attribute__((target("avx")))
+#endif
+
+AVX_TARGET inline __m256 reverse(__m256 x)
+{
+	// AVX has no 8-element shuffle: reverse within both 128-bit halves,
+	// then swap the halves
+	x = _mm256_permute_ps(x, _MM_SHUFFLE(0, 1, 2, 3));
+	return _mm256_permute2f128_ps(x, x, 1);
+}
+
+// Sum of the lower and upper 128-bit halves.
+AVX_TARGET inline __m128 fold(__m256 x)
+{
+	return _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+}
+
+// Coefficients [i, i + 4) or [i, i + 8), in the order they're used.
+template<bool REVERSE>
+inline __m128 loadTab4(const float* tab, size_t i)
+{
+	if constexpr (REVERSE) {
+		return reverse(_mm_load_ps(tab - i - 4));
+	} else {
+		return _mm_load_ps(tab + i);
+	}
+}
+template<bool REVERSE>
+AVX_TARGET inline __m256 loadTab8(const float* tab, size_t i)
+{
+	// the rows are only 16-byte aligned
+	if constexpr (REVERSE) {
+		return reverse(_mm256_loadu_ps(tab - i - 8));
+	} else {
+		return _mm256_loadu_ps(tab + i);
+	}
+}
+
+template<bool REVERSE>
+AVX_TARGET inline void calcAvxMono(const float* buf, const float* tab, size_t len, float* out)
+{
+	assert((len % 4) == 0);
+	assert((uintptr_t(tab) % 16) == 0);
+
+	__m256 a0 = _mm256_setzero_ps();
+	__m256 a1 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (/**/; (i + 16) <= len; i += 16) {
+		__m256 m0 = _mm256_mul_ps(_mm256_loadu_ps(buf + i + 0), loadTab8<REVERSE>(tab, i + 0));
+		__m256 m1 = _mm256_mul_ps(_mm256_loadu_ps(buf + i + 8), loadTab8<REVERSE>(tab, i + 8));
+		a0 = _mm256_add_ps(a0, m0);
+		a1 = _mm256_add_ps(a1, m1);
+	}
+	if (len & 8) {
+		__m256 m0 = _mm256_mul_ps(_mm256_loadu_ps(buf + i), loadTab8<REVERSE>(tab, i));
+		a0 = _mm256_add_ps(a0, m0);
+		i += 8;
+	}
+	__m128 a = fold(_mm256_add_ps(a0, a1));
+	if (len & 4) {
+		__m128 m0 = _mm_mul_ps(_mm_loadu_ps(buf + i), loadTab4<REVERSE>(tab, i));
+		a = _mm_add_ps(a, m0);
+	}
+
+	__m128 t = _mm_add_ps(a, _mm_movehl_ps(a, a));
+	__m128 s = _mm_add_ss(t, _mm_shuffle_ps(t, t, 1));
+	_mm_store_ss(out, s);
+}
+
+// [c0 c1 c2 c3] -> [c0 c0 c1 c1 c2 c2 c3 c3]
+AVX_TARGET inline __m256 duplicate(__m128 t)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_unpacklo_ps(t, t)),
+	                            _mm_unpackhi_ps(t, t), 1);
+}
+
+template<bool REVERSE>
+AVX_TARGET inline void calcAvxStereo(const float* buf, const float* tab, size_t len, float* out)
+{
+	assert((len % 4) == 0);
+	assert((uintptr_t(tab) % 16) == 0);
+
+	__m256 a0 = _mm256_setzero_ps();
+	__m256 a1 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (/**/; (i + 8) <= len; i += 8) {
+		// [c0 .. c7] -> [c0 c0 c1 c1 c2 c2 c3 c3], [c4 c4 .. c7 c7]
+		__m256 t = loadTab8<REVERSE>(tab, i);
+		__m256 lo = _mm256_unpacklo_ps(t, t); // [c0 c0 c1 c1 c4 c4 c5 c5]
+		__m256 hi = _mm256_unpackhi_ps(t, t); // [c2 c2 c3 c3 c6 c6 c7 c7]
+		__m256 t0 = _mm256_permute2f128_ps(lo, hi, 0x20);
+		__m256 t1 = _mm256_permute2f128_ps(lo, hi, 0x31);
+		__m256 m0 = _mm256_mul_ps(_mm256_loadu_ps(buf + 2 * i + 0), t0);
+		__m256 m1 = _mm256_mul_ps(_mm256_loadu_ps(buf + 2 * i + 8), t1);
+		a0 = _mm256_add_ps(a0, m0);
+		a1 = _mm256_add_ps(a1, m1);
+	}
+	if (len & 4) {
+		__m256 t0 = duplicate(loadTab4<REVERSE>(tab, i));
+		__m256 m0 = _mm256_mul_ps(_mm256_loadu_ps(buf + 2 * i), t0);
+		a0 = _mm256_add_ps(a0, m0);
+	}
+
+	__m128 a = fold(_mm256_add_ps(a0, a1)); // [L R L R]
+	__m128 s = _mm_add_ps(a, _mm_movehl_ps(a, a));
+	_mm_store_ss(&out[0], s);
+	_mm_store_ss(&out[1], shuffle<0x55>(s));
+}
+
+#undef AVX_TARGET
+
+#endif // __SSE2__
+
+#ifdef __ARM_NEON
+
+inline float32x4_t reverse(float32x4_t x)
+{
+	x = vrev64q_f32(x); // [1 0 3 2]
+	return vcombine_f32(vget_high_f32(x), vget_low_f32(x));
+}
+
+template<bool REVERSE>
+inline float32x4_t loadTabNeon(const float* tab, size_t i)
+{
+	if constexpr (REVERSE) {
+		return reverse(vld1q_f32(tab - i - 4));
+	} else {
+		return vld1q_f32(tab + i);
+	}
+}
+
+template<bool REVERSE>
+inline void calcNeonMono(const float* buf, const float* tab, size_t len, float* out)
+{
+	assert((len % 4) == 0);
+
+	float32x4_t a0 = vdupq_n_f32(0.0f);
+	float32x4_t a1 = vdupq_n_f32(0.0f);
+	size_t i = 0;
+	for (/**/; (i + 8) <= len; i += 8) {
+		float32x4_t m0 = vmulq_f32(vld1q_f32(buf + i + 0), loadTabNeon<REVERSE>(tab, i + 0));
+		float32x4_t m1 = vmulq_f32(vld1q_f32(buf + i + 4), loadTabNeon<REVERSE>(tab, i + 4));
+		a0 = vaddq_f32(a0, m0);
+		a1 = vaddq_f32(a1, m1);
+	}
+	if (len & 4) {
+		float32x4_t m0 = vmulq_f32(vld1q_f32(buf + i), loadTabNeon<REVERSE>(tab, i));
+		a0 = vaddq_f32(a0, m0);
+	}
+
+	float32x4_t a = vaddq_f32(a0, a1);
+	float32x2_t s = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+	out[0] = vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+template<bool REVERSE>
+inline void calcNeonStereo(const float* buf, const float* tab, size_t len, float* out)
+{
+	assert((len % 4) == 0);
+
+	float32x4_t a0 = vdupq_n_f32(0.0f);
+	float32x4_t a1 = vdupq_n_f32(0.0f);
+	for (size_t i = 0; i < len; i += 4) {
+		float32x4_t t = loadTabNeon<REVERSE>(tab, i);
+		float32x4x2_t tt = vzipq_f32(t, t); // [c0 c0 c1 c1], [c2 c2 c3 c3]
+		float32x4_t m0 = vmulq_f32(vld1q_f32(buf + 2 * i + 0), tt.val[0]);
+		float32x4_t m1 = vmulq_f32(vld1q_f32(buf + 2 * i + 4), tt.val[1]);
+		a0 = vaddq_f32(a0, m0);
+		a1 = vaddq_f32(a1, m1);
+	}
+
+	float32x4_t a = vaddq_f32(a0, a1); // [L R L R]
+	vst1_f32(out, vadd_f32(vget_low_f32(a), vget_high_f32(a)));
+}
+
+#endif // __ARM_NEON
+
+// Returns the fastest variant for this CPU.
+template<unsigned CHANNELS, bool REVERSE>
+[[nodiscard]] inline Kernel select()
+{
+	static_assert((CHANNELS == 1) || (CHANNELS == 2));
+#if defined(__SSE2__)
+	if (HostCPU::getFeatures().avx) {
+		if constexpr (CHANNELS == 1) {
+			return calcAvxMono  <REVERSE>;
+		} else {
+			return calcAvxStereo<REVERSE>;
+		}
+	}
+	if constexpr (CHANNELS == 1) {
+		return calcSseMono  <REVERSE>;
+	} else {
+		return calcSseStereo<REVERSE>;
+	}
+#elif defined(__ARM_NEON)
+	if constexpr (CHANNELS == 1) {
+		return calcNeonMono  <REVERSE>;
+	} else {
+		return calcNeonStereo<REVERSE>;
+	}
+#else
+	return calcScalar<CHANNELS, REVERSE>;
+#endif
+}
+
+template<unsigned CHANNELS, bool REVERSE>
+inline void calc(const float* buf, const float* tab, size_t len, float* out)
+{
+#if defined(__AVX__)
+	// compiled for AVX, no need to check at run-time
+	if constexpr (CHANNELS == 1) {
+		calcAvxMono  <REVERSE>(buf, tab, len, out);
+	} else {
+		calcAvxStereo<REVERSE>(buf, tab, len, out);
+	}
+#else
+	static const Kernel kernel = select<CHANNELS, REVERSE>();
+	kernel(buf, tab, len, out);
+#endif
+}
+
+} // namespace openmsx::ResampleHQKernels
+
+#endif
@@ -11,6 +11,8 @@
 
 #include "unreachable.hh"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <memory>
 
@@ -40,9 +42,28 @@ void ResampledSoundDevice::setOutputRate(unsigned /*hostSampleRate*/, double /*s
 bool ResampledSoundDevice::updateBuffer(size_t length, float* buffer,
                                         EmuTime time)
 {
+	if (!algo) createAlgo();
 	return algo->generateOutput(buffer, length, time);
 }
 
+void ResampledSoundDevice::skipBuffer(size_t /*length*/, EmuTime time)
+{
+	// Generate the input samples (so that the state of the sound chip
+	// advances exactly like before), but skip the resampling.
+	std::array<float, 2 * (1024 + 3)> buffer; // stereo, +3 see generateInput()
+	unsigned num = emuClock.getTicksTill(time);
+	emuClock += num;
+	while (num) {
+		auto n = std::min(num, 1024u);
+		bool ignore = generateInput(buffer.data(), n);
+		(void)ignore;
+		num -= n;
+	}
+	// The history in the resampler is no longer valid, it's recreated
+	// (starting from silence) on the next call to updateBuffer().
+	algo.reset();
+}
+
 bool ResampledSoundDevice::generateInput(float* buffer, size_t num)
 {
 	return mixChannels(buffer, num);
@@ -58,12 +79,16 @@ void ResampledSoundDevice::update(const Setting& setting) noexcept
 void ResampledSoundDevice::createResampler()
 {
 	const DynamicClock& hostClock = getHostSampleClock();
-	EmuDuration outputPeriod = hostClock.getPeriod();
 	EmuDuration inputPeriod = EmuDuration::sec(getEffectiveSpeed() / double(getInputRate()));
 	emuClock.reset(hostClock.getTime());
 	emuClock.setPeriod(inputPeriod);
+	createAlgo();
+}
 
-	if (outputPeriod == inputPeriod) {
+void ResampledSoundDevice::createAlgo()
+{
+	const DynamicClock& hostClock = getHostSampleClock();
+	if (hostClock.getPeriod() == emuClock.getPeriod()) {
 		algo = std::make_unique<ResampleTrivial>(*this);
 	} else {
 		switch (resampleSetting.getEnum()) {
@@ -46,15 +46,19 @@ protected:
 	void setOutputRate(unsigned hostSampleRate, double speed) override;
 	bool updateBuffer(size_t length, float* buffer,
 	                  EmuTime time) override;
+	void skipBuffer(size_t length, EmuTime time) override;
 
 	// Observer<Setting>
 	void update(const Setting& setting) noexcept override;
 
 	void createResampler();
 
+private:
+	void createAlgo();
+
 private:
 	EnumSetting<ResampleType>& resampleSetting;
-	std::unique_ptr<ResampleAlgo> algo;
+	std::unique_ptr<ResampleAlgo> algo; // nullptr after skipBuffer()
 	DynamicClock emuClock{EmuTime::zero()}; // time of the last produced emu-sample,
 	                                        //    ticks once per emu-sample
 };
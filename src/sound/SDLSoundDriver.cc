@@ -8,6 +8,7 @@
 #include "MSXMotherBoard.hh"
 #include "Reactor.hh"
 #include "RealTime.hh"
+#include "TclObject.hh"
 #include "ThrottleManager.hh"
 #include "Timer.hh"
 
@@ -41,7 +42,10 @@ SDLSoundDriver::SDLSoundDriver(Reactor& reactor_,
 	frequency = obtained.freq;
 	fragmentSize = obtained.samples;
 
-	mixBuffer.resize(3 * (obtained.size / sizeof(StereoFloat)) + 1);
+	// Room for 4 fragments, though normally at most 'targetFill' plus one
+	// fragment is used.
+	mixBuffer.resize(4 * size_t(fragmentSize));
+	targetFill = 2 * fragmentSize;
 	reInit();
 }
 
@@ -52,9 +56,10 @@ SDLSoundDriver::~SDLSoundDriver()
 
 void SDLSoundDriver::reInit()
 {
+	// Only called while the audio is paused, so the audio callback isn't
+	// running. Lock anyway, it's cheap and makes this obviously safe.
 	SDL_LockAudioDevice(deviceID);
-	readIdx  = 0;
-	writeIdx = 0;
+	mixBuffer.clear();
 	SDL_UnlockAudioDevice(deviceID);
 }
 
@@ -93,81 +98,76 @@ void SDLSoundDriver::audioCallbackHelper(void* userdata, uint8_t* strm, int len)
 		                        len / (2 * sizeof(float))});
 }
 
-unsigned SDLSoundDriver::getBufferFilled() const
-{
-	int result = narrow_cast<int>(writeIdx - readIdx);
-	if (result < 0) result += narrow<int>(mixBuffer.size());
-	assert((0 <= result) && (narrow<unsigned>(result) < mixBuffer.size()));
-	return result;
-}
-
-unsigned SDLSoundDriver::getBufferFree() const
+void SDLSoundDriver::audioCallback(std::span<StereoFloat> stream)
 {
-	// we can't distinguish completely filled from completely empty
-	// (in both cases readIx would be equal to writeIdx), so instead
-	// we define full as '(writeIdx + 1) == readIdx'.
-	auto result = narrow<unsigned>(mixBuffer.size() - 1 - getBufferFilled());
-	assert(narrow_cast<int>(result) >= 0);
-	assert(result < mixBuffer.size());
-	return result;
+	// Only the (relaxed) atomic statistics are shared with the emulation
+	// thread, and the ring buffer itself is lock-free. So this never blocks.
+	auto filled = mixBuffer.size();
+	callbacks.fetch_add(1, std::memory_order_relaxed);
+	sumFilled.fetch_add(filled, std::memory_order_relaxed);
+
+	auto num = mixBuffer.pop(stream);
+	if (auto missing = stream.size() - num) {
+		// buffer underrun
+		underruns.fetch_add(1, std::memory_order_relaxed);
+		underrunSamples.fetch_add(missing, std::memory_order_relaxed);
+		std::ranges::fill(stream.subspan(num), StereoFloat{});
+	}
 }
 
-void SDLSoundDriver::audioCallback(std::span<StereoFloat> stream)
+void SDLSoundDriver::adjustTargetFill()
 {
-	auto len = stream.size();
-
-	size_t available = getBufferFilled();
-	if (auto num = std::min(len, available);
-	    (readIdx + num) < mixBuffer.size()) {
-		copy_to_range(mixBuffer.subspan(readIdx, num), stream);
-		readIdx += narrow<unsigned>(num);
-	} else {
-		auto len1 = mixBuffer.size() - readIdx;
-		copy_to_range(mixBuffer.subspan(readIdx, len1), stream);
-		auto len2 = num - len1;
-		copy_to_range(mixBuffer.first(len2), stream.subspan(len1));
-		readIdx = narrow<unsigned>(len2);
-	}
-	auto missing = narrow_cast<ptrdiff_t>(len - available);
-	if (missing > 0) {
-		// buffer underrun
-		std::ranges::fill(subspan(stream, available, missing), StereoFloat{});
+	// Lower the latency (in small steps) as long as there are no underruns,
+	// raise it again (in bigger steps) when there are.
+	if (auto u = underruns.load(std::memory_order_relaxed); u != seenUnderruns) {
+		seenUnderruns = u;
+		stableSamples = 0;
+		targetFill = std::min(targetFill + std::max(fragmentSize / 4, 1u), 3 * fragmentSize);
+	} else if (stableSamples >= 10 * frequency) { // 10 seconds
+		stableSamples = 0;
+		targetFill = std::max(targetFill - fragmentSize / 8, fragmentSize);
 	}
 }
 
 void SDLSoundDriver::uploadBuffer(std::span<const StereoFloat> buffer)
 {
-	SDL_LockAudioDevice(deviceID);
-	unsigned free = getBufferFree();
-	if (buffer.size() > free) {
-		auto* board = reactor.getMotherBoard();
-		if (board && !board->getMSXMixer().isSynchronousMode() && // when not recording
-		    reactor.getGlobalSettings().getThrottleManager().isThrottled()) {
-			do {
-				SDL_UnlockAudioDevice(deviceID);
-				Timer::sleep(5000); // 5ms
-				SDL_LockAudioDevice(deviceID);
-				board->getRealTime().resync();
-				free = getBufferFree();
-			} while (buffer.size() > free);
-		} else {
-			// drop excess samples
-			buffer = buffer.subspan(0, free);
+	adjustTargetFill();
+	stableSamples += buffer.size();
+
+	auto* board = reactor.getMotherBoard();
+	bool wait = board && !board->getMSXMixer().isSynchronousMode() && // when not recording
+	            reactor.getGlobalSettings().getThrottleManager().isThrottled();
+	while (true) {
+		auto filled = mixBuffer.size();
+		if (!wait || (filled <= targetFill)) {
+			buffer = buffer.subspan(mixBuffer.push(buffer));
+			if (buffer.empty() || !wait) break;
+			filled = mixBuffer.size();
 		}
+		// Sleep about as long as it takes to play the excess samples.
+		auto excess = (filled > targetFill) ? (filled - targetFill) : (fragmentSize / 4);
+		Timer::sleep(std::max<uint64_t>(250, excess * uint64_t(1'000'000) / frequency));
+		board->getRealTime().resync();
 	}
-	assert(buffer.size() <= free);
-	if ((writeIdx + buffer.size()) < mixBuffer.size()) {
-		copy_to_range(buffer, mixBuffer.subspan(writeIdx));
-		writeIdx += narrow<unsigned>(buffer.size());
-	} else {
-		auto len1 = mixBuffer.size() - writeIdx;
-		copy_to_range(buffer.subspan(0, len1), mixBuffer.subspan(writeIdx));
-		auto len2 = buffer.size() - len1;
-		copy_to_range(buffer.subspan(len1, len2), std::span{mixBuffer});
-		writeIdx = narrow<unsigned>(len2);
-	}
+	// when not throttled, drop the excess samples
+	droppedSamples += buffer.size();
+}
 
-	SDL_UnlockAudioDevice(deviceID);
+void SDLSoundDriver::getInfo(TclObject& result) const
+{
+	auto toMs = [&](double samples) { return 1000.0 * samples / frequency; };
+	auto n = callbacks.load(std::memory_order_relaxed);
+	auto avgFilled = n ? double(sumFilled.load(std::memory_order_relaxed)) / double(n) : 0.0;
+	// The latency is the time the samples spend in our buffer plus the
+	// time in the SDL buffer (one fragment).
+	result.addDictKeyValues(
+		"buffer_size", uint64_t(mixBuffer.capacity()),
+		"buffer_filled", uint64_t(mixBuffer.size()),
+		"target_latency", toMs(targetFill + fragmentSize),
+		"latency", toMs(avgFilled + fragmentSize),
+		"underruns", underruns.load(std::memory_order_relaxed),
+		"underrun_samples", underrunSamples.load(std::memory_order_relaxed),
+		"dropped_samples", droppedSamples);
 }
 
 } // namespace openmsx
@@ -5,10 +5,13 @@
 
 #include "SDLSurfacePtr.hh"
 
-#include "MemBuffer.hh"
+#include "SPSCRingBuffer.hh"
 
 #include <SDL.h>
 
+#include <atomic>
+#include <cstdint>
+
 namespace openmsx {
 
 class Reactor;
@@ -30,22 +33,36 @@ public:
 	[[nodiscard]] unsigned getSamples() const override;
 
 	void uploadBuffer(std::span<const StereoFloat> buffer) override;
+	void getInfo(TclObject& result) const override;
 
 private:
 	void reInit();
-	[[nodiscard]] unsigned getBufferFilled() const;
-	[[nodiscard]] unsigned getBufferFree() const;
+	void adjustTargetFill();
 	static void audioCallbackHelper(void* userdata, uint8_t* strm, int len);
 	void audioCallback(std::span<StereoFloat> stream);
 
 private:
 	Reactor& reactor;
 	SDL_AudioDeviceID deviceID;
-	MemBuffer<StereoFloat> mixBuffer;
+	// Written by the emulation thread, read by the SDL audio thread.
+	SPSCRingBuffer<StereoFloat> mixBuffer;
 	unsigned frequency;
 	unsigned fragmentSize;
-	unsigned readIdx = 0, writeIdx = 0;
+	// When throttled, uploadBuffer() waits till the buffer contains at
+	// most this many samples. Lowered when playback is stable, raised on
+	// underruns, see adjustTargetFill().
+	unsigned targetFill;
 	bool muted = true;
+
+	// statistics, updated by the audio thread
+	std::atomic<uint64_t> callbacks = 0;
+	std::atomic<uint64_t> sumFilled = 0; // buffer level at callback start
+	std::atomic<uint64_t> underruns = 0;
+	std::atomic<uint64_t> underrunSamples = 0;
+	// statistics, updated by the emulation thread
+	uint64_t droppedSamples = 0;
+	uint64_t seenUnderruns = 0;
+	uint64_t stableSamples = 0; // uploaded since the last (seen) underrun
 	[[no_unique_address]] SDLSubSystemInitializer<SDL_INIT_AUDIO> audioInitializer;
 };
 
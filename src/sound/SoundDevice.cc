@@ -1,5 +1,6 @@
 #include "SoundDevice.hh"
 
+#include "AudioDigest.hh"
 #include "MSXMixer.hh"
 #include "Mixer.hh"
 
@@ -136,6 +137,7 @@ void SoundDevice::unregisterSound()
 void SoundDevice::updateStream(EmuTime time)
 {
 	mixer.updateStream(time);
+	idle = false; // the state of this device is about to change
 }
 
 void SoundDevice::setSoftwareVolume(float volume, EmuTime time)
@@ -179,6 +181,12 @@ void SoundDevice::recordChannel(unsigned channel, const std::string& filename)
 	}
 }
 
+void SoundDevice::digestChannel(unsigned channel, AudioDigest* newDigest)
+{
+	assert(channel < numChannels);
+	digest[channel] = newDigest;
+}
+
 void SoundDevice::muteChannel(unsigned channel, bool muted)
 {
 	assert(channel < numChannels);
@@ -198,9 +206,25 @@ std::span<const float> SoundDevice::getLastBuffer(unsigned channel)
 	return {&buf.buffer[buf.stopIdx - requestedSize], requestedSize};
 }
 
+void SoundDevice::skipBuffer(size_t length, EmuTime time)
+{
+	assert(length <= 8192);
+	inplace_buffer<float, 2 * (8192 + 3)> buffer(uninitialized_tag{}, 2 * (length + 3));
+	bool ignore = updateBuffer(length, buffer.data(), time);
+	(void)ignore;
+}
+
 bool SoundDevice::mixChannels(float* dataOut, size_t samples)
 {
 	if (samples == 0) return true;
+	if (idle && std::ranges::none_of(xrange(numChannels), [&](auto i) {
+		return channelBuffers[i].requestCounter != 0 || writer[i] || digest[i];
+	})) {
+		// Still silent, no need to call generateChannels(). (Only when
+		// the channel data isn't requested separately, otherwise those
+		// buffers must still be filled in.)
+		return false;
+	}
 	size_t outputStereo = isStereo() ? 2 : 1;
 
 	inplace_buffer<float*, MAX_CHANNELS> bufs(uninitialized_tag{}, numChannels);
@@ -212,6 +236,7 @@ bool SoundDevice::mixChannels(float* dataOut, size_t samples)
 		return channelBuffers[channel].requestCounter != 0
 		    || channelMuted[channel]
 		    || writer[channel]
+		    || digest[channel]
 		    || !balanceCenter;
 	};
 	bool anySeparateChannel = false;
@@ -268,24 +293,26 @@ bool SoundDevice::mixChannels(float* dataOut, size_t samples)
 	}
 
 	for (auto i : xrange(numChannels)) {
-		// record channels
-		if (writer[i]) {
+		// record channels (to file and/or digest)
+		auto output = [&](auto& out) {
 			assert(bufs[i] != dataOut);
 			if (bufs[i]) {
 				auto amp = getAmplificationFactor();
 				if (stereo == 1) {
-					writer[i]->write(
+					out.write(
 						std::span{bufs[i], samples},
 						amp.left);
 				} else {
-					writer[i]->write(
+					out.write(
 						std::span{std::bit_cast<const StereoFloat*>(bufs[i]), samples},
 						amp.left, amp.right);
 				}
 			} else {
-				writer[i]->writeSilence(narrow<unsigned>(stereo * samples));
+				out.writeSilence(narrow<unsigned>(stereo * samples));
 			}
-		}
+		};
+		if (writer[i]) output(*writer[i]);
+		if (digest[i]) output(*digest[i]);
 		// update silent info in channelBuffers
 		auto& cb = channelBuffers[i];
 		if (bufs[i]) {
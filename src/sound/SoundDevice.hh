@@ -12,6 +12,7 @@
 
 namespace openmsx {
 
+class AudioDigest;
 class DeviceConfig;
 class DynamicClock;
 class MSXMixer;
@@ -89,6 +90,12 @@ public:
 	void recordChannel(unsigned channel, const std::string& filename);
 	void muteChannel  (unsigned channel, bool muted);
 
+	/** Pass the output of this channel to the given digest (in addition to
+	  * the normal output). Pass nullptr to stop. The digest is owned by
+	  * the caller. See MSXMixer 'audio_digest' command.
+	  */
+	void digestChannel(unsigned channel, AudioDigest* digest);
+
 	/** Change the balance of a single channel.
 	 * @param channel [0, numChannels)
 	 * @param balance [-1, +1], -1: fully left, 0: center, +1: fully right
@@ -172,6 +179,15 @@ protected:
 	/** @see Mixer::updateStream */
 	void updateStream(EmuTime time);
 
+	/** Indicate that the output of this device is silent, and that it
+	  * remains silent till the next call to updateStream(). Every change to
+	  * the state of a sound device (e.g. a register write) must anyway be
+	  * preceded by such a call. Typically called from generateChannels().
+	  * Until then the mixer no longer calls generateChannels(), so also
+	  * the internal state of the device doesn't advance.
+	  */
+	void setIdle() { idle = true; }
+
 	void setInputRate(unsigned sampleRate) { inputSampleRate = sampleRate; }
 	[[nodiscard]] unsigned getInputRate() const { return inputSampleRate; }
 
@@ -204,6 +220,15 @@ public: // Will be called by Mixer:
 	[[nodiscard]] virtual bool updateBuffer(size_t length, float* buffer,
 	                                        EmuTime time) = 0;
 
+	/** Like updateBuffer(), but the output is not needed. The internal
+	  * state of the device must still advance exactly as if the output was
+	  * generated (see 'sound_decimation' setting). The default
+	  * implementation calls updateBuffer() and drops the result.
+	  * @param length The number of (host) samples to skip, at most 8192.
+	  * @param time current time
+	  */
+	virtual void skipBuffer(size_t length, EmuTime time);
+
 protected:
 	/** Adds a number of samples that all have the same value.
 	  * Can be used to synthesize segments of a square wave.
@@ -258,6 +283,7 @@ private:
 	const static_string_view description;
 
 	std::array<std::optional<Wav16Writer>, MAX_CHANNELS> writer;
+	std::array<AudioDigest*, MAX_CHANNELS> digest = {};
 
 	float softwareVolumeLeft = 1.0f;
 	float softwareVolumeRight = 1.0f;
@@ -268,6 +294,7 @@ private:
 	std::array<Balance,  MAX_CHANNELS> channelBalance;
 	std::array<bool, MAX_CHANNELS> channelMuted;
 	bool balanceCenter = true;
+	bool idle = false; // see setIdle()
 
 	// When channel data needs to be collected separately (e.g. because
 	// we're recording the channel, or because we want to present it in the
@@ -6,6 +6,8 @@
 
 namespace openmsx {
 
+class TclObject;
+
 class SoundDriver
 {
 public:
@@ -31,6 +33,12 @@ public:
 
 	virtual void uploadBuffer(std::span<const StereoFloat> buffer) = 0;
 
+	/** Add driver specific (statistical) info, e.g. the latency and the
+	  * number of buffer underruns, to the given Tcl dict.
+	  * Used by the 'info sound_driver' command.
+	  */
+	virtual void getInfo(TclObject& result) const = 0;
+
 protected:
 	SoundDriver() = default;
 };
@@ -819,6 +819,7 @@ void Y8950::generateChannels(std::span<float*> bufs, unsigned num)
 		// during mute pm_phase, am_phase, noiseA_phase, noiseB_phase
 		// and noise_seed aren't updated, probably ok
 		std::ranges::fill(bufs, nullptr);
+		setIdle(); // till the next register write
 		return;
 	}
 
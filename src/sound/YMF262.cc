@@ -47,6 +47,7 @@
 #include "cstd.hh"
 #include "narrow.hh"
 #include "outer.hh"
+#include "ranges.hh"
 #include "xrange.hh"
 
 #include <algorithm>
@@ -56,12 +57,12 @@
 
 namespace openmsx {
 
-[[nodiscard]] static constexpr YMF262::FreqIndex fnumToIncrement(unsigned block_fnum)
+[[nodiscard]] static constexpr YMF262Core::FreqIndex fnumToIncrement(unsigned block_fnum)
 {
 	// opn phase increment counter = 20bit
 	// chip works with 10.10 fixed point, while we use 16.16
 	int block = narrow<int>((block_fnum & 0x1C00) >> 10);
-	return YMF262::FreqIndex(block_fnum & 0x03FF) >> (11 - block);
+	return YMF262Core::FreqIndex(block_fnum & 0x03FF) >> (11 - block);
 }
 
 // envelope output entries
@@ -394,16 +395,16 @@ static constexpr auto tlTab = [] {
 // sin waveform table in 'decibel' scale
 // there are eight waveforms on OPL3 chips
 struct SinTab {
-	std::array<std::array<unsigned, YMF262::SIN_LEN>, 8> tab;
+	std::array<std::array<unsigned, YMF262Core::SIN_LEN>, 8> tab;
 };
 
 static constexpr SinTab getSinTab()
 {
 	SinTab sin = {};
 
-	constexpr auto SIN_BITS = YMF262::SIN_BITS;
-	constexpr auto SIN_LEN  = YMF262::SIN_LEN;
-	constexpr auto SIN_MASK = YMF262::SIN_MASK;
+	constexpr auto SIN_BITS = YMF262Core::SIN_BITS;
+	constexpr auto SIN_LEN  = YMF262Core::SIN_LEN;
+	constexpr auto SIN_MASK = YMF262Core::SIN_MASK;
 	for (auto i : xrange(SIN_LEN / 4)) {
 		// non-standard sinus
 		double m = cstd::sin<2>(((i * 2) + 1) * Math::pi / SIN_LEN); // checked against the real chip
@@ -489,7 +490,7 @@ static int phase_modulation2; // phase modulation input (SLOT 3
                               // in 4 operator channels)
 
 
-YMF262::Slot::Slot()
+YMF262Core::Slot::Slot()
 	: waveTable(sin.tab[0])
 {
 }
@@ -536,7 +537,7 @@ void YMF262::changeStatusMask(uint8_t flag)
 	}
 }
 
-void YMF262::Slot::advanceEnvelopeGenerator(unsigned egCnt)
+void YMF262Core::Slot::advanceEnvelopeGenerator(unsigned egCnt)
 {
 	switch (state) {
 	using enum EnvelopeState;
@@ -594,7 +595,7 @@ void YMF262::Slot::advanceEnvelopeGenerator(unsigned egCnt)
 	}
 }
 
-void YMF262::Slot::advancePhaseGenerator(const Channel& ch, unsigned lfo_pm)
+void YMF262Core::Slot::advancePhaseGenerator(const Channel& ch, unsigned lfo_pm)
 {
 	if (vib) {
 		// LFO phase modulation active
@@ -608,59 +609,76 @@ void YMF262::Slot::advancePhaseGenerator(const Channel& ch, unsigned lfo_pm)
 	}
 }
 
-// advance to next sample
-void YMF262::advance()
+// calculate the shared per-sample values for the next block of samples
+void YMF262Core::prepareBlock(Block& block, unsigned num)
 {
-	// Vibrato: 8 output levels (triangle waveform);
-	// 1 level takes 1024 samples
-	lfo_pm_cnt.addQuantum();
-	unsigned lfo_pm = (lfo_pm_cnt.toInt() & 7) | lfo_pm_depth_range;
-
-	++eg_cnt;
-	for (auto i : xrange(unsigned(channel.size()))) {
-		auto& ch = channel[i];
-		auto& ch2 = isExtended(i) ? getFirstOfPair(i) : ch;
-		for (auto& op : ch.slot) {
-			op.advanceEnvelopeGenerator(eg_cnt);
-			op.advancePhaseGenerator(ch2, lfo_pm);
+	block.num = std::min(num, Block::MAX);
+	block.egCnt = eg_cnt;
+	eg_cnt += block.num;
+
+	for (auto j : xrange(block.num)) {
+		// Amplitude modulation: 27 output levels (triangle waveform);
+		// 1 level takes one of: 192, 256 or 448 samples
+		// One entry from LFO_AM_TABLE lasts for 64 samples
+		lfo_am_cnt.addQuantum();
+		if (lfo_am_cnt == LFOAMIndex(LFO_AM_TAB_ELEMENTS)) {
+			// lfo_am_table is 210 elements long
+			lfo_am_cnt = LFOAMIndex(0);
 		}
-	}
+		unsigned tmp = lfo_am_table[lfo_am_cnt.toInt()];
+		block.lfo_am[j] = lfo_am_depth ? tmp : tmp / 4;
 
-	// The Noise Generator of the YM3812 is 23-bit shift register.
-	// Period is equal to 2^23-2 samples.
-	// Register works at sampling frequency of the chip, so output
-	// can change on every sample.
-	//
-	// Output of the register and input to the bit 22 is:
-	// bit0 XOR bit14 XOR bit15 XOR bit22
-	//
-	// Simply use bit 22 as the noise output.
-	//
-	// unsigned j = ((noise_rng >>  0) ^ (noise_rng >> 14) ^
-	//               (noise_rng >> 15) ^ (noise_rng >> 22)) & 1;
-	// noise_rng = (j << 22) | (noise_rng >> 1);
-	//
-	// Instead of doing all the logic operations above, we
-	// use a trick here (and use bit 0 as the noise output).
-	// The difference is only that the noise bit changes one
-	// step ahead. This doesn't matter since we don't know
-	// what is real state of the noise_rng after the reset.
-	if (noise_rng & 1) {
-		noise_rng ^= 0x800302;
+		// Vibrato: 8 output levels (triangle waveform);
+		// 1 level takes 1024 samples
+		// (used when advancing to the next sample)
+		lfo_pm_cnt.addQuantum();
+		block.lfo_pm[j] = (lfo_pm_cnt.toInt() & 7) | lfo_pm_depth_range;
+
+		block.noise[j] = noise_rng & 1;
+
+		// The Noise Generator of the YM3812 is 23-bit shift register.
+		// Period is equal to 2^23-2 samples.
+		// Register works at sampling frequency of the chip, so output
+		// can change on every sample.
+		//
+		// Output of the register and input to the bit 22 is:
+		// bit0 XOR bit14 XOR bit15 XOR bit22
+		//
+		// Simply use bit 22 as the noise output.
+		//
+		// unsigned j = ((noise_rng >>  0) ^ (noise_rng >> 14) ^
+		//               (noise_rng >> 15) ^ (noise_rng >> 22)) & 1;
+		// noise_rng = (j << 22) | (noise_rng >> 1);
+		//
+		// Instead of doing all the logic operations above, we
+		// use a trick here (and use bit 0 as the noise output).
+		// The difference is only that the noise bit changes one
+		// step ahead. This doesn't matter since we don't know
+		// what is real state of the noise_rng after the reset.
+		if (noise_rng & 1) {
+			noise_rng ^= 0x800302;
+		}
+		noise_rng >>= 1;
 	}
-	noise_rng >>= 1;
 }
 
-inline int YMF262::Slot::op_calc(unsigned phase, unsigned lfo_am) const
+inline int YMF262Core::Slot::op_calc(unsigned phase, unsigned lfo_am) const
 {
 	unsigned env = (TLL + volume + (lfo_am & AMmask)) << 4;
 	auto p = env + waveTable[phase & SIN_MASK];
 	return (p < TL_TAB_LEN) ? tlTab[p] : 0;
 }
 
+// Does op_calc() return zero, for any phase, till the next key-on?
+inline bool YMF262Core::Slot::isSilent() const
+{
+	return (state == EnvelopeState::OFF) &&
+	       (((TLL + volume) << 4) >= TL_TAB_LEN);
+}
+
 // calculate output of a standard 2 operator channel
 // (or 1st part of a 4-op channel)
-void YMF262::Channel::chan_calc(unsigned lfo_am)
+void YMF262Core::Channel::chan_calc(unsigned lfo_am)
 {
 	// !! something is wrong with this, it caused bug
 	// !!    [2823673] MoonSound 4 operator FM fail
@@ -699,7 +717,7 @@ void YMF262::Channel::chan_calc(unsigned lfo_am)
 }
 
 // calculate output of a 2nd part of 4-op channel
-void YMF262::Channel::chan_calc_ext(unsigned lfo_am)
+void YMF262Core::Channel::chan_calc_ext(unsigned lfo_am)
 {
 	// !! see remark in chan_cal(), something is wrong with this
 	// !! optimization disabled for now
@@ -755,7 +773,7 @@ void YMF262::Channel::chan_calc_ext(unsigned lfo_am)
 // The following formulas can be well optimized.
 // I leave them in direct form for now (in case I've missed something).
 
-inline unsigned YMF262::genPhaseHighHat()
+inline unsigned YMF262Core::genPhaseHighHat(unsigned noise)
 {
 	// high hat phase generation (verified on real YM3812):
 	// phase = d0 or 234 (based on frequency only)
@@ -785,29 +803,29 @@ inline unsigned YMF262::genPhaseHighHat()
 	// when phase & 0x200 is set and noise=1 then phase = 0x200|0xd0
 	// when phase & 0x200 is set and noise=0 then phase = 0x200|(0xd0>>2), ie no change
 	if (phase & 0x200) {
-		if (noise_rng & 1) {
+		if (noise) {
 			phase = 0x200 | 0xd0;
 		}
 	} else {
 	// when phase & 0x200 is clear and noise=1 then phase = 0xd0>>2
 	// when phase & 0x200 is clear and noise=0 then phase = 0xd0, ie no change
-		if (noise_rng & 1) {
+		if (noise) {
 			phase = 0xd0 >> 2;
 		}
 	}
 	return phase;
 }
 
-inline unsigned YMF262::genPhaseSnare()
+inline unsigned YMF262Core::genPhaseSnare(unsigned noise)
 {
 	// verified on real YM3812
 	// base frequency derived from operator 1 in channel 7
 	// noise bit XOR'es phase by 0x100
 	return ((channel[7].slot[MOD].Cnt.toInt() & 0x100) + 0x100)
-	     ^ ((noise_rng & 1) << 8);
+	     ^ (noise << 8);
 }
 
-inline unsigned YMF262::genPhaseCymbal()
+inline unsigned YMF262Core::genPhaseCymbal()
 {
 	// verified on real YM3812
 	// enable gate based on frequency of operator 2 in channel 8
@@ -827,7 +845,7 @@ inline unsigned YMF262::genPhaseCymbal()
 }
 
 // calculate rhythm
-void YMF262::chan_calc_rhythm(unsigned lfo_am)
+void YMF262Core::chan_calc_rhythm(unsigned lfo_am, unsigned noise)
 {
 	// Bass Drum (verified on real YM3812):
 	//  - depends on the channel 6 'connect' register:
@@ -858,16 +876,16 @@ void YMF262::chan_calc_rhythm(unsigned lfo_am)
 	// TOM channel 8->slot1
 	// TOP channel 8->slot2
 	const auto& mod7 = channel[7].slot[MOD];
-	chanOut[7] += 2 * mod7.op_calc(genPhaseHighHat(), lfo_am);
+	chanOut[7] += 2 * mod7.op_calc(genPhaseHighHat(noise), lfo_am);
 	const auto& car7 = channel[7].slot[CAR];
-	chanOut[7] += 2 * car7.op_calc(genPhaseSnare(),   lfo_am);
+	chanOut[7] += 2 * car7.op_calc(genPhaseSnare(noise), lfo_am);
 	const auto& mod8 = channel[8].slot[MOD];
 	chanOut[8] += 2 * mod8.op_calc(mod8.Cnt.toInt(),  lfo_am);
 	const auto& car8 = channel[8].slot[CAR];
 	chanOut[8] += 2 * car8.op_calc(genPhaseCymbal(),  lfo_am);
 }
 
-void YMF262::Slot::FM_KEYON(uint8_t key_set)
+void YMF262Core::Slot::FM_KEYON(uint8_t key_set)
 {
 	if (!key) {
 		// restart Phase Generator
@@ -878,7 +896,7 @@ void YMF262::Slot::FM_KEYON(uint8_t key_set)
 	key |= key_set;
 }
 
-void YMF262::Slot::FM_KEYOFF(uint8_t key_clr)
+void YMF262Core::Slot::FM_KEYOFF(uint8_t key_clr)
 {
 	if (key) {
 		key &= ~key_clr;
@@ -891,7 +909,7 @@ void YMF262::Slot::FM_KEYOFF(uint8_t key_clr)
 	}
 }
 
-void YMF262::Slot::update_ar_dr()
+void YMF262Core::Slot::update_ar_dr()
 {
 	if ((ar + ksr) < 16 + 60) {
 		// verified on real YMF262 - all 15 x rates take "zero" time
@@ -906,7 +924,7 @@ void YMF262::Slot::update_ar_dr()
 	eg_sel_dr = eg_rate_select[dr + ksr];
 	eg_m_dr   = (1 << eg_sh_dr) - 1;
 }
-void YMF262::Slot::update_rr()
+void YMF262Core::Slot::update_rr()
 {
 	eg_sh_rr  = eg_rate_shift [rr + ksr];
 	eg_sel_rr = eg_rate_select[rr + ksr];
@@ -914,7 +932,7 @@ void YMF262::Slot::update_rr()
 }
 
 // update phase increment counter of operator (also update the EG rates if necessary)
-void YMF262::Slot::calc_fc(const Channel& ch)
+void YMF262Core::Slot::calc_fc(const Channel& ch)
 {
 	// (frequency) phase increment counter
 	Incr = ch.fc * mul;
@@ -932,7 +950,7 @@ static constexpr std::array<unsigned, 18> channelPairTab = {
 	0,  1,  2,  0,  1,  2, unsigned(~0), unsigned(~0), unsigned(~0),
 	9, 10, 11,  9, 10, 11, unsigned(~0), unsigned(~0), unsigned(~0),
 };
-inline bool YMF262::isExtended(unsigned ch) const
+inline bool YMF262Core::isExtended(unsigned ch) const
 {
 	assert(ch < 18);
 	if (!OPL3_mode) return false;
@@ -944,17 +962,17 @@ static constexpr unsigned getFirstOfPairNum(unsigned ch)
 	assert((ch < 18) && (channelPairTab[ch] != unsigned(~0)));
 	return channelPairTab[ch];
 }
-inline YMF262::Channel& YMF262::getFirstOfPair(unsigned ch)
+inline YMF262Core::Channel& YMF262Core::getFirstOfPair(unsigned ch)
 {
 	return channel[getFirstOfPairNum(ch) + 0];
 }
-inline YMF262::Channel& YMF262::getSecondOfPair(unsigned ch)
+inline YMF262Core::Channel& YMF262Core::getSecondOfPair(unsigned ch)
 {
 	return channel[getFirstOfPairNum(ch) + 3];
 }
 
 // set multi,am,vib,EG-TYP,KSR,mul
-void YMF262::set_mul(unsigned sl, uint8_t v)
+void YMF262Core::set_mul(unsigned sl, uint8_t v)
 {
 	unsigned chan_no = sl / 2;
 	auto& ch = channel[chan_no];
@@ -977,7 +995,7 @@ void YMF262::set_mul(unsigned sl, uint8_t v)
 }
 
 // set ksl & tl
-void YMF262::set_ksl_tl(unsigned sl, uint8_t v)
+void YMF262Core::set_ksl_tl(unsigned sl, uint8_t v)
 {
 	unsigned chan_no = sl / 2;
 	auto& ch = channel[chan_no];
@@ -1001,7 +1019,7 @@ void YMF262::set_ksl_tl(unsigned sl, uint8_t v)
 }
 
 // set attack rate & decay rate
-void YMF262::set_ar_dr(unsigned sl, uint8_t v)
+void YMF262Core::set_ar_dr(unsigned sl, uint8_t v)
 {
 	auto& ch = channel[sl / 2];
 	auto& slot = ch.slot[sl & 1];
@@ -1012,7 +1030,7 @@ void YMF262::set_ar_dr(unsigned sl, uint8_t v)
 }
 
 // set sustain level & release rate
-void YMF262::set_sl_rr(unsigned sl, uint8_t v)
+void YMF262Core::set_sl_rr(unsigned sl, uint8_t v)
 {
 	auto& ch = channel[sl / 2];
 	auto& slot = ch.slot[sl & 1];
@@ -1030,12 +1048,12 @@ uint8_t YMF262::readReg(unsigned r) const
 
 uint8_t YMF262::peekReg(unsigned r) const
 {
-	return reg[r];
+	return core.peekReg(r);
 }
 
 void YMF262::writeReg(unsigned r, uint8_t v, EmuTime time)
 {
-	if (!OPL3_mode && (r != 0x105)) {
+	if (!core.isOPL3Mode() && (r != 0x105)) {
 		// in OPL2 mode the only accessible in set #2 is register 0x05
 		r &= ~0x100;
 	}
@@ -1047,6 +1065,43 @@ void YMF262::writeReg512(unsigned r, uint8_t v, EmuTime time)
 	writeRegDirect(r, v, time);
 }
 void YMF262::writeRegDirect(unsigned r, uint8_t v, EmuTime time)
+{
+	switch (r) {
+	case 0x002: // Timer 1
+		timer1->setValue(v);
+		break;
+
+	case 0x003: // Timer 2
+		timer2->setValue(v);
+		break;
+
+	case 0x004: // IRQ clear / mask and Timer enable
+		if (v & 0x80) {
+			// IRQ flags clear
+			resetStatus(0x60);
+		} else {
+			changeStatusMask((~v) & 0x60);
+			timer1->setStart((v & R04_ST1) != 0, time);
+			timer2->setStart((v & R04_ST2) != 0, time);
+		}
+		break;
+
+	case 0x105:
+		// Verified on real YMF278: When NEW2 bit is first set, a read
+		// from the status register (once) returns bit 1 set (0x02).
+		// This only happens once after reset, so clearing NEW2 and
+		// setting it again doesn't cause another change in the status
+		// register. Also, only bit 1 changes.
+		if ((v & 0x02) && !alreadySignaledNEW2 && isYMF278) {
+			status2 = 0x02;
+			alreadySignaledNEW2 = true;
+		}
+		break;
+	}
+	core.writeReg(r, v);
+}
+
+void YMF262Core::writeReg(unsigned r, uint8_t v)
 {
 	reg[r] = v;
 
@@ -1059,22 +1114,9 @@ void YMF262::writeRegDirect(unsigned r, uint8_t v, EmuTime time)
 			break;
 
 		case 0x002: // Timer 1
-			timer1->setValue(v);
-			break;
-
 		case 0x003: // Timer 2
-			timer2->setValue(v);
-			break;
-
 		case 0x004: // IRQ clear / mask and Timer enable
-			if (v & 0x80) {
-				// IRQ flags clear
-				resetStatus(0x60);
-			} else {
-				changeStatusMask((~v) & 0x60);
-				timer1->setStart((v & R04_ST1) != 0, time);
-				timer2->setStart((v & R04_ST2) != 0, time);
-			}
+			// handled in YMF262
 			break;
 
 		case 0x008: // x,NTS,x,x, x,x,x,x
@@ -1098,16 +1140,7 @@ void YMF262::writeRegDirect(unsigned r, uint8_t v, EmuTime time)
 		case 0x105:
 			// OPL3 mode when bit0=1 otherwise it is OPL2 mode
 			OPL3_mode = v & 0x01;
-
-			// Verified on real YMF278: When NEW2 bit is first set, a read
-			// from the status register (once) returns bit 1 set (0x02).
-			// This only happens once after reset, so clearing NEW2 and
-			// setting it again doesn't cause another change in the status
-			// register. Also, only bit 1 changes.
-			if ((v & 0x02) && !alreadySignaledNEW2 && isYMF278) {
-				status2 = 0x02;
-				alreadySignaledNEW2 = true;
-			}
+			// (the NEW2 bit is handled in YMF262)
 
 			// following behaviour was tested on real YMF262,
 			// switching OPL3/OPL2 modes on the fly:
@@ -1395,29 +1428,29 @@ void YMF262::writeRegDirect(unsigned r, uint8_t v, EmuTime time)
 }
 
 
-void YMF262::reset(EmuTime time)
+YMF262Core::YMF262Core()
+{
+	reset();
+}
+
+void YMF262Core::reset()
 {
 	eg_cnt = 0;
 
 	noise_rng = 1; // noise shift register
 	nts = false; // note split
-	alreadySignaledNEW2 = false;
-	resetStatus(0x60);
 
 	// reset with register write
-	writeRegDirect(0x01, 0, time); // test register
-	writeRegDirect(0x02, 0, time); // Timer1
-	writeRegDirect(0x03, 0, time); // Timer2
-	writeRegDirect(0x04, 0, time); // IRQ mask clear
+	writeReg(0x01, 0); // test register
 
 	// FIX IT  registers 101, 104 and 105
 	// FIX IT (dont change CH.D, CH.C, CH.B and CH.A in C0-C8 registers)
 	for (int c = 0xFF; c >= 0x20; c--) {
-		writeRegDirect(c, 0, time);
+		writeReg(c, 0);
 	}
 	// FIX IT (dont change CH.D, CH.C, CH.B and CH.A in C0-C8 registers)
 	for (int c = 0x1FF; c >= 0x120; c--) {
-		writeRegDirect(c, 0, time);
+		writeReg(c, 0);
 	}
 
 	// reset operator parameters
@@ -1427,6 +1460,18 @@ void YMF262::reset(EmuTime time)
 			sl.volume = MAX_ATT_INDEX;
 		}
 	}
+}
+
+void YMF262::reset(EmuTime time)
+{
+	alreadySignaledNEW2 = false;
+	resetStatus(0x60);
+
+	// reset with register write
+	writeRegDirect(0x02, 0, time); // Timer1
+	writeRegDirect(0x03, 0, time); // Timer2
+	writeRegDirect(0x04, 0, time); // IRQ mask clear
+	core.reset();
 
 	setMixLevel(0x1b, time); // -9dB left and right
 }
@@ -1484,7 +1529,7 @@ uint8_t YMF262::peekStatus() const
 	return status | status2;
 }
 
-bool YMF262::checkMuteHelper() const
+bool YMF262Core::checkMuteHelper() const
 {
 	// TODO this doesn't always mute when possible
 	for (const auto& ch : channel) {
@@ -1521,89 +1566,144 @@ float YMF262::getAmplificationFactorImpl() const
 	return 1.0f / 4096.0f;
 }
 
+// Calculate a block of samples for a group of channels. Channels only
+// influence each other within a group (a 4-op pair or the rhythm channels), so
+// all samples of one group can be calculated before moving to the next group.
+// 'calc(lfo_am, noise)' calculates one sample for the group.
+template<typename Calc>
+void YMF262Core::generateGroup(std::span<const uint8_t> group, const Block& block,
+                           std::span<float*> bufs, unsigned offset,
+                           std::array<bool, 18>& active, Calc calc)
+{
+	bool silent = std::ranges::all_of(group, [&](auto i) {
+		const auto& ch = channel[i];
+		return ch.slot[MOD].isSilent() && ch.slot[CAR].isSilent() &&
+		       (ch.slot[MOD].op1_out == std::array{0, 0});
+	});
+	if (silent) {
+		// The output remains zero, and so does the envelope generator
+		// (state OFF). Only the phase generator keeps running.
+		for (auto i : group) {
+			chanOut[i] = 0;
+			for (auto& op : channel[i].slot) {
+				for (auto j : xrange(block.num)) {
+					op.advancePhaseGenerator(*block.freqChan[i], block.lfo_pm[j]);
+				}
+			}
+		}
+		return;
+	}
+
+	for (auto i : group) active[i] = true;
+	for (auto j : xrange(block.num)) {
+		for (auto i : group) chanOut[i] = 0;
+		calc(block.lfo_am[j], block.noise[j]);
+
+		unsigned egCnt = block.egCnt + j + 1;
+		for (auto i : group) {
+			auto* buf = bufs[i] + 2 * (offset + j);
+			buf[0] += narrow_cast<float>(chanOut[i] & pan[4 * i + 0]);
+			buf[1] += narrow_cast<float>(chanOut[i] & pan[4 * i + 1]);
+			// unused c += narrow_cast<float>(chanOut[i] & pan[4 * i + 2]);
+			// unused d += narrow_cast<float>(chanOut[i] & pan[4 * i + 3]);
+
+			// advance to next sample
+			for (auto& op : channel[i].slot) {
+				op.advanceEnvelopeGenerator(egCnt);
+				op.advancePhaseGenerator(*block.freqChan[i], block.lfo_pm[j]);
+			}
+		}
+	}
+}
+
 void YMF262::generateChannels(std::span<float*> bufs, unsigned num)
 {
 	// TODO implement per-channel mute (instead of all-or-nothing)
-	// TODO output rhythm on separate channels?
-	if (checkMuteHelper()) {
+	if (core.checkMuteHelper()) {
 		// TODO update internal state, even if muted
 		std::ranges::fill(bufs, nullptr);
+		setIdle(); // till the next register write
 		return;
 	}
+	core.generateChannels(bufs, num);
+}
 
+void YMF262Core::generateChannels(std::span<float*> bufs, unsigned num)
+{
+	// TODO output rhythm on separate channels?
 	bool rhythmEnabled = (rhythm & 0x20) != 0;
 
-	for (auto j : xrange(num)) {
-		// Amplitude modulation: 27 output levels (triangle waveform);
-		// 1 level takes one of: 192, 256 or 448 samples
-		// One entry from LFO_AM_TABLE lasts for 64 samples
-		lfo_am_cnt.addQuantum();
-		if (lfo_am_cnt == LFOAMIndex(LFO_AM_TAB_ELEMENTS)) {
-			// lfo_am_table is 210 elements long
-			lfo_am_cnt = LFOAMIndex(0);
-		}
-		unsigned tmp = lfo_am_table[lfo_am_cnt.toInt()];
-		unsigned lfo_am = lfo_am_depth ? tmp : tmp / 4;
+	Block block;
+	for (auto i : xrange(uint8_t(18))) {
+		block.freqChan[i] = isExtended(i) ? &getFirstOfPair(i) : &channel[i];
+	}
 
-		// clear channel outputs
-		std::ranges::fill(chanOut, 0);
+	std::array<bool, 18> active = {};
+	for (unsigned offset = 0; offset < num; offset += block.num) {
+		prepareBlock(block, num - offset);
+		auto generate = [&](std::span<const uint8_t> group, auto calc) {
+			generateGroup(group, block, bufs, offset, active, calc);
+		};
 
 		// channels 0,3 1,4 2,5  9,12 10,13 11,14
 		// in either 2op or 4op mode
-		for (int k = 0; k <= 9; k += 9) {
-			for (auto i : xrange(3)) {
-				auto& ch0 = channel[k + i + 0];
-				auto& ch3 = channel[k + i + 3];
-				// extended 4op ch#0 part 1 or 2op ch#0
-				ch0.chan_calc(lfo_am);
+		for (uint8_t k = 0; k <= 9; k += 9) {
+			for (auto i : xrange(uint8_t(3))) {
+				std::array<uint8_t, 2> pair = {uint8_t(k + i), uint8_t(k + i + 3)};
+				auto& ch0 = channel[pair[0]];
+				auto& ch3 = channel[pair[1]];
 				if (ch0.extended) {
-					// extended 4op ch#0 part 2
-					ch3.chan_calc_ext(lfo_am);
+					// extended 4op ch#0 part 1 and part 2
+					generate(pair, [&](unsigned lfo_am, unsigned) {
+						ch0.chan_calc(lfo_am);
+						ch3.chan_calc_ext(lfo_am);
+					});
 				} else {
-					// standard 2op ch#3
-					ch3.chan_calc(lfo_am);
+					// standard 2op ch#0 and ch#3
+					generate(subspan<1>(pair, 0), [&](unsigned lfo_am, unsigned) {
+						ch0.chan_calc(lfo_am);
+					});
+					generate(subspan<1>(pair, 1), [&](unsigned lfo_am, unsigned) {
+						ch3.chan_calc(lfo_am);
+					});
 				}
 			}
 		}
 
 		// channels 6,7,8 rhythm or 2op mode
-		if (!rhythmEnabled) {
-			channel[6].chan_calc(lfo_am);
-			channel[7].chan_calc(lfo_am);
-			channel[8].chan_calc(lfo_am);
-		} else {
+		// channels 15,16,17 are fixed 2-operator channels only
+		static constexpr std::array<uint8_t, 6> chans = {6, 7, 8, 15, 16, 17};
+		if (rhythmEnabled) {
 			// Rhythm part
-			chan_calc_rhythm(lfo_am);
+			generate(subspan<3>(chans, 0), [&](unsigned lfo_am, unsigned noise) {
+				chan_calc_rhythm(lfo_am, noise);
+			});
 		}
-
-		// channels 15,16,17 are fixed 2-operator channels only
-		channel[15].chan_calc(lfo_am);
-		channel[16].chan_calc(lfo_am);
-		channel[17].chan_calc(lfo_am);
-
-		for (auto i : xrange(18)) {
-			bufs[i][2 * j + 0] += narrow_cast<float>(chanOut[i] & pan[4 * i + 0]);
-			bufs[i][2 * j + 1] += narrow_cast<float>(chanOut[i] & pan[4 * i + 1]);
-			// unused c        += narrow_cast<float>(chanOut[i] & pan[4 * i + 2]);
-			// unused d        += narrow_cast<float>(chanOut[i] & pan[4 * i + 3]);
+		for (auto i : xrange(rhythmEnabled ? 3 : 0, 6)) {
+			auto& ch = channel[chans[i]];
+			generate(subspan<1>(chans, i), [&](unsigned lfo_am, unsigned) {
+				ch.chan_calc(lfo_am);
+			});
 		}
+	}
 
-		advance();
+	for (auto i : xrange(18)) {
+		if (!active[i]) bufs[i] = nullptr;
 	}
 }
 
 
-static constexpr auto envelopeStateInfo = std::to_array<enum_string<YMF262::EnvelopeState>>({
-	{ "ATTACK",  YMF262::EnvelopeState::ATTACK  },
-	{ "DECAY",   YMF262::EnvelopeState::DECAY   },
-	{ "SUSTAIN", YMF262::EnvelopeState::SUSTAIN },
-	{ "RELEASE", YMF262::EnvelopeState::RELEASE },
-	{ "OFF",     YMF262::EnvelopeState::OFF     },
+static constexpr auto envelopeStateInfo = std::to_array<enum_string<YMF262Core::EnvelopeState>>({
+	{ "ATTACK",  YMF262Core::EnvelopeState::ATTACK  },
+	{ "DECAY",   YMF262Core::EnvelopeState::DECAY   },
+	{ "SUSTAIN", YMF262Core::EnvelopeState::SUSTAIN },
+	{ "RELEASE", YMF262Core::EnvelopeState::RELEASE },
+	{ "OFF",     YMF262Core::EnvelopeState::OFF     },
 });
-SERIALIZE_ENUM(YMF262::EnvelopeState, envelopeStateInfo);
+SERIALIZE_ENUM(YMF262Core::EnvelopeState, envelopeStateInfo);
 
 template<typename Archive>
-void YMF262::Slot::serialize(Archive& a, unsigned /*version*/)
+void YMF262Core::Slot::serialize(Archive& a, unsigned /*version*/)
 {
 	// waveTable
 	auto waveform = unsigned((waveTable.data() - sin.tab[0].data()) / SIN_LEN);
@@ -1647,7 +1747,7 @@ void YMF262::Slot::serialize(Archive& a, unsigned /*version*/)
 }
 
 template<typename Archive>
-void YMF262::Channel::serialize(Archive& a, unsigned /*version*/)
+void YMF262Core::Channel::serialize(Archive& a, unsigned /*version*/)
 {
 	a.serialize("slots",      slot,
 	            "block_fnum", block_fnum,
@@ -1657,15 +1757,10 @@ void YMF262::Channel::serialize(Archive& a, unsigned /*version*/)
 	            "extended",   extended);
 }
 
-// version 1: initial version
-// version 2: added alreadySignaledNEW2
 template<typename Archive>
-void YMF262::serialize(Archive& a, unsigned version)
+void YMF262Core::serialize(Archive& a, unsigned /*version*/)
 {
-	a.serialize("timer1",  *timer1,
-	            "timer2",  *timer2,
-	            "irq",     irq,
-	            "chanout", chanOut);
+	a.serialize("chanout", chanOut);
 	a.serialize_blob("registers", reg);
 	a.serialize("channels",           channel,
 	            "eg_cnt",             eg_cnt,
@@ -1676,10 +1771,30 @@ void YMF262::serialize(Archive& a, unsigned version)
 	            "lfo_pm_depth_range", lfo_pm_depth_range,
 	            "rhythm",             rhythm,
 	            "nts",                nts,
-	            "OPL3_mode",          OPL3_mode,
-	            "status",             status,
-	            "status2",            status2,
-	            "statusMask",         statusMask);
+	            "OPL3_mode",          OPL3_mode);
+
+	// TODO restore more state by rewriting register values
+	//   this handles pan
+	for (auto i : xrange(0xC0, 0xC9)) {
+		writeReg(i + 0x000, reg[i + 0x000]);
+		writeReg(i + 0x100, reg[i + 0x100]);
+	}
+}
+
+// version 1: initial version
+// version 2: added alreadySignaledNEW2
+template<typename Archive>
+void YMF262::serialize(Archive& a, unsigned version)
+{
+	a.serialize("timer1",  *timer1,
+	            "timer2",  *timer2,
+	            "irq",     irq);
+	// the core state is stored directly in this tag (not in a sub-tag),
+	// that's compatible with older savestates
+	core.serialize(a, version);
+	a.serialize("status",     status,
+	            "status2",    status2,
+	            "statusMask", statusMask);
 	if (a.versionAtLeast(version, 2)) {
 		a.serialize("alreadySignaledNEW2", alreadySignaledNEW2);
 	} else {
@@ -1687,14 +1802,6 @@ void YMF262::serialize(Archive& a, unsigned version)
 		alreadySignaledNEW2 = true; // we can't know the actual value,
 									// but 'true' is the safest value
 	}
-
-	// TODO restore more state by rewriting register values
-	//   this handles pan
-	EmuTime time = timer1->getCurrentTime();
-	for (auto i : xrange(0xC0, 0xC9)) {
-		writeRegDirect(i + 0x000, reg[i + 0x000], time);
-		writeRegDirect(i + 0x100, reg[i + 0x100], time);
-	}
 }
 
 INSTANTIATE_SERIALIZE_METHODS(YMF262);
@@ -21,7 +21,11 @@ namespace openmsx {
 
 class DeviceConfig;
 
-class YMF262 final : private ResampledSoundDevice, private EmuTimerCallback
+/** The sound generation part of the YMF262, without timers, status register
+  * and interrupts. This doesn't need a motherboard, so it can also be used
+  * from the unittests.
+  */
+class YMF262Core
 {
 public:
 	// sin-wave entries
@@ -30,19 +34,24 @@ public:
 	static constexpr int SIN_MASK = SIN_LEN - 1;
 
 public:
-	YMF262(const std::string& name, const DeviceConfig& config,
-	       bool isYMF278);
-	~YMF262();
-
-	void reset(EmuTime time);
-	void writeReg   (unsigned r, uint8_t v, EmuTime time);
-	void writeReg512(unsigned r, uint8_t v, EmuTime time);
-	[[nodiscard]] uint8_t readReg(unsigned reg) const;
-	[[nodiscard]] uint8_t peekReg(unsigned reg) const;
-	[[nodiscard]] uint8_t readStatus();
-	[[nodiscard]] uint8_t peekStatus() const;
-
-	void setMixLevel(uint8_t x, EmuTime time);
+	YMF262Core();
+
+	void reset();
+	/** Write a register, 'r' is in range [0..0x1FF] (the register set is
+	  * not masked in OPL2 mode, see YMF262::writeReg()).
+	  */
+	void writeReg(unsigned r, uint8_t v);
+	[[nodiscard]] uint8_t peekReg(unsigned r) const { return reg[r]; }
+	[[nodiscard]] bool isOPL3Mode() const { return OPL3_mode; }
+
+	/** Are all channels (nearly) silent? Then generateChannels() doesn't
+	  * need to be called.
+	  */
+	[[nodiscard]] bool checkMuteHelper() const;
+	/** Add 'num' samples to the 18 stereo buffers. The buffers of
+	  * channels that remain silent are set to nullptr.
+	  */
+	void generateChannels(std::span<float*> bufs, unsigned num);
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
@@ -62,6 +71,7 @@ private:
 	public:
 		Slot();
 		[[nodiscard]] int op_calc(unsigned phase, unsigned lfo_am) const;
+		[[nodiscard]] bool isSilent() const;
 		void FM_KEYON(uint8_t key_set);
 		void FM_KEYOFF(uint8_t key_clr);
 		void advanceEnvelopeGenerator(unsigned egCnt);
@@ -151,34 +161,95 @@ private:
 		                      // channels, ie 0,1,2 and 9,10,11)
 	};
 
-	// SoundDevice
-	[[nodiscard]] float getAmplificationFactorImpl() const override;
-	void generateChannels(std::span<float*> bufs, unsigned num) override;
-
-	void callback(uint8_t flag) override;
-
-	void writeRegDirect(unsigned r, uint8_t v, EmuTime time);
-	void init_tables();
-	void setStatus(uint8_t flag);
-	void resetStatus(uint8_t flag);
-	void changeStatusMask(uint8_t flag);
-	void advance();
-
-	[[nodiscard]] unsigned genPhaseHighHat();
-	[[nodiscard]] unsigned genPhaseSnare();
+	/** The LFO, noise and envelope counters are shared by all channels,
+	  * their per-sample values are calculated upfront for a block of
+	  * samples.
+	  */
+	struct Block {
+		static constexpr unsigned MAX = 128;
+		unsigned num;   // number of samples in this block
+		unsigned egCnt; // value of 'eg_cnt' before this block
+		std::array<unsigned, MAX> lfo_am;
+		std::array<unsigned, MAX> lfo_pm;
+		std::array<unsigned, MAX> noise; // bit 0 of 'noise_rng'
+		std::array<const Channel*, 18> freqChan; // see advancePhaseGenerator()
+	};
+	void prepareBlock(Block& block, unsigned num);
+	template<typename Calc>
+	void generateGroup(std::span<const uint8_t> group, const Block& block,
+	                   std::span<float*> bufs, unsigned offset,
+	                   std::array<bool, 18>& active, Calc calc);
+
+	[[nodiscard]] unsigned genPhaseHighHat(unsigned noise);
+	[[nodiscard]] unsigned genPhaseSnare(unsigned noise);
 	[[nodiscard]] unsigned genPhaseCymbal();
 
-	void chan_calc_rhythm(unsigned lfo_am);
+	void chan_calc_rhythm(unsigned lfo_am, unsigned noise);
 	void set_mul(unsigned sl, uint8_t v);
 	void set_ksl_tl(unsigned sl, uint8_t v);
 	void set_ar_dr(unsigned sl, uint8_t v);
 	void set_sl_rr(unsigned sl, uint8_t v);
-	[[nodiscard]] bool checkMuteHelper() const;
 
 	[[nodiscard]] bool isExtended(unsigned ch) const;
 	[[nodiscard]] Channel& getFirstOfPair(unsigned ch);
 	[[nodiscard]] Channel& getSecondOfPair(unsigned ch);
 
+private:
+	std::array<int, 18> chanOut = {};      // 18 channels
+
+	std::array<uint8_t, 512> reg = {};
+	std::array<Channel, 18> channel;  // OPL3 chips have 18 channels
+
+	std::array<int, 18 * 4> pan; // channels output masks 4 per channel
+	                             //    0xffffffff = enable
+	unsigned eg_cnt{0};          // global envelope generator counter
+	unsigned noise_rng{1};       // 23 bit noise shift register
+
+	// LFO
+	using LFOAMIndex = FixedPoint< 6>;
+	using LFOPMIndex = FixedPoint<10>;
+	LFOAMIndex lfo_am_cnt{0};
+	LFOPMIndex lfo_pm_cnt{0};
+	bool lfo_am_depth{false};
+	uint8_t lfo_pm_depth_range{0};
+
+	uint8_t rhythm{0};		// Rhythm mode
+	bool nts{false};			// NTS (note select)
+	bool OPL3_mode{false};		// OPL3 extension enable flag
+};
+
+class YMF262 final : private ResampledSoundDevice, private EmuTimerCallback
+{
+public:
+	YMF262(const std::string& name, const DeviceConfig& config,
+	       bool isYMF278);
+	~YMF262();
+
+	void reset(EmuTime time);
+	void writeReg   (unsigned r, uint8_t v, EmuTime time);
+	void writeReg512(unsigned r, uint8_t v, EmuTime time);
+	[[nodiscard]] uint8_t readReg(unsigned reg) const;
+	[[nodiscard]] uint8_t peekReg(unsigned reg) const;
+	[[nodiscard]] uint8_t readStatus();
+	[[nodiscard]] uint8_t peekStatus() const;
+
+	void setMixLevel(uint8_t x, EmuTime time);
+
+	template<typename Archive>
+	void serialize(Archive& ar, unsigned version);
+
+private:
+	// SoundDevice
+	[[nodiscard]] float getAmplificationFactorImpl() const override;
+	void generateChannels(std::span<float*> bufs, unsigned num) override;
+
+	void callback(uint8_t flag) override;
+
+	void writeRegDirect(unsigned r, uint8_t v, EmuTime time);
+	void setStatus(uint8_t flag);
+	void resetStatus(uint8_t flag);
+	void changeStatusMask(uint8_t flag);
+
 	struct Debuggable final : SimpleDebuggable {
 		Debuggable(MSXMotherBoard& motherBoard, const std::string& name);
 		[[nodiscard]] uint8_t read(unsigned address) override;
@@ -201,27 +272,7 @@ private:
 
 	IRQHelper irq;
 
-	std::array<int, 18> chanOut = {};      // 18 channels
-
-	std::array<uint8_t, 512> reg = {};
-	std::array<Channel, 18> channel;  // OPL3 chips have 18 channels
-
-	std::array<int, 18 * 4> pan; // channels output masks 4 per channel
-	                             //    0xffffffff = enable
-	unsigned eg_cnt{0};          // global envelope generator counter
-	unsigned noise_rng{1};       // 23 bit noise shift register
-
-	// LFO
-	using LFOAMIndex = FixedPoint< 6>;
-	using LFOPMIndex = FixedPoint<10>;
-	LFOAMIndex lfo_am_cnt{0};
-	LFOPMIndex lfo_pm_cnt{0};
-	bool lfo_am_depth{false};
-	uint8_t lfo_pm_depth_range{0};
-
-	uint8_t rhythm{0};		// Rhythm mode
-	bool nts{false};			// NTS (note select)
-	bool OPL3_mode{false};		// OPL3 extension enable flag
+	YMF262Core core;
 
 	uint8_t status{0};		// status flag
 	uint8_t status2{0};
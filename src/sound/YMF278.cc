@@ -194,7 +194,7 @@ static constexpr std::array<uint8_t, 8> am_depth = {
 };
 
 
-YMF278::Slot::Slot()
+YMF278Core::Slot::Slot()
 {
 	reset();
 }
@@ -219,7 +219,7 @@ YMF278::Slot::Slot()
 	return t >> 3; // was shifted 3 positions too far
 }
 
-void YMF278::Slot::reset()
+void YMF278Core::Slot::reset()
 {
 	wave = FN = TLdest = TL = pan = vib = AM = 0;
 	OCT = 0;
@@ -243,7 +243,7 @@ void YMF278::Slot::reset()
 	pos = 0;
 }
 
-uint8_t YMF278::Slot::compute_rate(int val) const
+uint8_t YMF278Core::Slot::compute_rate(int val) const
 {
 	if (val == 0) {
 		return 0;
@@ -259,7 +259,7 @@ uint8_t YMF278::Slot::compute_rate(int val) const
 	return narrow<uint8_t>(std::clamp(res, 0, 63));
 }
 
-uint8_t YMF278::Slot::compute_decay_rate(int val) const
+uint8_t YMF278Core::Slot::compute_decay_rate(int val) const
 {
 	if (DAMP) {
 		// damping
@@ -297,7 +297,7 @@ uint8_t YMF278::Slot::compute_decay_rate(int val) const
 	return compute_rate(val);
 }
 
-int16_t YMF278::Slot::compute_vib() const
+int16_t YMF278Core::Slot::compute_vib() const
 {
 	// verified via hardware recording:
 	//  With LFO speed 0 (period 262144 samples), each vibrato step takes
@@ -314,7 +314,7 @@ int16_t YMF278::Slot::compute_vib() const
 	return narrow<int16_t>((lfo_fm * vib_depth[vib]) / 12);
 }
 
-uint16_t YMF278::Slot::compute_am() const
+uint16_t YMF278Core::Slot::compute_am() const
 {
 	// verified via hardware recording:
 	//  With LFO speed 0 (period 262144 samples), each tremolo step takes
@@ -328,103 +328,101 @@ uint16_t YMF278::Slot::compute_am() const
 }
 
 
-void YMF278::advance()
+// advance to the next sample, 'egCnt' is the (already incremented) global
+// envelope generator counter
+void YMF278Core::Slot::advance(unsigned egCnt)
 {
-	eg_cnt++;
-
 	// modulo counters for volume interpolation
-	auto tl_int_cnt  =  eg_cnt % 9;      // 0 .. 8
-	auto tl_int_step = (eg_cnt / 9) % 3; // 0 .. 2
-
-	for (auto& op : slots) {
-		// volume interpolation
-		if (tl_int_cnt == 0) {
-			if (tl_int_step == 0) {
-				// decrease volume by one step every 27 samples
-				if (op.TL < op.TLdest) ++op.TL;
-			} else {
-				// increase volume by one step every 13.5 samples
-				if (op.TL > op.TLdest) --op.TL;
-			}
+	auto tl_int_cnt  =  egCnt % 9;      // 0 .. 8
+	auto tl_int_step = (egCnt / 9) % 3; // 0 .. 2
+
+	// volume interpolation
+	if (tl_int_cnt == 0) {
+		if (tl_int_step == 0) {
+			// decrease volume by one step every 27 samples
+			if (TL < TLdest) ++TL;
+		} else {
+			// increase volume by one step every 13.5 samples
+			if (TL > TLdest) --TL;
 		}
+	}
 
-		if (op.lfo_active) {
-			op.lfo_cnt = (op.lfo_cnt + lfo_period[op.lfo]) & (LFO_PERIOD - 1);
-		}
+	if (lfo_active) {
+		lfo_cnt = (lfo_cnt + lfo_period[lfo]) & (LFO_PERIOD - 1);
+	}
 
-		// Envelope Generator
-		switch (op.state) {
-		case EG_ATT: { // attack phase
-			uint8_t rate = op.compute_rate(op.AR);
-			// Verified by HW recording (and matches Nemesis' tests of the YM2612):
-			// AR = 0xF during KeyOn results in instant switch to EG_DEC. (see keyOnHelper)
-			// Setting AR = 0xF while the attack phase is in progress freezes the envelope.
-			if (rate >= 63) {
-				break;
-			}
-			uint8_t shift = eg_rate_shift[rate];
-			if (!(eg_cnt & ((1 << shift) - 1))) {
-				uint8_t select = eg_rate_select[rate];
-				// >>4 makes the attack phase's shape match the actual chip -Valley Bell
-				op.env_vol = narrow<int16_t>(op.env_vol + ((~op.env_vol * eg_inc[select + ((eg_cnt >> shift) & 7)]) >> 4));
-				if (op.env_vol <= MIN_ATT_INDEX) {
-					op.env_vol = MIN_ATT_INDEX;
-					// TODO does the real HW skip EG_DEC completely,
-					//      or is it active for 1 sample?
-					op.state = op.DL ? EG_DEC : EG_SUS;
-				}
-			}
+	// Envelope Generator
+	switch (state) {
+	case EG_ATT: { // attack phase
+		uint8_t rate = compute_rate(AR);
+		// Verified by HW recording (and matches Nemesis' tests of the YM2612):
+		// AR = 0xF during KeyOn results in instant switch to EG_DEC. (see keyOnHelper)
+		// Setting AR = 0xF while the attack phase is in progress freezes the envelope.
+		if (rate >= 63) {
 			break;
 		}
-		case EG_DEC: { // decay phase
-			uint8_t rate = op.compute_decay_rate(op.D1R);
-			uint8_t shift = eg_rate_shift[rate];
-			if (!(eg_cnt & ((1 << shift) - 1))) {
-				uint8_t select = eg_rate_select[rate];
-				op.env_vol = narrow<int16_t>(op.env_vol + eg_inc[select + ((eg_cnt >> shift) & 7)]);
-				if (op.env_vol >= op.DL) {
-					op.state = (op.env_vol < MAX_ATT_INDEX) ? EG_SUS : EG_OFF;
-				}
+		uint8_t shift = eg_rate_shift[rate];
+		if (!(egCnt & ((1 << shift) - 1))) {
+			uint8_t select = eg_rate_select[rate];
+			// >>4 makes the attack phase's shape match the actual chip -Valley Bell
+			env_vol = narrow<int16_t>(env_vol + ((~env_vol * eg_inc[select + ((egCnt >> shift) & 7)]) >> 4));
+			if (env_vol <= MIN_ATT_INDEX) {
+				env_vol = MIN_ATT_INDEX;
+				// TODO does the real HW skip EG_DEC completely,
+				//      or is it active for 1 sample?
+				state = DL ? EG_DEC : EG_SUS;
 			}
-			break;
 		}
-		case EG_SUS: { // sustain phase
-			uint8_t rate = op.compute_decay_rate(op.D2R);
-			uint8_t shift = eg_rate_shift[rate];
-			if (!(eg_cnt & ((1 << shift) - 1))) {
-				uint8_t select = eg_rate_select[rate];
-				op.env_vol = narrow<int16_t>(op.env_vol + eg_inc[select + ((eg_cnt >> shift) & 7)]);
-				if (op.env_vol >= MAX_ATT_INDEX) {
-					op.env_vol = MAX_ATT_INDEX;
-					op.state = EG_OFF;
-				}
+		break;
+	}
+	case EG_DEC: { // decay phase
+		uint8_t rate = compute_decay_rate(D1R);
+		uint8_t shift = eg_rate_shift[rate];
+		if (!(egCnt & ((1 << shift) - 1))) {
+			uint8_t select = eg_rate_select[rate];
+			env_vol = narrow<int16_t>(env_vol + eg_inc[select + ((egCnt >> shift) & 7)]);
+			if (env_vol >= DL) {
+				state = (env_vol < MAX_ATT_INDEX) ? EG_SUS : EG_OFF;
 			}
-			break;
 		}
-		case EG_REL: { // release phase
-			uint8_t rate = op.compute_decay_rate(op.RR);
-			uint8_t shift = eg_rate_shift[rate];
-			if (!(eg_cnt & ((1 << shift) - 1))) {
-				uint8_t select = eg_rate_select[rate];
-				op.env_vol = narrow<int16_t>(op.env_vol + eg_inc[select + ((eg_cnt >> shift) & 7)]);
-				if (op.env_vol >= MAX_ATT_INDEX) {
-					op.env_vol = MAX_ATT_INDEX;
-					op.state = EG_OFF;
-				}
+		break;
+	}
+	case EG_SUS: { // sustain phase
+		uint8_t rate = compute_decay_rate(D2R);
+		uint8_t shift = eg_rate_shift[rate];
+		if (!(egCnt & ((1 << shift) - 1))) {
+			uint8_t select = eg_rate_select[rate];
+			env_vol = narrow<int16_t>(env_vol + eg_inc[select + ((egCnt >> shift) & 7)]);
+			if (env_vol >= MAX_ATT_INDEX) {
+				env_vol = MAX_ATT_INDEX;
+				state = EG_OFF;
 			}
-			break;
 		}
-		case EG_OFF:
-			// nothing
-			break;
-
-		default:
-			UNREACHABLE;
+		break;
+	}
+	case EG_REL: { // release phase
+		uint8_t rate = compute_decay_rate(RR);
+		uint8_t shift = eg_rate_shift[rate];
+		if (!(egCnt & ((1 << shift) - 1))) {
+			uint8_t select = eg_rate_select[rate];
+			env_vol = narrow<int16_t>(env_vol + eg_inc[select + ((egCnt >> shift) & 7)]);
+			if (env_vol >= MAX_ATT_INDEX) {
+				env_vol = MAX_ATT_INDEX;
+				state = EG_OFF;
+			}
 		}
+		break;
+	}
+	case EG_OFF:
+		// nothing
+		break;
+
+	default:
+		UNREACHABLE;
 	}
 }
 
-int16_t YMF278::getSample(const Slot& slot, uint16_t pos) const
+int16_t YMF278Core::getSample(const Slot& slot, uint16_t pos) const
 {
 	// TODO How does this behave when R#2 bit 0 = 1?
 	//      As-if read returns 0xff? (Like for CPU memory reads.) Or is
@@ -460,7 +458,7 @@ int16_t YMF278::getSample(const Slot& slot, uint16_t pos) const
 	}
 }
 
-uint16_t YMF278::nextPos(const Slot& slot, uint16_t pos, uint16_t increment)
+uint16_t YMF278Core::nextPos(const Slot& slot, uint16_t pos, uint16_t increment)
 {
 	// If there is a 4-sample loop and you advance 12 samples per step,
 	// it may exceed the end offset.
@@ -471,7 +469,7 @@ uint16_t YMF278::nextPos(const Slot& slot, uint16_t pos, uint16_t increment)
 	return pos;
 }
 
-bool YMF278::anyActive()
+bool YMF278Core::anyActive() const
 {
 	return std::ranges::any_of(slots, [](auto& op) { return op.state != EG_OFF; });
 }
@@ -505,19 +503,34 @@ void YMF278::setMixLevel(uint8_t x, EmuTime time)
 
 void YMF278::generateChannels(std::span<float*> bufs, unsigned num)
 {
-	if (!anyActive()) {
+	if (!core.anyActive()) {
 		// TODO update internal state, even if muted
 		// TODO also mute individual channels
 		std::ranges::fill(bufs, nullptr);
+		setIdle(); // till the next register write
 		return;
 	}
+	core.generateChannels(bufs, num);
+}
 
-	for (auto j : xrange(num)) {
-		for (auto i : xrange(24)) {
-			auto& sl = slots[i];
+void YMF278Core::generateChannels(std::span<float*> bufs, unsigned num)
+{
+	// The slots are independent of each other, so calculate all samples of
+	// one slot before moving to the next slot.
+	for (auto i : xrange(24)) {
+		auto& sl = slots[i];
+		if (sl.state == EG_OFF) {
+			// Only a key-on (a register write) can change this, so the
+			// output remains silent for this whole block.
+			bufs[i] = nullptr;
+			for (auto j : xrange(num)) sl.advance(eg_cnt + j + 1);
+			continue;
+		}
+		for (auto j : xrange(num)) {
 			if (sl.state == EG_OFF) {
 				//bufs[i][2 * j + 0] += 0;
 				//bufs[i][2 * j + 1] += 0;
+				sl.advance(eg_cnt + j + 1);
 				continue;
 			}
 
@@ -556,12 +569,13 @@ void YMF278::generateChannels(std::span<float*> bufs, unsigned num)
 				sl.pos = nextPos(sl, sl.pos, narrow<uint16_t>(sl.stepPtr >> 16));
 				sl.stepPtr &= 0xffff;
 			}
+			sl.advance(eg_cnt + j + 1);
 		}
-		advance();
 	}
+	eg_cnt += num;
 }
 
-void YMF278::keyOnHelper(YMF278::Slot& slot) const
+void YMF278Core::keyOnHelper(YMF278Core::Slot& slot) const
 {
 	// Unlike FM, the envelope level is reset. (And it makes sense, because you restart the sample.)
 	slot.env_vol = MAX_ATT_INDEX;
@@ -571,7 +585,7 @@ void YMF278::keyOnHelper(YMF278::Slot& slot) const
 		// Nuke.YKT verified that the FM part does it exactly this way,
 		// and the OPL4 manual says it's instant as well.
 		slot.env_vol = MIN_ATT_INDEX;
-		// see comment in 'case EG_ATT' in YMF278::advance()
+		// see comment in 'case EG_ATT' in Slot::advance()
 		slot.state = slot.DL ? EG_DEC : EG_SUS;
 	}
 	slot.stepPtr = 0;
@@ -581,10 +595,10 @@ void YMF278::keyOnHelper(YMF278::Slot& slot) const
 void YMF278::writeReg(uint8_t reg, uint8_t data, EmuTime time)
 {
 	updateStream(time); // TODO optimize only for regs that directly influence sound
-	writeRegDirect(reg, data, time);
+	writeRegDirect(reg, data);
 }
 
-void YMF278::writeRegDirect(uint8_t reg, uint8_t data, EmuTime time)
+void YMF278Core::writeReg(uint8_t reg, uint8_t data)
 {
 	// Handle slot registers specifically
 	if (reg >= 0x08 && reg <= 0xF7) {
@@ -611,7 +625,7 @@ void YMF278::writeRegDirect(uint8_t reg, uint8_t data, EmuTime time)
 				// Verified on real YMF278:
 				// After tone loading, if you read these
 				// registers, their value actually has changed.
-				writeRegDirect(narrow<uint8_t>(8 + sNum + (i - 2) * 24), buf[i], time);
+				writeReg(narrow<uint8_t>(8 + sNum + (i - 2) * 24), buf[i]);
 			}
 			if (slot.keyon) {
 				keyOnHelper(slot);
@@ -698,62 +712,66 @@ void YMF278::writeRegDirect(uint8_t reg, uint8_t data, EmuTime time)
 			slot.AM = data & 0x7;
 			break;
 		}
-	} else {
-		// All non-slot registers
-		switch (reg) {
-		case 0x00: // TEST
-		case 0x01:
-			break;
-
-		case 0x02:
-			// wave-table-header / memory-type / memory-access-mode
-			// Simply store in regs[2]
-			// Immediately write reg here and update memory pointers
-			regs[2] = data;
-			setupMemoryPointers();
-			break;
+	}
+	// (the non-slot registers are handled in YMF278)
+	regs[reg] = data;
+}
 
-		case 0x03:
+void YMF278::writeRegDirect(uint8_t reg, uint8_t data)
+{
+	// The slot registers are handled in YMF278Core
+	switch (reg) {
+	case 0x00: // TEST
+	case 0x01:
+		break;
+
+	case 0x02:
+		// wave-table-header / memory-type / memory-access-mode
+		// Simply store in regs[2]
+		// Immediately write reg here and update memory pointers
+		core.writeReg(2, data);
+		setupMemoryPointers();
+		break;
+
+	case 0x03:
+		// Verified on real YMF278:
+		// * Don't update the 'memAdr' variable on writes to
+		//   reg 3 and 4. Only store the value in the 'regs'
+		//   array for later use.
+		// * The upper 2 bits are not used to address the
+		//   external memories (so from a HW pov they don't
+		//   matter). But if you read back this register, the
+		//   upper 2 bits always read as '0' (even if you wrote
+		//   '1'). So we mask the bits here already.
+		data &= 0x3F;
+		break;
+
+	case 0x04:
+		// See reg 3.
+		break;
+
+	case 0x05:
+		// Verified on real YMF278: (see above)
+		// Only writes to reg 5 change the (full) 'memAdr'.
+		memAdr = (core.peekReg(3) << 16) | (core.peekReg(4) << 8) | data;
+		break;
+
+	case 0x06:  // memory data
+		if (core.peekReg(2) & 1) {
+			writeMem(memAdr, data);
+			++memAdr; // no need to mask (again) here
+		} else {
 			// Verified on real YMF278:
-			// * Don't update the 'memAdr' variable on writes to
-			//   reg 3 and 4. Only store the value in the 'regs'
-			//   array for later use.
-			// * The upper 2 bits are not used to address the
-			//   external memories (so from a HW pov they don't
-			//   matter). But if you read back this register, the
-			//   upper 2 bits always read as '0' (even if you wrote
-			//   '1'). So we mask the bits here already.
-			data &= 0x3F;
-			break;
-
-		case 0x04:
-			// See reg 3.
-			break;
-
-		case 0x05:
-			// Verified on real YMF278: (see above)
-			// Only writes to reg 5 change the (full) 'memAdr'.
-			memAdr = (regs[3] << 16) | (regs[4] << 8) | data;
-			break;
-
-		case 0x06:  // memory data
-			if (regs[2] & 1) {
-				writeMem(memAdr, data);
-				++memAdr; // no need to mask (again) here
-			} else {
-				// Verified on real YMF278:
-				//  - writes are ignored
-				//  - memAdr is NOT increased
-			}
-			break;
-
-		case 0xf8: // These are implemented in MSXMoonSound.cc
-		case 0xf9:
-			break;
+			//  - writes are ignored
+			//  - memAdr is NOT increased
 		}
-	}
+		break;
 
-	regs[reg] = data;
+	case 0xf8: // These are implemented in MSXMoonSound.cc
+	case 0xf9:
+		break;
+	}
+	core.writeReg(reg, data);
 }
 
 uint8_t YMF278::readReg(uint8_t reg)
@@ -762,7 +780,7 @@ uint8_t YMF278::readReg(uint8_t reg)
 	uint8_t result = peekReg(reg);
 	if (reg == 6) {
 		// Memory Data Register
-		if (regs[2] & 1) {
+		if (core.peekReg(2) & 1) {
 			// Verified on real YMF278:
 			// memAdr is only increased when 'regs[2] & 1'
 			++memAdr; // no need to mask (again) here
@@ -775,10 +793,10 @@ uint8_t YMF278::peekReg(uint8_t reg) const
 {
 	switch (reg) {
 		case 2: // 3 upper bits are device ID
-			return (regs[2] & 0x1F) | 0x20;
+			return (core.peekReg(2) & 0x1F) | 0x20;
 
 		case 6: // Memory Data Register
-			if (regs[2] & 1) {
+			if (core.peekReg(2) & 1) {
 				return readMem(memAdr);
 			} else {
 				// Verified on real YMF278
@@ -786,7 +804,7 @@ uint8_t YMF278::peekReg(uint8_t reg) const
 			}
 
 		default:
-			return regs[reg];
+			return core.peekReg(reg);
 	}
 }
 
@@ -810,7 +828,6 @@ YMF278::YMF278(const std::string& name_, size_t ramSize, DeviceConfig& config,
 	}
 
 	memAdr = 0; // avoid UMR
-	std::ranges::fill(regs, 0);
 
 	registerSound(config);
 	reset(motherBoard.getCurrentTime()); // must come after registerSound() because of call to setSoftwareVolume() via setMixLevel()
@@ -826,10 +843,13 @@ void YMF278::clearRam()
 	ram.clear(0);
 }
 
-void YMF278::reset(EmuTime time)
+YMF278Core::YMF278Core()
 {
-	updateStream(time);
+	reset();
+}
 
+void YMF278Core::reset()
+{
 	eg_cnt = 0;
 
 	for (auto& op : slots) {
@@ -837,10 +857,17 @@ void YMF278::reset(EmuTime time)
 	}
 	regs[2] = 0; // avoid UMR
 	for (int i = 0xf7; i >= 0; --i) { // reverse order to avoid UMR
-		writeRegDirect(narrow<uint8_t>(i), 0, time);
+		writeReg(narrow<uint8_t>(i), 0);
 	}
 	regs[0xf8] = 0x1b; // FM mix-level, see also YMF262 reset
 	regs[0xf9] = 0x00; // Wave mix-level
+}
+
+void YMF278::reset(EmuTime time)
+{
+	updateStream(time);
+
+	core.reset(); // also clears the memory registers
 	memAdr = 0;
 	setMixLevel(0, time);
 
@@ -865,11 +892,11 @@ void YMF278::reset(EmuTime time)
 //  /MCS9   0x380000-0x3FFFFF   0x3E0000-0x3FFFFF
 void YMF278::setupMemoryPointers()
 {
-	bool mode0 = (regs[2] & 2) == 0;
-	setupMemPtrs(mode0, rom, ram, memPtrs);
+	bool mode0 = (core.peekReg(2) & 2) == 0;
+	setupMemPtrs(mode0, rom, ram, core.getMemPtrs());
 }
 
-uint8_t YMF278::readMem(unsigned address) const
+uint8_t YMF278Core::readMem(unsigned address) const
 {
 	// Verified on real YMF278: address space wraps at 4MB.
 	address &= 0x3F'FFFF;
@@ -879,10 +906,15 @@ uint8_t YMF278::readMem(unsigned address) const
 	return 0xFF;
 }
 
+uint8_t YMF278::readMem(unsigned address) const
+{
+	return core.readMem(address);
+}
+
 void YMF278::writeMem(unsigned address, uint8_t value)
 {
 	address &= 0x3F'FFFF;
-	if (auto chunk = memPtrs[address >> 17].asOptional()) { // mapped?
+	if (auto chunk = core.getMemPtrs()[address >> 17].asOptional()) { // mapped?
 		const auto* ptr = chunk->data() + (address & 0x1'ffff);
 		if ((&ram[0] <= ptr) && (ptr < (&ram[0] + ram.size()))) { // points to RAM?
 			// this assumes all RAM is emulated via a single contiguous memory block
@@ -906,13 +938,13 @@ void YMF278::writeMem(unsigned address, uint8_t value)
 //  - removed EG_DMP and EG_REV enum values from 'state'
 // version 5:
 //  - re-added 'lfo' member. This is not stored in the savestate, instead it's
-//    restored from register values in YMF278::serialize()
+//    restored from register values in YMF278Core::serialize()
 //  - removed members 'lfo_step' and ' 'lfo_max'
 //  - 'lfo_cnt' has changed meaning (but we don't try to translate old to new meaning)
 // version 6:
 //  - removed members: 'sample1', 'sample2'
 template<typename Archive>
-void YMF278::Slot::serialize(Archive& ar, unsigned version)
+void YMF278Core::Slot::serialize(Archive& ar, unsigned version)
 {
 	// TODO restore more state from registers
 	ar.serialize("startaddr", startAddr,
@@ -991,6 +1023,26 @@ void YMF278::Slot::serialize(Archive& ar, unsigned version)
 	// increased the error message is much clearer.
 }
 
+template<typename Archive>
+void YMF278Core::serialize(Archive& ar, unsigned /*version*/)
+{
+	ar.serialize("slots",  slots,
+	             "eg_cnt", eg_cnt);
+	ar.serialize_blob("registers", regs);
+
+	// TODO restore more state from registers
+	if constexpr (Archive::IS_LOADER) {
+		for (auto [i, sl] : enumerate(slots)) {
+			uint8_t t = regs[0x50 + i] >> 1;
+			sl.TLdest = (t != 0x7f) ? t : 0xff;
+
+			sl.keyon = (regs[0x68 + i] & 0x80) != 0;
+			sl.DAMP  = (regs[0x68 + i] & 0x40) != 0;
+			sl.lfo   = (regs[0x80 + i] >> 3) & 7;
+		}
+	}
+}
+
 // version 1: initial version
 // version 2: loadTime and busyTime moved to MSXMoonSound class
 // version 3: memAdr cannot be restored from register values
@@ -998,35 +1050,23 @@ void YMF278::Slot::serialize(Archive& ar, unsigned version)
 template<typename Archive>
 void YMF278::serialize(Archive& ar, unsigned version)
 {
-	ar.serialize("slots",  slots,
-	             "eg_cnt", eg_cnt);
+	// the core state is stored directly in this tag (not in a sub-tag),
+	// that's compatible with older savestates
+	core.serialize(ar, version);
 	if (ar.versionAtLeast(version, 4)) {
 		ar.serialize("ram", ram);
 	} else {
 		ar.serialize_blob("ram", ram.getWriteBackdoor());
 	}
-	ar.serialize_blob("registers", regs);
-	if (ar.versionAtLeast(version, 3)) { // must come after 'regs'
+	if (ar.versionAtLeast(version, 3)) { // must come after 'registers'
 		ar.serialize("memadr", memAdr);
 	} else {
 		assert(Archive::IS_LOADER);
 		// Old formats didn't store 'memAdr' so we also can't magically
 		// restore the correct value. The best we can do is restore the
 		// last set address.
-		regs[3] &= 0x3F; // mask upper two bits
-		memAdr = (regs[3] << 16) | (regs[4] << 8) | regs[5];
-	}
-
-	// TODO restore more state from registers
-	if constexpr (Archive::IS_LOADER) {
-		for (auto [i, sl] : enumerate(slots)) {
-			uint8_t t = regs[0x50 + i] >> 1;
-			sl.TLdest = (t != 0x7f) ? t : 0xff;
-
-			sl.keyon = (regs[0x68 + i] & 0x80) != 0;
-			sl.DAMP  = (regs[0x68 + i] & 0x40) != 0;
-			sl.lfo   = (regs[0x80 + i] >> 3) & 7;
-		}
+		core.writeReg(3, core.peekReg(3) & 0x3F); // mask upper two bits
+		memAdr = (core.peekReg(3) << 16) | (core.peekReg(4) << 8) | core.peekReg(5);
 	}
 	// subclasses are responsible for calling setupMemoryPointers()
 }
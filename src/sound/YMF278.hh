@@ -21,34 +21,39 @@ namespace openmsx {
 
 class DeviceConfig;
 
-class YMF278 final : public ResampledSoundDevice
+/** The sound generation part of the YMF278 wave part: the slot registers and
+  * the sample playback. The memory (ROM/RAM) and the memory access registers
+  * are handled in YMF278. This doesn't need a motherboard, so it can also be
+  * used from the unittests.
+  */
+class YMF278Core
 {
 public:
 	static constexpr auto k128 = size_t(128 * 1024); // 128kB
 	using Block128 = optional_fixed_span<const uint8_t, k128>; // a 128kB read-only memory block
 
-	using SetupMemPtrFunc = std::function<void(
-		bool /*mode0*/,
-		std::span<const uint8_t> /*rom*/,
-		std::span<const uint8_t> /*ram*/,
-		std::span<YMF278::Block128, 32> /*memPtrs*/)>;
-
 public:
-	YMF278(const std::string& name, size_t ramSize, DeviceConfig& config,
-	       SetupMemPtrFunc setupMemPtrs_);
-	~YMF278();
-	void clearRam();
-	void reset(EmuTime time);
-	void writeReg(uint8_t reg, uint8_t data, EmuTime time);
-	[[nodiscard]] uint8_t readReg(uint8_t reg);
-	[[nodiscard]] uint8_t peekReg(uint8_t reg) const;
+	YMF278Core();
 
-	[[nodiscard]] uint8_t readMem(unsigned address) const;
-	void writeMem(unsigned address, uint8_t value);
+	void reset();
+	/** Write a register. For the non-slot registers the value is only
+	  * stored.
+	  */
+	void writeReg(uint8_t reg, uint8_t data);
+	[[nodiscard]] uint8_t peekReg(uint8_t reg) const { return regs[reg]; }
 
-	void setMixLevel(uint8_t x, EmuTime time);
+	/** The 4MB address space, divided in 32 blocks of 128kB. */
+	[[nodiscard]] std::span<Block128, 32> getMemPtrs() { return memPtrs; }
+	[[nodiscard]] uint8_t readMem(unsigned address) const;
 
-	void setupMemoryPointers();
+	/** Is any slot active? If not generateChannels() doesn't need to be
+	  * called.
+	  */
+	[[nodiscard]] bool anyActive() const;
+	/** Add 'num' samples to the 24 stereo buffers. The buffers of slots
+	  * that remain silent are set to nullptr.
+	  */
+	void generateChannels(std::span<float*> bufs, unsigned num);
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
@@ -62,6 +67,7 @@ private:
 		[[nodiscard]] uint8_t compute_decay_rate(int val) const;
 		[[nodiscard]] unsigned decay_rate(int num, int sample_rate);
 		void envelope_next(int sample_rate);
+		void advance(unsigned egCnt);
 		[[nodiscard]] int16_t compute_vib() const;
 		[[nodiscard]] uint16_t compute_am() const;
 
@@ -105,17 +111,63 @@ private:
 		bool lfo_active;
 	};
 
-	// SoundDevice
-	void generateChannels(std::span<float*> bufs, unsigned num) override;
-
-	void writeRegDirect(uint8_t reg, uint8_t data, EmuTime time);
-	[[nodiscard]] unsigned getRamAddress(unsigned addr) const;
 	[[nodiscard]] int16_t getSample(const Slot& slot, uint16_t pos) const;
 	[[nodiscard]] static uint16_t nextPos(const Slot& slot, uint16_t pos, uint16_t increment);
-	void advance();
-	[[nodiscard]] bool anyActive();
 	void keyOnHelper(Slot& slot) const;
 
+private:
+	std::array<Slot, 24> slots;
+
+	/** Global envelope generator counter. */
+	unsigned eg_cnt;
+
+	std::array<uint8_t, 256> regs = {};
+
+	// To speed-up memory access we divide the 4MB address-space in 32 blocks of 128kB.
+	// For each block we point to the corresponding region inside 'rom' or 'ram',
+	// or 'nullBlock' means this region is unmapped.
+	// Note: we can only _read_ via these pointers, not write.
+	std::array<Block128, 32> memPtrs;
+};
+
+class YMF278 final : public ResampledSoundDevice
+{
+public:
+	static constexpr auto k128 = YMF278Core::k128;
+	using Block128 = YMF278Core::Block128;
+
+	using SetupMemPtrFunc = std::function<void(
+		bool /*mode0*/,
+		std::span<const uint8_t> /*rom*/,
+		std::span<const uint8_t> /*ram*/,
+		std::span<YMF278::Block128, 32> /*memPtrs*/)>;
+
+public:
+	YMF278(const std::string& name, size_t ramSize, DeviceConfig& config,
+	       SetupMemPtrFunc setupMemPtrs_);
+	~YMF278();
+	void clearRam();
+	void reset(EmuTime time);
+	void writeReg(uint8_t reg, uint8_t data, EmuTime time);
+	[[nodiscard]] uint8_t readReg(uint8_t reg);
+	[[nodiscard]] uint8_t peekReg(uint8_t reg) const;
+
+	[[nodiscard]] uint8_t readMem(unsigned address) const;
+	void writeMem(unsigned address, uint8_t value);
+
+	void setMixLevel(uint8_t x, EmuTime time);
+
+	void setupMemoryPointers();
+
+	template<typename Archive>
+	void serialize(Archive& ar, unsigned version);
+
+private:
+	// SoundDevice
+	void generateChannels(std::span<float*> bufs, unsigned num) override;
+
+	void writeRegDirect(uint8_t reg, uint8_t data);
+
 	MSXMotherBoard& motherBoard;
 
 	struct DebugRegisters final : SimpleDebuggable {
@@ -130,28 +182,17 @@ private:
 		void write(unsigned address, uint8_t value) override;
 	} debugMemory;
 
-	std::array<Slot, 24> slots;
-
-	/** Global envelope generator counter. */
-	unsigned eg_cnt;
+	YMF278Core core;
 
 	int memAdr;
 
 	Rom rom;
 	TrackedRam ram;
 
-	std::array<uint8_t, 256> regs;
-
-	// To speed-up memory access we divide the 4MB address-space in 32 blocks of 128kB.
-	// For each block we point to the corresponding region inside 'rom' or 'ram',
-	// or 'nullBlock' means this region is unmapped.
-	// Note: we can only _read_ via these pointers, not write.
-	std::array<Block128, 32> memPtrs;
-
-	// callback-function that fills in the above array
+	// callback-function that fills in the memory pointers of 'core'
 	SetupMemPtrFunc setupMemPtrs;
 };
-SERIALIZE_CLASS_VERSION(YMF278::Slot, 6);
+SERIALIZE_CLASS_VERSION(YMF278Core::Slot, 6);
 SERIALIZE_CLASS_VERSION(YMF278, 4);
 
 } // namespace openmsx
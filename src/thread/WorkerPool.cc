@@ -0,0 +1,97 @@
+#include "WorkerPool.hh"
+
+#include "xrange.hh"
+
+#include <cassert>
+#include <utility>
+
+namespace openmsx {
+
+WorkerPool::WorkerPool(unsigned numThreads)
+{
+	setNumThreads(numThreads);
+}
+
+WorkerPool::~WorkerPool()
+{
+	stopWorkers();
+}
+
+void WorkerPool::setNumThreads(unsigned numThreads)
+{
+	if (numThreads == workers.size()) return;
+	stopWorkers();
+	workers.reserve(numThreads);
+	repeat(numThreads, [&] {
+		workers.emplace_back([this, g = generation] { workerLoop(g); });
+	});
+}
+
+void WorkerPool::stopWorkers()
+{
+	{
+		std::scoped_lock lock(mutex);
+		stop = true;
+	}
+	workAvailable.notify_all();
+	for (auto& t : workers) t.join();
+	workers.clear();
+	stop = false;
+}
+
+void WorkerPool::run(size_t num_, Func func_, void* ctx_)
+{
+	{
+		std::scoped_lock lock(mutex);
+		assert(busy == 0);
+		func = func_;
+		ctx = ctx_;
+		num = num_;
+		next = 0;
+		error = nullptr;
+		busy = unsigned(workers.size());
+		++generation;
+	}
+	workAvailable.notify_all();
+
+	work();
+
+	std::unique_lock lock(mutex);
+	workDone.wait(lock, [&] { return busy == 0; });
+	if (error) {
+		std::rethrow_exception(std::exchange(error, nullptr));
+	}
+}
+
+void WorkerPool::work()
+{
+	while (true) {
+		auto i = next.fetch_add(1);
+		if (i >= num) return;
+		try {
+			func(ctx, i);
+		} catch (...) {
+			std::scoped_lock lock(mutex);
+			if (!error) error = std::current_exception();
+		}
+	}
+}
+
+void WorkerPool::workerLoop(uint64_t seen)
+{
+	while (true) {
+		{
+			std::unique_lock lock(mutex);
+			workAvailable.wait(lock, [&] { return stop || (generation != seen); });
+			if (stop) return;
+			seen = generation;
+		}
+		work();
+		{
+			std::scoped_lock lock(mutex);
+			if (--busy == 0) workDone.notify_one();
+		}
+	}
+}
+
+} // namespace openmsx
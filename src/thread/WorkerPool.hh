@@ -0,0 +1,82 @@
+#ifndef WORKERPOOL_HH
+#define WORKERPOOL_HH
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace openmsx {
+
+/** A small pool of threads to split a loop over independent work items.
+  *
+  * parallelFor() blocks till all items are processed, the calling thread
+  * processes items as well. So with zero extra threads (the default) this
+  * is simply a sequential loop. The order in which the items are processed
+  * is not specified, so the items must be independent of each other.
+  */
+class WorkerPool
+{
+public:
+	explicit WorkerPool(unsigned numThreads = 0);
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool(WorkerPool&&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	WorkerPool& operator=(WorkerPool&&) = delete;
+	~WorkerPool();
+
+	/** Change the number of extra threads (not counting the thread that
+	  * calls parallelFor()). Must not be called during parallelFor().
+	  */
+	void setNumThreads(unsigned numThreads);
+	[[nodiscard]] unsigned getNumThreads() const { return unsigned(workers.size()); }
+
+	/** Call 'f(i)' for all 'i' in [0, n).
+	  * If one of the calls throws, the (first) exception is rethrown after
+	  * all other calls are finished.
+	  */
+	template<typename F>
+	void parallelFor(size_t n, F&& f)
+	{
+		if (workers.empty() || (n <= 1)) {
+			for (size_t i = 0; i < n; ++i) f(i);
+			return;
+		}
+		using Fn = std::remove_reference_t<F>;
+		run(n, [](void* p, size_t i) { (*static_cast<Fn*>(p))(i); }, &f);
+	}
+
+private:
+	using Func = void (*)(void* ctx, size_t i);
+	void run(size_t num, Func func, void* ctx);
+	void work();
+	void workerLoop(uint64_t seen);
+	void stopWorkers();
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable workAvailable; // new job or exit
+	std::condition_variable workDone;      // all workers finished the job
+
+	// the current job, only changed while no worker is busy
+	Func func = nullptr;
+	void* ctx = nullptr;
+	size_t num = 0;
+	std::atomic<size_t> next = 0; // next item to process
+	std::exception_ptr error;
+
+	uint64_t generation = 0; // incremented for each job
+	unsigned busy = 0;       // number of workers still working on the job
+	bool stop = false;
+};
+
+} // namespace openmsx
+
+#endif
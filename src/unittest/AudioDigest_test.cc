@@ -0,0 +1,99 @@
+#include "catch.hpp"
+#include "AudioDigest.hh"
+
+#include "endian.hh"
+#include "ranges.hh"
+#include "sha1.hh"
+#include "xrange.hh"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace openmsx;
+
+static Sha1Sum sha1OfSamples(std::span<const int16_t> samples)
+{
+	std::vector<Endian::L16> buf;
+	for (auto s : samples) buf.emplace_back(uint16_t(s));
+	return SHA1::calc(as_byte_span(std::span{buf}));
+}
+
+TEST_CASE("AudioDigest: sha1 equals sha1 of the 16-bit little-endian data")
+{
+	AudioDigest digest(1, 1000, false);
+	std::vector<float> in = {0.0f, 0.5f, -0.5f, 1.0f, -1.0f, 2.0f, 0.25f};
+	digest.write(in);
+	digest.write(in, 0.5f);
+	std::vector<int16_t> expected = {
+		0, 16384, -16384, 32767, -32768, 32767, 8192, // clipped
+		0,  8192,  -8192, 16384, -16384, 32767, 4096,
+	};
+	auto r = digest.getResult();
+	CHECK(r.samples == expected.size());
+	CHECK(r.sha1 == sha1OfSamples(expected));
+	CHECK(r.peak == 1.0);
+
+	// the result can also be requested while still adding samples
+	digest.writeSilence(3);
+	expected.insert(expected.end(), 3, 0);
+	r = digest.getResult();
+	CHECK(r.samples == expected.size());
+	CHECK(r.sha1 == sha1OfSamples(expected));
+}
+
+TEST_CASE("AudioDigest: stereo")
+{
+	AudioDigest digest(2, 1000, false);
+	std::vector<StereoFloat> in = {{0.5f, -0.25f}, {0.125f, 0.0f}};
+	digest.write(in, 1.0f, 2.0f);
+	std::vector<int16_t> expected = {16384, -16384, 4096, 0};
+	auto r = digest.getResult();
+	CHECK(r.samples == 2); // sample frames
+	CHECK(r.sha1 == sha1OfSamples(expected));
+	CHECK(r.peak == 0.5);
+	CHECK(r.rms == Approx(std::sqrt((2 * 0.25 + 0.125 * 0.125) / 4)));
+}
+
+TEST_CASE("AudioDigest: per second")
+{
+	static constexpr unsigned RATE = 100;
+	AudioDigest digest(1, RATE, true);
+	std::vector<float> in(250);
+	for (auto i : xrange(in.size())) {
+		in[i] = (i < RATE) ? 0.0f : 0.5f; // 1st second silent
+	}
+	// write in chunks that don't align with the seconds
+	for (size_t pos = 0; pos < in.size(); pos += 30) {
+		digest.write(std::span{in}.subspan(pos, std::min<size_t>(30, in.size() - pos)));
+	}
+
+	auto seconds = digest.getResultPerSecond();
+	REQUIRE(seconds.size() == 3);
+	CHECK(seconds[0].samples == RATE);
+	CHECK(seconds[1].samples == RATE);
+	CHECK(seconds[2].samples == 50);
+	CHECK(seconds[0].rms == 0.0);
+	CHECK(seconds[0].peak == 0.0);
+	CHECK(seconds[1].rms == 0.5);
+	CHECK(seconds[1].peak == 0.5);
+	CHECK(seconds[1].sha1 == sha1OfSamples(std::vector<int16_t>(RATE, 16384)));
+	CHECK(seconds[2].sha1 == sha1OfSamples(std::vector<int16_t>(50, 16384)));
+
+	auto total = digest.getResult();
+	CHECK(total.samples == 250);
+	std::vector<int16_t> expected(250, 16384);
+	std::fill_n(expected.begin(), RATE, int16_t(0));
+	CHECK(total.sha1 == sha1OfSamples(expected));
+}
+
+TEST_CASE("AudioDigest: empty")
+{
+	AudioDigest digest(2, 44100, true);
+	auto r = digest.getResult();
+	CHECK(r.samples == 0);
+	CHECK(r.rms == 0.0);
+	CHECK(r.peak == 0.0);
+	CHECK(r.sha1 == SHA1::calc({}));
+	CHECK(digest.getResultPerSecond().empty());
+}
@@ -0,0 +1,56 @@
+#include "catch.hpp"
+#include "CowBuffer.hh"
+
+#include "ranges.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <vector>
+
+using namespace openmsx;
+
+TEST_CASE("CowBuffer")
+{
+	static constexpr size_t SIZE = 256 * 1024 + 100; // not a multiple of the page size
+	std::vector<uint8_t> content(SIZE);
+	for (auto i : xrange(SIZE)) content[i] = uint8_t(i * 7 + (i >> 12));
+
+	auto image = CowImage::create(content);
+	if (!image) return; // not supported on this platform
+	CHECK(std::ranges::equal(image->getData(), content));
+
+	CowBuffer buf1(SIZE);
+	CowBuffer buf2(SIZE);
+	std::ranges::fill(buf1, 0xff);
+	const auto* addr = buf1.data();
+	REQUIRE(buf1.share(*image));
+	REQUIRE(buf2.share(*image));
+	CHECK(buf1.data() == addr); // address doesn't change
+	CHECK(std::ranges::equal(buf1, content));
+	CHECK(std::ranges::equal(buf2, content));
+
+	// writes are private to each buffer
+	buf1[0] = 1;
+	buf1[SIZE - 1] = 2;
+	buf2[100'000] = 3;
+	CHECK(buf1[0] == 1);
+	CHECK(buf1[SIZE - 1] == 2);
+	CHECK(buf1[100'000] == content[100'000]);
+	CHECK(buf2[0] == content[0]);
+	CHECK(buf2[SIZE - 1] == content[SIZE - 1]);
+	CHECK(buf2[100'000] == 3);
+	CHECK(std::ranges::equal(image->getData(), content));
+
+	// the buffers remain valid when the image is gone
+	image.reset();
+	CHECK(buf1[1] == content[1]);
+	CHECK(buf2[SIZE - 2] == content[SIZE - 2]);
+
+	// small buffers are never shared, sizes must match
+	auto small = CowImage::create(std::span{content}.first(100));
+	CHECK(!small);
+	auto other = CowImage::create(std::span{content}.first(SIZE - 1));
+	REQUIRE(other);
+	CHECK(!buf1.share(*other));
+	CHECK(buf1[0] == 1);
+}
@@ -6,6 +6,10 @@
 #include "one_of.hh"
 #include "StringOp.hh"
 #include "Timer.hh"
+#include "sha1.hh"
+#include "strCat.hh"
+#include <bit>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 
@@ -135,3 +139,139 @@ TEST_CASE("FilePoolCore")
 
 	FileOperations::deleteRecursive(tmp);
 }
+
+TEST_CASE("FilePoolCore: scan many files")
+{
+	// more files than hashed in one (parallel) batch
+	auto tmp = FileOperations::getTempDir() + "/filepool_unittest2";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp + "/sub");
+	static constexpr int NUM = 100;
+	for (int i = 0; i < NUM; ++i) {
+		createFile(strCat(tmp, (i & 1) ? "/sub/" : "/", i), strCat("content ", i));
+	}
+
+	auto getDirectories = [&] {
+		FilePoolCore::Directories result;
+		result.emplace_back(tmp, FileType::ROM);
+		return result;
+	};
+	{
+		FilePoolCore pool(tmp + "/../filepool_unittest2.cache",
+				  getDirectories,
+				  [](std::string_view, float) { /* report progress: nothing */});
+
+		// not present, all files get indexed
+		{
+			auto [file, fname] = pool.getFile(FileType::ROM, Sha1Sum("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2"));
+			CHECK(!file.is_open());
+		}
+		// all are found (without rescanning)
+		for (int i = 0; i < NUM; ++i) {
+			auto content = strCat("content ", i);
+			auto sum = SHA1::calc(std::span{std::bit_cast<const uint8_t*>(content.data()), content.size()});
+			auto [file, fname] = pool.getFile(FileType::ROM, sum);
+			CHECK(file.is_open());
+			CHECK(fname == strCat(tmp, (i & 1) ? "/sub/" : "/", i));
+		}
+	}
+	CHECK(readLines(tmp + "/../filepool_unittest2.cache").size() == NUM);
+
+	FileOperations::unlink(tmp + "/../filepool_unittest2.cache");
+	FileOperations::deleteRecursive(tmp);
+}
+
+TEST_CASE("FilePoolCore: binary index")
+{
+	auto tmp = FileOperations::getTempDir() + "/filepool_unittest3";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp + "/pool");
+	createFile(tmp + "/pool/a", "aaa"); // 7e240de74fb1ed08fa08d38063f6a6a91462a815
+	createFile(tmp + "/pool/b", "bbb"); // 5cb138284d431abd6a053a56625ec088bfb88912
+
+	auto poolDir = tmp + "/pool";
+	bool scan = true;
+	auto getDirectories = [&] {
+		FilePoolCore::Directories result;
+		if (scan) result.emplace_back(poolDir, FileType::ROM);
+		return result;
+	};
+	auto noProgress = [](std::string_view, float) { /* nothing */ };
+	Sha1Sum sumA("7e240de74fb1ed08fa08d38063f6a6a91462a815");
+	Sha1Sum sumB("5cb138284d431abd6a053a56625ec088bfb88912");
+	{
+		FilePoolCore pool(tmp + "/cache", getDirectories, noProgress);
+		CHECK(pool.getFile(FileType::ROM, sumA).file.is_open());
+		CHECK(pool.getFile(FileType::ROM, sumB).file.is_open());
+	}
+	CHECK(FileOperations::isRegularFile(tmp + "/cache"));
+	CHECK(FileOperations::isRegularFile(tmp + "/cache.idx"));
+
+	// Without scanning, the files can only be found via the cache. First
+	// via the binary index: make the text file unusable, but keep its size
+	// and modification time.
+	scan = false;
+	auto text = readLines(tmp + "/cache");
+	auto textTime = std::filesystem::last_write_time(tmp + "/cache");
+	auto textSize = std::filesystem::file_size(tmp + "/cache");
+	createFile(tmp + "/cache", std::string(textSize, ' '));
+	std::filesystem::last_write_time(tmp + "/cache", textTime);
+	{
+		FilePoolCore pool(tmp + "/cache", getDirectories, noProgress);
+		auto [file, fname] = pool.getFile(FileType::ROM, sumA);
+		CHECK(file.is_open());
+		CHECK(fname == tmp + "/pool/a");
+		CHECK(pool.getFile(FileType::ROM, sumB).filename == tmp + "/pool/b");
+	}
+	// ... then (when the index is outdated) via the text file.
+	createFile(tmp + "/cache", strCat(text[0], '\n', text[1], '\n'));
+	{
+		std::ofstream of(tmp + "/cache.idx", std::ios::binary | std::ios::app);
+		of << "garbage";
+	}
+	{
+		FilePoolCore pool(tmp + "/cache", getDirectories, noProgress);
+		CHECK(pool.getFile(FileType::ROM, sumA).filename == tmp + "/pool/a");
+		CHECK(pool.getFile(FileType::ROM, sumB).filename == tmp + "/pool/b");
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
+
+#ifdef __linux__
+TEST_CASE("FilePoolCore: watch directories")
+{
+	auto tmp = FileOperations::getTempDir() + "/filepool_unittest4";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp + "/pool");
+
+	auto poolDir = tmp + "/pool";
+	bool scan = true;
+	auto getDirectories = [&] {
+		FilePoolCore::Directories result;
+		if (scan) result.emplace_back(poolDir, FileType::ROM);
+		return result;
+	};
+	FilePoolCore pool(tmp + "/cache", getDirectories,
+	                  [](std::string_view, float) { /* nothing */ });
+	pool.setWatching(true);
+	scan = false; // from now on only find files via the watcher
+
+	// give the watcher thread some time to install its watches
+	Timer::sleep(100'000);
+	FileOperations::mkdirp(tmp + "/pool/sub");
+	Timer::sleep(100'000);
+	createFile(tmp + "/pool/sub/c", "ccc"); // f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2
+
+	Sha1Sum sumC("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2");
+	bool found = false;
+	for (int i = 0; (i < 100) && !found; ++i) {
+		found = pool.getFile(FileType::ROM, sumC).filename == tmp + "/pool/sub/c";
+		if (!found) Timer::sleep(50'000);
+	}
+	CHECK(found);
+
+	pool.setWatching(false);
+	FileOperations::deleteRecursive(tmp);
+}
+#endif
@@ -0,0 +1,164 @@
+#include "catch.hpp"
+#include "LZ4VideoReader.hh"
+#include "LZ4VideoWriter.hh"
+
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "RawFrame.hh"
+
+#include "lz4.hh"
+#include "ranges.hh"
+#include "stl.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <bit>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+
+static constexpr unsigned WIDTH = 320;
+static constexpr unsigned HEIGHT = 240;
+static constexpr unsigned NUM_FRAMES = 5;
+static constexpr unsigned SAMPLES = 2 * 735; // stereo, 44100Hz, 60fps
+
+struct Recording {
+	std::vector<std::vector<uint32_t>> frames;
+	std::vector<std::vector<int16_t>> audio;
+};
+
+// Mostly static images (like real MSX output), with some changes per frame.
+[[nodiscard]] static Recording record(const std::string& filename)
+{
+	std::minstd_rand rng(1234);
+	Recording result;
+	RawFrame frame(WIDTH, HEIGHT);
+	for (auto y : xrange(HEIGHT)) {
+		frame.setLineWidth(y, WIDTH);
+		for (auto& p : frame.getLineDirect(y).first(WIDTH)) {
+			p = 0xff000000 | uint32_t((y / 8) * 0x010203);
+		}
+	}
+	LZ4VideoWriter writer(filename, WIDTH, HEIGHT, 2, 44100);
+	for (auto n : xrange(NUM_FRAMES)) {
+		repeat(500, [&] {
+			frame.getLineDirect(rng() % HEIGHT)[rng() % WIDTH] = uint32_t(rng());
+		});
+		std::vector<uint32_t> pixels;
+		for (auto y : xrange(HEIGHT)) {
+			append(pixels, frame.getLineDirect(y).first(WIDTH));
+		}
+		result.frames.push_back(std::move(pixels));
+
+		std::vector<int16_t> audio(SAMPLES);
+		for (auto& s : audio) s = int16_t(rng());
+		result.audio.push_back(audio);
+
+		writer.addFrame(&frame, audio);
+		if (n == 0) writer.setFps(60.0f); // like AviRecorder does
+	}
+	return result;
+}
+
+[[nodiscard]] static std::vector<uint8_t> readAll(const std::string& filename)
+{
+	File file(filename);
+	std::vector<uint8_t> result(file.getSize());
+	file.read(std::span{result});
+	return result;
+}
+
+static void writeAll(const std::string& filename, std::span<const uint8_t> data)
+{
+	File file(filename, File::OpenMode::TRUNCATE);
+	file.write(data);
+}
+
+TEST_CASE("LZ4Video: round trip")
+{
+	auto filename = FileOperations::getTempDir() + "/lz4video_unittest.omv";
+	auto rec = record(filename);
+
+	LZ4VideoReader reader(filename);
+	CHECK(reader.getWidth() == WIDTH);
+	CHECK(reader.getHeight() == HEIGHT);
+	CHECK(reader.getChannels() == 2);
+	CHECK(reader.getAudioRate() == 44100);
+	CHECK(reader.getNumFrames() == NUM_FRAMES);
+	CHECK(reader.getFps() == 60.0f);
+	for (auto n : xrange(NUM_FRAMES)) {
+		REQUIRE(reader.nextFrame());
+		CHECK(std::ranges::equal(reader.getPixels(), rec.frames[n]));
+		CHECK(std::ranges::equal(reader.getAudio(), rec.audio[n]));
+	}
+	CHECK(!reader.nextFrame());
+
+	FileOperations::unlink(filename);
+}
+
+TEST_CASE("LZ4Video: interrupted recording")
+{
+	auto filename = FileOperations::getTempDir() + "/lz4video_unittest2.omv";
+	auto rec = record(filename);
+
+	// Simulate a crash during the last frame: no index, and the last
+	// video chunk is only partially written.
+	auto data = readAll(filename);
+	LZ4Video::FileHeader header;
+	std::ranges::copy(std::span{data}.first(sizeof(header)), std::bit_cast<uint8_t*>(&header));
+	size_t lastAudio = header.indexOffset - SAMPLES * sizeof(int16_t) - sizeof(LZ4Video::ChunkHeader);
+	header.indexOffset = 0;
+	header.frames = 0;
+	header.indexCount = 0;
+	std::ranges::copy(std::span{std::bit_cast<const uint8_t*>(&header), sizeof(header)}, data.begin());
+	data.resize(lastAudio - 10);
+	writeAll(filename, data);
+
+	LZ4VideoReader reader(filename);
+	CHECK(reader.getNumFrames() == NUM_FRAMES - 1);
+	CHECK(reader.getFps() == 60.0f);
+	for (auto n : xrange(NUM_FRAMES - 1)) {
+		REQUIRE(reader.nextFrame());
+		CHECK(std::ranges::equal(reader.getPixels(), rec.frames[n]));
+		CHECK(std::ranges::equal(reader.getAudio(), rec.audio[n]));
+	}
+	CHECK(!reader.nextFrame());
+
+	FileOperations::unlink(filename);
+}
+
+TEST_CASE("LZ4Video: corrupt data")
+{
+	std::minstd_rand rng(4321);
+	std::vector<uint8_t> input(100'000);
+	for (auto i : xrange(input.size())) {
+		input[i] = (i & 0x400) ? uint8_t(rng()) : uint8_t(i >> 12);
+	}
+	std::vector<uint8_t> compressed(LZ4::compressBound(int(input.size())));
+	auto compressedSize = LZ4::compress(input.data(), compressed.data(), int(input.size()));
+	compressed.resize(compressedSize);
+
+	// valid input gives the same result as the fast (unchecked) version
+	std::vector<uint8_t> output(input.size());
+	CHECK(LZ4::decompressSafe(compressed.data(), output.data(), compressedSize, int(output.size()))
+	      == int(input.size()));
+	CHECK(output == input);
+	// too small output buffer
+	CHECK(LZ4::decompressSafe(compressed.data(), output.data(), compressedSize, int(output.size() - 1))
+	      == -1);
+	// truncated input
+	CHECK(LZ4::decompressSafe(compressed.data(), output.data(), compressedSize - 1, int(output.size()))
+	      != int(input.size()));
+
+	// Random corruption must never read or write out of bounds (best
+	// checked with a sanitizer build).
+	repeat(1000, [&] {
+		auto corrupt = compressed;
+		repeat(1 + rng() % 4, [&] {
+			corrupt[rng() % corrupt.size()] = uint8_t(rng());
+		});
+		auto size = LZ4::decompressSafe(corrupt.data(), output.data(), int(corrupt.size()), int(output.size()));
+		CHECK(size <= int(output.size()));
+	});
+}
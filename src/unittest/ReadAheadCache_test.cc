@@ -0,0 +1,172 @@
+#include "catch.hpp"
+#include "ReadAheadCache.hh"
+
+#include "FileException.hh"
+#include "FileOperations.hh"
+
+#include "ranges.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+using namespace openmsx;
+
+TEST_CASE("ReadAheadCache")
+{
+	static constexpr size_t BLOCK = 2048;
+	static constexpr size_t SIZE = 1000 * BLOCK + 100; // last block is partial
+	std::minstd_rand rng(1234);
+	std::vector<uint8_t> content(SIZE);
+	for (auto& c : content) c = uint8_t(rng());
+
+	auto filename = FileOperations::getTempDir() + "/readaheadcache_unittest";
+	{
+		File f(filename, File::OpenMode::TRUNCATE);
+		f.write(content);
+	}
+	File file(filename);
+	{
+		// the first sequential read already triggers read-ahead
+		ReadAheadCache cache(file, BLOCK, 64 * BLOCK);
+		std::vector<uint8_t> buf(BLOCK);
+		cache.read(0, buf);
+		// wait for the background thread (with a generous timeout)
+		for (int i = 0; (i < 10000) && (cache.getStats().prefetched < 8); ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		auto stats = cache.getStats();
+		CHECK(stats.prefetched == 8);
+		CHECK(stats.misses == 1);
+		// so the next 8 blocks are already in the cache
+		std::vector<uint8_t> buf2(8 * BLOCK);
+		cache.read(BLOCK, buf2);
+		CHECK(std::ranges::equal(buf2, std::span{content}.subspan(BLOCK, 8 * BLOCK)));
+		stats = cache.getStats();
+		CHECK(stats.hits == 8);
+		CHECK(stats.misses == 1);
+	}
+	{
+		ReadAheadCache cache(file, BLOCK, 64 * BLOCK);
+		auto check = [&](size_t pos, size_t len) {
+			std::vector<uint8_t> buf(len);
+			cache.read(pos, buf);
+			CHECK(std::ranges::equal(buf, std::span{content}.subspan(pos, len)));
+		};
+
+		// sequential, in pieces smaller than a block
+		for (size_t pos = 0; pos < SIZE; pos += 512) {
+			check(pos, std::min<size_t>(512, SIZE - pos));
+		}
+		cache.flush(); // wait for the background thread
+		auto stats = cache.getStats();
+		// how many blocks are prefetched in time depends on the timing
+		CHECK((stats.hits + stats.misses) == 4001);
+
+		// random access
+		for (auto i : xrange(200)) {
+			(void)i;
+			auto pos = rng() % SIZE;
+			auto len = std::min<size_t>(rng() % (3 * BLOCK), SIZE - pos);
+			check(pos, len);
+		}
+		std::vector<uint8_t> buf(10);
+		CHECK_THROWS_AS(cache.read(SIZE - 5, buf), FileException);
+
+		// written data is immediately visible, and ends up in the file
+		std::vector<uint8_t> newData(5 * BLOCK);
+		for (auto& c : newData) c = uint8_t(rng());
+		cache.write(10 * BLOCK, newData);
+		copy_to_range(newData, std::span{content}.subspan(10 * BLOCK));
+		for (auto i : xrange(100)) {
+			cache.write(size_t(500 + (i % 30)) * BLOCK, std::span{newData}.first(BLOCK));
+			copy_to_range(std::span{newData}.first(BLOCK),
+			              std::span{content}.subspan((500 + (i % 30)) * BLOCK));
+		}
+		check(9 * BLOCK, 7 * BLOCK);
+		check(500 * BLOCK - 10, 40 * BLOCK);
+		CHECK(cache.flush());
+		CHECK(!cache.flush());
+		CHECK(cache.getStats().written >= 35);
+
+		// sequential again, while writing
+		for (size_t pos = 0; pos < SIZE; pos += BLOCK) {
+			auto len = std::min(BLOCK, SIZE - pos);
+			check(pos, len);
+			if ((len == BLOCK) && (pos % (7 * BLOCK)) == 0) {
+				cache.write(pos, std::span{newData}.subspan(BLOCK, BLOCK));
+				copy_to_range(std::span{newData}.subspan(BLOCK, BLOCK),
+				              std::span{content}.subspan(pos));
+			}
+		}
+		CHECK(cache.flush());
+		cache.invalidate();
+		CHECK(cache.getStats().hits == 0);
+		check(0, SIZE);
+	}
+
+	std::vector<uint8_t> result(SIZE);
+	file.seek(0);
+	file.read(result);
+	CHECK(std::ranges::equal(result, content));
+	file.close();
+	FileOperations::unlink(filename);
+}
+
+TEST_CASE("ReadAheadCache: write error")
+{
+	static constexpr size_t BLOCK = 512;
+	std::vector<uint8_t> content(16 * BLOCK, 0x11);
+
+	// a compressed file can be read, but not written
+	auto filename = FileOperations::getTempDir() + "/readaheadcache_unittest.gz";
+	{
+		gzFile gz = gzopen(filename.c_str(), "wb");
+		REQUIRE(gz);
+		gzwrite(gz, content.data(), unsigned(content.size()));
+		gzclose(gz);
+	}
+	File file(filename);
+	ReadAheadCache cache(file, BLOCK, 8 * BLOCK);
+	auto check = [&](size_t block, uint8_t expected) {
+		std::vector<uint8_t> buf(BLOCK);
+		cache.read(block * BLOCK, buf);
+		CHECK(std::ranges::all_of(buf, [&](auto b) { return b == expected; }));
+	};
+
+	// the error is only reported later, it mentions the failing position
+	cache.write(3 * BLOCK, std::vector<uint8_t>(BLOCK, 0x33));
+	try {
+		(void)cache.flush();
+		FAIL("expected an exception");
+	} catch (FileException& e) {
+		CHECK(e.getMessage().contains("offset 1536"));
+	}
+	// the data remains in the cache (and writing it is retried)
+	check(3, 0x33);
+
+	// Once the retry failed, a write reports that error. But the new data
+	// is still stored.
+	bool threw = false;
+	for (int i = 0; (i < 10000) && !threw; ++i) {
+		try {
+			cache.write(5 * BLOCK, std::vector<uint8_t>(BLOCK, uint8_t(i)));
+		} catch (FileException& e) {
+			threw = true;
+			CHECK(e.getMessage().contains("offset 1536"));
+			check(5, uint8_t(i));
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK(threw);
+	check(3, 0x33);
+	check(4, 0x11);
+
+	cache.invalidate();
+	file.close();
+	FileOperations::unlink(filename);
+}
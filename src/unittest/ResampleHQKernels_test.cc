@@ -0,0 +1,133 @@
+#include "catch.hpp"
+#include "ResampleHQKernels.hh"
+
+#include "xrange.hh"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+using namespace openmsx::ResampleHQKernels;
+
+namespace {
+
+using Kernel = void (*)(const float* buf, const float* tab, size_t len, float* out);
+
+// Random input samples and coefficient rows. The rows are 16-byte aligned,
+// like in the ResampleCoeffs table.
+struct Data {
+	static constexpr size_t MAX_LEN = 128;
+
+	Data()
+	{
+		std::minstd_rand rng(4321);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		for (auto& b : buf) b = dist(rng);
+		for (auto& t : tab) t = dist(rng);
+	}
+
+	std::vector<float> buf = std::vector<float>(2 * MAX_LEN + 8);
+	alignas(32) std::array<float, MAX_LEN + 8> tab;
+};
+
+} // namespace
+
+// Compare a SIMD kernel with the scalar version, for all filter lengths and
+// for different (unaligned) input positions. Only the order of the additions
+// may differ, so allow a rounding error of (at most) one float epsilon per
+// term, relative to the sum of the absolute values of the products.
+template<unsigned CHANNELS, bool REVERSE>
+static void check(Kernel kernel)
+{
+	static const Data data;
+	for (size_t len = 8; len <= Data::MAX_LEN; len += 4) {
+		for (auto offset : xrange(3)) {
+			const float* buf = &data.buf[offset];
+			// for REVERSE the row ends at 'tab', the (aligned) start
+			// of the row is then also used for the forward variant
+			const float* tab = REVERSE ? &data.tab[len] : &data.tab[0];
+			std::array<float, CHANNELS> expected, actual;
+			calcScalar<CHANNELS, REVERSE>(buf, tab, len, expected.data());
+			kernel(buf, tab, len, actual.data());
+			for (auto ch : xrange(CHANNELS)) {
+				double mag = 0.0;
+				for (auto i : xrange(len)) {
+					auto c = REVERSE ? tab[-ptrdiff_t(i) - 1] : tab[i];
+					mag += std::abs(double(c) * buf[CHANNELS * i + ch]);
+				}
+				INFO("len=" << len << " offset=" << offset << " ch=" << ch);
+				auto eps = double(std::numeric_limits<float>::epsilon());
+				CHECK(std::abs(double(actual[ch]) - expected[ch]) <= double(len) * eps * mag);
+			}
+		}
+	}
+}
+
+template<bool REVERSE>
+static void checkAll()
+{
+	check<1, REVERSE>(calc<1, REVERSE>);
+	check<2, REVERSE>(calc<2, REVERSE>);
+#ifdef __SSE2__
+	check<1, REVERSE>(calcSseMono  <REVERSE>);
+	check<2, REVERSE>(calcSseStereo<REVERSE>);
+	// always compiled, but only test it when this CPU supports it
+	if (HostCPU::getFeatures().avx) {
+		check<1, REVERSE>(calcAvxMono  <REVERSE>);
+		check<2, REVERSE>(calcAvxStereo<REVERSE>);
+	} else {
+		WARN("AVX kernels not tested: not supported by this CPU");
+	}
+#endif
+#ifdef __ARM_NEON
+	check<1, REVERSE>(calcNeonMono  <REVERSE>);
+	check<2, REVERSE>(calcNeonStereo<REVERSE>);
+#endif
+}
+
+TEST_CASE("ResampleHQKernels: compare with scalar version")
+{
+	checkAll<false>();
+	checkAll<true>();
+}
+
+template<unsigned CHANNELS>
+static void benchmark(const char* name, Kernel forward, Kernel reverse)
+{
+	static const Data data;
+	static constexpr size_t NUM = 2'000'000;
+	for (size_t len : {32, 52, 100}) {
+		float sum = 0.0f;
+		auto start = std::chrono::steady_clock::now();
+		for (auto i : xrange(NUM)) {
+			std::array<float, CHANNELS> out;
+			const float* buf = &data.buf[i % 8];
+			if (i & 1) {
+				reverse(buf, &data.tab[len], len, out.data());
+			} else {
+				forward(buf, &data.tab[0], len, out.data());
+			}
+			sum += out[0];
+		}
+		std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+		std::cout << name << " len=" << len << ": "
+		          << d.count() / NUM * 1e9 << " ns/sample"
+		          << " (" << sum << ")\n";
+	}
+}
+
+// Not run by default, select it explicitly with:
+//   openmsx-unittest "[benchmark]"
+TEST_CASE("ResampleHQKernels: benchmark", "[.][benchmark]")
+{
+	benchmark<1>("scalar mono  ", calcScalar<1, false>, calcScalar<1, true>);
+	benchmark<1>("best   mono  ", calc<1, false>, calc<1, true>);
+	benchmark<2>("scalar stereo", calcScalar<2, false>, calcScalar<2, true>);
+	benchmark<2>("best   stereo", calc<2, false>, calc<2, true>);
+}
@@ -0,0 +1,81 @@
+#include "catch.hpp"
+#include "SPSCRingBuffer.hh"
+
+#include "xrange.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <thread>
+
+using namespace openmsx;
+
+TEST_CASE("SPSCRingBuffer: push/pop")
+{
+	SPSCRingBuffer<int> buf(5);
+	CHECK(buf.capacity() == 5);
+	CHECK(buf.empty());
+	CHECK(buf.free() == 5);
+
+	std::array<int, 8> out = {};
+	CHECK(buf.pop(out) == 0);
+
+	CHECK(buf.push(std::array{1, 2, 3}) == 3);
+	CHECK(buf.size() == 3);
+	CHECK(buf.free() == 2);
+
+	// only 2 fit, full buffer can be distinguished from empty
+	CHECK(buf.push(std::array{4, 5, 6}) == 2);
+	CHECK(buf.size() == 5);
+	CHECK(buf.free() == 0);
+	CHECK(buf.push(std::array{7}) == 0);
+
+	CHECK(buf.pop(std::span{out}.first(2)) == 2);
+	CHECK(out[0] == 1);
+	CHECK(out[1] == 2);
+
+	// wraps around the end of the storage
+	CHECK(buf.push(std::array{6, 7}) == 2);
+	CHECK(buf.pop(out) == 5);
+	CHECK(std::ranges::equal(std::span{out}.first(5), std::array{3, 4, 5, 6, 7}));
+	CHECK(buf.empty());
+
+	CHECK(buf.push(std::array{8}) == 1);
+	buf.clear();
+	CHECK(buf.empty());
+	CHECK(buf.pop(out) == 0);
+
+	buf.resize(2);
+	CHECK(buf.capacity() == 2);
+	CHECK(buf.push(std::array{1, 2, 3}) == 2);
+}
+
+TEST_CASE("SPSCRingBuffer: producer and consumer thread")
+{
+	static constexpr uint32_t NUM = 1'000'000;
+	SPSCRingBuffer<uint32_t> buf(1000);
+
+	std::thread producer([&] {
+		std::array<uint32_t, 37> chunk;
+		uint32_t next = 0;
+		while (next < NUM) {
+			auto n = std::min<size_t>(chunk.size(), NUM - next);
+			std::iota(chunk.begin(), chunk.begin() + n, next);
+			next += uint32_t(buf.push(std::span{chunk}.first(n)));
+		}
+	});
+
+	std::array<uint32_t, 53> chunk;
+	uint32_t expected = 0;
+	bool ok = true;
+	while (expected < NUM) {
+		auto n = buf.pop(chunk);
+		for (auto i : xrange(n)) {
+			ok &= chunk[i] == expected++;
+		}
+	}
+	producer.join();
+	CHECK(ok);
+	CHECK(buf.empty());
+}
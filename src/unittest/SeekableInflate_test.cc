@@ -0,0 +1,111 @@
+#include "catch.hpp"
+#include "SeekableInflate.hh"
+
+#include "FileException.hh"
+
+#include "ranges.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+
+[[nodiscard]] static std::vector<uint8_t> rawDeflate(std::span<const uint8_t> data)
+{
+	z_stream s = {};
+	REQUIRE(deflateInit2(&s, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+	std::vector<uint8_t> result(deflateBound(&s, uLong(data.size())));
+	s.next_in = data.data();
+	s.avail_in = uInt(data.size());
+	s.next_out = result.data();
+	s.avail_out = uInt(result.size());
+	REQUIRE(deflate(&s, Z_FINISH) == Z_STREAM_END);
+	result.resize(s.total_out);
+	deflateEnd(&s);
+	return result;
+}
+
+TEST_CASE("SeekableInflate")
+{
+	// compressible, but not too much (so that there are many deflate blocks)
+	std::minstd_rand rng(1234);
+	std::vector<uint8_t> data(5 * 1024 * 1024 + 123);
+	for (auto i : xrange(data.size())) {
+		data[i] = (rng() & 7) ? uint8_t(i >> 10) : uint8_t(rng());
+	}
+	auto compressed = rawDeflate(data);
+	// put some header in front of the deflate stream
+	compressed.insert(compressed.begin(), {'h', 'e', 'a', 'd'});
+
+	SeekableInflate inflate{MappedFile<const uint8_t>{
+		MappedFileImpl{std::span{compressed}, 0, true}}, 4, data.size()};
+	CHECK(inflate.getSize() == data.size());
+
+	auto check = [&](size_t pos, size_t len) {
+		std::vector<uint8_t> buf(len);
+		inflate.read(pos, buf);
+		CHECK(std::ranges::equal(buf, std::span{data}.subspan(pos, len)));
+	};
+
+	// random access, the first far read has to decompress everything before
+	check(4'000'000, 100);
+	check(10, 1000);
+	check(data.size() - 500, 500);
+	check(65536 - 10, 20); // crosses a chunk boundary
+	check(0, data.size());
+	for (auto i : xrange(100)) {
+		(void)i;
+		auto pos = rng() % data.size();
+		auto len = std::min<size_t>(rng() % 100'000, data.size() - pos);
+		check(pos, len);
+	}
+
+	// sequential
+	for (size_t pos = 0; pos < data.size(); pos += 512) {
+		check(pos, std::min<size_t>(512, data.size() - pos));
+	}
+
+	std::vector<uint8_t> buf(10);
+	CHECK_THROWS_AS(inflate.read(data.size() - 5, buf), FileException);
+	inflate.read(data.size() - 10, buf); // still ok after an error
+	CHECK(std::ranges::equal(buf, std::span{data}.last(10)));
+}
+
+TEST_CASE("SeekableInflate: wrong size")
+{
+	// e.g. the size stored in a gzip file is modulo 4GB
+	std::vector<uint8_t> data(3 * 1024 * 1024);
+	for (auto i : xrange(data.size())) data[i] = uint8_t(i * i >> 7);
+	auto compressed = rawDeflate(data);
+
+	auto size = data.size() - 1000;
+	SeekableInflate inflate{MappedFile<const uint8_t>{
+		MappedFileImpl{std::span{compressed}, 0, true}}, 0, size};
+	std::vector<uint8_t> buf(100);
+	inflate.read(0, buf);
+	CHECK(std::ranges::equal(buf, std::span{data}.first(100)));
+	CHECK_THROWS_AS(inflate.read(size - 100, buf), FileException);
+
+	// the correct size
+	SeekableInflate inflate2{MappedFile<const uint8_t>{
+		MappedFileImpl{std::span{compressed}, 0, true}}, 0, data.size()};
+	inflate2.read(data.size() - 100, buf);
+	CHECK(std::ranges::equal(buf, std::span{data}.last(100)));
+}
+
+TEST_CASE("SeekableInflate: truncated input")
+{
+	std::vector<uint8_t> data(3 * 1024 * 1024);
+	for (auto i : xrange(data.size())) data[i] = uint8_t(i * i >> 7);
+	auto compressed = rawDeflate(data);
+	compressed.resize(compressed.size() / 2);
+
+	SeekableInflate inflate{MappedFile<const uint8_t>{
+		MappedFileImpl{std::span{compressed}, 0, true}}, 0, data.size()};
+	std::vector<uint8_t> buf(100);
+	CHECK_THROWS_AS(inflate.read(data.size() - 100, buf), FileException);
+	inflate.read(0, buf);
+	CHECK(std::ranges::equal(buf, std::span{data}.first(100)));
+}
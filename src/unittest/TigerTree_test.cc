@@ -6,13 +6,16 @@
 
 #include <algorithm>
 #include <span>
+#include <vector>
 
 using namespace openmsx;
 
 struct TTTestData final : public TTData
 {
-	uint8_t* getData(size_t offset, size_t /*size*/) override
+	const uint8_t* getData(size_t offset, size_t size) override
 	{
+		++numCalls;
+		numBytes += size;
 		return buffer + offset;
 	}
 
@@ -22,10 +25,41 @@ struct TTTestData final : public TTData
 	}
 
 	uint8_t* buffer;
+	size_t numCalls = 0;
+	size_t numBytes = 0;
 };
 
+// Straightforward (non-incremental) tiger-tree-hash calculation.
+static TigerHash referenceHash(std::span<const uint8_t> input)
+{
+	static constexpr auto BLOCK_SIZE = TigerTree::BLOCK_SIZE;
+	std::vector<TigerHash> hashes;
+	size_t offset = 0;
+	do {
+		auto block = input.subspan(offset, std::min(BLOCK_SIZE, input.size() - offset));
+		std::vector<uint8_t> tmp = {0x00};
+		tmp.insert(tmp.end(), block.begin(), block.end());
+		tiger(tmp, hashes.emplace_back());
+		offset += BLOCK_SIZE;
+	} while (offset < input.size());
+
+	while (hashes.size() > 1) {
+		std::vector<TigerHash> parents;
+		for (size_t i = 0; i < hashes.size(); i += 2) {
+			if ((i + 1) == hashes.size()) {
+				parents.push_back(hashes[i]);
+			} else {
+				std::vector<uint8_t> tmp = {0x01};
+				tmp.insert(tmp.end(), hashes[i    ].h8.begin(), hashes[i    ].h8.end());
+				tmp.insert(tmp.end(), hashes[i + 1].h8.begin(), hashes[i + 1].h8.end());
+				tiger(tmp, parents.emplace_back());
+			}
+		}
+		hashes = std::move(parents);
+	}
+	return hashes[0];
+}
 
-// TODO check that hash (re)calculation is indeed incremental
 
 TEST_CASE("TigerTree")
 {
@@ -91,3 +125,52 @@ TEST_CASE("TigerTree")
 		      "PLHCYOTPV4TTXTUPHYGGVPMARGMFE4U5JYRV4VA");
 	}
 }
+
+TEST_CASE("TigerTree: large input")
+{
+	// multiple (partial) chunks, so hashed in parallel
+	static constexpr auto BLOCK_SIZE = TigerTree::BLOCK_SIZE;
+	static constexpr size_t SIZE = 9000 * BLOCK_SIZE + 123;
+	std::vector<uint8_t> buffer(SIZE);
+	for (size_t i = 0; i < SIZE; ++i) buffer[i] = uint8_t((i * i) >> 7);
+	TTTestData data;
+	data.buffer = buffer.data();
+
+	std::string name = "large";
+	time_t dummyTime = 0;
+	auto dummyCallback = [](size_t, size_t) {};
+
+	TigerTree tt(data, SIZE, name);
+	auto expected = referenceHash(buffer).toString();
+	CHECK(tt.calcHash(dummyCallback).toString() == expected);
+	CHECK(data.numBytes == SIZE);
+
+	// only the changed blocks are fetched again
+	data.numBytes = 0;
+	std::ranges::fill(subspan(buffer, 5000 * BLOCK_SIZE + 10, 3 * BLOCK_SIZE), 1);
+	tt.notifyChange(5000 * BLOCK_SIZE + 10, 3 * BLOCK_SIZE, dummyTime);
+	buffer[SIZE - 1] = 2;
+	tt.notifyChange(SIZE - 1, 1, dummyTime);
+	expected = referenceHash(buffer).toString();
+	CHECK(tt.calcHash(dummyCallback).toString() == expected);
+	CHECK(data.numBytes == 4 * BLOCK_SIZE + 123);
+
+	SECTION("restore upper nodes") {
+		auto nodes = tt.getUpperNodes(256);
+		CHECK(!nodes.empty());
+		CHECK(nodes.size() < 100);
+
+		// a fresh tree (data is not cached), nothing needs to be fetched
+		TigerTree tt2(data, SIZE, name);
+		tt2.restoreNodes(nodes);
+		data.numCalls = 0;
+		CHECK(tt2.calcHash(dummyCallback).toString() == expected);
+		CHECK(data.numCalls == 0);
+
+		// after a change only (about) 256 blocks need to be rehashed
+		buffer[1234] = 3;
+		tt2.notifyChange(1234, 1, dummyTime);
+		CHECK(tt2.calcHash(dummyCallback).toString() == referenceHash(buffer).toString());
+		CHECK(data.numCalls == 256);
+	}
+}
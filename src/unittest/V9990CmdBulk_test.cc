@@ -0,0 +1,178 @@
+#include "catch.hpp"
+#include "V9990CmdBulk.hh"
+
+#include "xrange.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace openmsx;
+
+// Run the V9990 block commands (the real code in V9990CmdBulk::BlockCommands)
+// twice: once synchronized in tiny steps (at most a pixel or a byte per sync,
+// like the old pixel by pixel implementation) and once in large steps (many
+// lines per sync). The VRAM content, the registers and the timing must be
+// identical at every common sync point.
+
+namespace {
+
+using P1    = V9990CmdEngine::V9990P1;
+using P2    = V9990CmdEngine::V9990P2;
+using Bpp2  = V9990CmdEngine::V9990Bpp2;
+using Bpp4  = V9990CmdEngine::V9990Bpp4;
+using Bpp8  = V9990CmdEngine::V9990Bpp8;
+using Bpp16 = V9990CmdEngine::V9990Bpp16;
+
+struct TestVRAM {
+	std::vector<uint8_t> data = std::vector<uint8_t>(0x80000);
+	[[nodiscard]] std::span<uint8_t> getCmdArea() { return data; }
+};
+
+struct TestVDP {
+	unsigned width = 256;
+	[[nodiscard]] unsigned getImageWidth() const { return width; }
+};
+
+// The members of V9990CmdEngine that are used by BlockCommands.
+struct TestEngine {
+	TestVDP vdp;
+	TestVRAM vram;
+	EmuTime engineTime = EmuTime::zero();
+	std::optional<EmuTime> doneTime;
+	unsigned srcAddress = 0;
+	unsigned dstAddress = 0;
+	uint16_t ANX = 0, ANY = 0;
+	uint16_t SX = 0, SY = 0, DX = 0, DY = 0, NX = 0, NY = 0;
+	uint16_t WM = 0, fgCol = 0, bgCol = 0;
+	uint8_t ARG = 0, LOG = 0;
+	uint8_t data = 0;
+	uint8_t bitsLeft = 0;
+
+	void cmdReady(EmuTime time) { doneTime = time; }
+	[[nodiscard]] uint16_t getWrappedNX() const { return NX ? NX : 2048; }
+	[[nodiscard]] uint16_t getWrappedNY() const { return NY ? NY : 4096; }
+};
+
+enum class Command { LMMV, LMMM, CMMM, BMXL, BMLX };
+
+void start(TestEngine& e, Command cmd, EmuTime time)
+{
+	using B = V9990CmdBulk::BlockCommands;
+	switch (cmd) {
+		case Command::LMMV: B::startLMMV(e, time); break;
+		case Command::LMMM: B::startLMMM(e, time); break;
+		case Command::CMMM: B::startCMMM(e, time); break;
+		case Command::BMXL: B::startBMXL(e, time); break;
+		case Command::BMLX: B::startBMLX(e, time); break;
+	}
+}
+
+template<typename Mode>
+void execute(TestEngine& e, Command cmd, EmuTime limit, EmuDuration delta)
+{
+	using B = V9990CmdBulk::BlockCommands;
+	switch (cmd) {
+		case Command::LMMV: B::executeLMMV<Mode>(e, limit, delta); break;
+		case Command::LMMM: B::executeLMMM<Mode>(e, limit, delta); break;
+		case Command::CMMM: B::executeCMMM<Mode>(e, limit, delta); break;
+		case Command::BMXL: B::executeBMXL<Mode>(e, limit, delta); break;
+		case Command::BMLX: B::executeBMLX<Mode>(e, limit, delta); break;
+	}
+}
+
+void checkEqual(const TestEngine& a, const TestEngine& b)
+{
+	REQUIRE(std::ranges::equal(a.vram.data, b.vram.data));
+	CHECK(a.engineTime == b.engineTime);
+	REQUIRE(a.doneTime.has_value() == b.doneTime.has_value());
+	if (a.doneTime) CHECK(*a.doneTime == *b.doneTime);
+	CHECK(a.srcAddress == b.srcAddress);
+	CHECK(a.dstAddress == b.dstAddress);
+	CHECK(a.ANX == b.ANX);
+	CHECK(a.ANY == b.ANY);
+	CHECK(a.SX == b.SX);
+	CHECK(a.SY == b.SY);
+	CHECK(a.DX == b.DX);
+	CHECK(a.DY == b.DY);
+	CHECK(a.data == b.data);
+	CHECK(a.bitsLeft == b.bitsLeft);
+}
+
+template<typename Mode>
+void testMode(std::mt19937& gen, unsigned width)
+{
+	auto rnd = [&](unsigned n) { return std::uniform_int_distribution<unsigned>(0, n - 1)(gen); };
+
+	TestEngine e;
+	e.vdp.width = width;
+	for (auto& v : e.vram.data) v = uint8_t(rnd(256));
+	for (auto iter : xrange(150)) {
+		(void)iter;
+		auto cmd = Command(rnd(5));
+		// small rectangles, sometimes crossing the edges of the image
+		e.SX = uint16_t(rnd(2048)); e.SY = uint16_t(rnd(4096));
+		e.DX = uint16_t(rnd(2048)); e.DY = uint16_t(rnd(4096));
+		if (rnd(4) == 0) { e.SY = e.DY; e.SX = uint16_t(e.DX + rnd(5) - 2); } // overlap
+		e.NX = uint16_t(rnd(4) ? rnd(40) : rnd(4096));
+		e.NY = uint16_t(rnd(10) + 1);
+		e.ARG = uint8_t(rnd(16));
+		e.LOG = uint8_t(rnd(32));
+		e.WM = rnd(2) ? 0xFFFF : uint16_t(rnd(0x10000));
+		e.fgCol = uint16_t(rnd(0x10000));
+		e.bgCol = rnd(4) ? uint16_t(rnd(0x10000)) : 0;
+		e.doneTime.reset();
+		auto delta = rnd(8) ? EmuDuration(uint64_t(rnd(200) + 1)) : EmuDuration::zero();
+		auto step = std::max(unsigned(delta.toUint64()), 1u);
+
+		start(e, cmd, e.engineTime);
+		TestEngine ref = e;
+		EmuTime limit = e.engineTime;
+		EmuTime refLimit = limit;
+		while (!e.doneTime) {
+			limit += EmuDuration(uint64_t(rnd(3) ? rnd(5000) : rnd(500000)));
+			while (!ref.doneTime && (refLimit < limit)) {
+				refLimit = std::min(limit, refLimit + EmuDuration(uint64_t(rnd(step) + 1)));
+				execute<Mode>(ref, cmd, refLimit, delta);
+			}
+			execute<Mode>(e, cmd, limit, delta);
+			checkEqual(e, ref);
+		}
+		e.engineTime = limit;
+	}
+}
+
+} // namespace
+
+TEST_CASE("V9990CmdBulk: numUnits")
+{
+	std::mt19937 gen(1234);
+	auto rnd = [&](unsigned n) { return std::uniform_int_distribution<unsigned>(0, n - 1)(gen); };
+	for (auto iter : xrange(1000)) {
+		(void)iter;
+		auto time = EmuTime::zero() + EmuDuration(uint64_t(rnd(1000)));
+		auto limit = EmuTime::zero() + EmuDuration(uint64_t(rnd(1000)));
+		auto delta = EmuDuration(uint64_t(rnd(20) + 1));
+		unsigned n = 0;
+		for (auto t = time; t < limit; t += delta) ++n;
+		CHECK(V9990CmdBulk::numUnits(time, limit, delta) == n);
+	}
+	CHECK(V9990CmdBulk::numUnits(EmuTime::zero(), EmuTime::zero(), EmuDuration::zero()) == 0);
+	CHECK(V9990CmdBulk::numUnits(EmuTime::zero(), EmuTime::zero() + EmuDuration::epsilon(),
+	                             EmuDuration::zero()) == std::numeric_limits<unsigned>::max());
+}
+
+TEST_CASE("V9990CmdBulk: tiny vs large syncs")
+{
+	std::mt19937 gen(5678);
+	SECTION("P1")    { testMode<P1   >(gen,  256); }
+	SECTION("P2")    { testMode<P2   >(gen,  512); }
+	SECTION("Bpp2")  { testMode<Bpp2 >(gen, 1024); }
+	SECTION("Bpp4")  { testMode<Bpp4 >(gen,  512); }
+	SECTION("Bpp8")  { testMode<Bpp8 >(gen,  256); }
+	SECTION("Bpp16") { testMode<Bpp16>(gen,  512); }
+}
@@ -0,0 +1,309 @@
+#include "catch.hpp"
+#include "VDPCmdBulk.hh"
+
+#include "xrange.hh"
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace openmsx;
+using namespace VDPAccessSlots;
+
+// Run the real VDPCmdEngine block commands (VDPCmdBulk::BlockCommands) on a
+// simplified VRAM model. The reference executes one VRAM access at a time,
+// synced in many small steps. The other run uses the bulk code path, synced
+// in larger steps. Both must give the same VRAM content, the same registers
+// and the same timing.
+
+namespace {
+
+// 128kB VRAM + 64kB extended VRAM. When 'direct' is false the command engine
+// can't write VRAM directly, like when a VRAM observer watches that range.
+struct TestVRAM
+{
+	struct Window {
+		const std::vector<uint8_t>& data;
+		[[nodiscard]] uint8_t readNP(unsigned address) const { return data[address]; }
+		void setMask(unsigned /*mask*/, unsigned /*base*/, EmuTime /*time*/) {}
+		void disable(EmuTime /*time*/) {}
+	};
+
+	std::vector<uint8_t> data = std::vector<uint8_t>(0x30000);
+	Window cmdReadWindow{data};
+	Window cmdWriteWindow{data};
+	bool direct = true;
+
+	void cmdWrite(unsigned address, uint8_t value, EmuTime /*time*/) {
+		data[address] = value;
+	}
+	[[nodiscard]] std::span<const uint8_t> getCmdReadArea(unsigned address, unsigned size) const {
+		if ((address + size) > 0x20000) return {};
+		return std::span{data}.subspan(address, size);
+	}
+	[[nodiscard]] std::span<uint8_t> getCmdWriteArea(unsigned address, unsigned size) {
+		if (!direct || ((address + size) > 0x20000)) return {};
+		return std::span{data}.subspan(address, size);
+	}
+};
+
+// Same members as VDPCmdEngine, as far as they're used by BlockCommands.
+struct TestEngine
+{
+	explicit TestEngine(std::span<const uint8_t, NUM_DELTAS * TICKS> tab_) : tab(tab_) {}
+
+	TestVRAM vram;
+	std::span<const uint8_t, NUM_DELTAS * TICKS> tab;
+	EmuTime engineTime = EmuTime::zero();
+	EmuTime doneTime = EmuTime::infinity();
+	unsigned SX = 0, SY = 0, DX = 0, DY = 0, NX = 0, NY = 0;
+	unsigned ASX = 0, ADX = 0, ANX = 0;
+	uint8_t COL = 0, ARG = 0, CMD = 0;
+	uint8_t tmpSrc = 0, tmpDst = 0;
+	int phase = 0;
+	bool hasExtendedVRAM = true;
+
+	[[nodiscard]] Calculator getSlotCalculator(EmuTime limit) const {
+		return {EmuTime::zero(), engineTime, limit, tab};
+	}
+	void nextAccessSlot(EmuTime time) {
+		Calculator calc(EmuTime::zero(), time, time, tab);
+		calc.next(Delta::D0);
+		engineTime = calc.getTime();
+	}
+	void calcFinishTime(unsigned /*nx*/, unsigned /*ny*/, unsigned /*ticksPerPixel*/) {}
+	void commandDone(EmuTime time) {
+		CMD = 0;
+		doneTime = time;
+	}
+};
+
+using VDPCmdBulk::BlockCommands;
+
+enum Cmd { LMMV, HMMV, HMMM, YMMM };
+
+// Synthetic access slot table: a slot every 8 ticks, with some gaps.
+[[nodiscard]] std::vector<uint8_t> slotTable(std::mt19937& rng)
+{
+	static constexpr std::array<int, NUM_DELTAS> deltaTicks = {
+		0, 1, 16, 24, 28, 32, 36, 40, 48, 64, 72, 88, 104, 120, 128, 136};
+	std::vector<bool> slot(TICKS);
+	for (auto t : xrange(TICKS)) slot[t] = ((t % 8) == 0) && ((rng() % 5) != 0);
+	std::vector<uint8_t> tab(NUM_DELTAS * TICKS);
+	for (auto d : xrange(NUM_DELTAS)) {
+		for (auto t : xrange(TICKS)) {
+			int k = std::max(deltaTicks[d], 1);
+			while (!slot[(t + k) % TICKS]) ++k;
+			tab[d * TICKS + t] = uint8_t(k);
+		}
+	}
+	return tab;
+}
+
+template<typename Mode>
+void start(TestEngine& e, Cmd cmd, EmuTime time)
+{
+	switch (cmd) {
+	case LMMV: BlockCommands::startLmmv<Mode>(e, time); break;
+	case HMMV: BlockCommands::startHmmv<Mode>(e, time); break;
+	case HMMM: BlockCommands::startHmmm<Mode>(e, time); break;
+	case YMMM: BlockCommands::startYmmm<Mode>(e, time); break;
+	}
+}
+
+template<typename Mode>
+void executeLmmv(TestEngine& e, uint8_t logOp, EmuTime limit)
+{
+	switch (logOp) {
+	case 0x0: BlockCommands::executeLmmv<Mode,  ImpOp>(e, limit); break;
+	case 0x1: BlockCommands::executeLmmv<Mode,  AndOp>(e, limit); break;
+	case 0x2: BlockCommands::executeLmmv<Mode,  OrOp >(e, limit); break;
+	case 0x3: BlockCommands::executeLmmv<Mode,  XorOp>(e, limit); break;
+	case 0x4: BlockCommands::executeLmmv<Mode,  NotOp>(e, limit); break;
+	case 0x8: BlockCommands::executeLmmv<Mode, TImpOp>(e, limit); break;
+	case 0x9: BlockCommands::executeLmmv<Mode, TAndOp>(e, limit); break;
+	case 0xA: BlockCommands::executeLmmv<Mode, TOrOp >(e, limit); break;
+	case 0xB: BlockCommands::executeLmmv<Mode, TXorOp>(e, limit); break;
+	case 0xC: BlockCommands::executeLmmv<Mode, TNotOp>(e, limit); break;
+	default:  BlockCommands::executeLmmv<Mode, DummyOp>(e, limit); break;
+	}
+}
+
+template<typename Mode>
+void execute(TestEngine& e, Cmd cmd, uint8_t logOp, EmuTime limit)
+{
+	if (!e.CMD) return;
+	switch (cmd) {
+	case LMMV: executeLmmv<Mode>(e, logOp, limit); break;
+	case HMMV: BlockCommands::executeHmmv<Mode>(e, limit); break;
+	case HMMM: BlockCommands::executeHmmm<Mode>(e, limit); break;
+	case YMMM: BlockCommands::executeYmmm<Mode>(e, limit); break;
+	}
+}
+
+void checkEqual(const TestEngine& ref, const TestEngine& bulk, Cmd cmd)
+{
+	CHECK(ref.engineTime == bulk.engineTime);
+	CHECK(ref.doneTime == bulk.doneTime);
+	CHECK(ref.CMD == bulk.CMD);
+	CHECK(ref.SY == bulk.SY);
+	CHECK(ref.DY == bulk.DY);
+	CHECK(ref.NY == bulk.NY);
+	CHECK(ref.ASX == bulk.ASX);
+	CHECK(ref.ADX == bulk.ADX);
+	CHECK(ref.ANX == bulk.ANX);
+	REQUIRE(ref.vram.data == bulk.vram.data);
+
+	// HMMV has no phases, for the others the phase is meaningless once the
+	// command is done
+	if (!ref.CMD || (cmd == HMMV)) return;
+	CHECK(ref.phase == bulk.phase);
+	if (ref.phase == 1) {
+		if (cmd == LMMV) {
+			CHECK(ref.tmpDst == bulk.tmpDst);
+		} else {
+			CHECK(ref.tmpSrc == bulk.tmpSrc);
+		}
+	}
+}
+
+template<typename Mode>
+void testMode()
+{
+	std::mt19937 rng(1234); // fixed seed
+	auto rnd = [&](unsigned n) { return unsigned(rng() % n); };
+	auto tab = slotTable(rng);
+	std::span<const uint8_t, NUM_DELTAS * TICKS> tabSpan{tab.data(), tab.size()};
+	auto time = [](unsigned ticks) { return EmuTime::zero() + VDP::VDPClock::duration(ticks); };
+
+	TestEngine ref(tabSpan);
+	TestEngine bulk(tabSpan);
+	for (auto& v : ref.vram.data) v = uint8_t(rng());
+	bulk.vram.data = ref.vram.data;
+	auto init = ref.vram.data;
+	ref.vram.direct = false; // one VRAM access at a time
+
+	unsigned now = 0; // in VDP ticks
+	unsigned numBulk = 0;
+	repeat(150, [&] {
+		auto cmd = Cmd(rnd(4));
+		auto logOp = uint8_t(rnd(16));
+		unsigned sx = rnd(Mode::PIXELS_PER_LINE + 8);
+		unsigned dx = rnd(Mode::PIXELS_PER_LINE + 8);
+		unsigned sy = rnd(1024);
+		unsigned dy = rnd(2) ? rnd(1024) : (sy + rnd(5) - 2) & 1023; // sometimes (almost) the same lines
+		unsigned nx = rnd(4) ? rnd(Mode::PIXELS_PER_LINE) : rnd(8); // 0 -> complete line
+		unsigned ny = 1 + rnd(8);
+		auto arg = uint8_t((rnd(2) ? VDPCmdEngine::DIX : 0) |
+		                   (rnd(2) ? VDPCmdEngine::DIY : 0) |
+		                   (rnd(8) ? 0 : VDPCmdEngine::MXD) |
+		                   (rnd(8) ? 0 : VDPCmdEngine::MXS));
+		auto col = uint8_t(rng());
+		for (auto* e : {&ref, &bulk}) {
+			e->SX = sx; e->SY = sy; e->DX = dx; e->DY = dy;
+			e->NX = nx; e->NY = ny; e->ARG = arg; e->COL = col;
+			e->CMD = 1;
+			e->doneTime = EmuTime::infinity();
+			start<Mode>(*e, cmd, time(now));
+		}
+		unsigned refNow = now;
+		while (bulk.CMD || ref.CMD) {
+			now += 1 + rnd(rnd(2) ? 500 : 20000);
+			// reference: many small steps
+			while (refNow < now) {
+				refNow = std::min(now, refNow + 1 + rnd(300));
+				execute<Mode>(ref, cmd, logOp, time(refNow));
+			}
+			// one large step, sometimes without direct VRAM access
+			bulk.vram.direct = rnd(4) != 0;
+			if (bulk.vram.direct && bulk.CMD) ++numBulk;
+			execute<Mode>(bulk, cmd, logOp, time(now));
+			checkEqual(ref, bulk, cmd);
+		}
+	});
+	CHECK(numBulk > 100);
+	CHECK(ref.vram.data != init);
+}
+
+} // namespace
+
+TEST_CASE("VDPCmdBulk: stepwise vs line at a time")
+{
+	SECTION("Graphic4") { testMode<Graphic4Mode>(); }
+	SECTION("Graphic5") { testMode<Graphic5Mode>(); }
+	SECTION("Graphic6") { testMode<Graphic6Mode>(); }
+	SECTION("Graphic7") { testMode<Graphic7Mode>(); }
+	SECTION("NonBitmap") { testMode<NonBitmapMode>(); }
+}
+
+TEST_CASE("VDPCmdBulk: getLine")
+{
+	TestVRAM vram;
+	auto& data = vram.data;
+	SECTION("linear") {
+		auto line = VDPCmdBulk::getBulkLine<Graphic4Mode, uint8_t>(vram, 3, 10, 5);
+		REQUIRE(line);
+		CHECK(&(*line)[0] == &data[3 * 128 + 10]);
+		CHECK(&(*line)[4] == &data[3 * 128 + 14]);
+	}
+	SECTION("planar") {
+		auto line = VDPCmdBulk::getBulkLine<Graphic7Mode, uint8_t>(vram, 3, 11, 4); // bytes 11, 12, 13, 14
+		REQUIRE(line);
+		CHECK(&(*line)[0] == &data[0x10000 + 3 * 128 + 5]);
+		CHECK(&(*line)[1] == &data[          3 * 128 + 6]);
+		CHECK(&(*line)[2] == &data[0x10000 + 3 * 128 + 6]);
+		CHECK(&(*line)[3] == &data[          3 * 128 + 7]);
+		CHECK(line->blocks[0].size() == 2);
+		CHECK(line->blocks[1].size() == 2);
+	}
+	SECTION("planar, single byte") {
+		auto line = VDPCmdBulk::getBulkLine<Graphic7Mode, uint8_t>(vram, 0, 6, 1);
+		REQUIRE(line);
+		CHECK(line->blocks[0].size() == 1);
+		CHECK(line->blocks[1].empty());
+	}
+	SECTION("not accessible") {
+		vram.direct = false;
+		CHECK(!VDPCmdBulk::getBulkLine<Graphic4Mode, uint8_t>(vram, 0, 0, 10));
+		CHECK( VDPCmdBulk::getBulkLine<Graphic4Mode, const uint8_t>(vram, 0, 0, 10));
+	}
+}
+
+TEST_CASE("VDPCmdBulk: stepLine")
+{
+	std::mt19937 rng(42); // fixed seed
+	auto tab = slotTable(rng);
+	std::span<const uint8_t, NUM_DELTAS * TICKS> tabSpan{tab.data(), tab.size()};
+
+	auto frame = EmuTime::zero();
+	VDP::VDPClock clock(frame);
+	repeat(200, [&] {
+		auto start = clock.getFastAdd(rng() % (3 * TICKS));
+		auto limit = clock.getFastAdd(rng() % (6 * TICKS));
+		unsigned num = 1 + rng() % 40;
+		std::array deltas = {Delta::D24, Delta::D64};
+
+		// reference: one access at a time, like the regular HMMM code
+		Calculator ref(frame, start, limit, tabSpan);
+		bool fits = true;
+		for (auto i : xrange(num)) {
+			for (auto j : xrange(deltas.size())) {
+				if (ref.limitReached()) { fits = false; break; }
+				if ((i == num - 1) && (j == deltas.size() - 1)) break;
+				ref.next(deltas[j]);
+			}
+			if (!fits) break;
+		}
+
+		Calculator calc(frame, start, limit, tabSpan);
+		Calculator orig = calc;
+		CHECK(VDPCmdBulk::stepLine(calc, num, deltas) == fits);
+		if (fits) {
+			CHECK(calc.getTime() == ref.getTime());
+		} else {
+			CHECK(calc.getTime() == orig.getTime());
+		}
+	});
+}
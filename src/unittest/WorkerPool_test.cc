@@ -0,0 +1,57 @@
+#include "catch.hpp"
+#include "WorkerPool.hh"
+
+#include "xrange.hh"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace openmsx;
+
+static void check(WorkerPool& pool, size_t n)
+{
+	std::vector<std::atomic<int>> counts(n);
+	pool.parallelFor(n, [&](size_t i) { ++counts[i]; });
+	for (auto& c : counts) CHECK(c == 1);
+}
+
+TEST_CASE("WorkerPool: all items are processed exactly once")
+{
+	for (auto threads : {0u, 1u, 3u}) {
+		WorkerPool pool(threads);
+		CHECK(pool.getNumThreads() == threads);
+		for (auto n : {0u, 1u, 2u, 7u, 100u, 1000u}) {
+			check(pool, n);
+		}
+		// repeatedly, to catch races between consecutive jobs
+		repeat(200, [&] { check(pool, 5); });
+	}
+}
+
+TEST_CASE("WorkerPool: change number of threads")
+{
+	WorkerPool pool;
+	check(pool, 10);
+	pool.setNumThreads(4);
+	CHECK(pool.getNumThreads() == 4);
+	check(pool, 10);
+	pool.setNumThreads(2);
+	CHECK(pool.getNumThreads() == 2);
+	check(pool, 10);
+	pool.setNumThreads(0);
+	CHECK(pool.getNumThreads() == 0);
+	check(pool, 10);
+}
+
+TEST_CASE("WorkerPool: exceptions")
+{
+	WorkerPool pool(2);
+	std::atomic<int> count = 0;
+	CHECK_THROWS_AS(pool.parallelFor(50, [&](size_t i) {
+		++count;
+		if (i == 17) throw std::runtime_error("oops");
+	}), std::runtime_error);
+	CHECK(count == 50); // the other items were still processed
+	check(pool, 10);    // and the pool is still usable
+}
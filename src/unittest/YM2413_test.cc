@@ -0,0 +1,247 @@
+#include "catch.hpp"
+#include "YM2413Burczynski.hh"
+#include "YM2413NukeYKT.hh"
+#include "YM2413Okazaki.hh"
+#include "YM2413OriginalNukeYKT.hh"
+
+#include "FFTReal.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace openmsx;
+
+namespace {
+
+// A VGM-style register log: wait 'wait' samples, then write 'value' to
+// register 'reg'.
+struct LogEntry {
+	unsigned wait;
+	uint8_t reg;
+	uint8_t value;
+};
+
+struct Core {
+	std::string_view name;
+	std::unique_ptr<YM2413Core> core;
+};
+
+} // namespace
+
+// A (deterministic) pseudo-random 'song': ~4 seconds of notes on the 9 melodic
+// channels, followed by ~4 seconds in rhythm mode. It uses all instruments,
+// including a custom one, and varies volume, sustain and octave.
+static std::vector<LogEntry> createLog(uint32_t seed = 12345)
+{
+	std::vector<LogEntry> log;
+	std::minstd_rand rng(seed);
+	auto rnd = [&](unsigned n) { return unsigned(rng() % n); };
+	auto write = [&](unsigned wait, unsigned reg, unsigned value) {
+		log.push_back({wait, uint8_t(reg), uint8_t(value)});
+	};
+
+	// custom instrument
+	for (auto reg : xrange(8)) write(0, reg, rnd(256));
+
+	static constexpr unsigned STEP = 2486; // ~1/20 s
+	for (auto step : xrange(160)) {
+		bool rhythm = step >= 80;
+		if (step == 80) {
+			// fixed frequencies for the drums
+			write(0, 0x16, 0x20); write(0, 0x26, 0x05);
+			write(0, 0x17, 0x50); write(0, 0x27, 0x05);
+			write(0, 0x18, 0xC0); write(0, 0x28, 0x01);
+			write(0, 0x36, 0x00); write(0, 0x37, 0x00); write(0, 0x38, 0x00);
+		}
+		unsigned wait = STEP;
+		for (auto ch : xrange(rhythm ? 6 : 9)) {
+			if (rnd(3) != 0) continue;
+			unsigned fnum = 172 + rnd(200);
+			unsigned block = 2 + rnd(4);
+			write(wait, 0x20 + ch, block << 1); // key off
+			wait = 0;
+			write(0, 0x30 + ch, (rnd(16) << 4) | rnd(8)); // instrument, volume
+			write(0, 0x10 + ch, fnum & 0xFF);
+			write(0, 0x20 + ch, 0x10 | (rnd(2) << 5) | (block << 1) | (fnum >> 8)); // key on
+		}
+		if (rhythm) {
+			write(wait, 0x0E, 0x20); // all drums off
+			wait = 0;
+			write(0, 0x0E, 0x20 | rnd(32));
+		}
+		if (wait) write(wait, 0x0F, 0); // only a delay
+	}
+	return log;
+}
+
+// Replay the log, returns the mono mix of all channels, normalized with
+// getAmplificationFactor().
+static std::vector<float> render(YM2413Core& core, std::span<const LogEntry> log)
+{
+	static constexpr unsigned CHUNK = 256;
+	std::vector<float> result;
+	std::array<std::array<float, CHUNK>, 9 + 5> bufs;
+	auto factor = core.getAmplificationFactor();
+
+	auto generate = [&](unsigned num) {
+		while (num) {
+			auto n = std::min(num, CHUNK);
+			std::array<float*, 9 + 5> ptrs;
+			for (auto i : xrange(9 + 5)) {
+				std::ranges::fill(bufs[i], 0.0f);
+				ptrs[i] = bufs[i].data();
+			}
+			core.generateChannels(ptrs, n);
+			auto start = result.size();
+			result.resize(start + n, 0.0f);
+			for (const auto* p : ptrs) {
+				if (!p) continue;
+				for (auto j : xrange(n)) result[start + j] += p[j] * factor;
+			}
+			num -= n;
+		}
+	};
+
+	core.reset();
+	for (const auto& e : log) {
+		generate(e.wait);
+		core.writePort(false, e.reg, 0);
+		core.writePort(true, e.value, 3); // 12 cycles after the address
+		generate(2); // 84 cycles are needed before the next address write
+	}
+	generate(CHUNK);
+	return result;
+}
+
+// Compare the magnitude spectra of 'x' and 'ref' in blocks of 1024 samples (with
+// a Hann window). Returns the energy of the difference relative to the energy
+// of the reference (in dB). Unlike a sample-by-sample compare this ignores
+// phase differences, e.g. a small delay in the output.
+static double spectralDiff(std::span<const float> x, std::span<const float> ref)
+{
+	static constexpr unsigned L2 = 10;
+	static constexpr unsigned N = 1 << L2;
+	static const auto window = [] {
+		std::array<float, N> result;
+		for (auto i : xrange(N)) {
+			result[i] = float(0.5 - 0.5 * std::cos(2 * M_PI * i / N));
+		}
+		return result;
+	}();
+
+	auto magnitudes = [&](std::span<const float> in, std::span<float, N / 2 + 1> out) {
+		std::array<float, N> input, output, tmp;
+		for (auto i : xrange(N)) input[i] = in[i] * window[i];
+		auto f = FFTReal<L2>::execute(input, output, tmp);
+		out[0] = std::abs(f[0]);
+		for (auto i : xrange(1u, N / 2)) out[i] = std::hypot(f[i], f[N / 2 + i]);
+		out[N / 2] = std::abs(f[N / 2]);
+	};
+
+	double diffEnergy = 0.0;
+	double refEnergy = 0.0;
+	auto len = std::min(x.size(), ref.size());
+	for (size_t pos = 0; pos + N <= len; pos += N) {
+		std::array<float, N / 2 + 1> mx, mr;
+		magnitudes(x.subspan(pos, N), mx);
+		magnitudes(ref.subspan(pos, N), mr);
+		for (auto i : xrange(N / 2 + 1)) {
+			double d = mx[i] - mr[i];
+			diffEnergy += d * d;
+			refEnergy += double(mr[i]) * mr[i];
+		}
+	}
+	return 10.0 * std::log10(diffEnergy / refEnergy);
+}
+
+// The maximum spectral difference (in dB) with Original-NukeYKT. The measured
+// values depend on the compiler and platform (the float code in Okazaki and
+// Burczynski isn't bit-exact): Okazaki -4.9 dB, Burczynski between -6.3 dB
+// and -5.3 dB. The bounds leave a margin of more than 1 dB on top of the worst
+// of these. For comparison: a rendering of a different song gives about
+// -1.2 dB (see below).
+static constexpr std::array<std::pair<std::string_view, double>, 2> maxSpectralDiff = {{
+	{"Okazaki",    -3.5},
+	{"Burczynski", -4.0},
+}};
+
+static std::vector<Core> createCores()
+{
+	std::vector<Core> result;
+	result.push_back({"Original-NukeYKT", std::make_unique<YM2413OriginalNukeYKT::YM2413>()});
+	result.push_back({"NukeYKT",          std::make_unique<YM2413NukeYKT::YM2413>()});
+	result.push_back({"Okazaki",          std::make_unique<YM2413Okazaki::YM2413>()});
+	result.push_back({"Burczynski",       std::make_unique<YM2413Burczynski::YM2413>()});
+	return result;
+}
+
+TEST_CASE("YM2413 cores: replay register log")
+{
+	auto log = createLog();
+	auto cores = createCores();
+	auto ref = render(*cores[0].core, log);
+	REQUIRE(ref.size() > 8 * 49716);
+	CHECK(std::ranges::any_of(ref, [](float f) { return f != 0.0f; }));
+
+	// sanity check: the measure does distinguish a different song
+	auto other = render(*cores[0].core, createLog(54321));
+	CHECK(spectralDiff(other, ref) > -2.0);
+
+	for (auto& [name, core] : cores) {
+		INFO("core: " << name);
+		auto out = render(*core, log);
+		REQUIRE(out.size() == ref.size());
+		if (name.ends_with("NukeYKT")) {
+			// rendering again and the optimized version must produce
+			// identical output
+			bool identical = out == ref;
+			CHECK(identical);
+		} else {
+			// different implementations of the same chip, they should
+			// at least sound roughly the same
+			auto it = std::ranges::find(maxSpectralDiff, name,
+				[](const auto& p) { return p.first; });
+			REQUIRE(it != maxSpectralDiff.end());
+			CHECK(spectralDiff(out, ref) < it->second);
+		}
+	}
+}
+
+// Not run by default, select it explicitly with:
+//   openmsx-unittest "[benchmark]"
+TEST_CASE("YM2413 cores: benchmark", "[.][benchmark]")
+{
+	auto log = createLog();
+	auto cores = createCores();
+	auto ref = render(*cores[0].core, log);
+
+	for (auto& [name, core] : cores) {
+		// best of a few runs
+		std::vector<float> out;
+		double best = 1e100;
+		repeat(5, [&] {
+			auto start = std::chrono::steady_clock::now();
+			out = render(*core, log);
+			std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+			best = std::min(best, d.count());
+		});
+		std::cout << name << ": " << double(out.size()) / best / 1e6
+		          << " Msamples/s, spectral diff vs Original-NukeYKT: ";
+		if (out == ref) {
+			std::cout << "identical\n";
+		} else {
+			std::cout << spectralDiff(out, ref) << " dB\n";
+		}
+	}
+}
@@ -0,0 +1,135 @@
+#include "catch.hpp"
+#include "YMF278.hh"
+
+#include "ranges.hh"
+#include "sha1.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace openmsx;
+
+namespace {
+
+// Wait 'wait' samples, then write 'value' to register 'reg'.
+struct LogEntry {
+	unsigned wait;
+	uint8_t reg;
+	uint8_t value;
+};
+
+} // namespace
+
+// 2MB of pseudo-random sample memory (the upper 2MB remains unmapped), so also
+// the wave table headers contain random start/loop/end addresses and sample
+// formats.
+static std::vector<uint8_t> createMemory()
+{
+	std::vector<uint8_t> result(16 * YMF278Core::k128);
+	std::minstd_rand rng(54321);
+	for (auto& b : result) b = uint8_t(rng());
+	return result;
+}
+
+// A (deterministic) pseudo-random register log for the slot registers. It
+// (re)starts samples with random waveforms, pitches and envelopes, and toggles
+// LFO, damping and pseudo-reverb on the fly.
+// Note: all random values are drawn in separate statements, the evaluation
+// order of function arguments is unspecified.
+static std::vector<LogEntry> createLog()
+{
+	std::vector<LogEntry> log;
+	std::minstd_rand rng(12345);
+	auto rnd = [&](unsigned n) { return unsigned(rng() % n); };
+
+	repeat(1500, [&] {
+		unsigned wait = rnd(4) ? 1 + rnd(300) : 1 + rnd(600);
+		repeat(rnd(8), [&] {
+			unsigned slot = rnd(24);
+			unsigned group = rnd(10);
+			unsigned value = 0;
+			switch (group) {
+			case 3: // total level (bit 0: without interpolation)
+				value = rnd(2) ? rnd(64) : rnd(256);
+				break;
+			case 4: // key on, damp, LFO reset, pan
+				value = rnd(2) ? (0x80 | rnd(128)) : rnd(256);
+				break;
+			default: // wave number, F-number, octave, LFO, envelope, ...
+				value = rnd(256);
+				break;
+			}
+			log.push_back({wait, uint8_t(0x08 + 24 * group + slot), uint8_t(value)});
+			wait = 0;
+		});
+		if (wait) log.push_back({wait, 0x00, 0}); // only a delay (test register)
+	});
+	return log;
+}
+
+// Replay the log in the same way as YMF278 does (generateChannels() is not
+// called when no slot is active). Returns the sha1sum of the output of all 24
+// stereo channels (as little endian 32-bit integers).
+static Sha1Sum render(YMF278Core& core, std::span<const LogEntry> log)
+{
+	static constexpr unsigned CHUNK = 256;
+	SHA1 sha1;
+	std::array<std::array<float, 2 * CHUNK>, 24> bufs;
+	std::array<uint8_t, 4 * 2 * CHUNK> bytes;
+
+	auto generate = [&](unsigned num) {
+		while (num) {
+			auto n = std::min(num, CHUNK);
+			std::array<float*, 24> ptrs;
+			for (auto i : xrange(24)) {
+				std::ranges::fill(bufs[i], 0.0f);
+				ptrs[i] = bufs[i].data();
+			}
+			if (core.anyActive()) {
+				core.generateChannels(ptrs, n);
+			} else {
+				std::ranges::fill(ptrs, nullptr);
+			}
+			for (const auto* p : ptrs) {
+				for (auto j : xrange(2 * n)) {
+					auto s = p ? uint32_t(int32_t(p[j])) : 0;
+					bytes[4 * j + 0] = uint8_t(s >>  0);
+					bytes[4 * j + 1] = uint8_t(s >>  8);
+					bytes[4 * j + 2] = uint8_t(s >> 16);
+					bytes[4 * j + 3] = uint8_t(s >> 24);
+				}
+				sha1.update(std::span{bytes}.first(4 * 2 * n));
+			}
+			num -= n;
+		}
+	};
+
+	for (const auto& e : log) {
+		generate(e.wait);
+		core.writeReg(e.reg, e.value);
+	}
+	generate(CHUNK);
+	return sha1.digest();
+}
+
+TEST_CASE("YMF278: replay register log")
+{
+	// The reference was recorded with the sample-by-sample implementation
+	// (before all samples of one slot were calculated in one go), the
+	// output must remain bit-exact.
+	const auto mem = createMemory();
+	auto log = createLog();
+	YMF278Core core;
+	auto memPtrs = core.getMemPtrs();
+	for (auto i : xrange(16)) {
+		memPtrs[i] = subspan<YMF278Core::k128>(mem, i * YMF278Core::k128);
+	}
+	auto sum = render(core, log);
+	std::array<char, 40> buf;
+	CHECK(sum.toString(buf) == "e2f239c533b0128b9d02d8eddeed298b62cd16eb");
+}
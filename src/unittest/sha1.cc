@@ -6,8 +6,12 @@
 #include "xrange.hh"
 
 #include <bit>
+#include <chrono>
 #include <cstring>
+#include <iostream>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 using namespace openmsx;
 
@@ -187,3 +191,99 @@ TEST_CASE("sha1: finalize")
 		CHECK(sum.toString(buf) == "0098ba824b5c16427bd7a1122a5a442a25ec644d");
 	}
 }
+
+[[nodiscard]] static std::vector<uint8_t> testData(size_t size)
+{
+	std::vector<uint8_t> result(size);
+	uint32_t x = 12345;
+	for (auto& b : result) {
+		x = x * 1103515245 + 12345;
+		b = uint8_t(x >> 16);
+	}
+	return result;
+}
+
+TEST_CASE("sha1: implementations")
+{
+	using enum SHA1::Impl;
+	std::array<char, 40> buf;
+
+	// reference results from the scalar implementation
+	REQUIRE(SHA1::forceImpl(SCALAR));
+	auto data = testData(100'000);
+	std::vector<std::span<const uint8_t>> inputs;
+	for (auto size : xrange(300)) { // all boundary cases of the padding
+		inputs.push_back(std::span{data}.subspan(size, size));
+	}
+	inputs.push_back(data); // mix with a large buffer
+	for (auto size : {1000, 4096, 5, 64}) {
+		inputs.push_back(std::span{data}.first(size));
+	}
+	std::vector<Sha1Sum> expected;
+	for (auto in : inputs) expected.push_back(SHA1::calc(in));
+
+	for (auto impl : {SCALAR, SHA_NI, AVX2, AUTO}) {
+		if (!SHA1::forceImpl(impl)) continue; // not supported by this CPU
+		INFO("implementation " << int(impl));
+
+		// FIPS PUB 180-1 test vectors
+		const char* abc = "abc";
+		CHECK(SHA1::calc({std::bit_cast<const uint8_t*>(abc), 3uz}).toString(buf) ==
+		      "a9993e364706816aba3e25717850c26c9cd0d89d");
+		const char* in = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+		CHECK(SHA1::calc({std::bit_cast<const uint8_t*>(in), strlen(in)}).toString(buf) ==
+		      "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+		std::vector<uint8_t> million(1'000'000, 'a');
+		CHECK(SHA1::calc(million).toString(buf) == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+
+		std::vector<Sha1Sum> sums;
+		for (auto i : inputs) sums.push_back(SHA1::calc(i));
+		CHECK(sums == expected);
+
+		std::vector<Sha1Sum> many(inputs.size());
+		SHA1::calcMany(inputs, many);
+		CHECK(many == expected);
+
+		// fewer buffers than lanes
+		SHA1::calcMany(std::span{inputs}.first(3), std::span{many}.first(3));
+		CHECK(std::ranges::equal(std::span{many}.first(3), std::span{expected}.first(3)));
+	}
+	SHA1::forceImpl(AUTO);
+}
+
+// Not run by default, select it explicitly with:
+//   openmsx-unittest "[benchmark]"
+TEST_CASE("sha1: benchmark", "[.][benchmark]")
+{
+	using enum SHA1::Impl;
+	auto data = testData(64 * 1024 * 1024);
+	std::vector<std::span<const uint8_t>> small;
+	for (size_t pos = 0; pos + 2000 < data.size(); pos += 2000) {
+		small.push_back(std::span{data}.subspan(pos, 1000 + pos % 1000));
+	}
+	std::vector<Sha1Sum> sums(small.size());
+
+	auto report = [](const char* name, const char* what, auto start, size_t bytes) {
+		std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+		std::cout << name << ' ' << what << ": "
+		          << double(bytes) / d.count() / (1024 * 1024) << " MB/s\n";
+	};
+	for (auto [impl, name] : {std::pair{SCALAR, "scalar"}, std::pair{SHA_NI, "sha-ni"},
+	                          std::pair{AVX2, "avx2  "}, std::pair{AUTO, "auto  "}}) {
+		if (!SHA1::forceImpl(impl)) {
+			std::cout << name << ": not supported\n";
+			continue;
+		}
+		auto start = std::chrono::steady_clock::now();
+		auto sum = SHA1::calc(data);
+		report(name, "single", start, data.size());
+
+		start = std::chrono::steady_clock::now();
+		SHA1::calcMany(small, sums);
+		size_t total = 0;
+		for (auto s : small) total += s.size();
+		report(name, "many  ", start, total);
+		CHECK(!sum.empty());
+	}
+	SHA1::forceImpl(AUTO);
+}
@@ -0,0 +1,135 @@
+#include "CowBuffer.hh"
+
+#include "ranges.hh"
+
+#include <cstdlib>
+#include <new> // for bad_alloc
+
+#ifdef __linux__
+#include <bit>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace openmsx {
+
+#ifdef __linux__
+
+// Smaller buffers are not worth a separate mapping (and a file descriptor for
+// the image).
+static constexpr size_t MIN_SHARE_SIZE = 16 * 1024;
+
+[[nodiscard]] static size_t roundToPages(size_t size)
+{
+	static const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGE_SIZE));
+	return (size + pageSize - 1) & ~(pageSize - 1);
+}
+
+[[nodiscard]] static bool mapFailed(const void* p)
+{
+	// MAP_FAILED is #define'd using an old-style cast
+	return p == std::bit_cast<void*>(intptr_t(-1));
+}
+
+std::shared_ptr<const CowImage> CowImage::create(std::span<const uint8_t> data)
+{
+	if (data.size() < MIN_SHARE_SIZE) return nullptr;
+	int fd = memfd_create("openmsx-cow", MFD_CLOEXEC);
+	if (fd == -1) return nullptr;
+	auto len = roundToPages(data.size());
+	void* p = MAP_FAILED;
+	if (ftruncate(fd, off_t(len)) == 0) {
+		p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	if (mapFailed(p)) {
+		close(fd);
+		return nullptr;
+	}
+	auto* dat = static_cast<uint8_t*>(p);
+	copy_to_range(data, std::span{dat, data.size()});
+	mprotect(p, len, PROT_READ);
+	return std::shared_ptr<const CowImage>(new CowImage(fd, dat, data.size()));
+}
+
+CowImage::CowImage(int fd_, const uint8_t* dat_, size_t sz_)
+	: fd(fd_), dat(dat_), sz(sz_)
+{
+}
+
+CowImage::~CowImage()
+{
+	// Buffers that share this image keep the pages alive.
+	munmap(const_cast<uint8_t*>(dat), roundToPages(sz));
+	close(fd);
+}
+
+CowBuffer::CowBuffer(size_t size)
+	: sz(size)
+{
+	if (size >= MIN_SHARE_SIZE) {
+		void* p = mmap(nullptr, roundToPages(size), PROT_READ | PROT_WRITE,
+		               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (!mapFailed(p)) {
+			dat = static_cast<uint8_t*>(p);
+			mapped = true;
+			return;
+		}
+	}
+	dat = static_cast<uint8_t*>(malloc(size));
+	if (size && !dat) throw std::bad_alloc();
+}
+
+CowBuffer::~CowBuffer()
+{
+	if (mapped) {
+		munmap(dat, roundToPages(sz));
+	} else {
+		free(dat);
+	}
+}
+
+bool CowBuffer::share(const CowImage& image)
+{
+	if (!mapped || (image.sz != sz)) return false;
+	// First map the image at a temporary location, then atomically move
+	// it over the current pages. A failing mmap(MAP_FIXED) could leave a
+	// hole in our buffer, a failing mremap() keeps the old pages.
+	auto len = roundToPages(sz);
+	void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, image.fd, 0);
+	if (mapFailed(p)) return false;
+	if (mapFailed(mremap(p, len, len, MREMAP_MAYMOVE | MREMAP_FIXED, dat))) {
+		munmap(p, len);
+		return false;
+	}
+	return true;
+}
+
+#else
+
+std::shared_ptr<const CowImage> CowImage::create(std::span<const uint8_t> /*data*/)
+{
+	return nullptr;
+}
+
+CowImage::~CowImage() = default;
+
+CowBuffer::CowBuffer(size_t size)
+	: dat(static_cast<uint8_t*>(malloc(size)))
+	, sz(size)
+{
+	if (size && !dat) throw std::bad_alloc();
+}
+
+CowBuffer::~CowBuffer()
+{
+	free(dat);
+}
+
+bool CowBuffer::share(const CowImage& /*image*/)
+{
+	return false;
+}
+
+#endif
+
+} // namespace openmsx
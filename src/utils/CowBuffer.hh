@@ -0,0 +1,96 @@
+#ifndef COWBUFFER_HH
+#define COWBUFFER_HH
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace openmsx {
+
+/** An immutable block of memory that can be mapped copy-on-write into one
+  * or more CowBuffer objects, see CowBuffer::share().
+  *
+  * Currently only implemented on Linux (via memfd_create()), on other
+  * platforms create() always returns nullptr.
+  */
+class CowImage
+{
+public:
+	/** Returns nullptr when not supported (or on error), the caller
+	  * should then fall back to copying the data. */
+	[[nodiscard]] static std::shared_ptr<const CowImage> create(std::span<const uint8_t> data);
+
+	CowImage(const CowImage&) = delete;
+	CowImage& operator=(const CowImage&) = delete;
+	~CowImage();
+
+	[[nodiscard]] std::span<const uint8_t> getData() const { return {dat, sz}; }
+
+private:
+	CowImage(int fd, const uint8_t* dat, size_t sz);
+
+	int fd;
+	const uint8_t* dat;
+	size_t sz;
+
+	friend class CowBuffer;
+};
+
+/** A fixed size block of (uninitialized) memory, for large buffers like the
+  * MSX RAM.
+  *
+  * The difference with MemBuffer is that the content can be replaced with
+  * that of a CowImage, without copying: the pages are shared with the image
+  * (and with all other buffers that share the same image) until they get
+  * written. E.g. 100 clones of a machine with 4MB RAM only need memory for
+  * the pages they actually modify.
+  *
+  * The address of the buffer never changes, so pointers into the buffer (e.g.
+  * in the CPU cache-lines) remain valid, also after share().
+  */
+class CowBuffer
+{
+public:
+	explicit CowBuffer(size_t size);
+	CowBuffer(const CowBuffer&) = delete;
+	CowBuffer& operator=(const CowBuffer&) = delete;
+	~CowBuffer();
+
+	[[nodiscard]] const uint8_t* data() const { return dat; }
+	[[nodiscard]]       uint8_t* data()       { return dat; }
+	[[nodiscard]] size_t size() const { return sz; }
+
+	[[nodiscard]]       uint8_t* begin()       { return data(); }
+	[[nodiscard]] const uint8_t* begin() const { return data(); }
+	[[nodiscard]]       uint8_t* end()         { return data() + size(); }
+	[[nodiscard]] const uint8_t* end()   const { return data() + size(); }
+
+	[[nodiscard]] const uint8_t& operator[](size_t i) const
+	{
+		assert(i < sz);
+		return dat[i];
+	}
+	[[nodiscard]] uint8_t& operator[](size_t i)
+	{
+		assert(i < sz);
+		return dat[i];
+	}
+
+	/** Replace the content of this buffer with the content of the given
+	  * image (sizes must match). Returns false when that's not possible
+	  * (e.g. for small buffers), then the content is not changed. */
+	[[nodiscard]] bool share(const CowImage& image);
+
+private:
+	uint8_t* dat;
+	size_t sz;
+#ifdef __linux__
+	bool mapped = false; // allocated via mmap() instead of malloc()
+#endif
+};
+
+} // namespace openmsx
+
+#endif
@@ -357,6 +357,22 @@ size_t DeltaBlockDiff::getDeltaSize() const
 }
 
 
+// class DeltaBlockShared
+
+DeltaBlockShared::DeltaBlockShared(std::shared_ptr<const CowImage> image_)
+	: image(std::move(image_))
+{
+#ifdef DEBUG
+	sha1 = SHA1::calc(image->getData());
+#endif
+}
+
+void DeltaBlockShared::apply(std::span<uint8_t> dst) const
+{
+	copy_to_range(image->getData(), dst);
+}
+
+
 // class LastDeltaBlocks
 
 std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
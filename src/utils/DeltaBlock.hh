@@ -3,6 +3,7 @@
 
 #define STATISTICS 0
 
+#include "CowBuffer.hh"
 #include "MemBuffer.hh"
 
 #include <cstdint>
@@ -25,6 +26,9 @@ public:
 #endif
 	virtual void apply(std::span<uint8_t> dst) const = 0;
 
+	/** The (full) content as a CowImage, or nullptr if not available. */
+	[[nodiscard]] virtual const CowImage* getCowImage() const { return nullptr; }
+
 protected:
 	DeltaBlock() = default;
 
@@ -71,6 +75,22 @@ private:
 };
 
 
+/** The content is stored in a CowImage, so it can be shared (copy-on-write)
+  * with the memory it's restored into, see MemInputArchive. Used when the
+  * same state is restored many times (clone_machine).
+  */
+class DeltaBlockShared final : public DeltaBlock
+{
+public:
+	explicit DeltaBlockShared(std::shared_ptr<const CowImage> image);
+	void apply(std::span<uint8_t> dst) const override;
+	[[nodiscard]] const CowImage* getCowImage() const override { return image.get(); }
+
+private:
+	const std::shared_ptr<const CowImage> image;
+};
+
+
 class LastDeltaBlocks
 {
 public:
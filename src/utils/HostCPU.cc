@@ -0,0 +1,71 @@
+#include "HostCPU.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define HOSTCPU_X86
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace openmsx::HostCPU {
+
+[[nodiscard]] static Features detect()
+{
+#ifdef HOSTCPU_X86
+	std::array<unsigned, 4> r1 = {}; // eax, ebx, ecx, edx of leaf 1
+	std::array<unsigned, 4> r7 = {}; // leaf 7, sub-leaf 0
+#ifdef _MSC_VER
+	std::array<int, 4> r;
+	__cpuid(r.data(), 0);
+	unsigned maxLeaf = r[0];
+	__cpuid(r.data(), 1);
+	std::ranges::transform(r, r1.begin(), [](int x) { return unsigned(x); });
+	if (maxLeaf >= 7) {
+		__cpuidex(r.data(), 7, 0);
+		std::ranges::transform(r, r7.begin(), [](int x) { return unsigned(x); });
+	}
+#else
+	if (!__get_cpuid(1, &r1[0], &r1[1], &r1[2], &r1[3])) return {};
+	(void)__get_cpuid_count(7, 0, &r7[0], &r7[1], &r7[2], &r7[3]);
+#endif
+	bool ssse3   = r1[2] & (1 <<  9);
+	bool sse41   = r1[2] & (1 << 19);
+	bool osxsave = r1[2] & (1 << 27);
+	bool avx     = r1[2] & (1 << 28);
+	bool avx2    = r7[1] & (1 <<  5);
+	bool sha     = r7[1] & (1 << 29);
+
+	// AVX registers must also be enabled by the OS
+	bool ymmEnabled = false;
+	if (osxsave && avx) {
+#ifdef _MSC_VER
+		uint64_t xcr0 = _xgetbv(0);
+#else
+		uint32_t lo, hi;
+		asm("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		uint64_t xcr0 = (uint64_t(hi) << 32) | lo;
+#endif
+		ymmEnabled = (xcr0 & 6) == 6;
+	}
+	return {.avx = avx && ymmEnabled,
+	        .avx2 = avx2 && ymmEnabled,
+	        .shaNi = sha && sse41 && ssse3};
+#else
+	return {};
+#endif
+}
+
+const Features& getFeatures()
+{
+	static const Features features = detect();
+	return features;
+}
+
+} // namespace openmsx::HostCPU
@@ -0,0 +1,21 @@
+#ifndef HOSTCPU_HH
+#define HOSTCPU_HH
+
+namespace openmsx::HostCPU {
+
+/** Instruction set extensions of the host CPU (checked at run-time). Code
+  * that's compiled for these instructions (e.g. via
+  * __attribute__((target("avx")))) may only be executed when the CPU (and
+  * the OS) supports them. On non-x86 CPUs all of these are false.
+  */
+struct Features {
+	bool avx = false;   // also enabled by the OS
+	bool avx2 = false;  // also enabled by the OS
+	bool shaNi = false; // including SSSE3 and SSE4.1
+};
+
+[[nodiscard]] const Features& getFeatures();
+
+} // namespace openmsx::HostCPU
+
+#endif
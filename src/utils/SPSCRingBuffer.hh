@@ -0,0 +1,110 @@
+#ifndef SPSCRINGBUFFER_HH
+#define SPSCRINGBUFFER_HH
+
+#include "MemBuffer.hh"
+#include "ranges.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace openmsx {
+
+/** Lock-free ring buffer for a single producer thread and a single consumer
+  * thread. E.g. to pass sample data from the emulation thread to the audio
+  * callback thread, without either of them ever blocking on a mutex.
+  *
+  * The read and write positions only increase. They're 64-bit counters, also
+  * on 32-bit platforms, so they never wrap in practice (then '% capacity'
+  * would break for a capacity that's not a power of 2). Because of that a
+  * full buffer can be distinguished from an empty one, so all 'capacity'
+  * elements can be used.
+  *
+  * Only the producer may call push() and free(), only the consumer may call
+  * pop(). size() can be called from both sides (and from other threads), but
+  * the result is then only a snapshot. clear() and resize() may only be
+  * called when neither side is active.
+  */
+template<typename T>
+class SPSCRingBuffer
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+	explicit SPSCRingBuffer(size_t capacity = 0)
+		: buffer(capacity)
+	{
+	}
+
+	[[nodiscard]] size_t capacity() const { return buffer.size(); }
+
+	/** Number of elements in the buffer. */
+	[[nodiscard]] size_t size() const {
+		// load 'readPos' first, so that the result is never negative
+		auto r = readPos.load(std::memory_order_acquire);
+		auto w = writePos.load(std::memory_order_acquire);
+		return size_t(w - r);
+	}
+	[[nodiscard]] bool empty() const { return size() == 0; }
+
+	/** Number of elements that can still be pushed. */
+	[[nodiscard]] size_t free() const { return capacity() - size(); }
+
+	/** Producer side: append (a prefix of) the given elements.
+	  * @return The number of elements actually appended, this is less than
+	  *         'data.size()' when the buffer is (almost) full.
+	  */
+	size_t push(std::span<const T> data) {
+		assert(capacity() > 0);
+		auto w = writePos.load(std::memory_order_relaxed);
+		auto r = readPos.load(std::memory_order_acquire);
+		auto num = std::min(data.size(), capacity() - size_t(w - r));
+		auto pos = size_t(w % capacity());
+		auto len1 = std::min(num, capacity() - pos);
+		copy_to_range(data.first(len1), buffer.subspan(pos));
+		copy_to_range(data.subspan(len1, num - len1), std::span{buffer});
+		writePos.store(w + num, std::memory_order_release);
+		return num;
+	}
+
+	/** Consumer side: remove elements from the front of the buffer.
+	  * @return The number of elements actually copied to 'out', this is
+	  *         less than 'out.size()' when the buffer runs empty.
+	  */
+	size_t pop(std::span<T> out) {
+		assert(capacity() > 0);
+		auto r = readPos.load(std::memory_order_relaxed);
+		auto w = writePos.load(std::memory_order_acquire);
+		auto num = std::min(out.size(), size_t(w - r));
+		auto pos = size_t(r % capacity());
+		auto len1 = std::min(num, capacity() - pos);
+		copy_to_range(buffer.subspan(pos, len1), out);
+		copy_to_range(buffer.subspan(0, num - len1), out.subspan(len1));
+		readPos.store(r + num, std::memory_order_release);
+		return num;
+	}
+
+	void clear() {
+		readPos.store(0, std::memory_order_relaxed);
+		writePos.store(0, std::memory_order_relaxed);
+	}
+
+	void resize(size_t capacity) {
+		buffer.resize(capacity);
+		clear();
+	}
+
+private:
+	MemBuffer<T> buffer;
+	// on separate cache lines, each is only written by one side
+	alignas(64) std::atomic<uint64_t> readPos = 0;
+	alignas(64) std::atomic<uint64_t> writePos = 0;
+};
+
+} // namespace openmsx
+
+#endif
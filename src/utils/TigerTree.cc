@@ -1,13 +1,18 @@
 #include "TigerTree.hh"
 
+#include "WorkerPool.hh"
+
 #include "Math.hh"
+#include "enumerate.hh"
 #include "MemBuffer.hh"
-#include "ScopedAssign.hh"
-#include "tiger.hh"
+#include "ranges.hh"
+#include "xrange.hh"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <map>
-#include <span>
+#include <thread>
 
 namespace openmsx {
 
@@ -26,6 +31,29 @@ struct TTCacheEntry
 // inserted. So still use std::map instead of std::vector.
 static std::map<std::pair<size_t, std::string>, TTCacheEntry> ttCache;
 
+// Subtrees that cover at most this many blocks are calculated as a whole:
+// first the data of all invalid leaves is fetched (sequentially, see TTData),
+// next the leaves and then the internal nodes (level by level) are hashed in
+// parallel. So this is also the granularity of the progress reports.
+static constexpr size_t CHUNK_BLOCKS = 4096; // 4MB
+
+// Only start extra threads when at least this many nodes are invalid.
+static constexpr size_t PARALLEL_THRESHOLD = 512;
+
+// Hashing a single node is too little work compared to the synchronization
+// overhead in WorkerPool, so hand out the nodes in batches.
+static constexpr size_t BATCH_SIZE = 32;
+
+template<typename F>
+static void parallelForBatched(WorkerPool& workers, size_t num, F f)
+{
+	workers.parallelFor((num + BATCH_SIZE - 1) / BATCH_SIZE, [&](size_t batch) {
+		for (auto i : xrange(batch * BATCH_SIZE, std::min(num, (batch + 1) * BATCH_SIZE))) {
+			f(i);
+		}
+	});
+}
+
 [[nodiscard]] static constexpr size_t calcNumNodes(size_t dataSize)
 {
 	auto numBlocks = (dataSize + TigerTree::BLOCK_SIZE - 1) / TigerTree::BLOCK_SIZE;
@@ -54,62 +82,95 @@ TigerTree::TigerTree(TTData& data_, size_t dataSize_, const std::string& name)
 
 const TigerHash& TigerTree::calcHash(const std::function<void(size_t, size_t)>& progressCallback)
 {
-	return calcHash(getTop(), progressCallback);
+	auto numInvalid = entry.nodes.size() - entry.numNodesValid;
+	auto numThreads = (numInvalid >= PARALLEL_THRESHOLD)
+	                ? std::max(1u, std::thread::hardware_concurrency()) - 1
+	                : 0;
+	WorkerPool workers(numThreads);
+	return calcHash(getTop(), workers, progressCallback);
 }
 
 void TigerTree::notifyChange(size_t offset, size_t len, time_t time)
 {
 	entry.time = time;
+	notifyChange(offset, len);
+}
 
+void TigerTree::notifyChange(size_t offset, size_t len)
+{
 	assert((offset + len) <= dataSize);
 	if (len == 0) return;
 
-	if (entry.nodes[getTop().n].valid) {
-		entry.nodes[getTop().n].valid = false; // set sentinel
-		entry.numNodesValid--;
-	}
+	// Note: always walk up till the top, we can't stop at the first node
+	// that is already invalid. Restored nodes (see restoreNodes()) can be
+	// valid while (some of) their descendants are not.
+	auto top = getTop().n;
 	auto first = offset / BLOCK_SIZE;
 	auto last = (offset + len - 1) / BLOCK_SIZE;
 	assert(first <= last); // requires len != 0
 	do {
 		auto node = getLeaf(first);
-		while (entry.nodes[node.n].valid) {
-			entry.nodes[node.n].valid = false;
-			entry.numNodesValid--;
+		while (true) {
+			if (entry.nodes[node.n].valid) {
+				entry.nodes[node.n].valid = false;
+				entry.numNodesValid--;
+			}
+			if (node.n == top) break;
 			node = getParent(node);
 		}
 	} while (++first <= last);
 }
 
-const TigerHash& TigerTree::calcHash(Node node, const std::function<void(size_t, size_t)>& progressCallback)
+std::vector<TigerTree::SavedNode> TigerTree::getUpperNodes(size_t minBlocks) const
 {
-	auto n = node.n;
-	auto& nod = entry.nodes[n];
+	std::vector<SavedNode> result;
+	for (auto n : xrange(entry.nodes.size())) {
+		auto level = ((n ^ (n + 1)) + 1) / 2; // see tree layout below
+		const auto& nod = entry.nodes[n];
+		if ((level >= minBlocks) && nod.valid) {
+			result.push_back({.n = n, .hash = nod.hash});
+		}
+	}
+	return result;
+}
+
+void TigerTree::restoreNodes(std::span<const SavedNode> nodes)
+{
+	for (const auto& node : nodes) {
+		if (node.n >= entry.nodes.size()) continue;
+		auto& nod = entry.nodes[node.n];
+		if (nod.valid) continue;
+		nod.hash = node.hash;
+		markValid(node.n);
+	}
+}
+
+bool TigerTree::hasValidNodes() const
+{
+	return entry.numNodesValid != 0;
+}
+
+void TigerTree::markValid(size_t n)
+{
+	assert(!entry.nodes[n].valid);
+	entry.nodes[n].valid = true;
+	entry.numNodesValid++;
+}
+
+const TigerHash& TigerTree::calcHash(
+	Node node, WorkerPool& workers,
+	const std::function<void(size_t, size_t)>& progressCallback)
+{
+	auto& nod = entry.nodes[node.n];
 	if (!nod.valid) {
-		if (n & 1) {
-			// interior node
-			auto left  = getLeftChild (node);
-			auto right = getRightChild(node);
-			const auto& h1 = calcHash(left, progressCallback);
-			const auto& h2 = calcHash(right, progressCallback);
-			tiger_int(h1, h2, nod.hash);
+		if (node.l <= CHUNK_BLOCKS) {
+			calcSubTree(node, workers);
 		} else {
-			// leaf node
-			size_t b = n * (BLOCK_SIZE / 2);
-			size_t l = dataSize - b;
-
-			if (l >= BLOCK_SIZE) {
-				auto* d = data.getData(b, BLOCK_SIZE);
-				tiger_leaf(std::span{d, BLOCK_SIZE}, nod.hash);
-			} else {
-				// partial last block
-				auto* d = data.getData(b, l);
-				auto sa = ScopedAssign(d[-1], uint8_t(0));
-				tiger(std::span{d - 1, l + 1}, nod.hash);
-			}
+			const auto& h1 = calcHash(getLeftChild (node), workers, progressCallback);
+			const auto& h2 = calcHash(getRightChild(node), workers, progressCallback);
+			tiger_int(h1, h2, nod.hash);
+			markValid(node.n);
 		}
-		nod.valid = true;
-		entry.numNodesValid++;
 		if (progressCallback) {
 			progressCallback(entry.numNodesValid, entry.nodes.size());
 		}
@@ -117,6 +178,71 @@ const TigerHash& TigerTree::calcHash(Node node, const std::function<void(size_t,
 	return nod.hash;
 }
 
+void TigerTree::calcSubTree(Node node, WorkerPool& workers)
+{
+	// Collect the invalid nodes. Valid nodes are not descended into.
+	std::vector<size_t> leaves;
+	std::vector<Node> internals;
+	std::vector<Node> todo = {node};
+	while (!todo.empty()) {
+		auto nd = todo.back();
+		todo.pop_back();
+		if (entry.nodes[nd.n].valid) continue;
+		if (nd.l == 1) {
+			leaves.push_back(nd.n);
+		} else {
+			internals.push_back(nd);
+			todo.push_back(getLeftChild (nd));
+			todo.push_back(getRightChild(nd));
+		}
+	}
+	std::ranges::sort(leaves);
+	// children are always on a lower level than their parent
+	std::ranges::sort(internals, {}, &Node::l);
+
+	// Fetch the data of the leaves (in order of increasing offset).
+	auto blockSize = [&](size_t n) {
+		return std::min(BLOCK_SIZE, dataSize - n * (BLOCK_SIZE / 2));
+	};
+	MemBuffer<uint8_t> buffer(leaves.size() * BLOCK_SIZE);
+	for (auto [i, n] : enumerate(leaves)) {
+		auto size = blockSize(n);
+		const auto* d = data.getData(n * (BLOCK_SIZE / 2), size);
+		std::copy_n(d, size, &buffer[i * BLOCK_SIZE]);
+	}
+
+	parallelForBatched(workers, leaves.size(), [&](size_t i) {
+		auto n = leaves[i];
+		auto size = blockSize(n);
+		auto d = buffer.subspan(i * BLOCK_SIZE, size);
+		auto& hash = entry.nodes[n].hash;
+		if (size == BLOCK_SIZE) {
+			tiger_leaf(d.first<BLOCK_SIZE>(), hash);
+		} else {
+			// partial last block
+			std::array<uint8_t, BLOCK_SIZE + 1> tmp;
+			tmp[0] = 0x00;
+			copy_to_range(d, subspan(tmp, 1));
+			tiger(subspan(tmp, 0, size + 1), hash);
+		}
+	});
+	for (auto n : leaves) markValid(n);
+
+	for (auto it = internals.begin(); it != internals.end(); /**/) {
+		auto level = it->l;
+		auto e = std::find_if(it, internals.end(), [&](const Node& nd) { return nd.l != level; });
+		std::span<const Node> sameLevel{it, e};
+		parallelForBatched(workers, sameLevel.size(), [&](size_t i) {
+			auto nd = sameLevel[i];
+			tiger_int(entry.nodes[getLeftChild (nd).n].hash,
+			          entry.nodes[getRightChild(nd).n].hash,
+			          entry.nodes[nd.n].hash);
+		});
+		for (const auto& nd : sameLevel) markValid(nd.n);
+		it = e;
+	}
+}
+
 
 // The TigerTree::nodes member variable stores a linearized binary tree. The
 // linearization is done like in this example:
@@ -28,14 +28,18 @@
 #ifndef TIGERTREE_HH
 #define TIGERTREE_HH
 
+#include "tiger.hh"
+
 #include <cstdint>
 #include <ctime>
 #include <functional>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace openmsx {
 
-struct TigerHash;
+class WorkerPool;
 
 /** The TigerTree class will query the to-be-hashed data via this abstract
   * interface. This allows to e.g. fetch the data from a file.
@@ -44,10 +48,11 @@ class TTData
 {
 public:
 	/** Return the requested portion of the to-be-hashed data block.
-	 * Special requirement: it should be allowed to temporarily overwrite
-	 * the byte one position before the returned pointer.
+	 * The returned pointer only needs to remain valid till the next call.
+	 * This is only called from the thread that calls calcHash(), the
+	 * hashing itself is spread over multiple threads.
 	 */
-	[[nodiscard]] virtual uint8_t* getData(size_t offset, size_t size) = 0;
+	[[nodiscard]] virtual const uint8_t* getData(size_t offset, size_t size) = 0;
 
 	/** Because TTH calculation of a large file takes some time (a few
 	  * 1/10s for a hard disk image) we try to cache previous calculations.
@@ -74,6 +79,12 @@ class TigerTree
 public:
 	static constexpr size_t BLOCK_SIZE = 1024;
 
+	/** A (valid) node in the tree, see getUpperNodes(). */
+	struct SavedNode {
+		uint64_t n; // node number
+		TigerHash hash;
+	};
+
 	/** Create TigerTree calculator for the given (abstract) data block
 	 * of given size.
 	 */
@@ -90,6 +101,29 @@ public:
 	 */
 	void notifyChange(size_t offset, size_t len, time_t time);
 
+	/** Same as above, but for a change that's not yet in the file (e.g.
+	 * it's still in a write-back cache), so the time stays the same.
+	 * Call the above version once the data is written.
+	 */
+	void notifyChange(size_t offset, size_t len);
+
+	/** Get the valid nodes in the upper part of the tree: the nodes that
+	 * cover at least 'minBlocks' blocks. After restoring these (e.g. in a
+	 * later session, see restoreNodes()) a small change in the input only
+	 * requires to rehash at most about 'minBlocks' blocks.
+	 */
+	[[nodiscard]] std::vector<SavedNode> getUpperNodes(size_t minBlocks) const;
+
+	/** Mark the given nodes as valid (again). It's the responsibility of
+	 * the caller to only pass nodes that match the current input data,
+	 * e.g. by checking the size and modification time of the file.
+	 */
+	void restoreNodes(std::span<const SavedNode> nodes);
+
+	/** Are there any valid nodes (e.g. from an earlier calculation on the
+	 * same data)? */
+	[[nodiscard]] bool hasValidNodes() const;
+
 private:
 	// functions to navigate in binary tree
 	struct Node {
@@ -103,7 +137,11 @@ private:
 	[[nodiscard]] Node getLeftChild(Node node) const;
 	[[nodiscard]] Node getRightChild(Node node) const;
 
-	[[nodiscard]] const TigerHash& calcHash(Node node, const std::function<void(size_t, size_t)>& progressCallback);
+	[[nodiscard]] const TigerHash& calcHash(
+		Node node, WorkerPool& workers,
+		const std::function<void(size_t, size_t)>& progressCallback);
+	void calcSubTree(Node node, WorkerPool& workers);
+	void markValid(size_t n);
 
 private:
 	TTData& data;
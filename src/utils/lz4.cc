@@ -4,6 +4,7 @@
 #include "endian.hh"
 #include "inline.hh"
 #include "unreachable.hh"
+#include <algorithm>
 #include <array>
 #include <bit>
 #include <cstring>
@@ -690,4 +691,57 @@ safe_match_copy:
 	return int(op - dst); // Nb of output bytes decoded
 }
 
+int decompressSafe(const uint8_t* src, uint8_t* dst, int compressedSize, int dstCapacity)
+{
+	const uint8_t* ip = src;
+	const uint8_t* const iend = ip + compressedSize;
+	uint8_t* op = dst;
+	uint8_t* const oend = op + dstCapacity;
+
+	// Add the optional extra length bytes. Stop early when the length
+	// becomes too large, this also prevents overflow.
+	auto addLength = [&](size_t& length) {
+		while (true) {
+			if ((ip == iend) || (length > size_t(dstCapacity))) return false;
+			unsigned s = *ip++;
+			length += s;
+			if (s != 255) return true;
+		}
+	};
+
+	while (true) {
+		if (ip == iend) return -1;
+		unsigned token = *ip++;
+
+		// literals
+		size_t length = token >> ML_BITS;
+		if ((length == RUN_MASK) && !addLength(length)) return -1;
+		if ((length > size_t(iend - ip)) || (length > size_t(oend - op))) return -1;
+		memcpy(op, ip, length);
+		ip += length;
+		op += length;
+		if (ip == iend) break; // the last sequence has no match
+
+		// match
+		if ((iend - ip) < 2) return -1;
+		size_t offset = Endian::read_UA_L16(ip);
+		ip += 2;
+		if ((offset == 0) || (offset > size_t(op - dst))) return -1;
+		length = token & ML_MASK;
+		if ((length == ML_MASK) && !addLength(length)) return -1;
+		length += MINMATCH;
+		if (length > size_t(oend - op)) return -1;
+		// Source and destination may overlap (when offset < length). Then
+		// copy in steps that don't overlap, those get larger each time.
+		const uint8_t* match = op - offset;
+		uint8_t* const mend = op + length;
+		while (op < mend) {
+			auto n = std::min(size_t(op - match), size_t(mend - op));
+			memcpy(op, match, n);
+			op += n;
+		}
+	}
+	return int(op - dst);
+}
+
 } // namespace LZ4
@@ -37,8 +37,9 @@
 //
 // The most important changes are:
 // - Stripped out all functions we don't use.
-// - Removed all safety checks. We only decompress data returned from the
-//   compress function, and that data is never stored/reloaded from disk.
+// - Removed all safety checks from decompress(). We only use that function
+//   on data returned from the compress function, which is never stored/
+//   reloaded from disk. For data read from a file use decompressSafe().
 // - Rewrite in C++ style.
 // - Use existing openMSX helper functions.
 
@@ -55,6 +56,13 @@ namespace LZ4 {
 
 	[[nodiscard]] int compress(const uint8_t* src, uint8_t* dst, int srcSize);
 	int decompress(const uint8_t* src, uint8_t* dst, int compressedSize, int dstCapacity);
+
+	/** Like decompress(), but checks all bounds, so it can be used on
+	  * untrusted (e.g. corrupt) input. This version is simpler and
+	  * somewhat slower.
+	  * @return The number of decompressed bytes, or -1 on invalid input.
+	  */
+	[[nodiscard]] int decompressSafe(const uint8_t* src, uint8_t* dst, int compressedSize, int dstCapacity);
 }
 
 #endif
@@ -20,21 +20,40 @@ A million repetitions of "a"
 
 #include "sha1.hh"
 
+#include "HostCPU.hh"
 #include "MSXException.hh"
 
 #include "endian.hh"
+#include "inline.hh"
 #include "narrow.hh"
+#include "one_of.hh"
 #include "ranges.hh"
+#include "unreachable.hh"
 #include "xrange.hh"
 
 #include <algorithm>
 #include <bit>
 #include <cassert>
 #include <cstring>
+#include <optional>
+#include <utility>
 #ifdef __SSE2__
 #include <emmintrin.h> // SSE2
 #endif
 
+// On x86 the SHA extensions and AVX2 are used when the CPU supports them
+// (checked at run-time), even when the rest of openMSX is compiled without
+// those instructions.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SHA1_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define SHA1_TARGET(x)
+#else
+#define SHA1_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
 namespace openmsx {
 
 // Rotate x bits to the left
@@ -43,6 +62,13 @@ namespace openmsx {
 	return (value << bits) | (value >> (32 - bits));
 }
 
+using State = std::array<uint32_t, 5>;
+
+// SHA1 initialization constants
+static constexpr State INITIAL_STATE = {
+	0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
 class WorkspaceBlock {
 private:
 	std::array<uint32_t, 16> data;
@@ -258,28 +284,16 @@ void Sha1Sum::clear()
 }
 
 
-// class SHA1
-
-SHA1::SHA1()
-{
-	// SHA1 initialization constants
-	m_state.a[0] = 0x67452301;
-	m_state.a[1] = 0xEFCDAB89;
-	m_state.a[2] = 0x98BADCFE;
-	m_state.a[3] = 0x10325476;
-	m_state.a[4] = 0xC3D2E1F0;
-}
-
-void SHA1::transform(std::span<const uint8_t, 64> buffer)
+static void transformBlock(State& state, std::span<const uint8_t, 64> buffer)
 {
 	WorkspaceBlock block(buffer);
 
-	// Copy m_state[] to working vars
-	uint32_t a = m_state.a[0];
-	uint32_t b = m_state.a[1];
-	uint32_t c = m_state.a[2];
-	uint32_t d = m_state.a[3];
-	uint32_t e = m_state.a[4];
+	// Copy state[] to working vars
+	uint32_t a = state[0];
+	uint32_t b = state[1];
+	uint32_t c = state[2];
+	uint32_t d = state[3];
+	uint32_t e = state[4];
 
 	// 4 rounds of 20 operations each. Loop unrolled
 	block.r0(a,b,c,d,e, 0); block.r0(e,a,b,c,d, 1); block.r0(d,e,a,b,c, 2);
@@ -310,12 +324,340 @@ void SHA1::transform(std::span<const uint8_t, 64> buffer)
 	block.r4(a,b,c,d,e,75); block.r4(e,a,b,c,d,76); block.r4(d,e,a,b,c,77);
 	block.r4(c,d,e,a,b,78); block.r4(b,c,d,e,a,79);
 
-	// Add the working vars back into m_state[]
-	m_state.a[0] += a;
-	m_state.a[1] += b;
-	m_state.a[2] += c;
-	m_state.a[3] += d;
-	m_state.a[4] += e;
+	// Add the working vars back into state[]
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+// Process one or more 64-byte blocks.
+static void transformScalar(State& state, std::span<const uint8_t> blocks)
+{
+	assert((blocks.size() % 64) == 0);
+	for (size_t i = 0; i < blocks.size(); i += 64) {
+		transformBlock(state, subspan<64>(blocks, i));
+	}
+}
+
+#ifdef SHA1_X86
+
+// Based on the Intel SHA extensions white paper (and the example code in
+// there). Each call to 'shaNiRounds<K>()' performs rounds 4*K up to 4*K+3,
+// and interleaves the calculation of the message schedule for later rounds.
+template<int K>
+SHA1_TARGET("sha,sse4.1") ALWAYS_INLINE void shaNiRounds(
+	__m128i& abcd, __m128i (&e)[2], __m128i (&msg)[4])
+{
+	auto& eCur   = e[K & 1];
+	auto& eOther = e[(K + 1) & 1];
+	const auto& m = msg[K & 3];
+	if constexpr (K == 0) {
+		eCur = _mm_add_epi32(eCur, m);
+	} else {
+		eCur = _mm_sha1nexte_epu32(eCur, m);
+	}
+	eOther = abcd;
+	if constexpr (3 <= K && K <= 18) {
+		msg[(K + 1) & 3] = _mm_sha1msg2_epu32(msg[(K + 1) & 3], m);
+	}
+	abcd = _mm_sha1rnds4_epu32(abcd, eCur, K / 5);
+	if constexpr (1 <= K && K <= 16) {
+		msg[(K + 3) & 3] = _mm_sha1msg1_epu32(msg[(K + 3) & 3], m);
+	}
+	if constexpr (2 <= K && K <= 17) {
+		msg[(K + 2) & 3] = _mm_xor_si128(msg[(K + 2) & 3], m);
+	}
+}
+
+template<int... K>
+SHA1_TARGET("sha,sse4.1") ALWAYS_INLINE void shaNiAllRounds(
+	__m128i& abcd, __m128i (&e)[2], __m128i (&msg)[4],
+	std::integer_sequence<int, K...>)
+{
+	(shaNiRounds<K>(abcd, e, msg), ...);
+}
+
+SHA1_TARGET("sha,sse4.1") static void transformShaNi(State& state, std::span<const uint8_t> blocks)
+{
+	assert((blocks.size() % 64) == 0);
+	const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607, 0x08090a0b0c0d0e0f);
+
+	// 'abcd' holds a in the upper and d in the lower 32 bits
+	__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(std::bit_cast<const __m128i*>(state.data())), 0x1B);
+	__m128i e0 = _mm_set_epi32(narrow_cast<int>(state[4]), 0, 0, 0);
+
+	for (size_t i = 0; i < blocks.size(); i += 64) {
+		const auto* p = std::bit_cast<const __m128i*>(&blocks[i]);
+		__m128i msg[4] = {
+			_mm_shuffle_epi8(_mm_loadu_si128(p + 0), byteSwap),
+			_mm_shuffle_epi8(_mm_loadu_si128(p + 1), byteSwap),
+			_mm_shuffle_epi8(_mm_loadu_si128(p + 2), byteSwap),
+			_mm_shuffle_epi8(_mm_loadu_si128(p + 3), byteSwap),
+		};
+		__m128i abcdSave = abcd;
+		__m128i e[2] = {e0, _mm_setzero_si128()};
+		shaNiAllRounds(abcd, e, msg, std::make_integer_sequence<int, 20>{});
+		e0 = _mm_sha1nexte_epu32(e[0], e0);
+		abcd = _mm_add_epi32(abcd, abcdSave);
+	}
+
+	_mm_storeu_si128(std::bit_cast<__m128i*>(state.data()), _mm_shuffle_epi32(abcd, 0x1B));
+	state[4] = uint32_t(_mm_extract_epi32(e0, 3));
+}
+
+
+// Hash 8 independent blocks in parallel, one per 32-bit lane of the AVX2
+// registers. This is the same calculation as in transformBlock(), only
+// vectorized.
+static constexpr size_t LANES = 8;
+using MultiState = std::array<std::array<uint32_t, LANES>, 5>; // [word][lane]
+
+template<int N>
+SHA1_TARGET("avx2") ALWAYS_INLINE __m256i rol32x8(__m256i x)
+{
+	return _mm256_or_si256(_mm256_slli_epi32(x, N), _mm256_srli_epi32(x, 32 - N));
+}
+
+// 8x8 matrix transpose of 32-bit elements
+SHA1_TARGET("avx2") ALWAYS_INLINE void transpose8x8(__m256i* r)
+{
+	__m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+	__m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+	__m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+	__m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+	__m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+	__m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+	__m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+	__m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+	__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+	__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+	__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+	__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+	__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+	__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+	__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+	__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+	r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+	r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+	r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+	r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+	r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+	r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+	r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+	r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+// Load 32 bytes (at 'offset') from each block, and transpose, so that r[i]
+// holds message word 'i' (in host byte order) of all blocks.
+SHA1_TARGET("avx2") ALWAYS_INLINE void loadWords(
+	__m256i* r, std::span<const uint8_t* const, LANES> blocks, size_t offset)
+{
+	const __m256i byteSwap = _mm256_set_epi64x(
+		0x0c0d0e0f08090a0b, 0x0405060700010203, 0x0c0d0e0f08090a0b, 0x0405060700010203);
+	for (auto lane : xrange(LANES)) {
+		r[lane] = _mm256_loadu_si256(std::bit_cast<const __m256i*>(blocks[lane] + offset));
+	}
+	transpose8x8(r);
+	for (auto i : xrange(8)) r[i] = _mm256_shuffle_epi8(r[i], byteSwap);
+}
+
+SHA1_TARGET("avx2") ALWAYS_INLINE void avx2Round(
+	__m256i (&w)[16], int i, __m256i f, __m256i k,
+	__m256i& a, __m256i& b, __m256i& c, __m256i& d, __m256i& e)
+{
+	if (i >= 16) {
+		w[i & 15] = rol32x8<1>(_mm256_xor_si256(
+			_mm256_xor_si256(w[(i + 13) & 15], w[(i + 8) & 15]),
+			_mm256_xor_si256(w[(i +  2) & 15], w[ i      & 15])));
+	}
+	__m256i t = _mm256_add_epi32(
+		_mm256_add_epi32(rol32x8<5>(a), f),
+		_mm256_add_epi32(_mm256_add_epi32(e, w[i & 15]), k));
+	e = d;
+	d = c;
+	c = rol32x8<30>(b);
+	b = a;
+	a = t;
+}
+
+SHA1_TARGET("avx2") static void transformAvx2(MultiState& state, std::span<const uint8_t* const, LANES> blocks)
+{
+	// (plain arrays: std::array<__m256i> triggers -Wignored-attributes)
+	__m256i w[16];
+	loadWords(&w[0], blocks,  0);
+	loadWords(&w[8], blocks, 32);
+
+	__m256i s[5];
+	for (auto i : xrange(5)) {
+		s[i] = _mm256_loadu_si256(std::bit_cast<const __m256i*>(state[i].data()));
+	}
+	__m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4];
+
+	__m256i k = _mm256_set1_epi32(0x5A827999);
+	for (int i = 0; i < 20; ++i) { // (b & c) | (~b & d)
+		__m256i f = _mm256_xor_si256(_mm256_and_si256(b, _mm256_xor_si256(c, d)), d);
+		avx2Round(w, i, f, k, a, b, c, d, e);
+	}
+	k = _mm256_set1_epi32(0x6ED9EBA1);
+	for (int i = 20; i < 40; ++i) { // b ^ c ^ d
+		__m256i f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+		avx2Round(w, i, f, k, a, b, c, d, e);
+	}
+	k = _mm256_set1_epi32(narrow_cast<int>(0x8F1BBCDC));
+	for (int i = 40; i < 60; ++i) { // (b & c) | (b & d) | (c & d)
+		__m256i f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(_mm256_or_si256(b, c), d));
+		avx2Round(w, i, f, k, a, b, c, d, e);
+	}
+	k = _mm256_set1_epi32(narrow_cast<int>(0xCA62C1D6));
+	for (int i = 60; i < 80; ++i) { // b ^ c ^ d
+		__m256i f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+		avx2Round(w, i, f, k, a, b, c, d, e);
+	}
+
+	__m256i r[5] = {a, b, c, d, e};
+	for (auto i : xrange(5)) {
+		_mm256_storeu_si256(std::bit_cast<__m256i*>(state[i].data()), _mm256_add_epi32(s[i], r[i]));
+	}
+}
+
+// Hash many buffers with transformAvx2(). Each lane hashes one buffer, when
+// that's done the lane continues with the next buffer. So buffers of
+// different sizes can be mixed. 'store(i, state)' is called with the result
+// for buffer 'i'.
+template<typename Store>
+static void calcManyAvx2(std::span<const std::span<const uint8_t>> data, Store store,
+                         void (*transform)(State&, std::span<const uint8_t>))
+{
+	struct Lane {
+		size_t msg = size_t(-1); // index in 'data', -1 when idle
+		std::span<const uint8_t> blocks; // remaining full blocks
+		std::span<const uint8_t> tailBlocks; // remaining part of 'tail'
+		std::array<uint8_t, 128> tail; // last (partial) block(s) plus padding
+	};
+	std::array<Lane, LANES> lanes;
+	MultiState state;
+	static constexpr std::array<uint8_t, 64> idleBlock = {};
+
+	size_t nextMsg = 0;
+	size_t numActive = 0;
+	auto startNext = [&](size_t l) {
+		auto& lane = lanes[l];
+		if (nextMsg == data.size()) {
+			lane.msg = size_t(-1);
+			--numActive;
+			return;
+		}
+		lane.msg = nextMsg++;
+		auto msg = data[lane.msg];
+		auto full = msg.size() & ~size_t(63);
+		lane.blocks = msg.first(full);
+		auto rest = msg.subspan(full);
+		std::ranges::fill(lane.tail, 0);
+		copy_to_range(rest, lane.tail);
+		lane.tail[rest.size()] = 0x80;
+		size_t tailSize = (rest.size() < 56) ? 64 : 128;
+		Endian::B64 bitCount(8 * uint64_t(msg.size()));
+		memcpy(&lane.tail[tailSize - 8], &bitCount, 8);
+		lane.tailBlocks = std::span{lane.tail}.first(tailSize);
+		for (auto i : xrange(5)) state[i][l] = INITIAL_STATE[i];
+	};
+	auto getState = [&](size_t l) {
+		State s;
+		for (auto i : xrange(5)) s[i] = state[i][l];
+		return s;
+	};
+	numActive = LANES;
+	for (auto l : xrange(LANES)) startNext(l);
+
+	// Once less than half of the lanes are in use, it's faster to finish
+	// the remaining buffers one at a time.
+	while (numActive > LANES / 2) {
+		std::array<const uint8_t*, LANES> ptrs;
+		for (auto l : xrange(LANES)) {
+			const auto& lane = lanes[l];
+			ptrs[l] = (lane.msg == size_t(-1)) ? idleBlock.data()
+			        : !lane.blocks.empty()     ? lane.blocks.data()
+			                                   : lane.tailBlocks.data();
+		}
+		transformAvx2(state, ptrs);
+		for (auto l : xrange(LANES)) {
+			auto& lane = lanes[l];
+			if (lane.msg == size_t(-1)) continue;
+			if (!lane.blocks.empty()) {
+				lane.blocks = lane.blocks.subspan(64);
+			} else {
+				lane.tailBlocks = lane.tailBlocks.subspan(64);
+				if (lane.tailBlocks.empty()) {
+					store(lane.msg, getState(l));
+					startNext(l);
+				}
+			}
+		}
+	}
+
+	for (auto l : xrange(LANES)) {
+		const auto& lane = lanes[l];
+		if (lane.msg == size_t(-1)) continue;
+		auto s = getState(l);
+		transform(s, lane.blocks);
+		transform(s, lane.tailBlocks);
+		store(lane.msg, s);
+	}
+}
+
+#endif // SHA1_X86
+
+struct Implementation {
+	void (*transform)(State& state, std::span<const uint8_t> blocks) = transformScalar;
+	bool multiAvx2 = false;
+};
+
+// Returns nullopt when not supported by this CPU.
+[[nodiscard]] static std::optional<Implementation> selectImplementation(SHA1::Impl impl)
+{
+	using enum SHA1::Impl;
+#ifdef SHA1_X86
+	const auto& cpu = HostCPU::getFeatures();
+	switch (impl) {
+	case AUTO:
+		// Hashing one buffer at a time with the SHA extensions is at
+		// least as fast as hashing 8 buffers in parallel with AVX2.
+		return Implementation{.transform = cpu.shaNi ? transformShaNi : transformScalar,
+		                      .multiAvx2 = cpu.avx2 && !cpu.shaNi};
+	case SHA_NI:
+		if (!cpu.shaNi) return {};
+		return Implementation{.transform = transformShaNi, .multiAvx2 = false};
+	case AVX2:
+		if (!cpu.avx2) return {};
+		return Implementation{.transform = transformScalar, .multiAvx2 = true};
+	case SCALAR:
+		return Implementation{};
+	}
+	UNREACHABLE;
+#else
+	if (impl == one_of(AUTO, SCALAR)) return Implementation{};
+	return {};
+#endif
+}
+
+static Implementation implementation = *selectImplementation(SHA1::Impl::AUTO);
+
+bool SHA1::forceImpl(Impl impl)
+{
+	auto newImpl = selectImplementation(impl);
+	if (!newImpl) return false;
+	implementation = *newImpl;
+	return true;
+}
+
+
+// class SHA1
+
+SHA1::SHA1()
+{
+	m_state.a = INITIAL_STATE;
 }
 
 // Use this function to hash in binary data and strings
@@ -331,10 +673,10 @@ void SHA1::update(std::span<const uint8_t> data)
 	if ((j + len) > 63) {
 		i = 64 - j;
 		copy_to_range(data.subspan(0, i), subspan(m_buffer, j));
-		transform(m_buffer);
-		for (/**/; i + 63 < len; i += 64) {
-			transform(subspan<64>(data, i));
-		}
+		implementation.transform(m_state.a, m_buffer);
+		size_t blocksSize = (len - i) & ~size_t(63);
+		implementation.transform(m_state.a, data.subspan(i, blocksSize));
+		i += blocksSize;
 		j = 0;
 	} else {
 		i = 0;
@@ -350,13 +692,13 @@ void SHA1::finalize()
 	m_buffer[j++] = 0x80;
 	if (j > 56) {
 		std::ranges::fill(subspan(m_buffer, j, 64 - j), 0);
-		transform(m_buffer);
+		implementation.transform(m_state.a, m_buffer);
 		j = 0;
 	}
 	std::ranges::fill(subspan(m_buffer, j, 56 - j), 0);
 	Endian::B64 finalCount(8 * m_count); // convert number of bytes to bits
 	memcpy(&m_buffer[56], &finalCount, 8);
-	transform(m_buffer);
+	implementation.transform(m_state.a, m_buffer);
 
 	m_finalized = true;
 }
@@ -374,4 +716,19 @@ Sha1Sum SHA1::calc(std::span<const uint8_t> data)
 	return sha1.digest();
 }
 
+void SHA1::calcMany(std::span<const std::span<const uint8_t>> data, std::span<Sha1Sum> result)
+{
+	assert(data.size() == result.size());
+#ifdef SHA1_X86
+	if (implementation.multiAvx2) {
+		calcManyAvx2(data, [&](size_t i, const State& s) { result[i].a = s; },
+		             implementation.transform);
+		return;
+	}
+#endif
+	for (auto i : xrange(data.size())) {
+		result[i] = calc(data[i]);
+	}
+}
+
 } // namespace openmsx
@@ -114,8 +114,29 @@ public:
 	/** Easier to use interface, if you can pass all data in one go. */
 	[[nodiscard]] static Sha1Sum calc(std::span<const uint8_t> data);
 
+	/** Calculate the hash values of many independent buffers, e.g. when
+	  * identifying a lot of (small) files. When supported by the CPU,
+	  * several buffers are hashed in parallel using SIMD instructions.
+	  * @pre data.size() == result.size()
+	  */
+	static void calcMany(std::span<const std::span<const uint8_t>> data,
+	                     std::span<Sha1Sum> result);
+
+	/** The fastest implementation that's supported by the CPU is selected
+	  * automatically at run-time:
+	  *  - SHA_NI: the x86 SHA extensions, for calc(), update() and
+	  *    calcMany().
+	  *  - AVX2: only for calcMany() (and only when SHA_NI is not
+	  *    supported), hashes 8 buffers in parallel.
+	  *  - SCALAR: portable C++ code.
+	  * For unittests and benchmarks, a specific implementation can be
+	  * forced. This returns false (and changes nothing) when it's not
+	  * supported by this CPU.
+	  */
+	enum class Impl : uint8_t { AUTO, SCALAR, SHA_NI, AVX2 };
+	static bool forceImpl(Impl impl);
+
 private:
-	void transform(std::span<const uint8_t, 64> buffer);
 	void finalize();
 
 private:
@@ -1,6 +1,5 @@
 #include "tiger.hh"
 
-#include "ScopedAssign.hh"
 #include "endian.hh"
 #include "ranges.hh"
 
@@ -712,7 +711,7 @@ void tiger(std::span<const uint8_t> input, TigerHash& result)
 
 void tiger_int(const TigerHash& h0, const TigerHash& h1, TigerHash& result)
 {
-	static std::array<uint8_t, 64> buf = {
+	std::array<uint8_t, 64> buf = {
 		0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -730,9 +729,16 @@ void tiger_int(const TigerHash& h0, const TigerHash& h1, TigerHash& result)
 	returnState(result.h64);
 }
 
-void tiger_leaf(std::span<uint8_t> data, TigerHash& result)
+void tiger_leaf(std::span<const uint8_t, 1024> data, TigerHash& result)
 {
-	static std::array<uint8_t, 64> last = {
+	// The hashed input is a 0x00 marker byte followed by the 1024 data
+	// bytes. So all chunks (except the first and the last) start at an
+	// offset of 63 bytes in 'data'.
+	std::array<uint8_t, 64> first;
+	first[0] = 0x00;
+	copy_to_range(data.subspan<0, 63>(), subspan<63>(first, 1));
+
+	std::array<uint8_t, 64> last = {
 		0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -745,11 +751,8 @@ void tiger_leaf(std::span<uint8_t> data, TigerHash& result)
 
 	initState(result.h64);
 
-	auto* p = data.data();
-	auto sa = ScopedAssign(p[-1], uint8_t(0));
-
-	std::span<uint8_t> chunks{p - 1, data.size()};
-	assert((chunks.size() % 64) == 0);
+	tiger_compress(first, result.h64);
+	std::span<const uint8_t> chunks = data.subspan<63, 1024 - 64>();
 	while (!chunks.empty()) {
 		tiger_compress(chunks.subspan<0, 64>(), result.h64);
 		chunks = chunks.subspan<64>();
@@ -47,19 +47,16 @@ void tiger(std::span<const uint8_t> input, TigerHash& result);
 /** Use for tiger-tree internal node hash calculations.
  * Combine two earlier calculated tiger hash values in a specific way (add
  * marker/padding/length bytes before/after) and calculate a new hash value.
- * This function is not reentrant.
+ * This function is reentrant (it can be called from multiple threads).
  */
 void tiger_int(const TigerHash& h0, const TigerHash& h1, TigerHash& result);
 
 /** Use for tiger-tree leaf node hash calculations.
- * Take a 1+1024-byte input block, add some marker/padding/length bytes
+ * Take a 1024-byte input block, add some marker/padding/length bytes
  * before/after and calculate a tiger-hash.
- * This function is not reentrant.
- * This function requires that data[0] can be (temporarily) overridden (so
- * after the function returns the data buffer is unchanged, but temporarily
- * it is changed, hence the parameter cannot be const).
+ * This function is reentrant (it can be called from multiple threads).
  */
-void tiger_leaf(std::span</*const*/uint8_t> data, TigerHash& result);
+void tiger_leaf(std::span<const uint8_t, 1024> data, TigerHash& result);
 
 } // namespace openmsx
 
@@ -1,6 +1,8 @@
 #include "AviRecorder.hh"
 
 #include "AviWriter.hh"
+#include "LZ4VideoReader.hh"
+#include "LZ4VideoWriter.hh"
 #include "PostProcessor.hh"
 
 #include "CliComm.hh"
@@ -39,11 +41,12 @@ AviRecorder::AviRecorder(Reactor& reactor_)
 AviRecorder::~AviRecorder()
 {
 	assert(!aviWriter);
+	assert(!lz4Writer);
 	assert(!wavWriter);
 }
 
 void AviRecorder::start(bool recordAudio, bool recordVideo, bool recordMono,
-                        bool recordStereo, const std::string& filename)
+                        bool recordStereo, bool fastFormat, const std::string& filename)
 {
 	stop();
 	MSXMotherBoard* motherBoard = reactor.getMotherBoard();
@@ -84,9 +87,16 @@ void AviRecorder::start(bool recordAudio, bool recordVideo, bool recordMono,
 		prevTime = EmuTime::infinity();
 
 		try {
-			aviWriter = std::make_unique<AviWriter>(
-				filename, frameWidth, frameHeight,
-				(recordAudio && stereo) ? 2 : 1, sampleRate);
+			unsigned channels = (recordAudio && stereo) ? 2 : 1;
+			if (fastFormat) {
+				lz4Writer = std::make_unique<LZ4VideoWriter>(
+					filename, frameWidth, frameHeight,
+					channels, sampleRate);
+			} else {
+				aviWriter = std::make_unique<AviWriter>(
+					filename, frameWidth, frameHeight,
+					channels, sampleRate);
+			}
 		} catch (MSXException& e) {
 			throw CommandException("Can't start recording: ",
 			                       e.getMessage());
@@ -115,6 +125,7 @@ void AviRecorder::stop()
 	}
 	sampleRate = 0;
 	aviWriter.reset();
+	lz4Writer.reset();
 	wavWriter.reset();
 }
 
@@ -189,14 +200,21 @@ void AviRecorder::addImage(const FrameSource* frame, EmuTime time)
 		}
 	} else if (prevTime != EmuTime::infinity()) {
 		duration = time - prevTime;
-		aviWriter->setFps(narrow_cast<float>(1.0 / duration.toDouble()));
+		auto fps = narrow_cast<float>(1.0 / duration.toDouble());
+		if (aviWriter) aviWriter->setFps(fps);
+		if (lz4Writer) lz4Writer->setFps(fps);
 	}
 	prevTime = time;
 
 	if (mixer) {
 		mixer->updateStream(time);
 	}
-	aviWriter->addFrame(frame, audioBuf);
+	if (aviWriter) {
+		aviWriter->addFrame(frame, audioBuf);
+	} else {
+		assert(lz4Writer);
+		lz4Writer->addFrame(frame, audioBuf);
+	}
 	audioBuf.clear();
 }
 
@@ -215,6 +233,7 @@ void AviRecorder::processStart(Interpreter& interp, std::span<const TclObject> t
 	bool recordStereo = false;
 	bool doubleSize   = false;
 	bool tripleSize   = false;
+	bool fastFormat   = false;
 	std::array info = {
 		valueArg("-prefix", prefix),
 		flagArg("-audioonly", audioOnly),
@@ -223,6 +242,7 @@ void AviRecorder::processStart(Interpreter& interp, std::span<const TclObject> t
 		flagArg("-stereo",    recordStereo),
 		flagArg("-doublesize", doubleSize),
 		flagArg("-triplesize", tripleSize),
+		flagArg("-lz4",       fastFormat),
 	};
 	auto arguments = parseTclArgs(interp, tokens.subspan(2), info);
 
@@ -238,6 +258,9 @@ void AviRecorder::processStart(Interpreter& interp, std::span<const TclObject> t
 	if (videoOnly && (recordStereo || recordMono)) {
 		throw CommandException("Can't have both -videoonly and -stereo or -mono.");
 	}
+	if (audioOnly && fastFormat) {
+		throw CommandException("Can't have both -audioonly and -lz4.");
+	}
 	std::string_view filenameArg;
 	switch (arguments.size()) {
 	case 0:
@@ -262,14 +285,16 @@ void AviRecorder::processStart(Interpreter& interp, std::span<const TclObject> t
 	bool recordAudio = !videoOnly;
 	bool recordVideo = !audioOnly;
 	std::string_view directory = recordVideo ? VIDEO_DIR : AUDIO_DIR;
-	std::string_view extension = recordVideo ? VIDEO_EXTENSION : AUDIO_EXTENSION;
+	std::string_view extension = !recordVideo ? AUDIO_EXTENSION
+	                           : fastFormat   ? LZ4_VIDEO_EXTENSION
+	                                          : VIDEO_EXTENSION;
 	auto filename = FileOperations::parseCommandFileArgument(
 		filenameArg, directory, prefix, extension);
 
-	if (aviWriter || wavWriter) {
+	if (isRecording()) {
 		result = "Already recording.";
 	} else {
-		start(recordAudio, recordVideo, recordMono, recordStereo, filename);
+		start(recordAudio, recordVideo, recordMono, recordStereo, fastFormat, filename);
 		result = tmpStrCat("Recording to ", filename);
 	}
 }
@@ -281,7 +306,7 @@ void AviRecorder::processStop(std::span<const TclObject> /*tokens*/)
 
 void AviRecorder::processToggle(Interpreter& interp, std::span<const TclObject> tokens, TclObject& result)
 {
-	if (aviWriter || wavWriter) {
+	if (isRecording()) {
 		// drop extra tokens
 		processStop(tokens.first<2>());
 	} else {
@@ -289,9 +314,35 @@ void AviRecorder::processToggle(Interpreter& interp, std::span<const TclObject>
 	}
 }
 
+void AviRecorder::processConvert(std::span<const TclObject> tokens, TclObject& result)
+{
+	auto input = FileOperations::parseCommandFileArgument(
+		tokens[2].getString(), VIDEO_DIR, "", LZ4_VIDEO_EXTENSION);
+	auto output = (tokens.size() == 4)
+		? FileOperations::parseCommandFileArgument(
+			tokens[3].getString(), VIDEO_DIR, "", VIDEO_EXTENSION)
+		: strCat(FileOperations::stripExtension(input), VIDEO_EXTENSION);
+	if (input == output) {
+		throw CommandException("Input and output file must be different.");
+	}
+
+	try {
+		LZ4VideoReader reader(input);
+		AviWriter writer(output, reader.getWidth(), reader.getHeight(),
+		                 reader.getChannels(), reader.getAudioRate());
+		writer.setFps(reader.getFps());
+		while (reader.nextFrame()) {
+			writer.addFrame(reader.getPixels(), reader.getAudio());
+		}
+	} catch (MSXException& e) {
+		throw CommandException("Can't convert recording: ", e.getMessage());
+	}
+	result = tmpStrCat("Converted to ", output);
+}
+
 bool AviRecorder::isRecording() const
 {
-	return aviWriter || wavWriter;
+	return aviWriter || lz4Writer || wavWriter;
 }
 
 void AviRecorder::status(std::span<const TclObject> /*tokens*/, TclObject& result) const
@@ -318,6 +369,9 @@ void AviRecorder::Cmd::execute(std::span<const TclObject> tokens, TclObject& res
 			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
 			recorder.processStop(tokens); },
 		"toggle", [&]{ recorder.processToggle(getInterpreter(), tokens, result); },
+		"convert", [&]{
+			checkNumArgs(tokens, Between{3, 4}, Prefix{2}, "input ?output?");
+			recorder.processConvert(tokens, result); },
 		"status", [&]{
 			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
 			recorder.status(tokens, result); });
@@ -332,11 +386,16 @@ std::string AviRecorder::Cmd::help(std::span<const TclObject> /*tokens*/) const
 	       "record stop               Stop recording\n"
 	       "record toggle             Toggle recording (useful as keybinding)\n"
 	       "record status             Query recording state\n"
+	       "record convert <in> [<out>]  Convert a .omv recording to .avi\n"
 	       "\n"
 	       "The start subcommand also accepts an optional -audioonly, -videoonly, "
-	       " -mono, -stereo, -doublesize, -triplesize flag.\n"
+	       " -mono, -stereo, -doublesize, -triplesize, -lz4 flag.\n"
 	       "Videos are recorded in a 320x240 size by default, at 640x480 when the "
-	       "-doublesize flag is used and at 960x720 when the -triplesize flag is used.";
+	       "-doublesize flag is used and at 960x720 when the -triplesize flag is used.\n"
+	       "With the -lz4 flag video is recorded to a .omv file instead. That "
+	       "format is much cheaper to record (e.g. when running at high "
+	       "emulation speed), but the files are bigger and must afterwards be "
+	       "converted to .avi with the convert subcommand.";
 }
 
 void AviRecorder::Cmd::tabCompletion(std::vector<std::string>& tokens) const
@@ -344,16 +403,18 @@ void AviRecorder::Cmd::tabCompletion(std::vector<std::string>& tokens) const
 	using namespace std::literals;
 	if (tokens.size() == 2) {
 		static constexpr std::array cmds = {
-			"start"sv, "stop"sv, "toggle"sv, "status"sv,
+			"start"sv, "stop"sv, "toggle"sv, "status"sv, "convert"sv,
 		};
 		completeString(tokens, cmds);
 	} else if ((tokens.size() >= 3) && (tokens[1] == "start")) {
 		static constexpr std::array options = {
 			"-prefix"sv, "-videoonly"sv, "-audioonly"sv,
 			"-doublesize"sv, "-triplesize"sv,
-			"-mono"sv, "-stereo"sv,
+			"-mono"sv, "-stereo"sv, "-lz4"sv,
 		};
 		completeFileName(tokens, userFileContext(), options);
+	} else if ((tokens.size() >= 3) && (tokens[1] == "convert")) {
+		completeFileName(tokens, userFileContext());
 	}
 }
 
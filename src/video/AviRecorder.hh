@@ -17,6 +17,7 @@ namespace openmsx {
 class AviWriter;
 class FrameSource;
 class Interpreter;
+class LZ4VideoWriter;
 class MSXMixer;
 class PostProcessor;
 class Reactor;
@@ -29,6 +30,7 @@ public:
 	static constexpr std::string_view VIDEO_DIR = "videos";
 	static constexpr std::string_view AUDIO_DIR = "soundlogs";
 	static constexpr std::string_view VIDEO_EXTENSION = ".avi";
+	static constexpr std::string_view LZ4_VIDEO_EXTENSION = ".omv";
 	static constexpr std::string_view AUDIO_EXTENSION = ".wav";
 
 public:
@@ -43,12 +45,13 @@ public:
 
 private:
 	void start(bool recordAudio, bool recordVideo, bool recordMono,
-		   bool recordStereo, const std::string& filename);
+		   bool recordStereo, bool fastFormat, const std::string& filename);
 	void status(std::span<const TclObject> tokens, TclObject& result) const;
 
 	void processStart (Interpreter& interp, std::span<const TclObject> tokens, TclObject& result);
 	void processStop  (std::span<const TclObject> tokens);
 	void processToggle(Interpreter& interp, std::span<const TclObject> tokens, TclObject& result);
+	void processConvert(std::span<const TclObject> tokens, TclObject& result);
 
 private:
 	Reactor& reactor;
@@ -62,6 +65,7 @@ private:
 
 	std::vector<int16_t> audioBuf;
 	std::unique_ptr<AviWriter>   aviWriter; // can be nullptr
+	std::unique_ptr<LZ4VideoWriter> lz4Writer; // can be nullptr
 	std::unique_ptr<Wav16Writer> wavWriter; // can be nullptr
 	std::vector<PostProcessor*> postProcessors;
 	MSXMixer* mixer = nullptr;
@@ -278,7 +278,19 @@ void AviWriter::addFrame(const FrameSource* video, std::span<const int16_t> audi
 {
 	bool keyFrame = (frames++ % 300 == 0);
 	auto buffer = codec.compressFrame(keyFrame, video);
-	addAviChunk(subspan<4>("00dc"), buffer, keyFrame ? 0x10 : 0x0);
+	addFrameData(buffer, keyFrame, audio);
+}
+
+void AviWriter::addFrame(std::span<const uint32_t> pixels, std::span<const int16_t> audio)
+{
+	bool keyFrame = (frames++ % 300 == 0);
+	auto buffer = codec.compressFrame(keyFrame, pixels);
+	addFrameData(buffer, keyFrame, audio);
+}
+
+void AviWriter::addFrameData(std::span<const uint8_t> video, bool keyFrame, std::span<const int16_t> audio)
+{
+	addAviChunk(subspan<4>("00dc"), video, keyFrame ? 0x10 : 0x0);
 
 	if (!audio.empty()) {
 		assert((audio.size() % channels) == 0);
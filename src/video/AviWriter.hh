@@ -25,9 +25,13 @@ public:
 	          unsigned channels, unsigned freq);
 	~AviWriter();
 	void addFrame(const FrameSource* video, std::span<const int16_t> audio);
+	/** Same as above, but for an already scaled 'width x height' frame.
+	  */
+	void addFrame(std::span<const uint32_t> pixels, std::span<const int16_t> audio);
 	void setFps(float fps_) { fps = fps_; }
 
 private:
+	void addFrameData(std::span<const uint8_t> video, bool keyFrame, std::span<const int16_t> audio);
 	void addAviChunk(std::span<const char, 4> tag, std::span<const uint8_t> data, unsigned flags);
 
 private:
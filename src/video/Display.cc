@@ -47,6 +47,7 @@ Display::Display(Reactor& reactor_)
 	, osdGui(reactor_.getCommandController(), *this)
 	, reactor(reactor_)
 	, renderSettings(reactor.getCommandController())
+	, screenShotQueue(reactor.getCommandController(), reactor.getCliComm())
 {
 	frameDurationSum = 0;
 	repeat(NUM_FRAME_DURATIONS, [&] {
@@ -424,12 +425,14 @@ void Display::ScreenShotCmd::execute(std::span<const TclObject> tokens, TclObjec
 	bool rawShot = false;
 	bool doubleSize = false;
 	bool withOsd = false;
+	bool async = false;
 	std::string size;
 	std::array info = {
 		valueArg("-prefix", prefix),
 		flagArg("-raw", rawShot),
 		flagArg("-doublesize", doubleSize), // bwcompat, alias for -size 640
 		flagArg("-with-osd", withOsd),
+		flagArg("-async", async),
 		valueArg("-size", size)
 	};
 	auto arguments = parseTclArgs(getInterpreter(), tokens.subspan(1), info);
@@ -477,31 +480,37 @@ void Display::ScreenShotCmd::execute(std::span<const TclObject> tokens, TclObjec
 	default:
 		throw SyntaxError();
 	}
-	std::string filename = FileOperations::parseCommandFileArgument(
-		fname, SCREENSHOT_DIR, prefix, SCREENSHOT_EXTENSION);
-
-	if (!rawShot) {
-		// take screenshot as displayed, possibly with other layers (OSD stuff, ImGUI)
-		try {
-			display.getVideoSystem().takeScreenShot(filename, withOsd);
-		} catch (MSXException& e) {
-			throw CommandException(
-				"Failed to take screenshot: ", e.getMessage());
-		}
-	} else {
-		auto* videoLayer = dynamic_cast<VideoLayer*>(
-			display.findActiveLayer());
+	VideoLayer* videoLayer = nullptr;
+	if (rawShot) {
+		videoLayer = dynamic_cast<VideoLayer*>(display.findActiveLayer());
 		if (!videoLayer) {
 			throw CommandException(
 				"Current renderer doesn't support taking screenshots.");
 		}
-		std::optional<unsigned> height = size == "auto" ? std::nullopt : size == "640" ? std::optional(480) : std::optional(240);
-		try {
-			videoLayer->takeRawScreenShot(height, filename);
-		} catch (MSXException& e) {
-			throw CommandException(
-				"Failed to take screenshot: ", e.getMessage());
+	}
+
+	// Asynchronous screenshots are only written later, and the headless
+	// renderer only saves the next frame. So an automatically numbered
+	// name must already be reserved now.
+	bool reserved = fname.empty();
+	std::string filename = reserved
+		? ScreenShotQueue::reserveNumberedFileName(
+			SCREENSHOT_DIR, prefix, SCREENSHOT_EXTENSION)
+		: FileOperations::parseCommandFileArgument(
+			fname, SCREENSHOT_DIR, prefix, SCREENSHOT_EXTENSION);
+
+	try {
+		if (!rawShot) {
+			// take screenshot as displayed, possibly with other layers (OSD stuff, ImGUI)
+			display.getVideoSystem().takeScreenShot(filename, withOsd, async);
+		} else {
+			std::optional<unsigned> height = size == "auto" ? std::nullopt : size == "640" ? std::optional(480) : std::optional(240);
+			videoLayer->takeRawScreenShot(height, filename, async);
 		}
+	} catch (MSXException& e) {
+		if (reserved) FileOperations::unlink(filename);
+		throw CommandException(
+			"Failed to take screenshot: ", e.getMessage());
 	}
 
 	result = filename;
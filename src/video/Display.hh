@@ -8,6 +8,7 @@
 #include "InfoTopic.hh"
 #include "OSDGUI.hh"
 #include "RTSchedulable.hh"
+#include "ScreenShotQueue.hh"
 
 #include "CircularBuffer.hh"
 #include "Observer.hh"
@@ -49,6 +50,7 @@ public:
 	[[nodiscard]] RenderSettings& getRenderSettings() { return renderSettings; }
 	[[nodiscard]] auto getRenderer() const { return currentRenderer; }
 	[[nodiscard]] OSDGUI& getOSDGUI() { return osdGui; }
+	[[nodiscard]] ScreenShotQueue& getScreenShotQueue() { return screenShotQueue; }
 
 	/** Redraw the display.
 	  * The repaintImpl() methods are for internal and VideoSystem/VisibleSurface use only.
@@ -134,6 +136,7 @@ private:
 
 	Reactor& reactor;
 	RenderSettings renderSettings;
+	ScreenShotQueue screenShotQueue;
 
 	// the current renderer
 	RenderSettings::RendererID currentRenderer = RenderSettings::RendererID::UNINITIALIZED;
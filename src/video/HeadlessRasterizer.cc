@@ -0,0 +1,179 @@
+#include "HeadlessRasterizer.hh"
+
+#include "Display.hh"
+#include "MSXCliComm.hh"
+#include "MSXException.hh"
+#include "MSXMotherBoard.hh"
+#include "PostProcessor.hh"
+#include "RawFrame.hh"
+#include "VDP.hh"
+
+#include "MemBuffer.hh"
+#include "aligned.hh"
+#include "inplace_buffer.hh"
+#include "stl.hh"
+#include "xrange.hh"
+
+#include <span>
+
+namespace openmsx {
+
+HeadlessRasterizer::HeadlessRasterizer(
+		VDP& vdp_, Display& display_, OutputSurface& screen,
+		HeadlessVideoSystem& videoSystem_)
+	: vdp(vdp_)
+	, display(display_)
+	, videoSystem(videoSystem_)
+	, rasterizer(vdp, display, screen, nullptr)
+{
+}
+
+PostProcessor* HeadlessRasterizer::getPostProcessor() const
+{
+	return nullptr;
+}
+
+const RawFrame* HeadlessRasterizer::getWorkingFrame() const
+{
+	return rasterizer.getWorkingFrame();
+}
+
+const RawFrame* HeadlessRasterizer::getLastFrame() const
+{
+	return nullptr;
+}
+
+bool HeadlessRasterizer::captureRequested() const
+{
+	// screenshots are always taken from the active machine
+	return videoSystem.hasPendingScreenShots() &&
+	       vdp.getMotherBoard().isActive();
+}
+
+bool HeadlessRasterizer::isActive()
+{
+	return captureRequested();
+}
+
+bool HeadlessRasterizer::isRecording() const
+{
+	// Pretend we're recording, this makes sure PixelRenderer doesn't
+	// skip the requested frame.
+	return captureRequested();
+}
+
+void HeadlessRasterizer::reset()
+{
+	rasterizer.reset();
+}
+
+void HeadlessRasterizer::frameStart(EmuTime time)
+{
+	// Only called when isActive() returned true.
+	capturing = videoSystem.takePendingScreenShots();
+	rasterizer.frameStart(time);
+}
+
+void HeadlessRasterizer::frameEnd()
+{
+	rasterizer.frameEnd();
+	if (!capturing.empty()) {
+		saveFrame();
+		capturing.clear();
+	}
+}
+
+void HeadlessRasterizer::saveFrame()
+{
+	const FrameSource& frame = *rasterizer.getWorkingFrame();
+	auto maxLineWidth = max_value(xrange(frame.getHeight()),
+		[&](auto y) { return frame.getLineWidth(y); });
+	// same choice as 'screenshot -raw' with the default size
+	unsigned width  = (maxLineWidth == 320) ? 320 : 640;
+	unsigned height = (maxLineWidth == 320) ? 240 : 480;
+
+	MemBuffer<FrameSource::Pixel, SSE_ALIGNMENT> buffer(size_t(width) * height);
+	inplace_buffer<const FrameSource::Pixel*, 480> lines(uninitialized_tag{}, height);
+	for (auto y : xrange(height)) {
+		auto dst = std::span{buffer}.subspan(y * size_t(width), width);
+		auto line = (height == 240)
+			? std::span<const FrameSource::Pixel>(frame.getLinePtr320_240(y, dst.first<320>()))
+			: std::span<const FrameSource::Pixel>(frame.getLinePtr640_480(y, dst.first<640>()));
+		lines[y] = line.data();
+	}
+
+	auto& queue = display.getScreenShotQueue();
+	for (const auto& [filename, async] : capturing) {
+		try {
+			queue.save(width, lines, filename, async);
+		} catch (MSXException& e) {
+			vdp.getMotherBoard().getMSXCliComm().printWarning(
+				"Failed to take screenshot: ", e.getMessage());
+		}
+	}
+}
+
+void HeadlessRasterizer::setDisplayMode(DisplayMode mode)
+{
+	rasterizer.setDisplayMode(mode);
+}
+
+void HeadlessRasterizer::setPalette(unsigned index, int grb)
+{
+	rasterizer.setPalette(index, grb);
+}
+
+void HeadlessRasterizer::setBackgroundColor(uint8_t index)
+{
+	rasterizer.setBackgroundColor(index);
+}
+
+void HeadlessRasterizer::setHorizontalAdjust(int adjust)
+{
+	rasterizer.setHorizontalAdjust(adjust);
+}
+
+void HeadlessRasterizer::setHorizontalScrollLow(uint8_t scroll)
+{
+	rasterizer.setHorizontalScrollLow(scroll);
+}
+
+void HeadlessRasterizer::setBorderMask(bool masked)
+{
+	rasterizer.setBorderMask(masked);
+}
+
+void HeadlessRasterizer::setTransparency(bool enabled)
+{
+	rasterizer.setTransparency(enabled);
+}
+
+void HeadlessRasterizer::setSuperimposeVideoFrame(const RawFrame* videoSource)
+{
+	rasterizer.setSuperimposeVideoFrame(videoSource);
+}
+
+void HeadlessRasterizer::drawBorder(int fromX, int fromY, int limitX, int limitY)
+{
+	rasterizer.drawBorder(fromX, fromY, limitX, limitY);
+}
+
+void HeadlessRasterizer::drawDisplay(
+	int fromX, int fromY,
+	int displayX, int displayY,
+	int displayWidth, int displayHeight)
+{
+	rasterizer.drawDisplay(fromX, fromY, displayX, displayY,
+	                       displayWidth, displayHeight);
+}
+
+void HeadlessRasterizer::drawSprites(
+	int fromX, int fromY,
+	int displayX, int displayY,
+	int displayWidth, int displayHeight)
+{
+	rasterizer.drawSprites(fromX, fromY, displayX, displayY,
+	                       displayWidth, displayHeight);
+}
+
+} // namespace openmsx
@@ -0,0 +1,72 @@
+#ifndef HEADLESSRASTERIZER_HH
+#define HEADLESSRASTERIZER_HH
+
+#include "HeadlessVideoSystem.hh"
+#include "Rasterizer.hh"
+#include "SDLRasterizer.hh"
+
+#include <vector>
+
+namespace openmsx {
+
+class Display;
+class OutputSurface;
+class VDP;
+
+/** Rasterizer for the 'headless' renderer.
+  * This wraps a SDLRasterizer (without post processor). As long as nobody
+  * asks for a frame, it reports itself as inactive, so PixelRenderer only
+  * keeps track of the VDP state (like DummyRenderer) and doesn't render
+  * anything. When a screenshot is requested, the next complete frame is
+  * rendered and, at the end of that frame, saved to a PNG file.
+  */
+class HeadlessRasterizer final : public Rasterizer
+{
+public:
+	HeadlessRasterizer(VDP& vdp, Display& display, OutputSurface& screen,
+	                   HeadlessVideoSystem& videoSystem);
+
+	// Rasterizer interface:
+	[[nodiscard]] PostProcessor* getPostProcessor() const override;
+	[[nodiscard]] const RawFrame* getWorkingFrame() const override;
+	[[nodiscard]] const RawFrame* getLastFrame() const override;
+	[[nodiscard]] bool isActive() override;
+	void reset() override;
+	void frameStart(EmuTime time) override;
+	void frameEnd() override;
+	void setDisplayMode(DisplayMode mode) override;
+	void setPalette(unsigned index, int grb) override;
+	void setBackgroundColor(uint8_t index) override;
+	void setHorizontalAdjust(int adjust) override;
+	void setHorizontalScrollLow(uint8_t scroll) override;
+	void setBorderMask(bool masked) override;
+	void setTransparency(bool enabled) override;
+	void setSuperimposeVideoFrame(const RawFrame* videoSource) override;
+	void drawBorder(int fromX, int fromY, int limitX, int limitY) override;
+	void drawDisplay(
+		int fromX, int fromY,
+		int displayX, int displayY,
+		int displayWidth, int displayHeight) override;
+	void drawSprites(
+		int fromX, int fromY,
+		int displayX, int displayY,
+		int displayWidth, int displayHeight) override;
+	[[nodiscard]] bool isRecording() const override;
+
+private:
+	[[nodiscard]] bool captureRequested() const;
+	void saveFrame();
+
+private:
+	VDP& vdp;
+	Display& display;
+	HeadlessVideoSystem& videoSystem;
+	SDLRasterizer rasterizer;
+
+	/** Screenshots that will be taken at the end of the current frame. */
+	std::vector<HeadlessVideoSystem::ScreenShotRequest> capturing;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,125 @@
+#include "HeadlessVideoSystem.hh"
+
+#include "HeadlessRasterizer.hh"
+#include "FileOperations.hh"
+#include "LDRasterizer.hh"
+#include "MSXException.hh"
+#include "V9990Rasterizer.hh"
+
+#include "unreachable.hh"
+
+#include "components.hh"
+
+#include <utility>
+
+namespace openmsx {
+
+HeadlessVideoSystem::Surface::Surface()
+{
+	calculateViewPort({640, 480}, {640, 480});
+}
+
+void HeadlessVideoSystem::Surface::saveScreenshot(
+	ScreenShotQueue& /*queue*/, const std::string& /*filename*/, bool /*async*/)
+{
+	throw MSXException("Not supported by the headless renderer.");
+}
+
+
+HeadlessVideoSystem::HeadlessVideoSystem(Display& display_)
+	: display(display_)
+{
+}
+
+HeadlessVideoSystem::~HeadlessVideoSystem()
+{
+	// Requests that never got a frame (e.g. the renderer was switched
+	// before the next frame): remove the (still empty) file that was
+	// created to reserve the name, see ScreenShotQueue.
+	for (const auto& request : pendingScreenShots) {
+		if (auto st = FileOperations::getStat(request.filename);
+		    st && (st->st_size == 0)) {
+			FileOperations::unlink(request.filename);
+		}
+	}
+}
+
+std::unique_ptr<Rasterizer> HeadlessVideoSystem::createRasterizer(VDP& vdp)
+{
+	return std::make_unique<HeadlessRasterizer>(vdp, display, surface, *this);
+}
+
+std::unique_ptr<V9990Rasterizer> HeadlessVideoSystem::createV9990Rasterizer(
+	V9990& /*vdp*/)
+{
+	UNREACHABLE; // V9990 uses the dummy renderer
+}
+
+#if COMPONENT_LASERDISC
+std::unique_ptr<LDRasterizer> HeadlessVideoSystem::createLDRasterizer(
+	LaserdiscPlayer& /*ld*/)
+{
+	UNREACHABLE; // laserdisc uses the dummy renderer
+}
+#endif
+
+void HeadlessVideoSystem::flush()
+{
+}
+
+void HeadlessVideoSystem::takeScreenShot(const std::string& filename, bool /*withOsd*/,
+                                         bool async)
+{
+	// There's no OSD, and there's no finished frame either. Instead the
+	// next frame gets rendered and saved, see HeadlessRasterizer.
+	pendingScreenShots.push_back({filename, async});
+}
+
+std::vector<HeadlessVideoSystem::ScreenShotRequest> HeadlessVideoSystem::takePendingScreenShots()
+{
+	return std::exchange(pendingScreenShots, {});
+}
+
+std::optional<gl::ivec2> HeadlessVideoSystem::getMouseCoord()
+{
+	return {};
+}
+
+OutputSurface* HeadlessVideoSystem::getOutputSurface()
+{
+	// there's nothing to paint the layers on
+	return nullptr;
+}
+
+void HeadlessVideoSystem::showCursor(bool /*show*/)
+{
+}
+
+bool HeadlessVideoSystem::getCursorEnabled()
+{
+	return false;
+}
+
+std::string HeadlessVideoSystem::getClipboardText()
+{
+	return "";
+}
+
+void HeadlessVideoSystem::setClipboardText(zstring_view /*text*/)
+{
+}
+
+std::optional<gl::ivec2> HeadlessVideoSystem::getWindowPosition()
+{
+	return {};
+}
+
+void HeadlessVideoSystem::setWindowPosition(gl::ivec2 /*pos*/)
+{
+}
+
+void HeadlessVideoSystem::repaint()
+{
+}
+
+} // namespace openmsx
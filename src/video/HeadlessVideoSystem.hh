@@ -0,0 +1,78 @@
+#ifndef HEADLESSVIDEOSYSTEM_HH
+#define HEADLESSVIDEOSYSTEM_HH
+
+#include "OutputSurface.hh"
+#include "VideoSystem.hh"
+
+#include "components.hh"
+
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class Display;
+
+/** Video system for the 'headless' renderer.
+  * There's no window, and (like with the 'none' renderer) normally nothing
+  * gets rendered. Only when a screenshot is requested, the next MSX frame
+  * is rasterized (in software) and saved. So in batch runs we only pay the
+  * rendering cost for the frames that are actually captured.
+  */
+class HeadlessVideoSystem final : public VideoSystem
+{
+public:
+	explicit HeadlessVideoSystem(Display& display);
+	~HeadlessVideoSystem() override;
+
+	// VideoSystem interface:
+	[[nodiscard]] std::unique_ptr<Rasterizer> createRasterizer(VDP& vdp) override;
+	[[nodiscard]] std::unique_ptr<V9990Rasterizer> createV9990Rasterizer(
+		V9990& vdp) override;
+#if COMPONENT_LASERDISC
+	[[nodiscard]] std::unique_ptr<LDRasterizer> createLDRasterizer(
+		LaserdiscPlayer& ld) override;
+#endif
+	void flush() override;
+	void takeScreenShot(const std::string& filename, bool withOsd,
+	                    bool async) override;
+	[[nodiscard]] std::optional<gl::ivec2> getMouseCoord() override;
+	[[nodiscard]] OutputSurface* getOutputSurface() override;
+	void showCursor(bool show) override;
+	[[nodiscard]] bool getCursorEnabled() override;
+	[[nodiscard]] std::string getClipboardText() override;
+	void setClipboardText(zstring_view text) override;
+	[[nodiscard]] std::optional<gl::ivec2> getWindowPosition() override;
+	void setWindowPosition(gl::ivec2 pos) override;
+	void repaint() override;
+
+	/** Are there screenshot requests that still need a frame? */
+	[[nodiscard]] bool hasPendingScreenShots() const {
+		return !pendingScreenShots.empty();
+	}
+	struct ScreenShotRequest {
+		std::string filename;
+		bool async;
+	};
+	/** Hand over all pending requests (to the rasterizer that will
+	  * produce the next frame). */
+	[[nodiscard]] std::vector<ScreenShotRequest> takePendingScreenShots();
+
+private:
+	/** In-memory surface, only used for its pixel format. */
+	class Surface final : public OutputSurface
+	{
+	public:
+		Surface();
+		void saveScreenshot(ScreenShotQueue& queue,
+		                    const std::string& filename, bool async) override;
+	};
+
+	Display& display;
+	Surface surface;
+	std::vector<ScreenShotRequest> pendingScreenShots;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef LZ4VIDEOFORMAT_HH
+#define LZ4VIDEOFORMAT_HH
+
+#include "endian.hh"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace openmsx::LZ4Video {
+
+// On-disk layout of the openMSX lossless 'fast' video format (.omv). This
+// format is meant as an intermediate format: it's very cheap to produce
+// during emulation, and it can later be converted to a regular (ZMBV) avi
+// file (see the 'record convert' command).
+//
+//   FileHeader
+//   chunk*      (ChunkHeader + data, in recording order)
+//   IndexEntry* (one per chunk, 'FileHeader::indexCount' entries)
+//
+// All integers are stored in little endian. Pixels are 32-bit values in the
+// openMSX pixel format (0xAABBGGRR).
+//
+// Video chunks are LZ4 compressed. A key-frame chunk contains the full
+// frame, a delta chunk contains the XOR of the current and the previous
+// frame (so it's mostly zeros and compresses very well). Audio chunks
+// contain uncompressed interleaved 16-bit PCM samples, they always follow
+// the video chunk of the frame they belong to.
+//
+// The index is only written when the recording is finished. Till then
+// 'FileHeader::indexOffset' (and 'frames', 'audioSamples', 'indexCount') is
+// zero. So when a recording was interrupted (e.g. openMSX crashed) the
+// reader instead reconstructs the index by scanning the chunk headers.
+
+static constexpr std::string_view MAGIC = "openMSX LZ4 vid"; // +1 for zero
+static constexpr uint32_t VERSION = 1;
+
+static constexpr std::string_view TAG_KEY_FRAME = "VKEY";
+static constexpr std::string_view TAG_DIFF_FRAME = "VDIF";
+static constexpr std::string_view TAG_AUDIO = "AUDS";
+
+struct FileHeader {
+	std::array<char, 16> magic;
+	Endian::L64 indexOffset;
+	Endian::L32 version;
+	Endian::L32 width;
+	Endian::L32 height;
+	Endian::L32 channels;  // 0 when there's no audio
+	Endian::L32 audioRate; // 0 when there's no audio
+	Endian::L32 fpsRate;   // frames per 1000000 seconds (same as in avi)
+	Endian::L32 frames;
+	Endian::L32 audioSamples; // total number of int16 samples
+	Endian::L32 indexCount;
+	Endian::L32 reserved;
+};
+static_assert(sizeof(FileHeader) == 64);
+
+struct ChunkHeader {
+	std::array<char, 4> tag;
+	Endian::L32 size; // excluding this header
+};
+static_assert(sizeof(ChunkHeader) == 8);
+
+struct IndexEntry {
+	std::array<char, 4> tag;
+	Endian::L32 size;   // excluding the chunk header
+	Endian::L64 offset; // file position of the chunk data
+};
+static_assert(sizeof(IndexEntry) == 16);
+
+} // namespace openmsx::LZ4Video
+
+#endif
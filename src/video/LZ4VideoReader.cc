@@ -0,0 +1,151 @@
+#include "LZ4VideoReader.hh"
+
+#include "MSXException.hh"
+
+#include "lz4.hh"
+#include "narrow.hh"
+#include "ranges.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <bit>
+
+namespace openmsx {
+
+using namespace LZ4Video;
+
+[[nodiscard]] static bool isTag(const std::array<char, 4>& tag, std::string_view expected)
+{
+	return std::string_view(tag.data(), tag.size()) == expected;
+}
+
+LZ4VideoReader::LZ4VideoReader(const std::string& filename)
+	: file(filename)
+{
+	auto fileSize = file.getSize();
+	FileHeader header;
+	if (fileSize < sizeof(header)) {
+		throw MSXException("File too small: ", filename);
+	}
+	file.read(std::span{&header, 1});
+	if (std::string_view(header.magic.data(), MAGIC.size()) != MAGIC) {
+		throw MSXException("Not an openMSX LZ4 video recording: ", filename);
+	}
+	if (header.version != VERSION) {
+		throw MSXException("Unsupported LZ4 video version: ", uint32_t(header.version));
+	}
+	width     = header.width;
+	height    = header.height;
+	channels  = header.channels;
+	audioRate = header.audioRate;
+	frames    = header.frames;
+	fps = narrow_cast<float>(header.fpsRate / 1000000.0);
+	// these are the only sizes AviRecorder (and ZMBVEncoder) support
+	if (!(((width == 320) && (height == 240)) ||
+	      ((width == 640) && (height == 480)) ||
+	      ((width == 960) && (height == 720)))) {
+		throw MSXException("Invalid frame size: ", width, 'x', height);
+	}
+	if ((fps == 0.0f) || ((audioRate != 0) && (channels != 1) && (channels != 2))) {
+		throw MSXException("Invalid recording header: ", filename);
+	}
+
+	uint64_t indexOffset = header.indexOffset;
+	if (indexOffset == 0) {
+		// The recording wasn't properly finished.
+		scanChunks(fileSize);
+		frames = narrow<unsigned>(std::ranges::count_if(index, [](const auto& e) {
+			return isTag(e.tag, TAG_KEY_FRAME) || isTag(e.tag, TAG_DIFF_FRAME);
+		}));
+	} else {
+		uint64_t indexSize = uint64_t(header.indexCount) * sizeof(IndexEntry);
+		if ((indexOffset < sizeof(header)) || ((indexOffset + indexSize) > fileSize)) {
+			throw MSXException("Corrupt index in: ", filename);
+		}
+		index.resize(header.indexCount);
+		file.seek(narrow<size_t>(indexOffset));
+		file.read(std::span{index});
+		for (const auto& e : index) {
+			if ((e.offset < sizeof(header)) ||
+			    ((uint64_t(e.offset) + e.size) > indexOffset)) {
+				throw MSXException("Corrupt index in: ", filename);
+			}
+		}
+	}
+
+	auto numPixels = size_t(width) * height;
+	frame.resize(numPixels);
+	std::ranges::fill(std::span{frame}, 0);
+	work.resize(numPixels);
+}
+
+void LZ4VideoReader::scanChunks(size_t fileSize)
+{
+	// Stop at the first unknown or truncated chunk, that's where the
+	// recording was interrupted.
+	size_t pos = sizeof(FileHeader);
+	while ((fileSize - pos) >= sizeof(ChunkHeader)) {
+		ChunkHeader chunk;
+		file.seek(pos);
+		file.read(std::span{&chunk, 1});
+		pos += sizeof(ChunkHeader);
+		if (!isTag(chunk.tag, TAG_KEY_FRAME) &&
+		    !isTag(chunk.tag, TAG_DIFF_FRAME) &&
+		    !isTag(chunk.tag, TAG_AUDIO)) break;
+		if (chunk.size > (fileSize - pos)) break;
+
+		IndexEntry entry;
+		entry.tag = chunk.tag;
+		entry.size = chunk.size;
+		entry.offset = pos;
+		index.push_back(entry);
+		pos += chunk.size;
+	}
+}
+
+void LZ4VideoReader::readChunk(const IndexEntry& entry)
+{
+	input.resize(entry.size);
+	file.seek(narrow<size_t>(uint64_t(entry.offset)));
+	file.read(std::span{input});
+}
+
+bool LZ4VideoReader::nextFrame()
+{
+	// skip till the next video chunk (there shouldn't be anything else)
+	while ((indexPos < index.size()) &&
+	       !isTag(index[indexPos].tag, TAG_KEY_FRAME) &&
+	       !isTag(index[indexPos].tag, TAG_DIFF_FRAME)) {
+		++indexPos;
+	}
+	if (indexPos == index.size()) return false;
+
+	const auto& videoEntry = index[indexPos++];
+	readChunk(videoEntry);
+	auto dst = as_byte_span(std::span{work});
+	auto size = LZ4::decompressSafe(input.data(), std::bit_cast<uint8_t*>(dst.data()),
+	                                narrow<int>(input.size()), narrow<int>(dst.size()));
+	if (size != narrow<int>(dst.size())) {
+		throw MSXException("Corrupt video frame.");
+	}
+	if (isTag(videoEntry.tag, TAG_KEY_FRAME)) {
+		for (auto i : xrange(frame.size())) frame[i] = work[i];
+	} else {
+		for (auto i : xrange(frame.size())) frame[i] ^= work[i];
+	}
+
+	audio.clear();
+	while ((indexPos < index.size()) && isTag(index[indexPos].tag, TAG_AUDIO)) {
+		const auto& audioEntry = index[indexPos++];
+		readChunk(audioEntry);
+		auto samples = input.size() / sizeof(Endian::L16);
+		auto s = audio.size();
+		audio.resize(s + samples);
+		for (auto i : xrange(samples)) {
+			audio[s + i] = int16_t(Endian::read_UA_L16(&input[2 * i]));
+		}
+	}
+	return true;
+}
+
+} // namespace openmsx
@@ -0,0 +1,73 @@
+#ifndef LZ4VIDEOREADER_HH
+#define LZ4VIDEOREADER_HH
+
+#include "LZ4VideoFormat.hh"
+
+#include "File.hh"
+#include "MemBuffer.hh"
+
+#include "aligned.hh"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+/** Reads back files written by LZ4VideoWriter, one frame at a time.
+  * This is used to convert such a recording to a regular avi file.
+  */
+class LZ4VideoReader
+{
+public:
+	using Pixel = uint32_t;
+
+	/** @throws MSXException when the file can't be opened or isn't a
+	  *         valid recording.
+	  */
+	explicit LZ4VideoReader(const std::string& filename);
+
+	[[nodiscard]] unsigned getWidth()     const { return width; }
+	[[nodiscard]] unsigned getHeight()    const { return height; }
+	[[nodiscard]] unsigned getChannels()  const { return channels; }
+	[[nodiscard]] unsigned getAudioRate() const { return audioRate; }
+	[[nodiscard]] unsigned getNumFrames() const { return frames; }
+	[[nodiscard]] float getFps() const { return fps; }
+
+	/** Decode the next frame (and the audio that belongs to it).
+	  * @return false when there are no more frames.
+	  * @throws MSXException on read errors or corrupt data.
+	  */
+	bool nextFrame();
+
+	/** The pixels ('width x height') and audio of the most recently
+	  * decoded frame. Only valid till the next call to nextFrame().
+	  */
+	[[nodiscard]] std::span<const Pixel> getPixels() const { return frame; }
+	[[nodiscard]] std::span<const int16_t> getAudio() const { return audio; }
+
+private:
+	void scanChunks(size_t fileSize);
+	void readChunk(const LZ4Video::IndexEntry& entry);
+
+private:
+	File file;
+	std::vector<LZ4Video::IndexEntry> index;
+	MemBuffer<Pixel, SSE_ALIGNMENT> frame;
+	MemBuffer<Endian::L32, SSE_ALIGNMENT> work;
+	MemBuffer<uint8_t> input;
+	std::vector<int16_t> audio;
+	size_t indexPos = 0;
+
+	unsigned width;
+	unsigned height;
+	unsigned channels;
+	unsigned audioRate;
+	unsigned frames;
+	float fps;
+};
+
+} // namespace openmsx
+
+#endif
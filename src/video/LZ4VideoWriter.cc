@@ -0,0 +1,167 @@
+#include "LZ4VideoWriter.hh"
+
+#include "FileOperations.hh"
+#include "FrameSource.hh"
+#include "MSXException.hh"
+
+#include "lz4.hh"
+#include "narrow.hh"
+#include "ranges.hh"
+#include "small_buffer.hh"
+#include "unreachable.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace openmsx {
+
+using namespace LZ4Video;
+
+// Same interval as in AviWriter. Key frames are not strictly needed (we
+// always decode sequentially), but they allow to start decoding in the middle
+// of a recording (the index tells where they are).
+static constexpr unsigned KEY_FRAME_INTERVAL = 300;
+
+LZ4VideoWriter::LZ4VideoWriter(const std::string& filename_, unsigned width_,
+                               unsigned height_, unsigned channels_, unsigned freq_)
+	: file(filename_, "wb")
+	, filename(filename_)
+	, prevFrame(size_t(width_) * height_)
+	, currFrame(size_t(width_) * height_)
+	, work(size_t(width_) * height_)
+	, output(LZ4::compressBound(narrow<int>(width_ * height_ * sizeof(Pixel))))
+	, width(width_)
+	, height(height_)
+	, channels(channels_)
+	, audioRate(freq_)
+{
+	// The header is completed when the recording is finished. Till then
+	// there's no index, see LZ4VideoFormat.hh.
+	writeHeader(0);
+}
+
+LZ4VideoWriter::~LZ4VideoWriter()
+{
+	if (frames == 0) {
+		// no data written yet (a recording less than one video frame)
+		file.close(); // close file (needed for windows?)
+		FileOperations::unlink(filename);
+		return;
+	}
+	assert(fps != 0.0f); // a decent fps should have been set
+
+	try {
+		file.write(std::span{index});
+		writeHeader(written);
+	} catch (MSXException&) {
+		// can't throw from destructor
+	}
+}
+
+void LZ4VideoWriter::setFps(float fps_)
+{
+	fps = fps_;
+	// Also store it in the header right away, so that an interrupted
+	// recording can still be read.
+	try {
+		writeHeader(0);
+		file.seek(narrow<size_t>(written));
+	} catch (MSXException&) {
+		// not fatal, the header is written again at the end
+	}
+}
+
+void LZ4VideoWriter::writeHeader(uint64_t indexOffset)
+{
+	FileHeader header = {};
+	copy_to_range(MAGIC, header.magic); // remaining chars are zero
+	header.indexOffset = indexOffset;
+	header.version = VERSION;
+	header.width = width;
+	header.height = height;
+	header.channels = audioRate ? channels : 0;
+	header.audioRate = audioRate;
+	header.fpsRate = uint32_t(1000000 * fps);
+	if (indexOffset) {
+		header.frames = frames;
+		header.audioSamples = audioWritten;
+		header.indexCount = narrow<uint32_t>(index.size());
+	}
+
+	file.seek(0);
+	file.write(std::span{&header, 1});
+}
+
+void LZ4VideoWriter::addChunk(std::string_view tag, std::span<const uint8_t> data)
+{
+	auto size32 = narrow<uint32_t>(data.size());
+
+	ChunkHeader chunk;
+	copy_to_range(tag, chunk.tag);
+	chunk.size = size32;
+	file.write(std::span{&chunk, 1});
+	file.write(data);
+
+	IndexEntry entry;
+	copy_to_range(tag, entry.tag);
+	entry.size = size32;
+	entry.offset = written + sizeof(ChunkHeader);
+	index.push_back(entry);
+
+	written += sizeof(ChunkHeader) + size32;
+}
+
+std::span<const LZ4VideoWriter::Pixel> LZ4VideoWriter::getScaledLine(
+	const FrameSource* frame, unsigned y, std::span<Pixel> workBuf) const
+{
+	switch (height) {
+	case 240:
+		return frame->getLinePtr320_240(y, workBuf.first<320>());
+	case 480:
+		return frame->getLinePtr640_480(y, workBuf.first<640>());
+	case 720:
+		return frame->getLinePtr960_720(y, workBuf.first<960>());
+	default:
+		UNREACHABLE;
+	}
+}
+
+void LZ4VideoWriter::addFrame(const FrameSource* video, std::span<const int16_t> audio)
+{
+	std::swap(prevFrame, currFrame);
+	for (auto y : xrange(height)) {
+		auto dest = std::span{currFrame}.subspan(y * size_t(width), width);
+		auto line = getScaledLine(video, y, dest);
+		if (line.data() != dest.data()) copy_to_range(line, dest);
+	}
+
+	// Either store the full frame or the difference with the previous
+	// frame. Also convert to little endian at the same time.
+	bool keyFrame = (frames++ % KEY_FRAME_INTERVAL) == 0;
+	auto num = currFrame.size();
+	if (keyFrame) {
+		for (auto i : xrange(num)) work[i] = currFrame[i];
+	} else {
+		for (auto i : xrange(num)) work[i] = currFrame[i] ^ prevFrame[i];
+	}
+	auto src = as_byte_span(std::span{work});
+	auto compressed = LZ4::compress(src.data(), output.data(), narrow<int>(src.size()));
+	addChunk(keyFrame ? TAG_KEY_FRAME : TAG_DIFF_FRAME,
+	         std::span{output}.first(compressed));
+
+	if (!audio.empty()) {
+		assert((audio.size() % channels) == 0);
+		assert(audioRate != 0);
+		if constexpr (Endian::BIG) {
+			small_buffer<Endian::L16, 4096> buf(audio);
+			addChunk(TAG_AUDIO, as_byte_span(std::span{buf}));
+		} else {
+			addChunk(TAG_AUDIO, as_byte_span(audio));
+		}
+		audioWritten += narrow<uint32_t>(audio.size());
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,71 @@
+#ifndef LZ4VIDEOWRITER_HH
+#define LZ4VIDEOWRITER_HH
+
+#include "LZ4VideoFormat.hh"
+
+#include "File.hh"
+#include "MemBuffer.hh"
+
+#include "aligned.hh"
+#include "endian.hh"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace openmsx {
+
+class FrameSource;
+
+/** Writes video (and audio) in the openMSX lossless fast format, see
+  * LZ4VideoFormat.hh for details. Compared to AviWriter (ZMBV) this trades
+  * file size for a much lower recording overhead: there's no motion
+  * search, and LZ4 is a lot faster than zlib.
+  */
+class LZ4VideoWriter
+{
+public:
+	using Pixel = uint32_t;
+
+	LZ4VideoWriter(const std::string& filename, unsigned width, unsigned height,
+	               unsigned channels, unsigned freq);
+	LZ4VideoWriter(const LZ4VideoWriter&) = delete;
+	LZ4VideoWriter(LZ4VideoWriter&&) = delete;
+	LZ4VideoWriter& operator=(const LZ4VideoWriter&) = delete;
+	LZ4VideoWriter& operator=(LZ4VideoWriter&&) = delete;
+	~LZ4VideoWriter();
+
+	void addFrame(const FrameSource* video, std::span<const int16_t> audio);
+	void setFps(float fps);
+
+private:
+	void writeHeader(uint64_t indexOffset);
+	void addChunk(std::string_view tag, std::span<const uint8_t> data);
+	[[nodiscard]] std::span<const Pixel> getScaledLine(
+		const FrameSource* frame, unsigned y, std::span<Pixel> workBuf) const;
+
+private:
+	File file;
+	std::string filename;
+	MemBuffer<Pixel, SSE_ALIGNMENT> prevFrame;
+	MemBuffer<Pixel, SSE_ALIGNMENT> currFrame;
+	MemBuffer<Endian::L32, SSE_ALIGNMENT> work;
+	MemBuffer<uint8_t> output;
+	std::vector<LZ4Video::IndexEntry> index;
+
+	float fps = 0.0f; // will be filled in later
+	const uint32_t width;
+	const uint32_t height;
+	const uint32_t channels;
+	const uint32_t audioRate;
+
+	uint32_t frames = 0;
+	uint32_t audioWritten = 0;
+	uint64_t written = sizeof(LZ4Video::FileHeader);
+};
+
+} // namespace openmsx
+
+#endif
@@ -24,9 +24,10 @@ OffScreenSurface::OffScreenSurface(const OutputSurface& output)
 	fbo.push();
 }
 
-void OffScreenSurface::saveScreenshot(const std::string& filename)
+void OffScreenSurface::saveScreenshot(
+	ScreenShotQueue& queue, const std::string& filename, bool async)
 {
-	VisibleSurface::saveScreenshotGL(*this, filename);
+	VisibleSurface::saveScreenshotGL(*this, queue, filename, async);
 }
 
 } // namespace openmsx
@@ -16,7 +16,8 @@ public:
 
 private:
 	// OutputSurface
-	void saveScreenshot(const std::string& filename) override;
+	void saveScreenshot(ScreenShotQueue& queue,
+	                    const std::string& filename, bool async) override;
 
 private:
 	gl::Texture fboTex;
@@ -10,6 +10,8 @@
 
 namespace openmsx {
 
+class ScreenShotQueue;
+
 /** A frame buffer where pixels can be written to.
   * It could be an in-memory buffer or a video buffer visible to the user
   * (see *OffScreenSurface and *VisibleSurface classes).
@@ -63,9 +65,12 @@ public:
 	}
 
 	/** Save the content of this OutputSurface to a PNG file.
+	  * The pixels are read immediately, with 'async' the PNG encoding
+	  * happens in the background.
 	  * @throws MSXException If creating the PNG file fails.
 	  */
-	virtual void saveScreenshot(const std::string& filename) = 0;
+	virtual void saveScreenshot(ScreenShotQueue& queue,
+	                            const std::string& filename, bool async) = 0;
 
 protected:
 	OutputSurface() = default;
@@ -232,8 +232,15 @@ static void flushData(png_structp ctx)
 	file->flush();
 }
 
+enum class Format : uint8_t {
+	GRAY,  // 8-bit grayscale
+	RGB,   // packed 24-bit RGB
+	PIXEL, // 32-bit openMSX pixels (see PixelOperations), alpha is dropped
+};
+
 static void IMG_SavePNG_RW(size_t width, std::span<const void*> rowPointers,
-                           const std::string& filename, bool color)
+                           const std::string& filename, Format format,
+                           int compressionLevel)
 {
 	auto height = rowPointers.size();
 	assert(width  <= std::numeric_limits<png_uint_32>::max());
@@ -258,6 +265,9 @@ static void IMG_SavePNG_RW(size_t width, std::span<const void*> rowPointers,
 
 		// Set up the output control.
 		png_set_write_fn(png.ptr, &file, writeData, flushData);
+		if (compressionLevel >= 0) {
+			png_set_compression_level(png.ptr, compressionLevel);
+		}
 
 		// Mark this image as being generated by openMSX and add creation time.
 		auto version = Version::full();
@@ -276,11 +286,18 @@ static void IMG_SavePNG_RW(size_t width, std::span<const void*> rowPointers,
 		// some extra buffer space.
 		static constexpr size_t size = (10 + 1 + 8 + 1) + 44;
 		time_t now = time(nullptr);
-		const struct tm* tm = localtime(&now);
+		// This runs on the ScreenShotQueue worker threads, so use the
+		// reentrant version of localtime().
+		struct tm tm = {};
+#ifdef _WIN32
+		localtime_s(&tm, &now);
+#else
+		localtime_r(&now, &tm);
+#endif
 		std::array<char, size> timeStr;
 		snprintf(timeStr.data(), sizeof(timeStr), "%04d-%02d-%02d %02d:%02d:%02d",
-		         1900 + tm->tm_year, tm->tm_mon + 1, tm->tm_mday,
-		         tm->tm_hour, tm->tm_min, tm->tm_sec);
+		         1900 + tm.tm_year, tm.tm_mon + 1, tm.tm_mday,
+		         tm.tm_hour, tm.tm_min, tm.tm_sec);
 		text[1].text = timeStr.data();
 
 		png_set_text(png.ptr, png.info, text.data(), narrow<int>(text.size()));
@@ -288,13 +305,25 @@ static void IMG_SavePNG_RW(size_t width, std::span<const void*> rowPointers,
 		png_set_IHDR(png.ptr, png.info,
 		             narrow<png_uint_32>(width), narrow<png_uint_32>(height),
 		             8,
-		             color ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_GRAY,
+		             (format == Format::GRAY) ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_RGB,
 		             PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE,
 		             PNG_FILTER_TYPE_BASE);
 
 		// Write the file header information.  REQUIRED
 		png_write_info(png.ptr, png.info);
 
+		if (format == Format::PIXEL) {
+			// Let libpng strip the alpha channel, this avoids an
+			// extra conversion step. In memory a pixel is R,G,B,A
+			// on little endian and A,B,G,R on big endian hosts.
+			if constexpr (Endian::BIG) {
+				png_set_filler(png.ptr, 0, PNG_FILLER_BEFORE);
+				png_set_bgr(png.ptr);
+			} else {
+				png_set_filler(png.ptr, 0, PNG_FILLER_AFTER);
+			}
+		}
+
 		// Write out the entire image data in one call.
 		png_write_image(
 			png.ptr,
@@ -307,44 +336,20 @@ static void IMG_SavePNG_RW(size_t width, std::span<const void*> rowPointers,
 	}
 }
 
-static void save(SDL_Surface* image, const std::string& filename)
-{
-	SDLAllocFormatPtr frmt24(SDL_AllocFormat(
-		Endian::BIG ? SDL_PIXELFORMAT_BGR24 : SDL_PIXELFORMAT_RGB24));
-	SDLSurfacePtr surf24(SDL_ConvertSurface(image, frmt24.get(), 0));
-
-	// Create the array of pointers to image data
-	small_buffer<const void*, 1080> rowPointers(std::views::transform(xrange(image->h),
-		[&](auto y) { return surf24.getLinePtr(y); }));
-
-	IMG_SavePNG_RW(image->w, rowPointers, filename, true);
-}
-
-void saveRGBA(size_t width, std::span<const uint32_t*> rowPointers,
-              const std::string& filename)
+void saveRGBA(size_t width, std::span<const uint32_t*> rowPointers_,
+              const std::string& filename, int compressionLevel)
 {
-	// this implementation creates 1 extra copy, can be optimized if required
-	auto height = narrow<unsigned>(rowPointers.size());
-	static constexpr int bpp = 32;
-	PixelOperations pixelOps;
-	SDLSurfacePtr surface(
-		narrow<unsigned>(width), height, bpp,
-		pixelOps.getRmask(), pixelOps.getGmask(),
-		pixelOps.getBmask(), pixelOps.getAmask());
-	for (auto y : xrange(height)) {
-		memcpy(surface.getLinePtr(y),
-		       rowPointers[y], width * sizeof(uint32_t));
-	}
-	save(surface.get(), filename);
+	std::span rowPointers{std::bit_cast<const void**>(rowPointers_.data()),
+	                      rowPointers_.size()};
+	IMG_SavePNG_RW(width, rowPointers, filename, Format::PIXEL, compressionLevel);
 }
 
-
 void saveRGB(size_t width, std::span<const uint8_t*> rowPointers,
 	     const std::string& filename)
 {
 	// Each row is width*3 bytes (packed RGB)
 	std::span rowPtrs{std::bit_cast<const void**>(rowPointers.data()), rowPointers.size()};
-	IMG_SavePNG_RW(width, rowPtrs, filename, true);
+	IMG_SavePNG_RW(width, rowPtrs, filename, Format::RGB, -1);
 }
 
 void saveGrayscale(size_t width, std::span<const uint8_t*> rowPointers_,
@@ -352,7 +357,7 @@ void saveGrayscale(size_t width, std::span<const uint8_t*> rowPointers_,
 {
 	std::span rowPointers{std::bit_cast<const void**>(rowPointers_.data()),
 	                      rowPointers_.size()};
-	IMG_SavePNG_RW(width, rowPointers, filename, false);
+	IMG_SavePNG_RW(width, rowPointers, filename, Format::GRAY, -1);
 }
 
 } // namespace openmsx::PNG
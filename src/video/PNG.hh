@@ -18,8 +18,15 @@ namespace openmsx::PNG {
 	 */
 	[[nodiscard]] SDLSurfacePtr load(const std::string& filename, bool want32bpp);
 
+	/** Save a buffer of openMSX pixels (see PixelOperations) as a 24bpp
+	 * PNG file (the alpha channel is dropped).
+	 * This function doesn't use SDL, so it's safe to call it from a
+	 * worker thread.
+	 * @param compressionLevel zlib compression level [0..9], or -1 for
+	 *                         the default level.
+	 */
 	void saveRGBA(size_t width, std::span<const uint32_t*> rowPointers,
-	              const std::string& filename);
+	              const std::string& filename, int compressionLevel = -1);
 	/** Save an RGB (24bpp) buffer as a PNG file. Each row is width*3 bytes. */
 	void saveRGB(size_t width, std::span<const uint8_t*> rowPointers,
 	       const std::string& filename);
@@ -258,10 +258,19 @@ void PixelRenderer::frameEnd(EmuTime time)
 	}
 	if (vdp.getMotherBoard().isActive() &&
 	    !vdp.getMotherBoard().isFastForwarding()) {
-		eventDistributor.distributeEvent(FinishFrameEvent(
-			rasterizer->getPostProcessor()->getVideoSource(),
-			videoSourceSetting.getSource(),
-			!paintFrame));
+		if (const auto* postProcessor = rasterizer->getPostProcessor()) {
+			eventDistributor.distributeEvent(FinishFrameEvent(
+				postProcessor->getVideoSource(),
+				videoSourceSetting.getSource(),
+				!paintFrame));
+		} else {
+			// Headless rasterizer: nothing gets displayed, but
+			// still signal the end of the frame (e.g. for the
+			// 'after frame' command).
+			auto source = videoSourceSetting.getSource();
+			eventDistributor.distributeEvent(FinishFrameEvent(
+				source, source, true));
+		}
 	}
 }
 
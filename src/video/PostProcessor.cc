@@ -15,10 +15,10 @@
 #include "GLScalerFactory.hh"
 #include "MSXMotherBoard.hh"
 #include "OutputSurface.hh"
-#include "PNG.hh"
 #include "RawFrame.hh"
 #include "Reactor.hh"
 #include "RenderSettings.hh"
+#include "ScreenShotQueue.hh"
 #include "SuperImposedFrame.hh"
 #include "gl_transform.hh"
 
@@ -159,7 +159,8 @@ static void getScaledFrame(const FrameSource& paintFrame,
 	}
 }
 
-void PostProcessor::takeRawScreenShot(std::optional<unsigned> desiredHeight, const std::string& filename)
+void PostProcessor::takeRawScreenShot(std::optional<unsigned> desiredHeight, const std::string& filename,
+                                      bool async)
 {
 	if (!paintFrame) {
 		throw CommandException("TODO");
@@ -176,7 +177,7 @@ void PostProcessor::takeRawScreenShot(std::optional<unsigned> desiredHeight, con
 	WorkBuffer workBuffer;
 	getScaledFrame(*paintFrame, lines, workBuffer);
 	unsigned width = (targetHeight == 240) ? 320 : 640;
-	PNG::saveRGBA(width, lines, filename);
+	display.getScreenShotQueue().save(width, lines, filename, async);
 }
 
 void PostProcessor::createRegions()
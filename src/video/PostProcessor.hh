@@ -100,7 +100,8 @@ public:
 	}
 
 	// VideoLayer
-	void takeRawScreenShot(std::optional<unsigned> height, const std::string& filename) override;
+	void takeRawScreenShot(std::optional<unsigned> height, const std::string& filename,
+	                       bool async) override;
 
 	[[nodiscard]] CliComm& getCliComm();
 
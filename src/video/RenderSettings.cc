@@ -36,6 +36,7 @@ EnumSetting<RenderSettings::RendererID>::Map RenderSettings::getRendererMap()
 	EnumSetting<RendererID>::Map rendererMap = {
 		{"uninitialized", UNINITIALIZED},
 		{"none",          DUMMY},
+		{"headless",      HEADLESS},
 		{"SDLGL-PP",      SDLGL_PP}
 	};
 	return rendererMap;
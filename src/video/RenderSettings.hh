@@ -28,7 +28,7 @@ public:
 	/** Enumeration of Renderers known to openMSX.
 	  * This is the full list, the list of available renderers may be smaller.
 	  */
-	enum class RendererID : uint8_t { UNINITIALIZED, DUMMY, SDLGL_PP };
+	enum class RendererID : uint8_t { UNINITIALIZED, DUMMY, HEADLESS, SDLGL_PP };
 	using RendererSetting = EnumSetting<RendererID>;
 
 	/** Render accuracy: granularity of the rendered area.
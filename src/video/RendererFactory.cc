@@ -3,6 +3,7 @@
 #include "Display.hh"
 #include "DummyRenderer.hh"
 #include "DummyVideoSystem.hh"
+#include "HeadlessVideoSystem.hh"
 #include "PixelRenderer.hh"
 #include "SDLVideoSystem.hh"
 #include "V9990DummyRenderer.hh"
@@ -27,6 +28,8 @@ std::unique_ptr<VideoSystem> createVideoSystem(Reactor& reactor)
 	switch (display.getRenderer()) {
 		case RenderSettings::RendererID::DUMMY:
 			return std::make_unique<DummyVideoSystem>();
+		case RenderSettings::RendererID::HEADLESS:
+			return std::make_unique<HeadlessVideoSystem>(display);
 		case RenderSettings::RendererID::SDLGL_PP:
 			return std::make_unique<SDLVideoSystem>(reactor);
 		default:
@@ -39,6 +42,7 @@ std::unique_ptr<Renderer> createRenderer(VDP& vdp, Display& display)
 	switch (display.getRenderer()) {
 		case RenderSettings::RendererID::DUMMY:
 			return std::make_unique<DummyRenderer>();
+		case RenderSettings::RendererID::HEADLESS:
 		case RenderSettings::RendererID::SDLGL_PP:
 			return std::make_unique<PixelRenderer>(vdp, display);
 		default:
@@ -50,6 +54,7 @@ std::unique_ptr<V9990Renderer> createV9990Renderer(V9990& vdp, Display& display)
 {
 	switch (display.getRenderer()) {
 		case RenderSettings::RendererID::DUMMY:
+		case RenderSettings::RendererID::HEADLESS: // not (yet) supported
 			return std::make_unique<V9990DummyRenderer>();
 		case RenderSettings::RendererID::SDLGL_PP:
 			return std::make_unique<V9990PixelRenderer>(vdp);
@@ -63,6 +68,7 @@ std::unique_ptr<LDRenderer> createLDRenderer(LaserdiscPlayer& ld, Display& displ
 {
 	switch (display.getRenderer()) {
 		case RenderSettings::RendererID::DUMMY:
+		case RenderSettings::RendererID::HEADLESS: // not (yet) supported
 			return std::make_unique<LDDummyRenderer>();
 		case RenderSettings::RendererID::SDLGL_PP:
 			return std::make_unique<LDPixelRenderer>(ld, display);
@@ -140,12 +140,12 @@ const RawFrame* SDLRasterizer::getWorkingFrame() const
 
 const RawFrame* SDLRasterizer::getLastFrame() const
 {
-	return postProcessor->getLastRawFrame();
+	return postProcessor ? postProcessor->getLastRawFrame() : nullptr;
 }
 
 bool SDLRasterizer::isActive()
 {
-	return postProcessor->needRender() &&
+	return postProcessor && postProcessor->needRender() &&
 	       vdp.getMotherBoard().isActive() &&
 	       !vdp.getMotherBoard().isFastForwarding();
 }
@@ -171,14 +171,18 @@ void SDLRasterizer::resetPalette()
 
 void SDLRasterizer::setSuperimposeVideoFrame(const RawFrame* videoSource)
 {
-	postProcessor->setSuperimposeVideoFrame(videoSource);
+	if (postProcessor) postProcessor->setSuperimposeVideoFrame(videoSource);
 	precalcColorIndex0(vdp.getDisplayMode(), vdp.getTransparency(),
 	                   videoSource, vdp.getBackgroundColor());
 }
 
 void SDLRasterizer::frameStart(EmuTime time)
 {
-	workFrame = postProcessor->rotateFrames(std::move(workFrame), time);
+	if (postProcessor) {
+		workFrame = postProcessor->rotateFrames(std::move(workFrame), time);
+	}
+	// else (headless): keep rendering into the same frame, our owner
+	// grabs its content in between frameEnd() and the next frameStart()
 	workFrame->init(
 	    vdp.isInterlaced() ? (vdp.getEvenOdd() ? FrameSource::FieldType::ODD
 	                                           : FrameSource::FieldType::EVEN)
@@ -632,7 +636,7 @@ void SDLRasterizer::drawSprites(
 
 bool SDLRasterizer::isRecording() const
 {
-	return postProcessor->isRecording();
+	return postProcessor && postProcessor->isRecording();
 }
 
 void SDLRasterizer::update(const Setting& setting) noexcept
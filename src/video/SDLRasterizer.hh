@@ -32,6 +32,9 @@ class SDLRasterizer final : public Rasterizer
 public:
 	using Pixel = uint32_t;
 
+	/** The post processor may be nullptr, then frames are rendered but
+	  * not displayed (see HeadlessRasterizer).
+	  */
 	SDLRasterizer(
 		VDP& vdp, Display& display, OutputSurface& screen,
 		std::unique_ptr<PostProcessor> postProcessor);
@@ -108,7 +111,7 @@ private:
 	OutputSurface& screen;
 
 	/** The video post processor which displays the frames produced by this
-	  *  rasterizer.
+	  *  rasterizer. Can be nullptr (headless rendering).
 	  */
 	const std::unique_ptr<PostProcessor> postProcessor;
 
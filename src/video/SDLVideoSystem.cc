@@ -108,11 +108,13 @@ void SDLVideoSystem::flush()
 	screen->finish();
 }
 
-void SDLVideoSystem::takeScreenShot(const std::string& filename, bool withOsd)
+void SDLVideoSystem::takeScreenShot(const std::string& filename, bool withOsd,
+                                    bool async)
 {
+	auto& queue = display.getScreenShotQueue();
 	if (withOsd) {
 		// we can directly save current content as screenshot
-		screen->saveScreenshot(filename);
+		screen->saveScreenshot(queue, filename, async);
 	} else {
 		// we first need to re-render to an off-screen surface
 		// with OSD layers disabled
@@ -120,7 +122,7 @@ void SDLVideoSystem::takeScreenShot(const std::string& filename, bool withOsd)
 		ScopedLayerHider hideImgui(*imGuiLayer);
 		std::unique_ptr<OutputSurface> surf = screen->createOffScreenSurface();
 		display.repaintImpl(*surf);
-		surf->saveScreenshot(filename);
+		surf->saveScreenshot(queue, filename, async);
 	}
 }
 
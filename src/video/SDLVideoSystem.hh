@@ -43,7 +43,8 @@ public:
 		LaserdiscPlayer& ld) override;
 #endif
 	void flush() override;
-	void takeScreenShot(const std::string& filename, bool withOsd) override;
+	void takeScreenShot(const std::string& filename, bool withOsd,
+	                    bool async) override;
 	void updateWindowTitle() override;
 	[[nodiscard]] std::optional<gl::ivec2> getMouseCoord() override;
 	[[nodiscard]] OutputSurface* getOutputSurface() override;
@@ -0,0 +1,153 @@
+#include "ScreenShotQueue.hh"
+
+#include "CliComm.hh"
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "PNG.hh"
+
+#include "ranges.hh"
+#include "small_buffer.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <ranges>
+#include <utility>
+
+namespace openmsx {
+
+// Limit the memory used by queued images (and the amount of work that's
+// still pending when openMSX exits).
+static constexpr size_t MAX_WORKERS = 4;
+static constexpr size_t MAX_QUEUED = 2 * MAX_WORKERS;
+
+ScreenShotQueue::ScreenShotQueue(
+		CommandController& commandController, CliComm& cliComm_)
+	: cliComm(cliComm_)
+	, compressionSetting(commandController, "screenshot_compression",
+		"zlib compression level for screenshots: 0 (fastest, no "
+		"compression) till 9 (slowest, smallest files)", 6, 0, 9)
+{
+}
+
+ScreenShotQueue::~ScreenShotQueue()
+{
+	flush();
+	{
+		std::scoped_lock lock(mutex);
+		stop = true;
+	}
+	workAvailable.notify_all();
+	for (auto& t : workers) t.join();
+}
+
+void ScreenShotQueue::save(size_t width, std::span<const uint32_t*> rowPointers,
+                           const std::string& filename, bool async)
+{
+	reportErrors();
+	int level = compressionSetting.getInt();
+	if (!async) {
+		PNG::saveRGBA(width, rowPointers, filename, level);
+		return;
+	}
+
+	auto height = rowPointers.size();
+	auto size = width * height;
+	std::unique_lock lock(mutex);
+	jobDone.wait(lock, [&] { return (jobs.size() + busy) < MAX_QUEUED; });
+	MemBuffer<uint32_t> buffer;
+	if (!freeBuffers.empty()) {
+		// prefer a buffer that already has the correct size
+		auto it = std::ranges::find(freeBuffers, size, &MemBuffer<uint32_t>::size);
+		if (it == freeBuffers.end()) it = freeBuffers.begin();
+		buffer = std::move(*it);
+		freeBuffers.erase(it);
+	}
+	lock.unlock();
+
+	// copy without holding the lock
+	buffer.resize(size);
+	for (auto y : xrange(height)) {
+		copy_to_range(std::span{rowPointers[y], width},
+		              std::span{buffer}.subspan(y * width, width));
+	}
+
+	lock.lock();
+	if (workers.empty()) startWorkers();
+	jobs.push_back(Job{std::move(buffer), width, height, filename, level});
+	lock.unlock();
+	workAvailable.notify_one();
+}
+
+void ScreenShotQueue::flush()
+{
+	{
+		std::unique_lock lock(mutex);
+		jobDone.wait(lock, [&] { return jobs.empty() && (busy == 0); });
+	}
+	reportErrors();
+}
+
+std::string ScreenShotQueue::reserveNumberedFileName(
+	std::string_view directory, std::string_view prefix, std::string_view extension)
+{
+	// Retry in case another process creates the same file in between.
+	for (int retries = 10; retries > 0; --retries) {
+		auto filename = FileOperations::getNextNumberedFileName(directory, prefix, extension);
+		if (FileOperations::openFile(filename, "wbx")) return filename;
+	}
+	throw MSXException("Couldn't create a new file in ",
+	                   FileOperations::getUserOpenMSXDir(directory));
+}
+
+void ScreenShotQueue::startWorkers()
+{
+	// called with the mutex locked
+	auto num = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, MAX_WORKERS);
+	workers.reserve(num);
+	repeat(num, [&] {
+		workers.emplace_back([this] { workerLoop(); });
+	});
+}
+
+void ScreenShotQueue::workerLoop()
+{
+	std::unique_lock lock(mutex);
+	while (true) {
+		workAvailable.wait(lock, [&] { return stop || !jobs.empty(); });
+		if (jobs.empty()) return; // only when stopping
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		++busy;
+		lock.unlock();
+
+		std::string error;
+		try {
+			small_buffer<const uint32_t*, 1080> rows(std::views::transform(xrange(job.height),
+				[&](auto y) { return &job.pixels[y * job.width]; }));
+			PNG::saveRGBA(job.width, rows, job.filename, job.compressionLevel);
+		} catch (MSXException& e) {
+			error = e.getMessage();
+		}
+
+		lock.lock();
+		if (!error.empty()) errors.push_back(std::move(error));
+		freeBuffers.push_back(std::move(job.pixels));
+		--busy;
+		jobDone.notify_all();
+	}
+}
+
+void ScreenShotQueue::reportErrors()
+{
+	// CliComm may only be used from the main thread
+	std::vector<std::string> tmp;
+	{
+		std::scoped_lock lock(mutex);
+		std::swap(tmp, errors);
+	}
+	for (const auto& e : tmp) {
+		cliComm.printWarning("Failed to take screenshot: ", e);
+	}
+}
+
+} // namespace openmsx
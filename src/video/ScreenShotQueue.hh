@@ -0,0 +1,92 @@
+#ifndef SCREENSHOTQUEUE_HH
+#define SCREENSHOTQUEUE_HH
+
+#include "IntegerSetting.hh"
+
+#include "MemBuffer.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace openmsx {
+
+class CliComm;
+class CommandController;
+
+/** Writes screenshots to PNG files, either synchronously or via a queue
+  * that's serviced by worker threads.
+  *
+  * In the asynchronous case the image is first copied into a (pooled)
+  * buffer, so the caller can immediately continue (e.g. with emulating the
+  * next frame), while zlib compression happens in the background. The
+  * number of queued images is limited: when the workers can't keep up, the
+  * caller blocks till there's room again.
+  */
+class ScreenShotQueue
+{
+public:
+	ScreenShotQueue(CommandController& commandController, CliComm& cliComm);
+	ScreenShotQueue(const ScreenShotQueue&) = delete;
+	ScreenShotQueue(ScreenShotQueue&&) = delete;
+	ScreenShotQueue& operator=(const ScreenShotQueue&) = delete;
+	ScreenShotQueue& operator=(ScreenShotQueue&&) = delete;
+	~ScreenShotQueue();
+
+	/** Save the given image (openMSX pixels, see PixelOperations).
+	  * @throws MSXException when writing fails, but only in synchronous
+	  *         mode. Errors in asynchronous mode are reported as warnings
+	  *         (on the next call to save() or flush()).
+	  */
+	void save(size_t width, std::span<const uint32_t*> rowPointers,
+	          const std::string& filename, bool async);
+
+	/** Wait till all queued screenshots have been written. */
+	void flush();
+
+	/** Like FileOperations::getNextNumberedFileName(), but the name is
+	  * also reserved by (exclusively) creating an empty file. Otherwise
+	  * the next call would return the same name as long as the previous
+	  * screenshot is still in the queue.
+	  */
+	[[nodiscard]] static std::string reserveNumberedFileName(
+		std::string_view directory, std::string_view prefix,
+		std::string_view extension);
+
+private:
+	struct Job {
+		MemBuffer<uint32_t> pixels;
+		size_t width;
+		size_t height;
+		std::string filename;
+		int compressionLevel;
+	};
+
+	void startWorkers();
+	void workerLoop();
+	void reportErrors();
+
+private:
+	CliComm& cliComm;
+	IntegerSetting compressionSetting;
+
+	std::mutex mutex;
+	std::condition_variable workAvailable; // signaled when a job is added or on exit
+	std::condition_variable jobDone;       // signaled when a job is finished
+	std::deque<Job> jobs;                  // waiting to be encoded
+	std::vector<MemBuffer<uint32_t>> freeBuffers; // for reuse
+	std::vector<std::string> errors;       // to be reported in the main thread
+	std::vector<std::thread> workers;      // started on first use
+	size_t busy = 0;                       // number of jobs being encoded
+	bool stop = false;
+};
+
+} // namespace openmsx
+
+#endif
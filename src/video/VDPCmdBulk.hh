@@ -0,0 +1,819 @@
+#ifndef VDPCMDBULK_HH
+#define VDPCMDBULK_HH
+
+#include "VDPAccessSlots.hh"
+#include "VDPCmdModes.hh"
+
+#include "EmuTime.hh"
+
+#include "unreachable.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+/** Helpers for the bulk execution of the VDP block commands (HMMV, HMMM,
+  * YMMM and LMMV).
+  *
+  * Normally VDPCmdEngine executes these commands one VRAM access at a time:
+  * advance to the next access slot, check whether the sync limit is reached
+  * and then read or write a single byte (and notify the VRAM observers).
+  * Within one sync() call nothing can happen in between those accesses (a
+  * CPU VRAM access always first syncs the command engine). So when all
+  * accesses for the remainder of a line happen before the limit and no
+  * observer is interested in the written VRAM range, it's equivalent to
+  * first calculate the timing for that line and then process all its bytes
+  * at once.
+  */
+namespace openmsx::VDPCmdBulk {
+
+using VDPAccessSlots::Delta;
+
+/** Advance the access slot calculator over the 'num' remaining work units
+  * of a line. Each unit consists of N VRAM accesses, 'deltas[i]' is the
+  * minimal distance between access 'i' and the next one. The delta after
+  * the very last access is not applied, instead the caller either applies
+  * the (larger) end-of-line delta or finishes the command.
+  * @return true iff all accesses happen before the limit. Only in that
+  *         case 'calc' is updated, it then points to the last access.
+  */
+template<size_t N>
+[[nodiscard]] inline bool stepLine(
+	VDPAccessSlots::Calculator& calc, unsigned num,
+	const std::array<VDPAccessSlots::Delta, N>& deltas)
+{
+	auto c = calc;
+	for (auto i : xrange(num)) {
+		for (auto j : xrange(N)) {
+			if (c.limitReached()) return false;
+			if ((i == (num - 1)) && (j == (N - 1))) break;
+			c.next(deltas[j]);
+		}
+	}
+	calc = c;
+	return true;
+}
+
+/** A run of consecutive bytes of one line, as it's laid out in VRAM. In the
+  * planar modes (Graphic 6 and 7) the even and odd bytes live in different
+  * VRAM banks, then block 0 holds the 1st, 3rd, 5th, ... byte of the run and
+  * block 1 the 2nd, 4th, ... byte.
+  */
+template<typename T, bool PLANAR>
+struct Line
+{
+	std::array<std::span<T>, PLANAR ? 2 : 1> blocks;
+
+	[[nodiscard]] T& operator[](unsigned i) const {
+		if constexpr (PLANAR) {
+			return blocks[i & 1][i >> 1];
+		} else {
+			return blocks[0][i];
+		}
+	}
+};
+
+/** Get the bytes [first, first + num) of the line that starts at VRAM
+  * address 'lineAddr'.
+  * @param getArea Callback 'std::span<T>(unsigned address, unsigned size)'
+  *                that returns an empty span if that VRAM block cannot be
+  *                accessed directly.
+  * @return The line, or nothing when (part of) it cannot be accessed.
+  */
+template<typename T, bool PLANAR, typename GetArea>
+[[nodiscard]] std::optional<Line<T, PLANAR>> getLine(
+	unsigned lineAddr, unsigned first, unsigned num, GetArea getArea)
+{
+	Line<T, PLANAR> result;
+	if constexpr (PLANAR) {
+		for (auto q : xrange(2u)) {
+			if (num <= q) break;
+			unsigned b = first + q;
+			unsigned size = (num - q + 1) / 2;
+			result.blocks[q] = getArea(((b & 1) << 16) | lineAddr | (b >> 1), size);
+			if (result.blocks[q].empty()) return {};
+		}
+	} else {
+		result.blocks[0] = getArea(lineAddr + first, num);
+		if (result.blocks[0].empty()) return {};
+	}
+	return result;
+}
+
+/** Do (some of) the VRAM blocks of both lines overlap? */
+template<typename T1, typename T2, bool PLANAR>
+[[nodiscard]] bool overlaps(const Line<T1, PLANAR>& x, const Line<T2, PLANAR>& y)
+{
+	return std::ranges::any_of(x.blocks, [&](const auto& a) {
+		return std::ranges::any_of(y.blocks, [&](const auto& b) {
+			return !a.empty() && !b.empty() &&
+			       (a.data() < (b.data() + b.size())) &&
+			       (b.data() < (a.data() + a.size()));
+		});
+	});
+}
+
+/** HMMV: fill all bytes with the same value. */
+template<bool PLANAR>
+void fill(const Line<uint8_t, PLANAR>& dst, uint8_t value)
+{
+	for (const auto& block : dst.blocks) {
+		std::ranges::fill(block, value);
+	}
+}
+
+/** HMMM, YMMM: copy bytes, the lines must not overlap. */
+template<bool PLANAR>
+void copy(const Line<const uint8_t, PLANAR>& src, const Line<uint8_t, PLANAR>& dst)
+{
+	assert(!overlaps(src, dst));
+	for (auto q : xrange(src.blocks.size())) {
+		assert(src.blocks[q].size() == dst.blocks[q].size());
+		std::ranges::copy(src.blocks[q], dst.blocks[q].begin());
+	}
+}
+
+/** LMMV: apply a logical operation with a fixed color to the pixels
+  * [firstPixel, firstPixel + numPixels). 'dst' must start at the byte that
+  * contains 'firstPixel'. Pixels that share a byte with a pixel outside this
+  * range are handled one at a time, like Mode::pset() does. For the other
+  * bytes all pixels in that byte are done at once, IOW the operation is
+  * applied with a duplicated color and an empty mask.
+  * @param op 'uint8_t op(uint8_t dst, uint8_t color, uint8_t mask)'
+  */
+template<unsigned PIXELS_PER_BYTE_SHIFT, uint8_t COLOR_MASK, bool PLANAR, typename Op>
+void logicalFill(const Line<uint8_t, PLANAR>& dst, unsigned firstPixel,
+                 unsigned numPixels, uint8_t color, Op op)
+{
+	constexpr unsigned SHIFT = PIXELS_PER_BYTE_SHIFT;
+	constexpr unsigned PIXELS_PER_BYTE = 1 << SHIFT;
+	constexpr unsigned BITS_PER_PIXEL = 8 >> SHIFT;
+	unsigned firstByte = firstPixel >> SHIFT;
+
+	auto pset = [&](unsigned x) {
+		auto sh = ((~x) & (PIXELS_PER_BYTE - 1)) * BITS_PER_PIXEL;
+		auto& b = dst[(x >> SHIFT) - firstByte];
+		b = op(b, uint8_t(color << sh), uint8_t(~(COLOR_MASK << sh)));
+	};
+
+	unsigned endPixel = firstPixel + numPixels;
+	unsigned fullBegin = (firstPixel + PIXELS_PER_BYTE - 1) >> SHIFT;
+	unsigned fullEnd = endPixel >> SHIFT;
+	if (fullBegin >= fullEnd) {
+		// no byte is completely covered
+		for (auto x : xrange(firstPixel, endPixel)) pset(x);
+		return;
+	}
+	for (auto x : xrange(firstPixel, fullBegin << SHIFT)) pset(x);
+
+	auto all = uint8_t(color * (0xFF / COLOR_MASK));
+	unsigned lo = fullBegin - firstByte;
+	unsigned hi = fullEnd   - firstByte;
+	auto step = unsigned(dst.blocks.size());
+	for (auto q : xrange(step)) {
+		unsigned b = (lo + step - 1 - q) / step;
+		unsigned e = (hi + step - 1 - q) / step;
+		for (auto& v : dst.blocks[q].subspan(b, e - b)) {
+			v = op(v, all, 0);
+		}
+	}
+
+	for (auto x : xrange(fullEnd << SHIFT, endPixel)) pset(x);
+}
+
+/** The index (within the line) of the first byte of a run of 'num' bytes
+  * that starts at x-coordinate 'x' and goes in direction 'tx'.
+  */
+template<typename Mode>
+[[nodiscard]] unsigned firstBulkByte(unsigned x, unsigned num, int tx)
+{
+	unsigned b = (x & (Mode::PIXELS_PER_LINE - 1)) >> Mode::PIXELS_PER_BYTE_SHIFT;
+	return (tx < 0) ? (b + 1 - num) : b;
+}
+
+/** Direct access to the bytes [firstByte, firstByte + numBytes) of line 'y'.
+  * Use 'T = const uint8_t' for a source line, 'T = uint8_t' for a
+  * destination line.
+  */
+template<typename Mode, typename T, typename VRAM>
+[[nodiscard]] std::optional<Line<T, Mode::PLANAR>> getBulkLine(
+	VRAM& vram, unsigned y, unsigned firstByte, unsigned numBytes)
+{
+	return getLine<T, Mode::PLANAR>(
+		Mode::addressOf(0, y, false), firstByte, numBytes,
+		[&](unsigned address, unsigned size) {
+			if constexpr (std::is_const_v<T>) {
+				return vram.getCmdReadArea(address, size);
+			} else {
+				return vram.getCmdWriteArea(address, size);
+			}
+		});
+}
+
+/** The block commands that can use the bulk code path. They're templates on
+  * the command engine (normally VDPCmdEngine) so that the unit test can run
+  * exactly this code on a simplified VRAM model. See VDPCmdEngine for the
+  * other commands.
+  */
+struct BlockCommands
+{
+	template<typename Mode, typename Engine> static void startLmmv(Engine& e, EmuTime time);
+	template<typename Mode, typename Engine> static void startHmmv(Engine& e, EmuTime time);
+	template<typename Mode, typename Engine> static void startHmmm(Engine& e, EmuTime time);
+	template<typename Mode, typename Engine> static void startYmmm(Engine& e, EmuTime time);
+
+	template<typename Mode, typename LogOp, typename Engine> static void executeLmmv(Engine& e, EmuTime limit);
+	template<typename Mode,                 typename Engine> static void executeHmmv(Engine& e, EmuTime limit);
+	template<typename Mode,                 typename Engine> static void executeHmmm(Engine& e, EmuTime limit);
+	template<typename Mode,                 typename Engine> static void executeYmmm(Engine& e, EmuTime limit);
+};
+
+template<typename Mode, typename Engine>
+void BlockCommands::startLmmv(Engine& e, EmuTime time)
+{
+	e.vram.cmdReadWindow.disable(time);
+	e.vram.cmdWriteWindow.setMask(0x3FFFF, ~0u << 18, time);
+	e.NY &= 1023;
+	unsigned tmpNX = clipNX_1_pixel<Mode>(e.DX, e.NX, e.ARG);
+	unsigned tmpNY = clipNY_1(e.DY, e.NY, e.ARG);
+	e.ADX = e.DX;
+	e.ANX = tmpNX;
+	e.nextAccessSlot(time);
+	e.calcFinishTime(tmpNX, tmpNY, 72 + 24);
+	e.phase = 0;
+}
+
+template<typename Mode, typename LogOp, typename Engine>
+void BlockCommands::executeLmmv(Engine& e, EmuTime limit)
+{
+	e.NY &= 1023;
+	unsigned tmpNX = clipNX_1_pixel<Mode>(e.DX, e.NX, e.ARG);
+	unsigned tmpNY = clipNY_1(e.DY, e.NY, e.ARG);
+	int TX = (e.ARG & VDPCmdEngine::DIX) ? -1 : 1;
+	int TY = (e.ARG & VDPCmdEngine::DIY) ? -1 : 1;
+	e.ANX = clipNX_1_pixel<Mode>(e.ADX, e.ANX, e.ARG);
+	uint8_t CL = e.COL & Mode::COLOR_MASK;
+	bool dstExt = (e.ARG & VDPCmdEngine::MXD) != 0;
+	bool doPset = !dstExt || e.hasExtendedVRAM;
+	auto calculator = e.getSlotCalculator(limit);
+
+	// Fast path: complete lines at once, see VDPCmdBulk.hh.
+	while ((e.phase == 0) && !dstExt) {
+		auto lineCalc = calculator;
+		if (!stepLine(lineCalc, e.ANX, std::array{Delta::D24, Delta::D72})) break;
+		unsigned x = e.ADX & (Mode::PIXELS_PER_LINE - 1);
+		unsigned firstPixel = (TX < 0) ? (x + 1 - e.ANX) : x;
+		unsigned firstByte = firstPixel >> Mode::PIXELS_PER_BYTE_SHIFT;
+		unsigned lastByte = (firstPixel + e.ANX - 1) >> Mode::PIXELS_PER_BYTE_SHIFT;
+		auto dst = getBulkLine<Mode, uint8_t>(
+			e.vram, e.DY, firstByte, lastByte - firstByte + 1);
+		if (!dst) break;
+		logicalFill<Mode::PIXELS_PER_BYTE_SHIFT, Mode::COLOR_MASK>(
+			*dst, firstPixel, e.ANX, CL,
+			[](uint8_t src, uint8_t color, uint8_t mask) {
+				return LogOp::calc(src, color, mask);
+			});
+		calculator = lineCalc;
+		e.DY += TY; --e.NY;
+		e.ADX = e.DX; e.ANX = tmpNX;
+		if (--tmpNY == 0) {
+			e.commandDone(calculator.getTime());
+			e.engineTime = calculator.getTime();
+			return;
+		}
+		calculator.next(Delta::D136);
+	}
+
+	unsigned addr = Mode::addressOf(e.ADX, e.DY, dstExt);
+	switch (e.phase) {
+	case 0:
+loop:		if (calculator.limitReached()) [[unlikely]] { e.phase = 0; break; }
+		if (doPset) [[likely]] {
+			e.tmpDst = e.vram.cmdWriteWindow.readNP(addr);
+		}
+		calculator.next(Delta::D24);
+		[[fallthrough]];
+	case 1: {
+		if (calculator.limitReached()) [[unlikely]] { e.phase = 1; break; }
+		if (doPset) [[likely]] {
+			Mode::pset(calculator.getTime(), e.vram, e.ADX, addr,
+			           e.tmpDst, CL, LogOp());
+		}
+		e.ADX += TX;
+		Delta delta = Delta::D72;
+		if (--e.ANX == 0) {
+			delta = Delta::D136; // 72 + 64;
+			e.DY += TY; --e.NY;
+			e.ADX = e.DX; e.ANX = tmpNX;
+			if (--tmpNY == 0) {
+				e.commandDone(calculator.getTime());
+				break;
+			}
+		}
+		addr = Mode::addressOf(e.ADX, e.DY, dstExt);
+		calculator.next(delta);
+		goto loop;
+	}
+	default:
+		UNREACHABLE;
+	}
+	e.engineTime = calculator.getTime();
+	e.calcFinishTime(tmpNX, tmpNY, 72 + 24);
+
+	/*
+	if (dstExt) [[unlikely]] {
+		bool doPset = !dstExt || hasExtendedVRAM;
+		while (engineTime < limit) {
+			if (doPset) [[likely]] {
+				Mode::pset(engineTime, vram, ADX, DY,
+					   dstExt, CL, LogOp());
+			}
+			engineTime += delta;
+			ADX += TX;
+			if (--ANX == 0) {
+				DY += TY; --NY;
+				ADX = DX; ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(engineTime);
+					break;
+				}
+			}
+		}
+	} else {
+		// fast-path, no extended VRAM
+		CL = Mode::duplicate(CL);
+		while (engineTime < limit) {
+			typename Mode::IncrPixelAddr dstAddr(ADX, DY, TX);
+			typename Mode::IncrMask      dstMask(ADX, TX);
+			EmuDuration dur = limit - engineTime;
+			unsigned num = (delta != EmuDuration::zero())
+			             ? std::min(dur.divUp(delta), ANX)
+			             : ANX;
+			for (auto i : xrange(num)) {
+				uint8_t mask = dstMask.getMask();
+				psetFast(engineTime, vram, dstAddr.getAddr(),
+					 CL & ~mask, mask, LogOp());
+				engineTime += delta;
+				dstAddr.step(TX);
+				dstMask.step();
+			}
+			ANX -= num;
+			if (ANX == 0) {
+				DY += TY;
+				NY -= 1;
+				ADX = DX;
+				ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(engineTime);
+					break;
+				}
+			} else {
+				ADX += num * TX;
+				assert(engineTime >= limit);
+				break;
+			}
+		}
+	}
+	*/
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::startHmmv(Engine& e, EmuTime time)
+{
+	e.vram.cmdReadWindow.disable(time);
+	e.vram.cmdWriteWindow.setMask(0x3FFFF, ~0u << 18, time);
+	e.NY &= 1023;
+	unsigned tmpNX = clipNX_1_byte<Mode>(e.DX, e.NX, e.ARG);
+	unsigned tmpNY = clipNY_1(e.DY, e.NY, e.ARG);
+	e.ADX = e.DX;
+	e.ANX = tmpNX;
+	e.nextAccessSlot(time);
+	e.calcFinishTime(tmpNX, tmpNY, 48);
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::executeHmmv(Engine& e, EmuTime limit)
+{
+	e.NY &= 1023;
+	unsigned tmpNX = clipNX_1_byte<Mode>(e.DX, e.NX, e.ARG);
+	unsigned tmpNY = clipNY_1(e.DY, e.NY, e.ARG);
+	int TX = (e.ARG & VDPCmdEngine::DIX)
+		? -Mode::PIXELS_PER_BYTE : Mode::PIXELS_PER_BYTE;
+	int TY = (e.ARG & VDPCmdEngine::DIY) ? -1 : 1;
+	e.ANX = clipNX_1_byte<Mode>(
+		e.ADX, e.ANX << Mode::PIXELS_PER_BYTE_SHIFT, e.ARG);
+	bool dstExt = (e.ARG & VDPCmdEngine::MXD) != 0;
+	bool doPset = !dstExt || e.hasExtendedVRAM;
+	auto calculator = e.getSlotCalculator(limit);
+
+	// Fast path: fill complete lines at once, see VDPCmdBulk.hh.
+	while (!dstExt) {
+		auto lineCalc = calculator;
+		if (!stepLine(lineCalc, e.ANX, std::array{Delta::D48})) break;
+		auto dst = getBulkLine<Mode, uint8_t>(
+			e.vram, e.DY, firstBulkByte<Mode>(e.ADX, e.ANX, TX), e.ANX);
+		if (!dst) break;
+		fill(*dst, e.COL);
+		calculator = lineCalc;
+		e.DY += TY; --e.NY;
+		e.ADX = e.DX; e.ANX = tmpNX;
+		if (--tmpNY == 0) {
+			e.commandDone(calculator.getTime());
+			e.engineTime = calculator.getTime();
+			return;
+		}
+		calculator.next(Delta::D104);
+	}
+
+	while (!calculator.limitReached()) {
+		if (doPset) [[likely]] {
+			e.vram.cmdWrite(Mode::addressOf(e.ADX, e.DY, dstExt),
+			                e.COL, calculator.getTime());
+		}
+		e.ADX += TX;
+		Delta delta = Delta::D48;
+		if (--e.ANX == 0) {
+			delta = Delta::D104; // 48 + 56;
+			e.DY += TY; --e.NY;
+			e.ADX = e.DX; e.ANX = tmpNX;
+			if (--tmpNY == 0) {
+				e.commandDone(calculator.getTime());
+				break;
+			}
+		}
+		calculator.next(delta);
+	}
+	e.engineTime = calculator.getTime();
+	e.calcFinishTime(tmpNX, tmpNY, 48);
+
+	/*if (dstExt) [[unlikely]] {
+		bool doPset = !dstExt || hasExtendedVRAM;
+		while (engineTime < limit) {
+			if (doPset) [[likely]] {
+				vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
+					      COL, engineTime);
+			}
+			engineTime += delta;
+			ADX += TX;
+			if (--ANX == 0) {
+				DY += TY; --NY;
+				ADX = DX; ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(engineTime);
+					break;
+				}
+			}
+		}
+	} else {
+		// fast-path, no extended VRAM
+		while (engineTime < limit) {
+			typename Mode::IncrByteAddr dstAddr(ADX, DY, TX);
+			EmuDuration dur = limit - engineTime;
+			unsigned num = (delta != EmuDuration::zero())
+			             ? std::min(dur.divUp(delta), ANX)
+			             : ANX;
+			for (auto i : xrange(num)) {
+				vram.cmdWrite(dstAddr.getAddr(), COL,
+					      engineTime);
+				engineTime += delta;
+				dstAddr.step(TX);
+			}
+			ANX -= num;
+			if (ANX == 0) {
+				DY += TY;
+				NY -= 1;
+				ADX = DX;
+				ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(engineTime);
+					break;
+				}
+			} else {
+				ADX += num * TX;
+				assert(engineTime >= limit);
+				break;
+			}
+		}
+	}
+	*/
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::startHmmm(Engine& e, EmuTime time)
+{
+	e.vram.cmdReadWindow .setMask(0x3FFFF, ~0u << 18, time);
+	e.vram.cmdWriteWindow.setMask(0x3FFFF, ~0u << 18, time);
+	e.NY &= 1023;
+	unsigned tmpNX = clipNX_2_byte<Mode>(e.SX, e.DX, e.NX, e.ARG);
+	unsigned tmpNY = clipNY_2(e.SY, e.DY, e.NY, e.ARG);
+	e.ASX = e.SX;
+	e.ADX = e.DX;
+	e.ANX = tmpNX;
+	e.nextAccessSlot(time);
+	e.calcFinishTime(tmpNX, tmpNY, 24 + 64);
+	e.phase = 0;
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::executeHmmm(Engine& e, EmuTime limit)
+{
+	e.NY &= 1023;
+	unsigned tmpNX = clipNX_2_byte<Mode>(e.SX, e.DX, e.NX, e.ARG);
+	unsigned tmpNY = clipNY_2(e.SY, e.DY, e.NY, e.ARG);
+	int TX = (e.ARG & VDPCmdEngine::DIX)
+	       ? -Mode::PIXELS_PER_BYTE : Mode::PIXELS_PER_BYTE;
+	int TY = (e.ARG & VDPCmdEngine::DIY) ? -1 : 1;
+	e.ANX = clipNX_2_byte<Mode>(
+		e.ASX, e.ADX, e.ANX << Mode::PIXELS_PER_BYTE_SHIFT, e.ARG);
+	bool srcExt  = (e.ARG & VDPCmdEngine::MXS) != 0;
+	bool dstExt  = (e.ARG & VDPCmdEngine::MXD) != 0;
+	bool doPoint = !srcExt || e.hasExtendedVRAM;
+	bool doPset  = !dstExt || e.hasExtendedVRAM;
+	auto calculator = e.getSlotCalculator(limit);
+
+	// Fast path: copy complete lines at once, see VDPCmdBulk.hh.
+	while ((e.phase == 0) && !srcExt && !dstExt) {
+		auto lineCalc = calculator;
+		if (!stepLine(lineCalc, e.ANX, std::array{Delta::D24, Delta::D64})) break;
+		auto src = getBulkLine<Mode, const uint8_t>(
+			e.vram, e.SY, firstBulkByte<Mode>(e.ASX, e.ANX, TX), e.ANX);
+		auto dst = getBulkLine<Mode, uint8_t>(
+			e.vram, e.DY, firstBulkByte<Mode>(e.ADX, e.ANX, TX), e.ANX);
+		// when source and destination overlap, the order matters
+		if (!src || !dst || overlaps(*src, *dst)) break;
+		copy(*src, *dst);
+		calculator = lineCalc;
+		e.SY += TY; e.DY += TY; --e.NY;
+		e.ASX = e.SX; e.ADX = e.DX; e.ANX = tmpNX;
+		if (--tmpNY == 0) {
+			e.commandDone(calculator.getTime());
+			e.engineTime = calculator.getTime();
+			return;
+		}
+		calculator.next(Delta::D128);
+	}
+
+	switch (e.phase) {
+	case 0:
+loop:		if (calculator.limitReached()) [[unlikely]] { e.phase = 0; break; }
+		if (doPoint) [[likely]] {
+			e.tmpSrc = e.vram.cmdReadWindow.readNP(Mode::addressOf(e.ASX, e.SY, srcExt));
+		} else {
+			e.tmpSrc = 0xFF;
+		}
+		calculator.next(Delta::D24);
+		[[fallthrough]];
+	case 1: {
+		if (calculator.limitReached()) [[unlikely]] { e.phase = 1; break; }
+		if (doPset) [[likely]] {
+			e.vram.cmdWrite(Mode::addressOf(e.ADX, e.DY, dstExt),
+			                e.tmpSrc, calculator.getTime());
+		}
+		e.ASX += TX; e.ADX += TX;
+		Delta delta = Delta::D64;
+		if (--e.ANX == 0) {
+			delta = Delta::D128; // 64 + 64
+			e.SY += TY; e.DY += TY; --e.NY;
+			e.ASX = e.SX; e.ADX = e.DX; e.ANX = tmpNX;
+			if (--tmpNY == 0) {
+				e.commandDone(calculator.getTime());
+				break;
+			}
+		}
+		calculator.next(delta);
+		goto loop;
+	}
+	default:
+		UNREACHABLE;
+	}
+	e.engineTime = calculator.getTime();
+	e.calcFinishTime(tmpNX, tmpNY, 24 + 64);
+
+	/*if (srcExt || dstExt) [[unlikely]] {
+		bool doPoint = !srcExt || hasExtendedVRAM;
+		bool doPset  = !dstExt || hasExtendedVRAM;
+		while (engineTime < limit) {
+			if (doPset) [[likely]] {
+				auto p = [&] -> uint8_t {
+					if (doPoint) [[likely]] {
+						return vram.cmdReadWindow.readNP(Mode::addressOf(ASX, SY, srcExt));
+					} else {
+						return 0xFF;
+					}
+				}();
+				vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
+					      p, engineTime);
+			}
+			engineTime += delta;
+			ASX += TX; ADX += TX;
+			if (--ANX == 0) {
+				SY += TY; DY += TY; --NY;
+				ASX = SX; ADX = DX; ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(engineTime);
+					break;
+				}
+			}
+		}
+	} else {
+		// fast-path, no extended VRAM
+		while (engineTime < limit) {
+			typename Mode::IncrByteAddr srcAddr(ASX, SY, TX);
+			typename Mode::IncrByteAddr dstAddr(ADX, DY, TX);
+			EmuDuration dur = limit - engineTime;
+			unsigned num = (delta != EmuDuration::zero())
+			             ? std::min(dur.divUp(delta), ANX)
+			             : ANX;
+			for (auto i : xrange(num)) {
+				uint8_t p = vram.cmdReadWindow.readNP(srcAddr.getAddr());
+				vram.cmdWrite(dstAddr.getAddr(), p, engineTime);
+				engineTime += delta;
+				srcAddr.step(TX);
+				dstAddr.step(TX);
+			}
+			ANX -= num;
+			if (ANX == 0) {
+				SY += TY;
+				DY += TY;
+				NY -= 1;
+				ASX = SX;
+				ADX = DX;
+				ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(engineTime);
+					break;
+				}
+			} else {
+				ASX += num * TX;
+				ADX += num * TX;
+				assert(engineTime >= limit);
+				break;
+			}
+		}
+	}
+	*/
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::startYmmm(Engine& e, EmuTime time)
+{
+	e.vram.cmdReadWindow .setMask(0x3FFFF, ~0u << 18, time);
+	e.vram.cmdWriteWindow.setMask(0x3FFFF, ~0u << 18, time);
+	e.NY &= 1023;
+	unsigned tmpNX = clipNX_1_byte<Mode>(e.DX, 512, e.ARG);
+		// large enough so that it gets clipped
+	unsigned tmpNY = clipNY_2(e.SY, e.DY, e.NY, e.ARG);
+	e.ADX = e.DX;
+	e.ANX = tmpNX;
+	e.nextAccessSlot(time);
+	e.calcFinishTime(tmpNX, tmpNY, 24 + 36);
+	e.phase = 0;
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::executeYmmm(Engine& e, EmuTime limit)
+{
+	e.NY &= 1023;
+	unsigned tmpNX = clipNX_1_byte<Mode>(e.DX, 512, e.ARG);
+		// large enough so that it gets clipped
+	unsigned tmpNY = clipNY_2(e.SY, e.DY, e.NY, e.ARG);
+	int TX = (e.ARG & VDPCmdEngine::DIX)
+		? -Mode::PIXELS_PER_BYTE : Mode::PIXELS_PER_BYTE;
+	int TY = (e.ARG & VDPCmdEngine::DIY) ? -1 : 1;
+	e.ANX = clipNX_1_byte<Mode>(e.ADX, 512, e.ARG);
+
+	// TODO does this use MXD for both read and write?
+	//  it says so in the datasheet, but it seems illogical
+	//  OTOH YMMM also uses DX for both read and write
+	bool dstExt = (e.ARG & VDPCmdEngine::MXD) != 0;
+	bool doPset  = !dstExt || e.hasExtendedVRAM;
+	auto calculator = e.getSlotCalculator(limit);
+
+	// Note: we changed the timing
+	//    from:  40 R 24 W  +0   (see doc/internal/vdp-vram-timing/vdp-timing.html for notation and background info)
+	//    to:    36 R 24 W  +68  (TODO update the above documentation, as it's wrong now)
+	// This is based on:
+	//    https://github.com/openMSX/openMSX/issues/2057   (measurement tools by bengalack)
+	//    https://github.com/sndpl/openMSX/pull/5          (analysis done by Claude (Opus), an AI assistant)
+
+	// Fast path: copy complete lines at once, see VDPCmdBulk.hh.
+	while ((e.phase == 0) && !dstExt) {
+		auto lineCalc = calculator;
+		if (!stepLine(lineCalc, e.ANX, std::array{Delta::D24, Delta::D36})) break;
+		unsigned first = firstBulkByte<Mode>(e.ADX, e.ANX, TX);
+		auto src = getBulkLine<Mode, const uint8_t>(e.vram, e.SY, first, e.ANX);
+		auto dst = getBulkLine<Mode, uint8_t>      (e.vram, e.DY, first, e.ANX);
+		if (!src || !dst || overlaps(*src, *dst)) break;
+		copy(*src, *dst);
+		calculator = lineCalc;
+		e.SY += TY; e.DY += TY; --e.NY;
+		e.ADX = e.DX; e.ANX = tmpNX;
+		if (--tmpNY == 0) {
+			e.commandDone(calculator.getTime());
+			e.engineTime = calculator.getTime();
+			return;
+		}
+		calculator.next(Delta::D104);
+	}
+
+	switch (e.phase) {
+	case 0:
+loop:		if (calculator.limitReached()) [[unlikely]] { e.phase = 0; break; }
+		if (doPset) [[likely]] {
+			e.tmpSrc = e.vram.cmdReadWindow.readNP(
+			           Mode::addressOf(e.ADX, e.SY, dstExt));
+		}
+		calculator.next(Delta::D24);
+		[[fallthrough]];
+	case 1: {
+		if (calculator.limitReached()) [[unlikely]] { e.phase = 1; break; }
+		if (doPset) [[likely]] {
+			e.vram.cmdWrite(Mode::addressOf(e.ADX, e.DY, dstExt),
+			                e.tmpSrc, calculator.getTime());
+		}
+		e.ADX += TX;
+		Delta delta = Delta::D36;
+		if (--e.ANX == 0) {
+			delta = Delta::D104; // 36 + 68
+			e.SY += TY; e.DY += TY; --e.NY;
+			e.ADX = e.DX; e.ANX = tmpNX;
+			if (--tmpNY == 0) {
+				e.commandDone(calculator.getTime());
+				break;
+			}
+		}
+		calculator.next(delta);
+		goto loop;
+	}
+	default:
+		UNREACHABLE;
+	}
+	e.engineTime = calculator.getTime();
+	e.calcFinishTime(tmpNX, tmpNY, 24 + 36);
+
+	/*
+	if (dstExt) [[unlikely]] {
+		bool doPset  = !dstExt || hasExtendedVRAM;
+		while (engineTime < limit) {
+			if (doPset) [[likely]] {
+				uint8_t p = vram.cmdReadWindow.readNP(
+					      Mode::addressOf(ADX, SY, dstExt));
+				vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
+					      p, engineTime);
+			}
+			engineTime += delta;
+			ADX += TX;
+			if (--ANX == 0) {
+				SY += TY; DY += TY; --NY;
+				ADX = DX; ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(engineTime);
+					break;
+				}
+			}
+		}
+	} else {
+		// fast-path, no extended VRAM
+		while (engineTime < limit) {
+			typename Mode::IncrByteAddr srcAddr(ADX, SY, TX);
+			typename Mode::IncrByteAddr dstAddr(ADX, DY, TX);
+			EmuDuration dur = limit - engineTime;
+			unsigned num = (delta != EmuDuration::zero())
+			             ? std::min(dur.divUp(delta), ANX)
+			             : ANX;
+			for (auto i : xrange(num)) {
+				uint8_t p = vram.cmdReadWindow.readNP(srcAddr.getAddr());
+				vram.cmdWrite(dstAddr.getAddr(), p, engineTime);
+				engineTime += delta;
+				srcAddr.step(TX);
+				dstAddr.step(TX);
+			}
+			ANX -= num;
+			if (ANX == 0) {
+				SY += TY;
+				DY += TY;
+				NY -= 1;
+				ADX = DX;
+				ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(engineTime);
+					break;
+				}
+			} else {
+				ADX += num * TX;
+				assert(engineTime >= limit);
+				break;
+			}
+		}
+	}
+	*/
+}
+
+} // namespace openmsx::VDPCmdBulk
+
+#endif
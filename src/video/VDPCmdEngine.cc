@@ -35,6 +35,8 @@ TODO:
 
 #include "VDPCmdEngine.hh"
 
+#include "VDPCmdBulk.hh"
+#include "VDPCmdModes.hh"
 #include "VDPVRAM.hh"
 
 #include "EmuTime.hh"
@@ -52,80 +54,6 @@ namespace openmsx {
 
 using namespace VDPAccessSlots;
 
-template<typename Mode>
-static constexpr unsigned clipNX_1_pixel(unsigned DX, unsigned NX, uint8_t ARG)
-{
-	if (DX >= Mode::PIXELS_PER_LINE) [[unlikely]] {
-		return 1;
-	}
-	NX = NX ? NX : Mode::PIXELS_PER_LINE;
-	return (ARG & VDPCmdEngine::DIX)
-		? std::min(NX, DX + 1)
-		: std::min(NX, Mode::PIXELS_PER_LINE - DX);
-}
-
-template<typename Mode>
-static constexpr unsigned clipNX_1_byte(unsigned DX, unsigned NX, uint8_t ARG)
-{
-	constexpr unsigned BYTES_PER_LINE =
-		Mode::PIXELS_PER_LINE >> Mode::PIXELS_PER_BYTE_SHIFT;
-
-	DX >>= Mode::PIXELS_PER_BYTE_SHIFT;
-	if (BYTES_PER_LINE <= DX) [[unlikely]] {
-		return 1;
-	}
-	NX >>= Mode::PIXELS_PER_BYTE_SHIFT;
-	NX = NX ? NX : BYTES_PER_LINE;
-	return (ARG & VDPCmdEngine::DIX)
-		? std::min(NX, DX + 1)
-		: std::min(NX, BYTES_PER_LINE - DX);
-}
-
-template<typename Mode>
-static constexpr unsigned clipNX_2_pixel(unsigned SX, unsigned DX, unsigned NX, uint8_t ARG)
-{
-	if ((SX >= Mode::PIXELS_PER_LINE) ||
-	    (DX >= Mode::PIXELS_PER_LINE)) [[unlikely]] {
-		return 1;
-	}
-	NX = NX ? NX : Mode::PIXELS_PER_LINE;
-	return (ARG & VDPCmdEngine::DIX)
-		? std::min(NX, std::min(SX, DX) + 1)
-		: std::min(NX, Mode::PIXELS_PER_LINE - std::max(SX, DX));
-}
-
-template<typename Mode>
-static constexpr unsigned clipNX_2_byte(unsigned SX, unsigned DX, unsigned NX, uint8_t ARG)
-{
-	constexpr unsigned BYTES_PER_LINE =
-		Mode::PIXELS_PER_LINE >> Mode::PIXELS_PER_BYTE_SHIFT;
-
-	SX >>= Mode::PIXELS_PER_BYTE_SHIFT;
-	DX >>= Mode::PIXELS_PER_BYTE_SHIFT;
-	if ((BYTES_PER_LINE <= SX) ||
-	    (BYTES_PER_LINE <= DX)) [[unlikely]] {
-		return 1;
-	}
-	NX >>= Mode::PIXELS_PER_BYTE_SHIFT;
-	NX = NX ? NX : BYTES_PER_LINE;
-	return (ARG & VDPCmdEngine::DIX)
-		? std::min(NX, std::min(SX, DX) + 1)
-		: std::min(NX, BYTES_PER_LINE - std::max(SX, DX));
-}
-
-static constexpr unsigned clipNY_1(unsigned DY, unsigned NY, uint8_t ARG)
-{
-	NY = NY ? NY : 1024;
-	return (ARG & VDPCmdEngine::DIY) ? std::min(NY, DY + 1) : NY;
-}
-
-static constexpr unsigned clipNY_2(unsigned SY, unsigned DY, unsigned NY, uint8_t ARG)
-{
-	NY = NY ? NY : 1024;
-	return (ARG & VDPCmdEngine::DIY) ? std::min(NY, std::min(SY, DY) + 1) : NY;
-}
-
-
 //struct IncrByteAddr4;
 //struct IncrByteAddr5;
 //struct IncrByteAddr6;
@@ -152,263 +80,6 @@ template<typename LogOp> static void psetFast(
 	op(time, vram, addr, src, color, mask);
 }
 
-/** Represents V9938 Graphic 4 mode (SCREEN5).
-  */
-struct Graphic4Mode
-{
-	//using IncrByteAddr  = IncrByteAddr4;
-	//using IncrPixelAddr = IncrPixelAddr4;
-	//using IncrMask      = IncrMask4;
-	//using IncrShift     = IncrShift4;
-	static constexpr uint8_t COLOR_MASK = 0x0F;
-	static constexpr uint8_t PIXELS_PER_BYTE = 2;
-	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 1;
-	static constexpr unsigned PIXELS_PER_LINE = 256;
-	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
-	static uint8_t point(const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
-	template<typename LogOp>
-	static void pset(EmuTime time, VDPVRAM& vram,
-		unsigned x, unsigned addr, uint8_t src, uint8_t color, LogOp op);
-	static uint8_t duplicate(uint8_t color);
-};
-
-inline unsigned Graphic4Mode::addressOf(
-	unsigned x, unsigned y, bool extVRAM)
-{
-	if (!extVRAM) [[likely]] {
-		return ((y & 1023) << 7) | ((x & 255) >> 1);
-	} else {
-		return ((y &  511) << 7) | ((x & 255) >> 1) | 0x20000;
-	}
-}
-
-inline uint8_t Graphic4Mode::point(
-	const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM)
-{
-	return (vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM))
-		>> (((~x) & 1) << 2)) & 15;
-}
-
-template<typename LogOp>
-inline void Graphic4Mode::pset(
-	EmuTime time, VDPVRAM& vram, unsigned x, unsigned addr,
-	uint8_t src, uint8_t color, LogOp op)
-{
-	auto sh = uint8_t(((~x) & 1) << 2);
-	op(time, vram, addr, src, uint8_t(color << sh), ~uint8_t(15 << sh));
-}
-
-inline uint8_t Graphic4Mode::duplicate(uint8_t color)
-{
-	assert((color & 0xF0) == 0);
-	return uint8_t(color | (color << 4));
-}
-
-/** Represents V9938 Graphic 5 mode (SCREEN6).
-  */
-struct Graphic5Mode
-{
-	//using IncrByteAddr  = IncrByteAddr5;
-	//using IncrPixelAddr = IncrPixelAddr5;
-	//using IncrMask      = IncrMask5;
-	//using IncrShift     = IncrShift5;
-	static constexpr uint8_t COLOR_MASK = 0x03;
-	static constexpr uint8_t PIXELS_PER_BYTE = 4;
-	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 2;
-	static constexpr unsigned PIXELS_PER_LINE = 512;
-	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
-	static uint8_t point(const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
-	template<typename LogOp>
-	static void pset(EmuTime time, VDPVRAM& vram,
-		unsigned x, unsigned addr, uint8_t src, uint8_t color, LogOp op);
-	static uint8_t duplicate(uint8_t color);
-};
-
-inline unsigned Graphic5Mode::addressOf(
-	unsigned x, unsigned y, bool extVRAM)
-{
-	if (!extVRAM) [[likely]] {
-		return ((y & 1023) << 7) | ((x & 511) >> 2);
-	} else {
-		return ((y &  511) << 7) | ((x & 511) >> 2) | 0x20000;
-	}
-}
-
-inline uint8_t Graphic5Mode::point(
-	const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM)
-{
-	return (vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM))
-		>> (((~x) & 3) << 1)) & 3;
-}
-
-template<typename LogOp>
-inline void Graphic5Mode::pset(
-	EmuTime time, VDPVRAM& vram, unsigned x, unsigned addr,
-	uint8_t src, uint8_t color, LogOp op)
-{
-	auto sh = uint8_t(((~x) & 3) << 1);
-	op(time, vram, addr, src, uint8_t(color << sh), ~uint8_t(3 << sh));
-}
-
-inline uint8_t Graphic5Mode::duplicate(uint8_t color)
-{
-	assert((color & 0xFC) == 0);
-	color |= color << 2;
-	color |= color << 4;
-	return color;
-}
-
-/** Represents V9938 Graphic 6 mode (SCREEN7).
-  */
-struct Graphic6Mode
-{
-	//using IncrByteAddr  = IncrByteAddr6;
-	//using IncrPixelAddr = IncrPixelAddr6;
-	//using IncrMask      = IncrMask6;
-	//using IncrShift     = IncrShift6;
-	static constexpr uint8_t COLOR_MASK = 0x0F;
-	static constexpr uint8_t PIXELS_PER_BYTE = 2;
-	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 1;
-	static constexpr unsigned PIXELS_PER_LINE = 512;
-	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
-	static uint8_t point(const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
-	template<typename LogOp>
-	static void pset(EmuTime time, VDPVRAM& vram,
-		unsigned x, unsigned addr, uint8_t src, uint8_t color, LogOp op);
-	static uint8_t duplicate(uint8_t color);
-};
-
-inline unsigned Graphic6Mode::addressOf(
-	unsigned x, unsigned y, bool extVRAM)
-{
-	if (!extVRAM) [[likely]] {
-		return ((x & 2) << 15) | ((y & 511) << 7) | ((x & 511) >> 2);
-	} else {
-		return 0x20000         | ((y & 511) << 7) | ((x & 511) >> 2);
-	}
-}
-
-inline uint8_t Graphic6Mode::point(
-	const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM)
-{
-	return (vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM))
-		>> (((~x) & 1) << 2)) & 15;
-}
-
-template<typename LogOp>
-inline void Graphic6Mode::pset(
-	EmuTime time, VDPVRAM& vram, unsigned x, unsigned addr,
-	uint8_t src, uint8_t color, LogOp op)
-{
-	auto sh = uint8_t(((~x) & 1) << 2);
-	op(time, vram, addr, src, uint8_t(color << sh), ~uint8_t(15 << sh));
-}
-
-inline uint8_t Graphic6Mode::duplicate(uint8_t color)
-{
-	assert((color & 0xF0) == 0);
-	return uint8_t(color | (color << 4));
-}
-
-/** Represents V9938 Graphic 7 mode (SCREEN8).
-  */
-struct Graphic7Mode
-{
-	//using IncrByteAddr  = IncrByteAddr7;
-	//using IncrPixelAddr = IncrPixelAddr7;
-	//using IncrMask      = IncrMask7;
-	//using IncrShift     = IncrShift7;
-	static constexpr uint8_t COLOR_MASK = 0xFF;
-	static constexpr uint8_t PIXELS_PER_BYTE = 1;
-	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 0;
-	static constexpr unsigned PIXELS_PER_LINE = 256;
-	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
-	static uint8_t point(const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
-	template<typename LogOp>
-	static void pset(EmuTime time, VDPVRAM& vram,
-		unsigned x, unsigned addr, uint8_t src, uint8_t color, LogOp op);
-	static uint8_t duplicate(uint8_t color);
-};
-
-inline unsigned Graphic7Mode::addressOf(
-	unsigned x, unsigned y, bool extVRAM)
-{
-	if (!extVRAM) [[likely]] {
-		return ((x & 1) << 16) | ((y & 511) << 7) | ((x & 255) >> 1);
-	} else {
-		return 0x20000         | ((y & 511) << 7) | ((x & 255) >> 1);
-	}
-}
-
-inline uint8_t Graphic7Mode::point(
-	const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM)
-{
-	return vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM));
-}
-
-template<typename LogOp>
-inline void Graphic7Mode::pset(
-	EmuTime time, VDPVRAM& vram, unsigned /*x*/, unsigned addr,
-	uint8_t src, uint8_t color, LogOp op)
-{
-	op(time, vram, addr, src, color, 0);
-}
-
-inline uint8_t Graphic7Mode::duplicate(uint8_t color)
-{
-	return color;
-}
-
-/** Represents V9958 non-bitmap command mode. This uses the Graphic7Mode
-  * coordinate system, but in non-planar mode.
-  */
-struct NonBitmapMode
-{
-	//using IncrByteAddr  = IncrByteAddrNonBitMap;
-	//using IncrPixelAddr = IncrPixelAddrNonBitMap;
-	//using IncrMask      = IncrMaskNonBitMap;
-	//using IncrShift     = IncrShiftNonBitMap;
-	static constexpr uint8_t COLOR_MASK = 0xFF;
-	static constexpr uint8_t PIXELS_PER_BYTE = 1;
-	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 0;
-	static constexpr unsigned PIXELS_PER_LINE = 256;
-	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
-	static uint8_t point(const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
-	template<typename LogOp>
-	static void pset(EmuTime time, VDPVRAM& vram,
-		unsigned x, unsigned addr, uint8_t src, uint8_t color, LogOp op);
-	static uint8_t duplicate(uint8_t color);
-};
-
-inline unsigned NonBitmapMode::addressOf(
-	unsigned x, unsigned y, bool extVRAM)
-{
-	if (!extVRAM) [[likely]] {
-		return ((y & 511) << 8) | (x & 255);
-	} else {
-		return ((y & 255) << 8) | (x & 255) | 0x20000;
-	}
-}
-
-inline uint8_t NonBitmapMode::point(
-	const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM)
-{
-	return vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM));
-}
-
-template<typename LogOp>
-inline void NonBitmapMode::pset(
-	EmuTime time, VDPVRAM& vram, unsigned /*x*/, unsigned addr,
-	uint8_t src, uint8_t color, LogOp op)
-{
-	op(time, vram, addr, src, color, 0);
-}
-
-inline uint8_t NonBitmapMode::duplicate(uint8_t color)
-{
-	return color;
-}
-
 /** Incremental address calculation (byte based, no extended VRAM)
  */
 struct IncrByteAddr4
@@ -652,74 +323,6 @@ struct IncrShift7
 };
 
 
-// Logical operations:
-
-struct DummyOp {
-	void operator()(EmuTime /*time*/, VDPVRAM& /*vram*/, unsigned /*addr*/,
-	                uint8_t /*src*/, uint8_t /*color*/, uint8_t /*mask*/) const
-	{
-		// Undefined logical operations do nothing.
-	}
-};
-
-struct ImpOp {
-	void operator()(EmuTime time, VDPVRAM& vram, unsigned addr,
-	                uint8_t src, uint8_t color, uint8_t mask) const
-	{
-		vram.cmdWrite(addr, (src & mask) | color, time);
-	}
-};
-
-struct AndOp {
-	void operator()(EmuTime time, VDPVRAM& vram, unsigned addr,
-	                uint8_t src, uint8_t color, uint8_t mask) const
-	{
-		vram.cmdWrite(addr, src & (color | mask), time);
-	}
-};
-
-struct OrOp {
-	void operator()(EmuTime time, VDPVRAM& vram, unsigned addr,
-	                uint8_t src, uint8_t color, uint8_t /*mask*/) const
-	{
-		vram.cmdWrite(addr, src | color, time);
-	}
-};
-
-struct XorOp {
-	void operator()(EmuTime time, VDPVRAM& vram, unsigned addr,
-	                uint8_t src, uint8_t color, uint8_t /*mask*/) const
-	{
-		vram.cmdWrite(addr, src ^ color, time);
-	}
-};
-
-struct NotOp {
-	void operator()(EmuTime time, VDPVRAM& vram, unsigned addr,
-	                uint8_t src, uint8_t color, uint8_t mask) const
-	{
-		vram.cmdWrite(addr, (src & mask) | ~(color | mask), time);
-	}
-};
-
-template<typename Op>
-struct TransparentOp : Op {
-	void operator()(EmuTime time, VDPVRAM& vram, unsigned addr,
-	                uint8_t src, uint8_t color, uint8_t mask) const
-	{
-		// TODO does this skip the write or re-write the original value
-		//      might make a difference in case the CPU has written
-		//      the same address between the command read and write
-		if (color) Op::operator()(time, vram, addr, src, color, mask);
-	}
-};
-using TImpOp = TransparentOp<ImpOp>;
-using TAndOp = TransparentOp<AndOp>;
-using TOrOp  = TransparentOp<OrOp>;
-using TXorOp = TransparentOp<XorOp>;
-using TNotOp = TransparentOp<NotOp>;
-
-
 // Commands
 
 void VDPCmdEngine::setStatusChangeTime(EmuTime t)
@@ -969,123 +572,13 @@ loop:		if (calculator.limitReached()) [[unlikely]] { phase = 0; break; }
 template<typename Mode>
 void VDPCmdEngine::startLmmv(EmuTime time)
 {
-	vram.cmdReadWindow.disable(time);
-	vram.cmdWriteWindow.setMask(0x3FFFF, ~0u << 18, time);
-	NY &= 1023;
-	unsigned tmpNX = clipNX_1_pixel<Mode>(DX, NX, ARG);
-	unsigned tmpNY = clipNY_1(DY, NY, ARG);
-	ADX = DX;
-	ANX = tmpNX;
-	nextAccessSlot(time);
-	calcFinishTime(tmpNX, tmpNY, 72 + 24);
-	phase = 0;
+	VDPCmdBulk::BlockCommands::startLmmv<Mode>(*this, time);
 }
 
 template<typename Mode, typename LogOp>
 void VDPCmdEngine::executeLmmv(EmuTime limit)
 {
-	NY &= 1023;
-	unsigned tmpNX = clipNX_1_pixel<Mode>(DX, NX, ARG);
-	unsigned tmpNY = clipNY_1(DY, NY, ARG);
-	int TX = (ARG & DIX) ? -1 : 1;
-	int TY = (ARG & DIY) ? -1 : 1;
-	ANX = clipNX_1_pixel<Mode>(ADX, ANX, ARG);
-	uint8_t CL = COL & Mode::COLOR_MASK;
-	bool dstExt = (ARG & MXD) != 0;
-	bool doPset = !dstExt || hasExtendedVRAM;
-	unsigned addr = Mode::addressOf(ADX, DY, dstExt);
-	auto calculator = getSlotCalculator(limit);
-
-	switch (phase) {
-	case 0:
-loop:		if (calculator.limitReached()) [[unlikely]] { phase = 0; break; }
-		if (doPset) [[likely]] {
-			tmpDst = vram.cmdWriteWindow.readNP(addr);
-		}
-		calculator.next(Delta::D24);
-		[[fallthrough]];
-	case 1: {
-		if (calculator.limitReached()) [[unlikely]] { phase = 1; break; }
-		if (doPset) [[likely]] {
-			Mode::pset(calculator.getTime(), vram, ADX, addr,
-			           tmpDst, CL, LogOp());
-		}
-		ADX += TX;
-		Delta delta = Delta::D72;
-		if (--ANX == 0) {
-			delta = Delta::D136; // 72 + 64;
-			DY += TY; --NY;
-			ADX = DX; ANX = tmpNX;
-			if (--tmpNY == 0) {
-				commandDone(calculator.getTime());
-				break;
-			}
-		}
-		addr = Mode::addressOf(ADX, DY, dstExt);
-		calculator.next(delta);
-		goto loop;
-	}
-	default:
-		UNREACHABLE;
-	}
-	engineTime = calculator.getTime();
-	this->calcFinishTime(tmpNX, tmpNY, 72 + 24);
-
-	/*
-	if (dstExt) [[unlikely]] {
-		bool doPset = !dstExt || hasExtendedVRAM;
-		while (engineTime < limit) {
-			if (doPset) [[likely]] {
-				Mode::pset(engineTime, vram, ADX, DY,
-					   dstExt, CL, LogOp());
-			}
-			engineTime += delta;
-			ADX += TX;
-			if (--ANX == 0) {
-				DY += TY; --NY;
-				ADX = DX; ANX = tmpNX;
-				if (--tmpNY == 0) {
-					commandDone(engineTime);
-					break;
-				}
-			}
-		}
-	} else {
-		// fast-path, no extended VRAM
-		CL = Mode::duplicate(CL);
-		while (engineTime < limit) {
-			typename Mode::IncrPixelAddr dstAddr(ADX, DY, TX);
-			typename Mode::IncrMask      dstMask(ADX, TX);
-			EmuDuration dur = limit - engineTime;
-			unsigned num = (delta != EmuDuration::zero())
-			             ? std::min(dur.divUp(delta), ANX)
-			             : ANX;
-			for (auto i : xrange(num)) {
-				uint8_t mask = dstMask.getMask();
-				psetFast(engineTime, vram, dstAddr.getAddr(),
-					 CL & ~mask, mask, LogOp());
-				engineTime += delta;
-				dstAddr.step(TX);
-				dstMask.step();
-			}
-			ANX -= num;
-			if (ANX == 0) {
-				DY += TY;
-				NY -= 1;
-				ADX = DX;
-				ANX = tmpNX;
-				if (--tmpNY == 0) {
-					commandDone(engineTime);
-					break;
-				}
-			} else {
-				ADX += num * TX;
-				assert(engineTime >= limit);
-				break;
-			}
-		}
-	}
-	*/
+	VDPCmdBulk::BlockCommands::executeLmmv<Mode, LogOp>(*this, limit);
 }
 
 /** Logical move VRAM -> VRAM.
@@ -1371,103 +864,13 @@ void VDPCmdEngine::executeLmmc(EmuTime limit)
 template<typename Mode>
 void VDPCmdEngine::startHmmv(EmuTime time)
 {
-	vram.cmdReadWindow.disable(time);
-	vram.cmdWriteWindow.setMask(0x3FFFF, ~0u << 18, time);
-	NY &= 1023;
-	unsigned tmpNX = clipNX_1_byte<Mode>(DX, NX, ARG);
-	unsigned tmpNY = clipNY_1(DY, NY, ARG);
-	ADX = DX;
-	ANX = tmpNX;
-	nextAccessSlot(time);
-	calcFinishTime(tmpNX, tmpNY, 48);
+	VDPCmdBulk::BlockCommands::startHmmv<Mode>(*this, time);
 }
 
 template<typename Mode>
 void VDPCmdEngine::executeHmmv(EmuTime limit)
 {
-	NY &= 1023;
-	unsigned tmpNX = clipNX_1_byte<Mode>(DX, NX, ARG);
-	unsigned tmpNY = clipNY_1(DY, NY, ARG);
-	int TX = (ARG & DIX)
-		? -Mode::PIXELS_PER_BYTE : Mode::PIXELS_PER_BYTE;
-	int TY = (ARG & DIY) ? -1 : 1;
-	ANX = clipNX_1_byte<Mode>(
-		ADX, ANX << Mode::PIXELS_PER_BYTE_SHIFT, ARG);
-	bool dstExt = (ARG & MXD) != 0;
-	bool doPset = !dstExt || hasExtendedVRAM;
-	auto calculator = getSlotCalculator(limit);
-
-	while (!calculator.limitReached()) {
-		if (doPset) [[likely]] {
-			vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
-			              COL, calculator.getTime());
-		}
-		ADX += TX;
-		Delta delta = Delta::D48;
-		if (--ANX == 0) {
-			delta = Delta::D104; // 48 + 56;
-			DY += TY; --NY;
-			ADX = DX; ANX = tmpNX;
-			if (--tmpNY == 0) {
-				commandDone(calculator.getTime());
-				break;
-			}
-		}
-		calculator.next(delta);
-	}
-	engineTime = calculator.getTime();
-	calcFinishTime(tmpNX, tmpNY, 48);
-
-	/*if (dstExt) [[unlikely]] {
-		bool doPset = !dstExt || hasExtendedVRAM;
-		while (engineTime < limit) {
-			if (doPset) [[likely]] {
-				vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
-					      COL, engineTime);
-			}
-			engineTime += delta;
-			ADX += TX;
-			if (--ANX == 0) {
-				DY += TY; --NY;
-				ADX = DX; ANX = tmpNX;
-				if (--tmpNY == 0) {
-					commandDone(engineTime);
-					break;
-				}
-			}
-		}
-	} else {
-		// fast-path, no extended VRAM
-		while (engineTime < limit) {
-			typename Mode::IncrByteAddr dstAddr(ADX, DY, TX);
-			EmuDuration dur = limit - engineTime;
-			unsigned num = (delta != EmuDuration::zero())
-			             ? std::min(dur.divUp(delta), ANX)
-			             : ANX;
-			for (auto i : xrange(num)) {
-				vram.cmdWrite(dstAddr.getAddr(), COL,
-					      engineTime);
-				engineTime += delta;
-				dstAddr.step(TX);
-			}
-			ANX -= num;
-			if (ANX == 0) {
-				DY += TY;
-				NY -= 1;
-				ADX = DX;
-				ANX = tmpNX;
-				if (--tmpNY == 0) {
-					commandDone(engineTime);
-					break;
-				}
-			} else {
-				ADX += num * TX;
-				assert(engineTime >= limit);
-				break;
-			}
-		}
-	}
-	*/
+	VDPCmdBulk::BlockCommands::executeHmmv<Mode>(*this, limit);
 }
 
 /** High-speed move VRAM -> VRAM.
@@ -1475,135 +878,13 @@ void VDPCmdEngine::executeHmmv(EmuTime limit)
 template<typename Mode>
 void VDPCmdEngine::startHmmm(EmuTime time)
 {
-	vram.cmdReadWindow .setMask(0x3FFFF, ~0u << 18, time);
-	vram.cmdWriteWindow.setMask(0x3FFFF, ~0u << 18, time);
-	NY &= 1023;
-	unsigned tmpNX = clipNX_2_byte<Mode>(SX, DX, NX, ARG);
-	unsigned tmpNY = clipNY_2(SY, DY, NY, ARG);
-	ASX = SX;
-	ADX = DX;
-	ANX = tmpNX;
-	nextAccessSlot(time);
-	calcFinishTime(tmpNX, tmpNY, 24 + 64);
-	phase = 0;
+	VDPCmdBulk::BlockCommands::startHmmm<Mode>(*this, time);
 }
 
 template<typename Mode>
 void VDPCmdEngine::executeHmmm(EmuTime limit)
 {
-	NY &= 1023;
-	unsigned tmpNX = clipNX_2_byte<Mode>(SX, DX, NX, ARG);
-	unsigned tmpNY = clipNY_2(SY, DY, NY, ARG);
-	int TX = (ARG & DIX)
-	       ? -Mode::PIXELS_PER_BYTE : Mode::PIXELS_PER_BYTE;
-	int TY = (ARG & DIY) ? -1 : 1;
-	ANX = clipNX_2_byte<Mode>(
-		ASX, ADX, ANX << Mode::PIXELS_PER_BYTE_SHIFT, ARG);
-	bool srcExt  = (ARG & MXS) != 0;
-	bool dstExt  = (ARG & MXD) != 0;
-	bool doPoint = !srcExt || hasExtendedVRAM;
-	bool doPset  = !dstExt || hasExtendedVRAM;
-	auto calculator = getSlotCalculator(limit);
-
-	switch (phase) {
-	case 0:
-loop:		if (calculator.limitReached()) [[unlikely]] { phase = 0; break; }
-		if (doPoint) [[likely]] {
-			tmpSrc = vram.cmdReadWindow.readNP(Mode::addressOf(ASX, SY, srcExt));
-		} else {
-			tmpSrc = 0xFF;
-		}
-		calculator.next(Delta::D24);
-		[[fallthrough]];
-	case 1: {
-		if (calculator.limitReached()) [[unlikely]] { phase = 1; break; }
-		if (doPset) [[likely]] {
-			vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
-			              tmpSrc, calculator.getTime());
-		}
-		ASX += TX; ADX += TX;
-		Delta delta = Delta::D64;
-		if (--ANX == 0) {
-			delta = Delta::D128; // 64 + 64
-			SY += TY; DY += TY; --NY;
-			ASX = SX; ADX = DX; ANX = tmpNX;
-			if (--tmpNY == 0) {
-				commandDone(calculator.getTime());
-				break;
-			}
-		}
-		calculator.next(delta);
-		goto loop;
-	}
-	default:
-		UNREACHABLE;
-	}
-	engineTime = calculator.getTime();
-	calcFinishTime(tmpNX, tmpNY, 24 + 64);
-
-	/*if (srcExt || dstExt) [[unlikely]] {
-		bool doPoint = !srcExt || hasExtendedVRAM;
-		bool doPset  = !dstExt || hasExtendedVRAM;
-		while (engineTime < limit) {
-			if (doPset) [[likely]] {
-				auto p = [&] -> uint8_t {
-					if (doPoint) [[likely]] {
-						return vram.cmdReadWindow.readNP(Mode::addressOf(ASX, SY, srcExt));
-					} else {
-						return 0xFF;
-					}
-				}();
-				vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
-					      p, engineTime);
-			}
-			engineTime += delta;
-			ASX += TX; ADX += TX;
-			if (--ANX == 0) {
-				SY += TY; DY += TY; --NY;
-				ASX = SX; ADX = DX; ANX = tmpNX;
-				if (--tmpNY == 0) {
-					commandDone(engineTime);
-					break;
-				}
-			}
-		}
-	} else {
-		// fast-path, no extended VRAM
-		while (engineTime < limit) {
-			typename Mode::IncrByteAddr srcAddr(ASX, SY, TX);
-			typename Mode::IncrByteAddr dstAddr(ADX, DY, TX);
-			EmuDuration dur = limit - engineTime;
-			unsigned num = (delta != EmuDuration::zero())
-			             ? std::min(dur.divUp(delta), ANX)
-			             : ANX;
-			for (auto i : xrange(num)) {
-				uint8_t p = vram.cmdReadWindow.readNP(srcAddr.getAddr());
-				vram.cmdWrite(dstAddr.getAddr(), p, engineTime);
-				engineTime += delta;
-				srcAddr.step(TX);
-				dstAddr.step(TX);
-			}
-			ANX -= num;
-			if (ANX == 0) {
-				SY += TY;
-				DY += TY;
-				NY -= 1;
-				ASX = SX;
-				ADX = DX;
-				ANX = tmpNX;
-				if (--tmpNY == 0) {
-					commandDone(engineTime);
-					break;
-				}
-			} else {
-				ASX += num * TX;
-				ADX += num * TX;
-				assert(engineTime >= limit);
-				break;
-			}
-		}
-	}
-	*/
+	VDPCmdBulk::BlockCommands::executeHmmm<Mode>(*this, limit);
 }
 
 /** High-speed move VRAM -> VRAM (Y direction only).
@@ -1611,135 +892,13 @@ loop:		if (calculator.limitReached()) [[unlikely]] { phase = 0; break; }
 template<typename Mode>
 void VDPCmdEngine::startYmmm(EmuTime time)
 {
-	vram.cmdReadWindow .setMask(0x3FFFF, ~0u << 18, time);
-	vram.cmdWriteWindow.setMask(0x3FFFF, ~0u << 18, time);
-	NY &= 1023;
-	unsigned tmpNX = clipNX_1_byte<Mode>(DX, 512, ARG);
-		// large enough so that it gets clipped
-	unsigned tmpNY = clipNY_2(SY, DY, NY, ARG);
-	ADX = DX;
-	ANX = tmpNX;
-	nextAccessSlot(time);
-	calcFinishTime(tmpNX, tmpNY, 24 + 36);
-	phase = 0;
+	VDPCmdBulk::BlockCommands::startYmmm<Mode>(*this, time);
 }
 
 template<typename Mode>
 void VDPCmdEngine::executeYmmm(EmuTime limit)
 {
-	NY &= 1023;
-	unsigned tmpNX = clipNX_1_byte<Mode>(DX, 512, ARG);
-		// large enough so that it gets clipped
-	unsigned tmpNY = clipNY_2(SY, DY, NY, ARG);
-	int TX = (ARG & DIX)
-		? -Mode::PIXELS_PER_BYTE : Mode::PIXELS_PER_BYTE;
-	int TY = (ARG & DIY) ? -1 : 1;
-	ANX = clipNX_1_byte<Mode>(ADX, 512, ARG);
-
-	// TODO does this use MXD for both read and write?
-	//  it says so in the datasheet, but it seems illogical
-	//  OTOH YMMM also uses DX for both read and write
-	bool dstExt = (ARG & MXD) != 0;
-	bool doPset  = !dstExt || hasExtendedVRAM;
-	auto calculator = getSlotCalculator(limit);
-
-	// Note: we changed the timing
-	//    from:  40 R 24 W  +0   (see doc/internal/vdp-vram-timing/vdp-timing.html for notation and background info)
-	//    to:    36 R 24 W  +68  (TODO update the above documentation, as it's wrong now)
-	// This is based on:
-	//    https://github.com/openMSX/openMSX/issues/2057   (measurement tools by bengalack)
-	//    https://github.com/sndpl/openMSX/pull/5          (analysis done by Claude (Opus), an AI assistant)
-	switch (phase) {
-	case 0:
-loop:		if (calculator.limitReached()) [[unlikely]] { phase = 0; break; }
-		if (doPset) [[likely]] {
-			tmpSrc = vram.cmdReadWindow.readNP(
-			       Mode::addressOf(ADX, SY, dstExt));
-		}
-		calculator.next(Delta::D24);
-		[[fallthrough]];
-	case 1: {
-		if (calculator.limitReached()) [[unlikely]] { phase = 1; break; }
-		if (doPset) [[likely]] {
-			vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
-			              tmpSrc, calculator.getTime());
-		}
-		ADX += TX;
-		Delta delta = Delta::D36;
-		if (--ANX == 0) {
-			delta = Delta::D104; // 36 + 68
-			SY += TY; DY += TY; --NY;
-			ADX = DX; ANX = tmpNX;
-			if (--tmpNY == 0) {
-				commandDone(calculator.getTime());
-				break;
-			}
-		}
-		calculator.next(delta);
-		goto loop;
-	}
-	default:
-		UNREACHABLE;
-	}
-	engineTime = calculator.getTime();
-	calcFinishTime(tmpNX, tmpNY, 24 + 36);
-
-	/*
-	if (dstExt) [[unlikely]] {
-		bool doPset  = !dstExt || hasExtendedVRAM;
-		while (engineTime < limit) {
-			if (doPset) [[likely]] {
-				uint8_t p = vram.cmdReadWindow.readNP(
-					      Mode::addressOf(ADX, SY, dstExt));
-				vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
-					      p, engineTime);
-			}
-			engineTime += delta;
-			ADX += TX;
-			if (--ANX == 0) {
-				SY += TY; DY += TY; --NY;
-				ADX = DX; ANX = tmpNX;
-				if (--tmpNY == 0) {
-					commandDone(engineTime);
-					break;
-				}
-			}
-		}
-	} else {
-		// fast-path, no extended VRAM
-		while (engineTime < limit) {
-			typename Mode::IncrByteAddr srcAddr(ADX, SY, TX);
-			typename Mode::IncrByteAddr dstAddr(ADX, DY, TX);
-			EmuDuration dur = limit - engineTime;
-			unsigned num = (delta != EmuDuration::zero())
-			             ? std::min(dur.divUp(delta), ANX)
-			             : ANX;
-			for (auto i : xrange(num)) {
-				uint8_t p = vram.cmdReadWindow.readNP(srcAddr.getAddr());
-				vram.cmdWrite(dstAddr.getAddr(), p, engineTime);
-				engineTime += delta;
-				srcAddr.step(TX);
-				dstAddr.step(TX);
-			}
-			ANX -= num;
-			if (ANX == 0) {
-				SY += TY;
-				DY += TY;
-				NY -= 1;
-				ADX = DX;
-				ANX = tmpNX;
-				if (--tmpNY == 0) {
-					commandDone(engineTime);
-					break;
-				}
-			} else {
-				ADX += num * TX;
-				assert(engineTime >= limit);
-				break;
-			}
-		}
-	}
-	*/
+	VDPCmdBulk::BlockCommands::executeYmmm<Mode>(*this, limit);
 }
 
 /** High-speed move CPU -> VRAM.
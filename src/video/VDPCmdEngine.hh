@@ -18,6 +18,7 @@ namespace openmsx {
 class VDPVRAM;
 class DisplayMode;
 class CommandController;
+namespace VDPCmdBulk { struct BlockCommands; }
 
 /** VDP command engine by Alex Wulms.
   * Implements command execution unit of V9938/58.
@@ -182,6 +183,9 @@ public:
 	void serialize(Archive& ar, unsigned version);
 
 private:
+	// executes (part of) the block commands, see VDPCmdBulk.hh
+	friend struct VDPCmdBulk::BlockCommands;
+
 	void executeCommand(EmuTime time);
 
 	void setStatusChangeTime(EmuTime t);
@@ -0,0 +1,471 @@
+#ifndef VDPCMDMODES_HH
+#define VDPCMDMODES_HH
+
+#include "VDPCmdEngine.hh"
+
+#include "EmuTime.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace openmsx {
+
+// The screen modes and logical operations used by VDPCmdEngine. The VRAM
+// accesses are templates on the VRAM type: VDPCmdEngine uses VDPVRAM, the
+// unit test uses a simplified model.
+
+template<typename Mode>
+constexpr unsigned clipNX_1_pixel(unsigned DX, unsigned NX, uint8_t ARG)
+{
+	if (DX >= Mode::PIXELS_PER_LINE) [[unlikely]] {
+		return 1;
+	}
+	NX = NX ? NX : Mode::PIXELS_PER_LINE;
+	return (ARG & VDPCmdEngine::DIX)
+		? std::min(NX, DX + 1)
+		: std::min(NX, Mode::PIXELS_PER_LINE - DX);
+}
+
+template<typename Mode>
+constexpr unsigned clipNX_1_byte(unsigned DX, unsigned NX, uint8_t ARG)
+{
+	constexpr unsigned BYTES_PER_LINE =
+		Mode::PIXELS_PER_LINE >> Mode::PIXELS_PER_BYTE_SHIFT;
+
+	DX >>= Mode::PIXELS_PER_BYTE_SHIFT;
+	if (BYTES_PER_LINE <= DX) [[unlikely]] {
+		return 1;
+	}
+	NX >>= Mode::PIXELS_PER_BYTE_SHIFT;
+	NX = NX ? NX : BYTES_PER_LINE;
+	return (ARG & VDPCmdEngine::DIX)
+		? std::min(NX, DX + 1)
+		: std::min(NX, BYTES_PER_LINE - DX);
+}
+
+template<typename Mode>
+constexpr unsigned clipNX_2_pixel(unsigned SX, unsigned DX, unsigned NX, uint8_t ARG)
+{
+	if ((SX >= Mode::PIXELS_PER_LINE) ||
+	    (DX >= Mode::PIXELS_PER_LINE)) [[unlikely]] {
+		return 1;
+	}
+	NX = NX ? NX : Mode::PIXELS_PER_LINE;
+	return (ARG & VDPCmdEngine::DIX)
+		? std::min(NX, std::min(SX, DX) + 1)
+		: std::min(NX, Mode::PIXELS_PER_LINE - std::max(SX, DX));
+}
+
+template<typename Mode>
+constexpr unsigned clipNX_2_byte(unsigned SX, unsigned DX, unsigned NX, uint8_t ARG)
+{
+	constexpr unsigned BYTES_PER_LINE =
+		Mode::PIXELS_PER_LINE >> Mode::PIXELS_PER_BYTE_SHIFT;
+
+	SX >>= Mode::PIXELS_PER_BYTE_SHIFT;
+	DX >>= Mode::PIXELS_PER_BYTE_SHIFT;
+	if ((BYTES_PER_LINE <= SX) ||
+	    (BYTES_PER_LINE <= DX)) [[unlikely]] {
+		return 1;
+	}
+	NX >>= Mode::PIXELS_PER_BYTE_SHIFT;
+	NX = NX ? NX : BYTES_PER_LINE;
+	return (ARG & VDPCmdEngine::DIX)
+		? std::min(NX, std::min(SX, DX) + 1)
+		: std::min(NX, BYTES_PER_LINE - std::max(SX, DX));
+}
+
+constexpr unsigned clipNY_1(unsigned DY, unsigned NY, uint8_t ARG)
+{
+	NY = NY ? NY : 1024;
+	return (ARG & VDPCmdEngine::DIY) ? std::min(NY, DY + 1) : NY;
+}
+
+constexpr unsigned clipNY_2(unsigned SY, unsigned DY, unsigned NY, uint8_t ARG)
+{
+	NY = NY ? NY : 1024;
+	return (ARG & VDPCmdEngine::DIY) ? std::min(NY, std::min(SY, DY) + 1) : NY;
+}
+
+/** Represents V9938 Graphic 4 mode (SCREEN5).
+  */
+struct Graphic4Mode
+{
+	//using IncrByteAddr  = IncrByteAddr4;
+	//using IncrPixelAddr = IncrPixelAddr4;
+	//using IncrMask      = IncrMask4;
+	//using IncrShift     = IncrShift4;
+	static constexpr uint8_t COLOR_MASK = 0x0F;
+	static constexpr uint8_t PIXELS_PER_BYTE = 2;
+	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 1;
+	static constexpr unsigned PIXELS_PER_LINE = 256;
+	static constexpr bool PLANAR = false;
+	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
+	template<typename VRAM>
+	static uint8_t point(const VRAM& vram, unsigned x, unsigned y, bool extVRAM);
+	template<typename VRAM, typename LogOp>
+	static void pset(EmuTime time, VRAM& vram,
+		unsigned x, unsigned addr, uint8_t src, uint8_t color, LogOp op);
+	static uint8_t duplicate(uint8_t color);
+};
+
+inline unsigned Graphic4Mode::addressOf(
+	unsigned x, unsigned y, bool extVRAM)
+{
+	if (!extVRAM) [[likely]] {
+		return ((y & 1023) << 7) | ((x & 255) >> 1);
+	} else {
+		return ((y &  511) << 7) | ((x & 255) >> 1) | 0x20000;
+	}
+}
+
+template<typename VRAM>
+inline uint8_t Graphic4Mode::point(
+	const VRAM& vram, unsigned x, unsigned y, bool extVRAM)
+{
+	return (vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM))
+		>> (((~x) & 1) << 2)) & 15;
+}
+
+template<typename VRAM, typename LogOp>
+inline void Graphic4Mode::pset(
+	EmuTime time, VRAM& vram, unsigned x, unsigned addr,
+	uint8_t src, uint8_t color, LogOp op)
+{
+	auto sh = uint8_t(((~x) & 1) << 2);
+	op(time, vram, addr, src, uint8_t(color << sh), ~uint8_t(15 << sh));
+}
+
+inline uint8_t Graphic4Mode::duplicate(uint8_t color)
+{
+	assert((color & 0xF0) == 0);
+	return uint8_t(color | (color << 4));
+}
+
+/** Represents V9938 Graphic 5 mode (SCREEN6).
+  */
+struct Graphic5Mode
+{
+	//using IncrByteAddr  = IncrByteAddr5;
+	//using IncrPixelAddr = IncrPixelAddr5;
+	//using IncrMask      = IncrMask5;
+	//using IncrShift     = IncrShift5;
+	static constexpr uint8_t COLOR_MASK = 0x03;
+	static constexpr uint8_t PIXELS_PER_BYTE = 4;
+	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 2;
+	static constexpr unsigned PIXELS_PER_LINE = 512;
+	static constexpr bool PLANAR = false;
+	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
+	template<typename VRAM>
+	static uint8_t point(const VRAM& vram, unsigned x, unsigned y, bool extVRAM);
+	template<typename VRAM, typename LogOp>
+	static void pset(EmuTime time, VRAM& vram,
+		unsigned x, unsigned addr, uint8_t src, uint8_t color, LogOp op);
+	static uint8_t duplicate(uint8_t color);
+};
+
+inline unsigned Graphic5Mode::addressOf(
+	unsigned x, unsigned y, bool extVRAM)
+{
+	if (!extVRAM) [[likely]] {
+		return ((y & 1023) << 7) | ((x & 511) >> 2);
+	} else {
+		return ((y &  511) << 7) | ((x & 511) >> 2) | 0x20000;
+	}
+}
+
+template<typename VRAM>
+inline uint8_t Graphic5Mode::point(
+	const VRAM& vram, unsigned x, unsigned y, bool extVRAM)
+{
+	return (vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM))
+		>> (((~x) & 3) << 1)) & 3;
+}
+
+template<typename VRAM, typename LogOp>
+inline void Graphic5Mode::pset(
+	EmuTime time, VRAM& vram, unsigned x, unsigned addr,
+	uint8_t src, uint8_t color, LogOp op)
+{
+	auto sh = uint8_t(((~x) & 3) << 1);
+	op(time, vram, addr, src, uint8_t(color << sh), ~uint8_t(3 << sh));
+}
+
+inline uint8_t Graphic5Mode::duplicate(uint8_t color)
+{
+	assert((color & 0xFC) == 0);
+	color |= color << 2;
+	color |= color << 4;
+	return color;
+}
+
+/** Represents V9938 Graphic 6 mode (SCREEN7).
+  */
+struct Graphic6Mode
+{
+	//using IncrByteAddr  = IncrByteAddr6;
+	//using IncrPixelAddr = IncrPixelAddr6;
+	//using IncrMask      = IncrMask6;
+	//using IncrShift     = IncrShift6;
+	static constexpr uint8_t COLOR_MASK = 0x0F;
+	static constexpr uint8_t PIXELS_PER_BYTE = 2;
+	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 1;
+	static constexpr unsigned PIXELS_PER_LINE = 512;
+	static constexpr bool PLANAR = true;
+	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
+	template<typename VRAM>
+	static uint8_t point(const VRAM& vram, unsigned x, unsigned y, bool extVRAM);
+	template<typename VRAM, typename LogOp>
+	static void pset(EmuTime time, VRAM& vram,
+		unsigned x, unsigned addr, uint8_t src, uint8_t color, LogOp op);
+	static uint8_t duplicate(uint8_t color);
+};
+
+inline unsigned Graphic6Mode::addressOf(
+	unsigned x, unsigned y, bool extVRAM)
+{
+	if (!extVRAM) [[likely]] {
+		return ((x & 2) << 15) | ((y & 511) << 7) | ((x & 511) >> 2);
+	} else {
+		return 0x20000         | ((y & 511) << 7) | ((x & 511) >> 2);
+	}
+}
+
+template<typename VRAM>
+inline uint8_t Graphic6Mode::point(
+	const VRAM& vram, unsigned x, unsigned y, bool extVRAM)
+{
+	return (vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM))
+		>> (((~x) & 1) << 2)) & 15;
+}
+
+template<typename VRAM, typename LogOp>
+inline void Graphic6Mode::pset(
+	EmuTime time, VRAM& vram, unsigned x, unsigned addr,
+	uint8_t src, uint8_t color, LogOp op)
+{
+	auto sh = uint8_t(((~x) & 1) << 2);
+	op(time, vram, addr, src, uint8_t(color << sh), ~uint8_t(15 << sh));
+}
+
+inline uint8_t Graphic6Mode::duplicate(uint8_t color)
+{
+	assert((color & 0xF0) == 0);
+	return uint8_t(color | (color << 4));
+}
+
+/** Represents V9938 Graphic 7 mode (SCREEN8).
+  */
+struct Graphic7Mode
+{
+	//using IncrByteAddr  = IncrByteAddr7;
+	//using IncrPixelAddr = IncrPixelAddr7;
+	//using IncrMask      = IncrMask7;
+	//using IncrShift     = IncrShift7;
+	static constexpr uint8_t COLOR_MASK = 0xFF;
+	static constexpr uint8_t PIXELS_PER_BYTE = 1;
+	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 0;
+	static constexpr unsigned PIXELS_PER_LINE = 256;
+	static constexpr bool PLANAR = true;
+	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
+	template<typename VRAM>
+	static uint8_t point(const VRAM& vram, unsigned x, unsigned y, bool extVRAM);
+	template<typename VRAM, typename LogOp>
+	static void pset(EmuTime time, VRAM& vram,
+		unsigned x, unsigned addr, uint8_t src, uint8_t color, LogOp op);
+	static uint8_t duplicate(uint8_t color);
+};
+
+inline unsigned Graphic7Mode::addressOf(
+	unsigned x, unsigned y, bool extVRAM)
+{
+	if (!extVRAM) [[likely]] {
+		return ((x & 1) << 16) | ((y & 511) << 7) | ((x & 255) >> 1);
+	} else {
+		return 0x20000         | ((y & 511) << 7) | ((x & 255) >> 1);
+	}
+}
+
+template<typename VRAM>
+inline uint8_t Graphic7Mode::point(
+	const VRAM& vram, unsigned x, unsigned y, bool extVRAM)
+{
+	return vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM));
+}
+
+template<typename VRAM, typename LogOp>
+inline void Graphic7Mode::pset(
+	EmuTime time, VRAM& vram, unsigned /*x*/, unsigned addr,
+	uint8_t src, uint8_t color, LogOp op)
+{
+	op(time, vram, addr, src, color, 0);
+}
+
+inline uint8_t Graphic7Mode::duplicate(uint8_t color)
+{
+	return color;
+}
+
+/** Represents V9958 non-bitmap command mode. This uses the Graphic7Mode
+  * coordinate system, but in non-planar mode.
+  */
+struct NonBitmapMode
+{
+	//using IncrByteAddr  = IncrByteAddrNonBitMap;
+	//using IncrPixelAddr = IncrPixelAddrNonBitMap;
+	//using IncrMask      = IncrMaskNonBitMap;
+	//using IncrShift     = IncrShiftNonBitMap;
+	static constexpr uint8_t COLOR_MASK = 0xFF;
+	static constexpr uint8_t PIXELS_PER_BYTE = 1;
+	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 0;
+	static constexpr unsigned PIXELS_PER_LINE = 256;
+	static constexpr bool PLANAR = false;
+	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
+	template<typename VRAM>
+	static uint8_t point(const VRAM& vram, unsigned x, unsigned y, bool extVRAM);
+	template<typename VRAM, typename LogOp>
+	static void pset(EmuTime time, VRAM& vram,
+		unsigned x, unsigned addr, uint8_t src, uint8_t color, LogOp op);
+	static uint8_t duplicate(uint8_t color);
+};
+
+inline unsigned NonBitmapMode::addressOf(
+	unsigned x, unsigned y, bool extVRAM)
+{
+	if (!extVRAM) [[likely]] {
+		return ((y & 511) << 8) | (x & 255);
+	} else {
+		return ((y & 255) << 8) | (x & 255) | 0x20000;
+	}
+}
+
+template<typename VRAM>
+inline uint8_t NonBitmapMode::point(
+	const VRAM& vram, unsigned x, unsigned y, bool extVRAM)
+{
+	return vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM));
+}
+
+template<typename VRAM, typename LogOp>
+inline void NonBitmapMode::pset(
+	EmuTime time, VRAM& vram, unsigned /*x*/, unsigned addr,
+	uint8_t src, uint8_t color, LogOp op)
+{
+	op(time, vram, addr, src, color, 0);
+}
+
+inline uint8_t NonBitmapMode::duplicate(uint8_t color)
+{
+	return color;
+}
+
+
+// Logical operations:
+
+// Besides the VRAM write, each operation also has a 'calc()' method that only
+// calculates the new value, that one is used by the bulk code paths.
+
+struct DummyOp {
+	[[nodiscard]] static uint8_t calc(uint8_t src, uint8_t /*color*/, uint8_t /*mask*/)
+	{
+		return src;
+	}
+	template<typename VRAM>
+	void operator()(EmuTime /*time*/, VRAM& /*vram*/, unsigned /*addr*/,
+	                uint8_t /*src*/, uint8_t /*color*/, uint8_t /*mask*/) const
+	{
+		// Undefined logical operations do nothing.
+	}
+};
+
+struct ImpOp {
+	[[nodiscard]] static uint8_t calc(uint8_t src, uint8_t color, uint8_t mask)
+	{
+		return (src & mask) | color;
+	}
+	template<typename VRAM>
+	void operator()(EmuTime time, VRAM& vram, unsigned addr,
+	                uint8_t src, uint8_t color, uint8_t mask) const
+	{
+		vram.cmdWrite(addr, calc(src, color, mask), time);
+	}
+};
+
+struct AndOp {
+	[[nodiscard]] static uint8_t calc(uint8_t src, uint8_t color, uint8_t mask)
+	{
+		return src & (color | mask);
+	}
+	template<typename VRAM>
+	void operator()(EmuTime time, VRAM& vram, unsigned addr,
+	                uint8_t src, uint8_t color, uint8_t mask) const
+	{
+		vram.cmdWrite(addr, calc(src, color, mask), time);
+	}
+};
+
+struct OrOp {
+	[[nodiscard]] static uint8_t calc(uint8_t src, uint8_t color, uint8_t /*mask*/)
+	{
+		return src | color;
+	}
+	template<typename VRAM>
+	void operator()(EmuTime time, VRAM& vram, unsigned addr,
+	                uint8_t src, uint8_t color, uint8_t mask) const
+	{
+		vram.cmdWrite(addr, calc(src, color, mask), time);
+	}
+};
+
+struct XorOp {
+	[[nodiscard]] static uint8_t calc(uint8_t src, uint8_t color, uint8_t /*mask*/)
+	{
+		return src ^ color;
+	}
+	template<typename VRAM>
+	void operator()(EmuTime time, VRAM& vram, unsigned addr,
+	                uint8_t src, uint8_t color, uint8_t mask) const
+	{
+		vram.cmdWrite(addr, calc(src, color, mask), time);
+	}
+};
+
+struct NotOp {
+	[[nodiscard]] static uint8_t calc(uint8_t src, uint8_t color, uint8_t mask)
+	{
+		return uint8_t((src & mask) | ~(color | mask));
+	}
+	template<typename VRAM>
+	void operator()(EmuTime time, VRAM& vram, unsigned addr,
+	                uint8_t src, uint8_t color, uint8_t mask) const
+	{
+		vram.cmdWrite(addr, calc(src, color, mask), time);
+	}
+};
+
+template<typename Op>
+struct TransparentOp : Op {
+	[[nodiscard]] static uint8_t calc(uint8_t src, uint8_t color, uint8_t mask)
+	{
+		return color ? Op::calc(src, color, mask) : src;
+	}
+	template<typename VRAM>
+	void operator()(EmuTime time, VRAM& vram, unsigned addr,
+	                uint8_t src, uint8_t color, uint8_t mask) const
+	{
+		// TODO does this skip the write or re-write the original value
+		//      might make a difference in case the CPU has written
+		//      the same address between the command read and write
+		if (color) Op::operator()(time, vram, addr, src, color, mask);
+	}
+};
+using TImpOp = TransparentOp<ImpOp>;
+using TAndOp = TransparentOp<AndOp>;
+using TOrOp  = TransparentOp<OrOp>;
+using TXorOp = TransparentOp<XorOp>;
+using TNotOp = TransparentOp<NotOp>;
+
+} // namespace openmsx
+
+#endif
@@ -12,6 +12,7 @@
 
 #include <cassert>
 #include <cstdint>
+#include <span>
 
 namespace openmsx {
 
@@ -312,6 +313,19 @@ public:
 		return (address & combiMask) == baseAddr;
 	}
 
+	/** Test whether an address in the range [address, address + size)
+	  * might be inside this window. This is a conservative test: it can
+	  * return true when none of the addresses is inside, but never the
+	  * other way around.
+	  * @param address The first address of the range.
+	  * @param size The size of the range, must be at least 1.
+	  */
+	[[nodiscard]] bool mightBeInside(unsigned address, unsigned size) const {
+		assert(size != 0);
+		unsigned varying = Math::floodRight(address ^ (address + size - 1));
+		return (address & combiMask & ~varying) == (baseAddr & ~varying);
+	}
+
 	/** Notifies the observer of this window of a VRAM change,
 	  * if the changes address is inside this window.
 	  * @param address The address to test.
@@ -447,6 +461,33 @@ public:
 		writeCommon(address, value, time);
 	}
 
+	/** Direct access to a block of VRAM for the bulk operations of the
+	  * command engine (see VDPCmdBulk.hh). This is only possible when the
+	  * block maps one-to-one on physical VRAM (no mirroring, no missing
+	  * VRAM chips). For writes it's additionally required that no
+	  * observer needs to be notified about changes in the block, so that
+	  * the exact moment of the write doesn't matter.
+	  * @return The block, or an empty span when it cannot be accessed
+	  *         directly, then the caller should fall back to cmdWrite()
+	  *         and cmdReadWindow.
+	  */
+	[[nodiscard]] std::span<const uint8_t> getCmdReadArea(unsigned address, unsigned size) const {
+		if (!isCmdArea(address, size)) return {};
+		return {&data[address], size};
+	}
+	[[nodiscard]] std::span<uint8_t> getCmdWriteArea(unsigned address, unsigned size) {
+		if (!isCmdArea(address, size)) return {};
+		auto observed = [&](const VRAMWindow& window) {
+			return window.hasObserver() && window.mightBeInside(address, size);
+		};
+		if (observed(bitmapVisibleWindow) ||
+		    observed(spriteAttribTable) ||
+		    observed(spritePatternTable)) {
+			return {};
+		}
+		return {&data[address], size};
+	}
+
 	/** Write a byte to VRAM through the CPU interface.
 	  * @param address The address to write.
 	  * @param value The value to write.
@@ -622,6 +663,14 @@ private:
 
 	void setSizeMask(EmuTime time);
 
+	[[nodiscard]] bool isCmdArea(unsigned address, unsigned size) const {
+		// Only the lowest part of 'sizeMask' is contiguous (e.g. with
+		// 16kB VRAM it's 0x13FFF).
+		unsigned end = address + size;
+		unsigned lowMask = sizeMask & ~(sizeMask + 1);
+		return (size != 0) && (end <= actualSize) && ((end - 1) <= lowMask);
+	}
+
 private:
 	/** VDP this VRAM belongs to.
 	  */
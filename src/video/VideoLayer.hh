@@ -39,10 +39,12 @@ public:
 	 * parameter should be either '240' or '480' if specified. If not
 	 * specified, the height will be determined based on the available
 	 * widths in the raw frame. The result will be scaled to either
-	 * '320x240' or '640x480' and written to a png file.
+	 * '320x240' or '640x480' and written to a png file. With 'async'
+	 * the png file is encoded in the background (see ScreenShotQueue).
 	 */
 	virtual void takeRawScreenShot(
-		std::optional<unsigned> height, const std::string& filename) = 0;
+		std::optional<unsigned> height, const std::string& filename,
+		bool async) = 0;
 
 	// We used to test whether a Layer is active by looking at the
 	// Z-coordinate (Z_MSX_ACTIVE vs Z_MSX_PASSIVE). Though in case of
@@ -5,7 +5,7 @@
 namespace openmsx {
 
 void VideoSystem::takeScreenShot(
-	const std::string& /*filename*/, bool /*withOsd*/)
+	const std::string& /*filename*/, bool /*withOsd*/, bool /*async*/)
 {
 	throw MSXException(
 		"Taking screenshot not possible with current renderer.");
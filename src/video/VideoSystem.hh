@@ -55,9 +55,12 @@ public:
 	  * The default implementation throws an exception.
 	  * @param filename Name of the file to save the screenshot to.
 	  * @param withOsd Should OSD elements be included in the screenshot.
+	  * @param async Encode the PNG file in the background, see
+	  *              ScreenShotQueue.
 	  * @throws MSXException If taking the screen shot fails.
 	  */
-	virtual void takeScreenShot(const std::string& filename, bool withOsd);
+	virtual void takeScreenShot(const std::string& filename, bool withOsd,
+	                            bool async);
 
 	/** Called when the window title string has changed.
 	  */
@@ -22,6 +22,7 @@
 #include "MemBuffer.hh"
 #include "OSDGUILayer.hh"
 #include "PNG.hh"
+#include "ScreenShotQueue.hh"
 
 #include "narrow.hh"
 #include "outer.hh"
@@ -354,13 +355,15 @@ std::optional<gl::ivec2> VisibleSurface::getMouseCoord() const
 }
 
 
-void VisibleSurface::saveScreenshot(const std::string& filename)
+void VisibleSurface::saveScreenshot(
+	ScreenShotQueue& queue, const std::string& filename, bool async)
 {
-	saveScreenshotGL(*this, filename);
+	saveScreenshotGL(*this, queue, filename, async);
 }
 
 void VisibleSurface::saveScreenshotGL(
-	const OutputSurface& output, const std::string& filename)
+	const OutputSurface& output, ScreenShotQueue& queue,
+	const std::string& filename, bool async)
 {
 	auto [x, y] = output.getViewOffset();
 	auto [w, h] = output.getViewSize();
@@ -372,7 +375,7 @@ void VisibleSurface::saveScreenshotGL(
 	small_buffer<const uint32_t*, 1080> rowPointers(std::views::transform(xrange(size_t(h)),
 		[&](auto i) { return &buffer[size_t(w) * (h - 1 - i)]; }));
 
-	PNG::saveRGBA(w, rowPointers, filename);
+	queue.save(w, rowPointers, filename, async);
 }
 
 void VisibleSurface::finish()
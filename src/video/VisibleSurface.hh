@@ -45,7 +45,8 @@ public:
 	[[nodiscard]] Display& getDisplay() const { return display; }
 
 	static void saveScreenshotGL(const OutputSurface& output,
-	                             const std::string& filename);
+	                             ScreenShotQueue& queue,
+	                             const std::string& filename, bool async);
 
 	[[nodiscard]] std::optional<gl::ivec2> getMouseCoord() const;
 	void updateWindowTitle();
@@ -76,7 +77,8 @@ public:
 	void setWindowPosition(gl::ivec2 pos);
 
 	// OutputSurface
-	void saveScreenshot(const std::string& filename) override;
+	void saveScreenshot(ScreenShotQueue& queue,
+	                    const std::string& filename, bool async) override;
 
 	// Observer
 	void update(const Setting& setting) noexcept override;
@@ -304,6 +304,41 @@ std::span<const uint8_t> ZMBVEncoder::compressFrame(bool keyFrame, const FrameSo
 {
 	std::swap(newFrame, oldFrame); // replace oldFrame with newFrame
 
+	// copy lines (to add black border)
+	static constexpr size_t pixelSize = sizeof(Pixel);
+	auto linePitch = pitch * pixelSize;
+	auto lineWidth = size_t(width) * pixelSize;
+	uint8_t* dest =
+		&newFrame[pixelSize * (MAX_VECTOR + MAX_VECTOR * pitch)];
+	for (auto i : xrange(height)) {
+		const auto* scaled = std::bit_cast<const uint8_t*>(
+			getScaledLine(frame, i, std::bit_cast<Pixel*>(dest)));
+		if (scaled != dest) memcpy(dest, scaled, lineWidth);
+		dest += linePitch;
+	}
+	return compressNewFrame(keyFrame);
+}
+
+std::span<const uint8_t> ZMBVEncoder::compressFrame(bool keyFrame, std::span<const Pixel> pixels)
+{
+	assert(pixels.size() == size_t(width) * height);
+	std::swap(newFrame, oldFrame); // replace oldFrame with newFrame
+
+	// copy lines (to add black border)
+	static constexpr size_t pixelSize = sizeof(Pixel);
+	auto linePitch = pitch * pixelSize;
+	auto lineWidth = size_t(width) * pixelSize;
+	uint8_t* dest =
+		&newFrame[pixelSize * (MAX_VECTOR + MAX_VECTOR * pitch)];
+	for (auto i : xrange(height)) {
+		memcpy(dest, &pixels[i * size_t(width)], lineWidth);
+		dest += linePitch;
+	}
+	return compressNewFrame(keyFrame);
+}
+
+std::span<const uint8_t> ZMBVEncoder::compressNewFrame(bool keyFrame)
+{
 	// Reset the work buffer
 	unsigned workUsed = 0;
 	unsigned writeDone = 1;
@@ -326,19 +361,6 @@ std::span<const uint8_t> ZMBVEncoder::compressFrame(bool keyFrame, const FrameSo
 		deflateReset(&zstream); // restart deflate
 	}
 
-	// copy lines (to add black border)
-	static constexpr size_t pixelSize = sizeof(Pixel);
-	auto linePitch = pitch * pixelSize;
-	auto lineWidth = size_t(width) * pixelSize;
-	uint8_t* dest =
-		&newFrame[pixelSize * (MAX_VECTOR + MAX_VECTOR * pitch)];
-	for (auto i : xrange(height)) {
-		const auto* scaled = std::bit_cast<const uint8_t*>(
-			getScaledLine(frame, i, std::bit_cast<Pixel*>(dest)));
-		if (scaled != dest) memcpy(dest, scaled, lineWidth);
-		dest += linePitch;
-	}
-
 	// Add the frame data.
 	if (keyFrame) {
 		// Key frame: full frame data.
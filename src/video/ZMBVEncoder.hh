@@ -30,9 +30,14 @@ public:
 	~ZMBVEncoder() = default;
 
 	[[nodiscard]] std::span<const uint8_t> compressFrame(bool keyFrame, const FrameSource* frame);
+	/** Same as above, but the input is an already scaled frame of
+	  * exactly 'width x height' pixels (row after row).
+	  */
+	[[nodiscard]] std::span<const uint8_t> compressFrame(bool keyFrame, std::span<const Pixel> pixels);
 
 private:
 	void setupBuffers();
+	[[nodiscard]] std::span<const uint8_t> compressNewFrame(bool keyFrame);
 	[[nodiscard]] unsigned neededSize() const;
 	void addFullFrame(unsigned& workUsed);
 	void addXorFrame (unsigned& workUsed);
@@ -0,0 +1,476 @@
+#ifndef V9990CMDBULK_HH
+#define V9990CMDBULK_HH
+
+#include "V9990CmdEngine.hh"
+#include "V9990VRAM.hh"
+
+#include "EmuDuration.hh"
+#include "EmuTime.hh"
+
+#include "narrow.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+/** Helpers to execute the V9990 block commands (LMMV, LMMM, CMMM, BMXL and
+  * BMLX) a line at a time.
+  *
+  * These commands take a fixed amount of time per pixel (or per byte), so
+  * instead of checking the sync limit before every pixel, V9990CmdEngine
+  * first calculates how many pixels can be processed before the limit and
+  * then processes them line by line. Within a line the VRAM address is only
+  * calculated once per byte and the destination byte is only read and
+  * written once, even when it holds multiple pixels. The result (both the
+  * VRAM content and the timing) is identical to processing the pixels one by
+  * one.
+  *
+  * The 'Mode' template parameter is one of the V9990CmdEngine::V9990xxx
+  * classes (or something with the same interface).
+  */
+namespace openmsx::V9990CmdBulk {
+
+using LogOpLUT = std::span<const uint8_t, 256 * 256>;
+
+/** How many work units (pixels or bytes) does
+  *   while (time < limit) { time += delta; <work unit>; }
+  * execute? For zero delta (broken command timing) the result is unlimited,
+  * that's represented by the maximum unsigned value, which is more than any
+  * command can use.
+  */
+[[nodiscard]] inline unsigned numUnits(EmuTime time, EmuTime limit, EmuDuration delta)
+{
+	constexpr auto UNLIMITED = std::numeric_limits<unsigned>::max();
+	if (time >= limit) return 0;
+	if (delta == EmuDuration::zero()) return UNLIMITED;
+	auto d = delta.toUint64();
+	auto n = ((limit - time).toUint64() + d - 1) / d;
+	return unsigned(std::min<uint64_t>(n, UNLIMITED));
+}
+
+/** Process (part of) a block command. 'pixels' is the maximum number of
+  * pixels to process, on return it holds the unused part. For each (part of
+  * a) line 'doLine(unsigned num)' is called. At the end of each line
+  * 'nextLine()' is called and the line counter is decreased.
+  * @return true iff the command is finished.
+  */
+template<typename DoLine, typename NextLine>
+[[nodiscard]] bool processLines(uint16_t& anx, uint16_t& any, uint16_t nx,
+                                uint64_t& pixels, DoLine doLine, NextLine nextLine)
+{
+	while (pixels) {
+		auto num = unsigned(std::min<uint64_t>(anx, pixels));
+		doLine(num);
+		pixels -= num;
+		anx = uint16_t(anx - num);
+		if (anx == 0) {
+			nextLine();
+			if (--any == 0) return true;
+			anx = nx;
+		}
+	}
+	return false;
+}
+
+/** Read a pixel, like Mode::point(), but via 'uint8_t read(unsigned addr)'. */
+template<typename Mode, typename Read>
+[[nodiscard]] typename Mode::Type point(Read read, unsigned x, unsigned y, unsigned pitch)
+{
+	auto addr = Mode::addressOf(x, y, pitch);
+	if constexpr (Mode::BITS_PER_PIXEL == 16) {
+		return uint16_t(read(addr + 0x00000) + read(addr + 0x40000) * 256);
+	} else {
+		return read(addr);
+	}
+}
+
+/** The part of a 16-bit color that is used for the given VRAM address, like
+  * Mode::psetColor() does it.
+  */
+template<typename Mode>
+[[nodiscard]] typename Mode::Type selectColor(uint16_t color, unsigned addr)
+{
+	if constexpr (Mode::BITS_PER_PIXEL == 16) {
+		return color;
+	} else {
+		return uint8_t((addr & 0x40000) ? (color >> 8) : (color & 0xFF));
+	}
+}
+
+/** Draw 'num' pixels, starting at (x, y) in direction 'dx', like a sequence
+  * of Mode::pset() calls. On return 'x' points past the last pixel.
+  * The source pixels are produced by
+  *   'Mode::Type getSrc(unsigned x, unsigned addr, auto read)'
+  * which is called once per pixel, in drawing order. 'addr' is the VRAM
+  * address of the destination pixel and 'uint8_t read(unsigned addr)' must be
+  * used to read VRAM: the destination byte is only written back after all
+  * its pixels are drawn.
+  */
+template<typename Mode, typename GetSrc>
+void psetLine(std::span<uint8_t> vram, uint16_t& x, unsigned y, uint16_t dx,
+              unsigned num, unsigned pitch, uint16_t wm, LogOpLUT lut,
+              uint8_t op, GetSrc getSrc)
+{
+	if constexpr (Mode::BITS_PER_PIXEL == 16) {
+		auto read = [&](unsigned a) { return vram[a]; };
+		bool transp = (op & 0x10) != 0;
+		for (/**/; num; --num, x += dx) {
+			auto addr = Mode::addressOf(x, y, pitch);
+			uint16_t src = getSrc(x, addr, read);
+			auto dst = uint16_t(vram[addr + 0x00000] + vram[addr + 0x40000] * 256);
+			auto newColor = Mode::logOp(lut, src, dst, transp);
+			auto result = uint16_t((dst & ~wm) | (newColor & wm));
+			vram[addr + 0x00000] = uint8_t(result & 0xFF);
+			vram[addr + 0x40000] = uint8_t(result >> 8);
+		}
+	} else {
+		constexpr unsigned SHIFT = std::countr_zero(unsigned(Mode::PIXELS_PER_BYTE));
+		while (num) {
+			auto addr = Mode::addressOf(x, y, pitch);
+			auto mask1 = uint8_t((addr & 0x40000) ? (wm >> 8) : (wm & 0xFF));
+			uint8_t cur = vram[addr];
+			auto read = [&](unsigned a) { return (a == addr) ? cur : vram[a]; };
+			unsigned byte = x >> SHIFT;
+			do {
+				uint8_t src = getSrc(x, addr, read);
+				auto newColor = Mode::logOp(lut, src, cur);
+				uint8_t mask2 = mask1 & Mode::shiftMask(x);
+				cur = uint8_t((cur & ~mask2) | (newColor & mask2));
+				x += dx;
+				--num;
+			} while (num && ((unsigned(x) >> SHIFT) == byte));
+			vram[addr] = cur;
+		}
+	}
+}
+
+/** Like psetLine(), but with the same color for all pixels (LMMV).
+  * The logical operation is applied per bit (or per pixel, for the
+  * transparent variants). So when multiple pixels of a byte are drawn, this
+  * can be done with a single lookup for all of them.
+  */
+template<typename Mode>
+void fillLine(std::span<uint8_t> vram, uint16_t& x, unsigned y, uint16_t dx,
+              unsigned num, unsigned pitch, uint16_t color, uint16_t wm,
+              LogOpLUT lut, uint8_t op)
+{
+	if constexpr (Mode::BITS_PER_PIXEL == 16) {
+		psetLine<Mode>(vram, x, y, dx, num, pitch, wm, lut, op,
+			[&](unsigned, unsigned, auto) { return color; });
+	} else {
+		constexpr unsigned SHIFT = std::countr_zero(unsigned(Mode::PIXELS_PER_BYTE));
+		while (num) {
+			auto addr = Mode::addressOf(x, y, pitch);
+			auto mask1 = uint8_t((addr & 0x40000) ? (wm >> 8) : (wm & 0xFF));
+			unsigned byte = x >> SHIFT;
+			uint8_t mask2 = 0;
+			do {
+				mask2 |= Mode::shiftMask(x);
+				x += dx;
+				--num;
+			} while (num && ((unsigned(x) >> SHIFT) == byte));
+			mask2 &= mask1;
+			auto& v = vram[addr];
+			auto newColor = Mode::logOp(lut, selectColor<Mode>(color, addr), v);
+			v = uint8_t((v & ~mask2) | (newColor & mask2));
+		}
+	}
+}
+
+/** Read 'num' pixels, starting at (x, y) in direction 'dx', and pass them to
+  * 'put(unsigned x, Mode::Type pixel)' (BMLX). On return 'x' points past the
+  * last pixel. 'put' may write to VRAM.
+  */
+template<typename Mode, typename Put>
+void pointLine(std::span<const uint8_t> vram, uint16_t& x, unsigned y, uint16_t dx,
+               unsigned num, unsigned pitch, Put put)
+{
+	auto read = [&](unsigned a) { return vram[a]; };
+	for (/**/; num; --num, x += dx) {
+		put(x, point<Mode>(read, x, y, pitch));
+	}
+}
+
+/** The block commands that use the code above. They're templates on the
+  * command engine (normally V9990CmdEngine) so that the unit test can run
+  * exactly this code on a plain VRAM buffer. The time per pixel (or per
+  * byte) is passed in by the caller. See V9990CmdEngine for the other
+  * commands.
+  */
+struct BlockCommands
+{
+	template<typename Engine> static void startLMMV(Engine& e, EmuTime time);
+	template<typename Engine> static void startLMMM(Engine& e, EmuTime time);
+	template<typename Engine> static void startCMMM(Engine& e, EmuTime time);
+	template<typename Engine> static void startBMXL(Engine& e, EmuTime time);
+	template<typename Engine> static void startBMLX(Engine& e, EmuTime time);
+
+	template<typename Mode, typename Engine> static void executeLMMV(Engine& e, EmuTime limit, EmuDuration delta);
+	template<typename Mode, typename Engine> static void executeLMMM(Engine& e, EmuTime limit, EmuDuration delta);
+	template<typename Mode, typename Engine> static void executeCMMM(Engine& e, EmuTime limit, EmuDuration delta);
+	template<typename Mode, typename Engine> static void executeBMXL(Engine& e, EmuTime limit, EmuDuration delta);
+	template<typename Mode, typename Engine> static void executeBMLX(Engine& e, EmuTime limit, EmuDuration delta);
+};
+
+// LMMV
+template<typename Engine>
+void BlockCommands::startLMMV(Engine& e, EmuTime time)
+{
+	e.engineTime = time;
+	e.ANX = e.getWrappedNX();
+	e.ANY = e.getWrappedNY();
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::executeLMMV(Engine& e, EmuTime limit, EmuDuration delta)
+{
+	uint64_t pixels = numUnits(e.engineTime, limit, delta);
+	if (!pixels) return;
+
+	auto area = e.vram.getCmdArea();
+	unsigned pitch = Mode::getPitch(e.vdp.getImageWidth());
+	uint16_t dx = (e.ARG & V9990CmdEngine::DIX) ? uint16_t(-1) : 1;
+	uint16_t dy = (e.ARG & V9990CmdEngine::DIY) ? uint16_t(-1) : 1;
+	auto lut = Mode::getLogOpLUT(e.LOG);
+	auto budget = pixels;
+	bool done = processLines(e.ANX, e.ANY, e.getWrappedNX(), pixels,
+		[&](unsigned num) {
+			fillLine<Mode>(area, e.DX, e.DY, dx, num, pitch, e.fgCol, e.WM, lut, e.LOG);
+		},
+		[&] {
+			e.DX -= uint16_t(e.NX * dx);
+			e.DY += dy;
+		});
+	e.engineTime += delta * (budget - pixels);
+	if (done) e.cmdReady(e.engineTime);
+}
+
+// LMMM
+template<typename Engine>
+void BlockCommands::startLMMM(Engine& e, EmuTime time)
+{
+	e.engineTime = time;
+	e.ANX = e.getWrappedNX();
+	e.ANY = e.getWrappedNY();
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::executeLMMM(Engine& e, EmuTime limit, EmuDuration delta)
+{
+	uint64_t pixels = numUnits(e.engineTime, limit, delta);
+	if (!pixels) return;
+
+	auto area = e.vram.getCmdArea();
+	unsigned pitch = Mode::getPitch(e.vdp.getImageWidth());
+	uint16_t dx = (e.ARG & V9990CmdEngine::DIX) ? uint16_t(-1) : 1;
+	uint16_t dy = (e.ARG & V9990CmdEngine::DIY) ? uint16_t(-1) : 1;
+	auto lut = Mode::getLogOpLUT(e.LOG);
+	auto getSrc = [&](unsigned x, unsigned /*addr*/, auto read) {
+		auto src = point<Mode>(read, e.SX, e.SY, pitch);
+		src = Mode::shift(src, e.SX, x);
+		e.SX += dx;
+		return src;
+	};
+	auto budget = pixels;
+	bool done = processLines(e.ANX, e.ANY, e.getWrappedNX(), pixels,
+		[&](unsigned num) {
+			psetLine<Mode>(area, e.DX, e.DY, dx, num, pitch, e.WM, lut, e.LOG, getSrc);
+		},
+		[&] {
+			e.DX -= uint16_t(e.NX * dx);
+			e.SX -= uint16_t(e.NX * dx);
+			e.DY += dy;
+			e.SY += dy;
+		});
+	e.engineTime += delta * (budget - pixels);
+	if (done) e.cmdReady(e.engineTime);
+}
+
+// CMMM
+template<typename Engine>
+void BlockCommands::startCMMM(Engine& e, EmuTime time)
+{
+	e.engineTime = time;
+	e.srcAddress = (e.SX & 0xFF) + ((e.SY & 0x7FF) << 8);
+	e.ANX = e.getWrappedNX();
+	e.ANY = e.getWrappedNY();
+	e.bitsLeft = 0;
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::executeCMMM(Engine& e, EmuTime limit, EmuDuration delta)
+{
+	uint64_t pixels = numUnits(e.engineTime, limit, delta);
+	if (!pixels) return;
+
+	auto area = e.vram.getCmdArea();
+	unsigned pitch = Mode::getPitch(e.vdp.getImageWidth());
+	uint16_t dx = (e.ARG & V9990CmdEngine::DIX) ? uint16_t(-1) : 1;
+	uint16_t dy = (e.ARG & V9990CmdEngine::DIY) ? uint16_t(-1) : 1;
+	auto lut = Mode::getLogOpLUT(e.LOG);
+	auto getSrc = [&](unsigned /*x*/, unsigned addr, auto read) {
+		if (!e.bitsLeft) {
+			e.data = read(V9990VRAM::transformBx(e.srcAddress++));
+			e.bitsLeft = 8;
+		}
+		--e.bitsLeft;
+		bool bit = (e.data & 0x80) != 0;
+		e.data <<= 1;
+		return selectColor<Mode>(bit ? e.fgCol : e.bgCol, addr);
+	};
+	auto budget = pixels;
+	bool done = processLines(e.ANX, e.ANY, e.getWrappedNX(), pixels,
+		[&](unsigned num) {
+			psetLine<Mode>(area, e.DX, e.DY, dx, num, pitch, e.WM, lut, e.LOG, getSrc);
+		},
+		[&] {
+			e.DX -= uint16_t(e.NX * dx);
+			e.DY += dy;
+		});
+	e.engineTime += delta * (budget - pixels);
+	if (done) e.cmdReady(e.engineTime);
+}
+
+// BMXL
+template<typename Engine>
+void BlockCommands::startBMXL(Engine& e, EmuTime time)
+{
+	e.engineTime = time;
+	e.srcAddress = (e.SX & 0xFF) + ((e.SY & 0x7FF) << 8);
+	e.ANX = e.getWrappedNX();
+	e.ANY = e.getWrappedNY();
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::executeBMXL(Engine& e, EmuTime limit, EmuDuration delta)
+{
+	auto area = e.vram.getCmdArea();
+	unsigned pitch = Mode::getPitch(e.vdp.getImageWidth());
+	uint16_t dx = (e.ARG & V9990CmdEngine::DIX) ? uint16_t(-1) : 1;
+	uint16_t dy = (e.ARG & V9990CmdEngine::DIY) ? uint16_t(-1) : 1;
+	auto lut = Mode::getLogOpLUT(e.LOG);
+	auto nextLine = [&] {
+		e.DX -= uint16_t(e.NX * dx);
+		e.DY += dy;
+	};
+	if constexpr (Mode::BITS_PER_PIXEL == 16) {
+		// timing value is times 2, because it does 2 bytes per iteration:
+		delta *= 2u;
+		uint64_t pixels = numUnits(e.engineTime, limit, delta);
+		if (!pixels) return;
+
+		auto getSrc = [&](unsigned /*x*/, unsigned /*addr*/, auto read) {
+			auto src = uint16_t(read(V9990VRAM::transformBx(e.srcAddress + 0)) +
+			                    read(V9990VRAM::transformBx(e.srcAddress + 1)) * 256);
+			e.srcAddress += 2;
+			return src;
+		};
+		auto budget = pixels;
+		bool done = processLines(e.ANX, e.ANY, e.getWrappedNX(), pixels,
+			[&](unsigned num) {
+				psetLine<Mode>(area, e.DX, e.DY, dx, num, pitch, e.WM, lut, e.LOG, getSrc);
+			},
+			nextLine);
+		e.engineTime += delta * (budget - pixels);
+		if (done) e.cmdReady(e.engineTime);
+	} else {
+		// Timing is per (source) byte, a byte can span multiple lines.
+		unsigned bytes = numUnits(e.engineTime, limit, delta);
+		if (!bytes) return;
+
+		unsigned i = 0;
+		uint8_t d = 0;
+		auto getSrc = [&](unsigned x, unsigned /*addr*/, auto read) {
+			if (i == 0) d = read(V9990VRAM::transformBx(e.srcAddress++));
+			auto d2 = Mode::shift(d, i, x);
+			i = (i + 1) % Mode::PIXELS_PER_BYTE;
+			return d2;
+		};
+		uint64_t budget = uint64_t(bytes) * Mode::PIXELS_PER_BYTE;
+		uint64_t pixels = budget;
+		bool done = processLines(e.ANX, e.ANY, e.getWrappedNX(), pixels,
+			[&](unsigned num) {
+				psetLine<Mode>(area, e.DX, e.DY, dx, num, pitch, e.WM, lut, e.LOG, getSrc);
+			},
+			nextLine);
+		auto used = budget - pixels;
+		e.engineTime += delta * ((used + Mode::PIXELS_PER_BYTE - 1) / Mode::PIXELS_PER_BYTE);
+		if (done) e.cmdReady(e.engineTime);
+	}
+}
+
+// BMLX
+template<typename Engine>
+void BlockCommands::startBMLX(Engine& e, EmuTime time)
+{
+	e.engineTime = time;
+	e.dstAddress = (e.DX & 0xFF) + ((e.DY & 0x7FF) << 8);
+	e.ANX = e.getWrappedNX();
+	e.ANY = e.getWrappedNY();
+}
+
+template<typename Mode, typename Engine>
+void BlockCommands::executeBMLX(Engine& e, EmuTime limit, EmuDuration delta)
+{
+	// TODO test corner cases, timing
+	auto area = e.vram.getCmdArea();
+	unsigned pitch = Mode::getPitch(e.vdp.getImageWidth());
+	uint16_t dx = (e.ARG & V9990CmdEngine::DIX) ? uint16_t(-1) : 1;
+	uint16_t dy = (e.ARG & V9990CmdEngine::DIY) ? uint16_t(-1) : 1;
+	auto nextLine = [&] {
+		e.SX -= uint16_t(e.NX * dx);
+		e.SY += dy;
+	};
+	if constexpr (Mode::BITS_PER_PIXEL == 16) {
+		uint64_t pixels = numUnits(e.engineTime, limit, delta);
+		if (!pixels) return;
+
+		auto put = [&](unsigned /*x*/, uint16_t src) {
+			area[V9990VRAM::transformBx(e.dstAddress++)] = narrow_cast<uint8_t>(src & 0xFF);
+			area[V9990VRAM::transformBx(e.dstAddress++)] = narrow_cast<uint8_t>(src >> 8);
+		};
+		auto budget = pixels;
+		bool done = processLines(e.ANX, e.ANY, e.getWrappedNX(), pixels,
+			[&](unsigned num) {
+				pointLine<Mode>(area, e.SX, e.SY, dx, num, pitch, put);
+			},
+			nextLine);
+		e.engineTime += delta * (budget - pixels);
+		if (done) e.cmdReady(e.engineTime);
+	} else {
+		// Timing is per (destination) byte, a byte can span multiple lines.
+		unsigned bytes = numUnits(e.engineTime, limit, delta);
+		if (!bytes) return;
+
+		unsigned i = 0;
+		uint8_t d = 0;
+		auto put = [&](unsigned x, uint8_t src) {
+			d |= uint8_t(Mode::shift(src, x, i) & Mode::shiftMask(i));
+			if (++i == Mode::PIXELS_PER_BYTE) {
+				area[V9990VRAM::transformBx(e.dstAddress++)] = d;
+				d = 0;
+				i = 0;
+			}
+		};
+		uint64_t budget = uint64_t(bytes) * Mode::PIXELS_PER_BYTE;
+		uint64_t pixels = budget;
+		bool done = processLines(e.ANX, e.ANY, e.getWrappedNX(), pixels,
+			[&](unsigned num) {
+				pointLine<Mode>(area, e.SX, e.SY, dx, num, pitch, put);
+			},
+			nextLine);
+		auto used = budget - pixels;
+		e.engineTime += delta * ((used + Mode::PIXELS_PER_BYTE - 1) / Mode::PIXELS_PER_BYTE);
+		if (done) {
+			// write the last (partial) byte
+			if (i) area[V9990VRAM::transformBx(e.dstAddress++)] = d;
+			e.cmdReady(e.engineTime);
+		}
+	}
+}
+
+} // namespace openmsx::V9990CmdBulk
+
+#endif
@@ -1,6 +1,7 @@
 #include "V9990CmdEngine.hh"
 
 #include "V9990.hh"
+#include "V9990CmdBulk.hh"
 #include "V9990DisplayTiming.hh"
 #include "V9990VRAM.hh"
 
@@ -284,18 +285,13 @@ static constexpr void fillTable8(unsigned op, std::span<uint8_t, 256 * 256> tabl
 }
 
 
-static constexpr uint8_t DIY = 0x08;
-static constexpr uint8_t DIX = 0x04;
-static constexpr uint8_t NEQ = 0x02;
-static constexpr uint8_t MAJ = 0x01;
-
 // P1 --------------------------------------------------------------
-inline unsigned V9990CmdEngine::V9990P1::getPitch(unsigned width)
+unsigned V9990CmdEngine::V9990P1::getPitch(unsigned width)
 {
 	return width / 2;
 }
 
-inline unsigned V9990CmdEngine::V9990P1::addressOf(
+unsigned V9990CmdEngine::V9990P1::addressOf(
 	unsigned x, unsigned y, unsigned pitch)
 {
 	//return V9990VRAM::transformP1(((x / 2) & (pitch - 1)) + y * pitch) & 0x7FFFF;
@@ -304,36 +300,36 @@ inline unsigned V9990CmdEngine::V9990P1::addressOf(
 	return (addr & 0x3FFFF) | ((x & 0x200) << 9);
 }
 
-inline uint8_t V9990CmdEngine::V9990P1::point(
+uint8_t V9990CmdEngine::V9990P1::point(
 	const V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch)
 {
 	return vram.readVRAMDirect(addressOf(x, y, pitch));
 }
 
-inline uint8_t V9990CmdEngine::V9990P1::shift(
+uint8_t V9990CmdEngine::V9990P1::shift(
 	uint8_t value, unsigned fromX, unsigned toX)
 {
 	int shift = 4 * (narrow<int>(toX & 1) - narrow<int>(fromX & 1));
 	return (shift > 0) ? uint8_t(value >> shift) : uint8_t(value << -shift);
 }
 
-inline uint8_t V9990CmdEngine::V9990P1::shiftMask(unsigned x)
+uint8_t V9990CmdEngine::V9990P1::shiftMask(unsigned x)
 {
 	return (x & 1) ? 0x0F : 0xF0;
 }
 
-inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990P1::getLogOpLUT(uint8_t op)
+std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990P1::getLogOpLUT(uint8_t op)
 {
 	return getLogOpImpl((op & 0x10) ? Log::BPP4 : Log::NO_T, op);
 }
 
-inline uint8_t V9990CmdEngine::V9990P1::logOp(
+uint8_t V9990CmdEngine::V9990P1::logOp(
 	std::span<const uint8_t, 256 * 256> lut, uint8_t src, uint8_t dst)
 {
 	return lut[256 * dst + src];
 }
 
-inline void V9990CmdEngine::V9990P1::pset(
+void V9990CmdEngine::V9990P1::pset(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint8_t srcColor, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t /*op*/)
 {
@@ -345,7 +341,7 @@ inline void V9990CmdEngine::V9990P1::pset(
 	uint8_t result = (dstColor & ~mask2) | (newColor & mask2);
 	vram.writeVRAMDirect(addr, result);
 }
-inline void V9990CmdEngine::V9990P1::psetColor(
+void V9990CmdEngine::V9990P1::psetColor(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint16_t color, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t /*op*/)
 {
@@ -360,48 +356,48 @@ inline void V9990CmdEngine::V9990P1::psetColor(
 }
 
 // P2 --------------------------------------------------------------
-inline unsigned V9990CmdEngine::V9990P2::getPitch(unsigned width)
+unsigned V9990CmdEngine::V9990P2::getPitch(unsigned width)
 {
 	return width / 2;
 }
 
-inline unsigned V9990CmdEngine::V9990P2::addressOf(
+unsigned V9990CmdEngine::V9990P2::addressOf(
 	unsigned x, unsigned y, unsigned pitch)
 {
 	// TODO check
 	return V9990VRAM::transformP2(((x / 2) & (pitch - 1)) + y * pitch) & 0x7FFFF;
 }
 
-inline uint8_t V9990CmdEngine::V9990P2::point(
+uint8_t V9990CmdEngine::V9990P2::point(
 	const V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch)
 {
 	return vram.readVRAMDirect(addressOf(x, y, pitch));
 }
 
-inline uint8_t V9990CmdEngine::V9990P2::shift(
+uint8_t V9990CmdEngine::V9990P2::shift(
 	uint8_t value, unsigned fromX, unsigned toX)
 {
 	int shift = 4 * (narrow<int>(toX & 1) - narrow<int>(fromX & 1));
 	return (shift > 0) ? uint8_t(value >> shift) : uint8_t(value << -shift);
 }
 
-inline uint8_t V9990CmdEngine::V9990P2::shiftMask(unsigned x)
+uint8_t V9990CmdEngine::V9990P2::shiftMask(unsigned x)
 {
 	return (x & 1) ? 0x0F : 0xF0;
 }
 
-inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990P2::getLogOpLUT(uint8_t op)
+std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990P2::getLogOpLUT(uint8_t op)
 {
 	return getLogOpImpl((op & 0x10) ? Log::BPP4 : Log::NO_T, op);
 }
 
-inline uint8_t V9990CmdEngine::V9990P2::logOp(
+uint8_t V9990CmdEngine::V9990P2::logOp(
 	std::span<const uint8_t, 256 * 256> lut, uint8_t src, uint8_t dst)
 {
 	return lut[256 * dst + src];
 }
 
-inline void V9990CmdEngine::V9990P2::pset(
+void V9990CmdEngine::V9990P2::pset(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint8_t srcColor, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t /*op*/)
 {
@@ -414,7 +410,7 @@ inline void V9990CmdEngine::V9990P2::pset(
 	vram.writeVRAMDirect(addr, result);
 }
 
-inline void V9990CmdEngine::V9990P2::psetColor(
+void V9990CmdEngine::V9990P2::psetColor(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint16_t color, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t /*op*/)
 {
@@ -429,47 +425,47 @@ inline void V9990CmdEngine::V9990P2::psetColor(
 }
 
 // 2 bpp --------------------------------------------------------------
-inline unsigned V9990CmdEngine::V9990Bpp2::getPitch(unsigned width)
+unsigned V9990CmdEngine::V9990Bpp2::getPitch(unsigned width)
 {
 	return width / 4;
 }
 
-inline unsigned V9990CmdEngine::V9990Bpp2::addressOf(
+unsigned V9990CmdEngine::V9990Bpp2::addressOf(
 	unsigned x, unsigned y, unsigned pitch)
 {
 	return V9990VRAM::transformBx(((x / 4) & (pitch - 1)) + y * pitch) & 0x7FFFF;
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp2::point(
+uint8_t V9990CmdEngine::V9990Bpp2::point(
 	const V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch)
 {
 	return vram.readVRAMDirect(addressOf(x, y, pitch));
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp2::shift(
+uint8_t V9990CmdEngine::V9990Bpp2::shift(
 	uint8_t value, unsigned fromX, unsigned toX)
 {
 	int shift = 2 * (narrow<int>(toX & 3) - narrow<int>(fromX & 3));
 	return (shift > 0) ? uint8_t(value >> shift) : uint8_t(value << -shift);
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp2::shiftMask(unsigned x)
+uint8_t V9990CmdEngine::V9990Bpp2::shiftMask(unsigned x)
 {
 	return 0xC0 >> (2 * (x & 3));
 }
 
-inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp2::getLogOpLUT(uint8_t op)
+std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp2::getLogOpLUT(uint8_t op)
 {
 	return getLogOpImpl((op & 0x10) ? Log::BPP2 : Log::NO_T, op);
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp2::logOp(
+uint8_t V9990CmdEngine::V9990Bpp2::logOp(
 	std::span<const uint8_t, 256 * 256> lut, uint8_t src, uint8_t dst)
 {
 	return lut[256 * dst + src];
 }
 
-inline void V9990CmdEngine::V9990Bpp2::pset(
+void V9990CmdEngine::V9990Bpp2::pset(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint8_t srcColor, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t /*op*/)
 {
@@ -482,7 +478,7 @@ inline void V9990CmdEngine::V9990Bpp2::pset(
 	vram.writeVRAMDirect(addr, result);
 }
 
-inline void V9990CmdEngine::V9990Bpp2::psetColor(
+void V9990CmdEngine::V9990Bpp2::psetColor(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint16_t color, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t /*op*/)
 {
@@ -497,47 +493,47 @@ inline void V9990CmdEngine::V9990Bpp2::psetColor(
 }
 
 // 4 bpp --------------------------------------------------------------
-inline unsigned V9990CmdEngine::V9990Bpp4::getPitch(unsigned width)
+unsigned V9990CmdEngine::V9990Bpp4::getPitch(unsigned width)
 {
 	return width / 2;
 }
 
-inline unsigned V9990CmdEngine::V9990Bpp4::addressOf(
+unsigned V9990CmdEngine::V9990Bpp4::addressOf(
 	unsigned x, unsigned y, unsigned pitch)
 {
 	return V9990VRAM::transformBx(((x / 2) & (pitch - 1)) + y * pitch) & 0x7FFFF;
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp4::point(
+uint8_t V9990CmdEngine::V9990Bpp4::point(
 	const V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch)
 {
 	return vram.readVRAMDirect(addressOf(x, y, pitch));
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp4::shift(
+uint8_t V9990CmdEngine::V9990Bpp4::shift(
 	uint8_t value, unsigned fromX, unsigned toX)
 {
 	int shift = 4 * (narrow<int>(toX & 1) - narrow<int>(fromX & 1));
 	return (shift > 0) ? uint8_t(value >> shift) : uint8_t(value << -shift);
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp4::shiftMask(unsigned x)
+uint8_t V9990CmdEngine::V9990Bpp4::shiftMask(unsigned x)
 {
 	return (x & 1) ? 0x0F : 0xF0;
 }
 
-inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp4::getLogOpLUT(uint8_t op)
+std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp4::getLogOpLUT(uint8_t op)
 {
 	return getLogOpImpl((op & 0x10) ? Log::BPP4 : Log::NO_T, op);
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp4::logOp(
+uint8_t V9990CmdEngine::V9990Bpp4::logOp(
 	std::span<const uint8_t, 256 * 256> lut, uint8_t src, uint8_t dst)
 {
 	return lut[256 * dst + src];
 }
 
-inline void V9990CmdEngine::V9990Bpp4::pset(
+void V9990CmdEngine::V9990Bpp4::pset(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint8_t srcColor, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t /*op*/)
 {
@@ -550,7 +546,7 @@ inline void V9990CmdEngine::V9990Bpp4::pset(
 	vram.writeVRAMDirect(addr, result);
 }
 
-inline void V9990CmdEngine::V9990Bpp4::psetColor(
+void V9990CmdEngine::V9990Bpp4::psetColor(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint16_t color, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t /*op*/)
 {
@@ -565,46 +561,46 @@ inline void V9990CmdEngine::V9990Bpp4::psetColor(
 }
 
 // 8 bpp --------------------------------------------------------------
-inline unsigned V9990CmdEngine::V9990Bpp8::getPitch(unsigned width)
+unsigned V9990CmdEngine::V9990Bpp8::getPitch(unsigned width)
 {
 	return width;
 }
 
-inline unsigned V9990CmdEngine::V9990Bpp8::addressOf(
+unsigned V9990CmdEngine::V9990Bpp8::addressOf(
 	unsigned x, unsigned y, unsigned pitch)
 {
 	return V9990VRAM::transformBx((x & (pitch - 1)) + y * pitch) & 0x7FFFF;
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp8::point(
+uint8_t V9990CmdEngine::V9990Bpp8::point(
 	const V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch)
 {
 	return vram.readVRAMDirect(addressOf(x, y, pitch));
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp8::shift(
+uint8_t V9990CmdEngine::V9990Bpp8::shift(
 	uint8_t value, unsigned /*fromX*/, unsigned /*toX*/)
 {
 	return value;
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp8::shiftMask(unsigned /*x*/)
+uint8_t V9990CmdEngine::V9990Bpp8::shiftMask(unsigned /*x*/)
 {
 	return 0xFF;
 }
 
-inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp8::getLogOpLUT(uint8_t op)
+std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp8::getLogOpLUT(uint8_t op)
 {
 	return getLogOpImpl((op & 0x10) ? Log::BPP8 : Log::NO_T, op);
 }
 
-inline uint8_t V9990CmdEngine::V9990Bpp8::logOp(
+uint8_t V9990CmdEngine::V9990Bpp8::logOp(
 	std::span<const uint8_t, 256 * 256> lut, uint8_t src, uint8_t dst)
 {
 	return lut[256 * dst + src];
 }
 
-inline void V9990CmdEngine::V9990Bpp8::pset(
+void V9990CmdEngine::V9990Bpp8::pset(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint8_t srcColor, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t /*op*/)
 {
@@ -616,7 +612,7 @@ inline void V9990CmdEngine::V9990Bpp8::pset(
 	vram.writeVRAMDirect(addr, result);
 }
 
-inline void V9990CmdEngine::V9990Bpp8::psetColor(
+void V9990CmdEngine::V9990Bpp8::psetColor(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint16_t color, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t /*op*/)
 {
@@ -630,20 +626,20 @@ inline void V9990CmdEngine::V9990Bpp8::psetColor(
 }
 
 // 16 bpp -------------------------------------------------------------
-inline unsigned V9990CmdEngine::V9990Bpp16::getPitch(unsigned width)
+unsigned V9990CmdEngine::V9990Bpp16::getPitch(unsigned width)
 {
 	//return width * 2;
 	return width;
 }
 
-inline unsigned V9990CmdEngine::V9990Bpp16::addressOf(
+unsigned V9990CmdEngine::V9990Bpp16::addressOf(
 	unsigned x, unsigned y, unsigned pitch)
 {
 	//return V9990VRAM::transformBx(((x * 2) & (pitch - 1)) + y * pitch) & 0x7FFFF;
 	return ((x & (pitch - 1)) + y * pitch) & 0x3FFFF;
 }
 
-inline uint16_t V9990CmdEngine::V9990Bpp16::point(
+uint16_t V9990CmdEngine::V9990Bpp16::point(
 	const V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch)
 {
 	unsigned addr = addressOf(x, y, pitch);
@@ -651,23 +647,23 @@ inline uint16_t V9990CmdEngine::V9990Bpp16::point(
 	                vram.readVRAMDirect(addr + 0x40000) * 256);
 }
 
-inline uint16_t V9990CmdEngine::V9990Bpp16::shift(
+uint16_t V9990CmdEngine::V9990Bpp16::shift(
 	uint16_t value, unsigned /*fromX*/, unsigned /*toX*/)
 {
 	return value;
 }
 
-inline uint16_t V9990CmdEngine::V9990Bpp16::shiftMask(unsigned /*x*/)
+uint16_t V9990CmdEngine::V9990Bpp16::shiftMask(unsigned /*x*/)
 {
 	return 0xFFFF;
 }
 
-inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp16::getLogOpLUT(uint8_t op)
+std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp16::getLogOpLUT(uint8_t op)
 {
 	return getLogOpImpl(Log::NO_T, op);
 }
 
-inline uint16_t V9990CmdEngine::V9990Bpp16::logOp(
+uint16_t V9990CmdEngine::V9990Bpp16::logOp(
 	std::span<const uint8_t, 256 * 256> lut, uint16_t src, uint16_t dst, bool transp)
 {
 	if (transp && (src == 0)) return dst;
@@ -675,7 +671,7 @@ inline uint16_t V9990CmdEngine::V9990Bpp16::logOp(
 	                (lut[((dst & 0xFF00) << 0) + ((src & 0xFF00) >> 8)] << 8));
 }
 
-inline void V9990CmdEngine::V9990Bpp16::pset(
+void V9990CmdEngine::V9990Bpp16::pset(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint16_t srcColor, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t op)
 {
@@ -688,7 +684,7 @@ inline void V9990CmdEngine::V9990Bpp16::pset(
 	vram.writeVRAMDirect(addr + 0x40000, narrow_cast<uint8_t>(result >> 8));
 }
 
-inline void V9990CmdEngine::V9990Bpp16::psetColor(
+void V9990CmdEngine::V9990Bpp16::psetColor(
 	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 	uint16_t srcColor, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t op)
 {
@@ -1038,37 +1034,13 @@ void V9990CmdEngine::executeLMMC(EmuTime limit)
 // LMMV
 void V9990CmdEngine::startLMMV(EmuTime time)
 {
-	engineTime = time;
-	ANX = getWrappedNX();
-	ANY = getWrappedNY();
+	V9990CmdBulk::BlockCommands::startLMMV(*this, time);
 }
 
 template<typename Mode>
 void V9990CmdEngine::executeLMMV(EmuTime limit)
 {
-	// TODO can be optimized a lot
-
-	auto delta = getTiming(*this, LMMV_TIMING);
-	unsigned pitch = Mode::getPitch(vdp.getImageWidth());
-	uint16_t dx = (ARG & DIX) ? uint16_t(-1) : 1;
-	uint16_t dy = (ARG & DIY) ? uint16_t(-1) : 1;
-	auto lut = Mode::getLogOpLUT(LOG);
-	while (engineTime < limit) {
-		engineTime += delta;
-		Mode::psetColor(vram, DX, DY, pitch, fgCol, WM, lut, LOG);
-
-		DX += dx;
-		if (!--ANX) {
-			DX -= uint16_t(NX * dx);
-			DY += dy;
-			if (!--ANY) {
-				cmdReady(engineTime);
-				return;
-			} else {
-				ANX = getWrappedNX();
-			}
-		}
-	}
+	V9990CmdBulk::BlockCommands::executeLMMV<Mode>(*this, limit, getTiming(*this, LMMV_TIMING));
 }
 
 // LMCM
@@ -1131,42 +1103,13 @@ void V9990CmdEngine::executeLMCM(EmuTime /*limit*/)
 // LMMM
 void V9990CmdEngine::startLMMM(EmuTime time)
 {
-	engineTime = time;
-	ANX = getWrappedNX();
-	ANY = getWrappedNY();
+	V9990CmdBulk::BlockCommands::startLMMM(*this, time);
 }
 
 template<typename Mode>
 void V9990CmdEngine::executeLMMM(EmuTime limit)
 {
-	// TODO can be optimized a lot
-
-	auto delta = getTiming(*this, LMMM_TIMING);
-	unsigned pitch = Mode::getPitch(vdp.getImageWidth());
-	uint16_t dx = (ARG & DIX) ? uint16_t(-1) : 1;
-	uint16_t dy = (ARG & DIY) ? uint16_t(-1) : 1;
-	auto lut = Mode::getLogOpLUT(LOG);
-	while (engineTime < limit) {
-		engineTime += delta;
-		auto src = Mode::point(vram, SX, SY, pitch);
-		src = Mode::shift(src, SX, DX);
-		Mode::pset(vram, DX, DY, pitch, src, WM, lut, LOG);
-
-		DX += dx;
-		SX += dx;
-		if (!--ANX) {
-			DX -= uint16_t(NX * dx);
-			SX -= uint16_t(NX * dx);
-			DY += dy;
-			SY += dy;
-			if (!--ANY) {
-				cmdReady(engineTime);
-				return;
-			} else {
-				ANX = getWrappedNX();
-			}
-		}
-	}
+	V9990CmdBulk::BlockCommands::executeLMMM<Mode>(*this, limit, getTiming(*this, LMMM_TIMING));
 }
 
 // CMMC
@@ -1225,185 +1168,37 @@ void V9990CmdEngine::executeCMMK(EmuTime /*limit*/)
 // CMMM
 void V9990CmdEngine::startCMMM(EmuTime time)
 {
-	engineTime = time;
-	srcAddress = (SX & 0xFF) + ((SY & 0x7FF) << 8);
-	ANX = getWrappedNX();
-	ANY = getWrappedNY();
-	bitsLeft = 0;
+	V9990CmdBulk::BlockCommands::startCMMM(*this, time);
 }
 
 template<typename Mode>
 void V9990CmdEngine::executeCMMM(EmuTime limit)
 {
-	// TODO can be optimized a lot
-
-	auto delta = getTiming(*this, CMMM_TIMING);
-	unsigned pitch = Mode::getPitch(vdp.getImageWidth());
-	uint16_t dx = (ARG & DIX) ? uint16_t(-1) : 1;
-	uint16_t dy = (ARG & DIY) ? uint16_t(-1) : 1;
-	auto lut = Mode::getLogOpLUT(LOG);
-	while (engineTime < limit) {
-		engineTime += delta;
-		if (!bitsLeft) {
-			data = vram.readVRAMBx(srcAddress++);
-			bitsLeft = 8;
-		}
-		--bitsLeft;
-		bool bit = (data & 0x80) != 0;
-		data <<= 1;
-
-		uint16_t color = bit ? fgCol : bgCol;
-		Mode::psetColor(vram, DX, DY, pitch, color, WM, lut, LOG);
-
-		DX += dx;
-		if (!--ANX) {
-			DX -= uint16_t(NX * dx);
-			DY += dy;
-			if (!--ANY) {
-				cmdReady(engineTime);
-				return;
-			} else {
-				ANX = getWrappedNX();
-			}
-		}
-	}
+	V9990CmdBulk::BlockCommands::executeCMMM<Mode>(*this, limit, getTiming(*this, CMMM_TIMING));
 }
 
 // BMXL
 void V9990CmdEngine::startBMXL(EmuTime time)
 {
-	engineTime = time;
-	srcAddress = (SX & 0xFF) + ((SY & 0x7FF) << 8);
-	ANX = getWrappedNX();
-	ANY = getWrappedNY();
-}
-
-template<>
-void V9990CmdEngine::executeBMXL<V9990CmdEngine::V9990Bpp16>(EmuTime limit)
-{
-	// timing value is times 2, because it does 2 bytes per iteration:
-	auto delta = getTiming(*this, BMXL_TIMING) * 2;
-	unsigned pitch = V9990Bpp16::getPitch(vdp.getImageWidth());
-	uint16_t dx = (ARG & DIX) ? uint16_t(-1) : 1;
-	uint16_t dy = (ARG & DIY) ? uint16_t(-1) : 1;
-	auto lut = V9990Bpp16::getLogOpLUT(LOG);
-
-	while (engineTime < limit) {
-		engineTime += delta;
-		auto src = uint16_t(vram.readVRAMBx(srcAddress + 0) +
-		                    vram.readVRAMBx(srcAddress + 1) * 256);
-		srcAddress += 2;
-		V9990Bpp16::pset(vram, DX, DY, pitch, src, WM, lut, LOG);
-		DX += dx;
-		if (!--ANX) {
-			DX -= uint16_t(NX * dx);
-			DY += dy;
-			if (!--ANY) {
-				cmdReady(engineTime);
-				return;
-			} else {
-				ANX = getWrappedNX();
-			}
-		}
-	}
+	V9990CmdBulk::BlockCommands::startBMXL(*this, time);
 }
 
 template<typename Mode>
 void V9990CmdEngine::executeBMXL(EmuTime limit)
 {
-	auto delta = getTiming(*this, BMXL_TIMING);
-	unsigned pitch = Mode::getPitch(vdp.getImageWidth());
-	uint16_t dx = (ARG & DIX) ? uint16_t(-1) : 1;
-	uint16_t dy = (ARG & DIY) ? uint16_t(-1) : 1;
-	auto lut = Mode::getLogOpLUT(LOG);
-
-	while (engineTime < limit) {
-		engineTime += delta;
-		uint8_t d = vram.readVRAMBx(srcAddress++);
-		for (int i = 0; (ANY > 0) && (i < Mode::PIXELS_PER_BYTE); ++i) {
-			auto d2 = Mode::shift(d, i, DX);
-			Mode::pset(vram, DX, DY, pitch, d2, WM, lut, LOG);
-			DX += dx;
-			if (!--ANX) {
-				DX -= uint16_t(NX * dx);
-				DY += dy;
-				if (!--ANY) {
-					cmdReady(engineTime);
-					return;
-				} else {
-					ANX = getWrappedNX();
-				}
-			}
-		}
-	}
+	V9990CmdBulk::BlockCommands::executeBMXL<Mode>(*this, limit, getTiming(*this, BMXL_TIMING));
 }
 
 // BMLX
 void V9990CmdEngine::startBMLX(EmuTime time)
 {
-	engineTime = time;
-	dstAddress = (DX & 0xFF) + ((DY & 0x7FF) << 8);
-	ANX = getWrappedNX();
-	ANY = getWrappedNY();
+	V9990CmdBulk::BlockCommands::startBMLX(*this, time);
 }
 
-template<>
-void V9990CmdEngine::executeBMLX<V9990CmdEngine::V9990Bpp16>(EmuTime limit)
-{
-	// TODO test corner cases, timing
-	auto delta = getTiming(*this, BMLX_TIMING);
-	unsigned pitch = V9990Bpp16::getPitch(vdp.getImageWidth());
-	uint16_t dx = (ARG & DIX) ? uint16_t(-1) : 1;
-	uint16_t dy = (ARG & DIY) ? uint16_t(-1) : 1;
-
-	while (engineTime < limit) {
-		engineTime += delta;
-		auto src = V9990Bpp16::point(vram, SX, SY, pitch);
-		vram.writeVRAMBx(dstAddress++, narrow_cast<uint8_t>(src & 0xFF));
-		vram.writeVRAMBx(dstAddress++, narrow_cast<uint8_t>(src >> 8));
-		SX += dx;
-		if (!--ANX) {
-			SX -= uint16_t(NX * dx);
-			SY += dy;
-			if (!--ANY) {
-				cmdReady(engineTime);
-				return;
-			} else {
-				ANX = getWrappedNX();
-			}
-		}
-	}
-}
 template<typename Mode>
 void V9990CmdEngine::executeBMLX(EmuTime limit)
 {
-	// TODO test corner cases, timing
-	auto delta = getTiming(*this, BMLX_TIMING);
-	unsigned pitch = Mode::getPitch(vdp.getImageWidth());
-	uint16_t dx = (ARG & DIX) ? uint16_t(-1) : 1;
-	uint16_t dy = (ARG & DIY) ? uint16_t(-1) : 1;
-
-	while (engineTime < limit) {
-		engineTime += delta;
-		uint8_t d = 0;
-		for (auto i : xrange(Mode::PIXELS_PER_BYTE)) {
-			auto src = Mode::point(vram, SX, SY, pitch);
-			d |= uint8_t(Mode::shift(src, SX, i) & Mode::shiftMask(i));
-			SX += dx;
-			if (!--ANX) {
-				SX -= uint16_t(NX * dx);
-				SY += dy;
-				if (!--ANY) {
-					vram.writeVRAMBx(dstAddress++, d);
-					cmdReady(engineTime);
-					return;
-				} else {
-					ANX = getWrappedNX();
-				}
-			}
-		}
-		vram.writeVRAMBx(dstAddress++, d);
-	}
+	V9990CmdBulk::BlockCommands::executeBMLX<Mode>(*this, limit, getTiming(*this, BMLX_TIMING));
 }
 
 // BMLL
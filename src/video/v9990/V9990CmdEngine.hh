@@ -15,6 +15,7 @@ class V9990VRAM;
 class Setting;
 class RenderSettings;
 class BooleanSetting;
+namespace V9990CmdBulk { struct BlockCommands; }
 
 /** Command engine.
   */
@@ -26,6 +27,12 @@ public:
 	static constexpr uint8_t BD = 0x10;
 	static constexpr uint8_t CE = 0x01;
 
+	// bits in ARG register
+	static constexpr uint8_t DIY = 0x08;
+	static constexpr uint8_t DIX = 0x04;
+	static constexpr uint8_t NEQ = 0x02;
+	static constexpr uint8_t MAJ = 0x01;
+
 	V9990CmdEngine(V9990& vdp, EmuTime time,
 	               RenderSettings& settings);
 	~V9990CmdEngine();
@@ -95,7 +102,7 @@ public:
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
-private:
+	// The color modes, used as 'Mode' template parameter.
 	class V9990P1 {
 	public:
 		using Type = uint8_t;
@@ -222,6 +229,10 @@ private:
 			uint16_t color, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t op);
 	};
 
+private:
+	// executes (part of) the block commands, see V9990CmdBulk.hh
+	friend struct V9990CmdBulk::BlockCommands;
+
 	void startSTOP  (EmuTime time);
 	void startLMMC  (EmuTime time);
 	void startLMMC16(EmuTime time);
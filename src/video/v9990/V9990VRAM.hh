@@ -7,6 +7,7 @@
 #include "TrackedRam.hh"
 
 #include <cstdint>
+#include <span>
 
 namespace openmsx {
 
@@ -80,6 +81,14 @@ public:
 		data.write(address, value);
 	}
 
+	/** Direct access to the whole VRAM, for the command engine. This
+	  * marks the VRAM as modified, so only call it when the command
+	  * engine is actually going to write.
+	  */
+	[[nodiscard]] std::span<uint8_t> getCmdArea() {
+		return data.getWriteBackdoor();
+	}
+
 	[[nodiscard]] uint8_t readVRAMCPU(unsigned address, EmuTime time);
 	void writeVRAMCPU(unsigned address, uint8_t val, EmuTime time);
 
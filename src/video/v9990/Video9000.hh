@@ -40,7 +40,8 @@ private:
 
 	// VideoLayer
 	void paint(OutputSurface& output) override;
-	void takeRawScreenShot(std::optional<unsigned> height, const std::string& filename) override;
+	void takeRawScreenShot(std::optional<unsigned> height, const std::string& filename,
+	                       bool async) override;
 
 	// EventListener
 	bool signalEvent(const Event& event) override;